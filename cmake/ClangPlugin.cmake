@@ -0,0 +1,28 @@
+# Add a Clang plugin (i.e., a shared library that is loaded into the
+# compiler with -fplugin=).  This must be used after the ClangFoo and CAL
+# packages have been found.
+#
+# The plugin is not linked with the LLVM/Clang libraries, since it uses
+# the copies of these libraries that are already loaded into the compiler
+# (and linking a second copy breaks the plugin registry).  For the same
+# reason, only header-only CAL code can be used by a plugin.  Sanitizers
+# are disabled for the plugin, since the compiler that loads it is not
+# built with them.
+function(add_clang_plugin target)
+	add_library(${target} MODULE ${ARGN})
+	set_target_properties(${target} PROPERTIES PREFIX "")
+	target_include_directories(${target} PRIVATE
+	  ${CLANG_INCLUDE_DIRS} ${LLVM_INCLUDE_DIRS} ${CAL_INCLUDE_DIRS})
+	separate_arguments(llvm_definitions UNIX_COMMAND "${LLVM_DEFINITIONS}")
+	target_compile_definitions(${target} PRIVATE ${llvm_definitions})
+	if(ClangFoo_PROPAGATE_ENABLE_RTTI AND NOT LLVM_ENABLE_RTTI)
+		target_compile_options(${target} PRIVATE -fno-rtti)
+	endif()
+	target_compile_options(${target} PRIVATE -fno-sanitize=all)
+	target_link_options(${target} PRIVATE -fno-sanitize=all)
+endfunction()
+
+# The compiler that can load the plugins (i.e., the one that goes with the
+# LLVM/Clang libraries that were found), for use by the demo scripts.
+find_program(CLANG_PLUGIN_HOST_PROGRAM clang++
+  HINTS "${LLVM_TOOLS_BINARY_DIR}" NO_DEFAULT_PATH)
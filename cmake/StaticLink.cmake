@@ -0,0 +1,42 @@
+# Options for building the tools for fast startup.  This must be included
+# before the ClangFoo package is found.
+#
+# ENABLE_STATIC_LINK links the LLVM/Clang component libraries (and the C++
+# standard library) statically, which avoids loading libLLVM and
+# libclang-cpp and resolving their (very many) symbols when each tool
+# starts.  This requires an LLVM/Clang installation that provides the
+# static component libraries.
+#
+# ENABLE_LTO enables link-time optimization (for the code that is not
+# already compiled, since the LLVM/Clang libraries are generally not built
+# with it).  Combined with static linking, this also lets the linker drop
+# the unused parts of the libraries.
+
+option(ENABLE_STATIC_LINK "Link the LLVM/Clang libraries statically" OFF)
+option(ENABLE_LTO "Enable link-time optimization" OFF)
+
+if(ENABLE_STATIC_LINK)
+	message("Enabling static linking of LLVM/Clang")
+	set(ClangFoo_USE_LLVM_COMPONENTS TRUE)
+	set(ClangFoo_USE_CLANGCPP_COMPONENTS TRUE)
+	if(CMAKE_CXX_COMPILER_ID STREQUAL "Clang" OR
+	  CMAKE_CXX_COMPILER_ID STREQUAL GNU)
+		set(CMAKE_CXX_FLAGS
+		  "${CMAKE_CXX_FLAGS} -ffunction-sections -fdata-sections")
+		set(CMAKE_EXE_LINKER_FLAGS
+		  "${CMAKE_EXE_LINKER_FLAGS} -static-libstdc++ -static-libgcc")
+		set(CMAKE_EXE_LINKER_FLAGS
+		  "${CMAKE_EXE_LINKER_FLAGS} -Wl,--gc-sections")
+	endif()
+endif()
+
+if(ENABLE_LTO)
+	include(CheckIPOSupported)
+	check_ipo_supported(RESULT HAVE_IPO OUTPUT ipo_output LANGUAGES CXX)
+	if(HAVE_IPO)
+		message("Enabling link-time optimization")
+		set(CMAKE_INTERPROCEDURAL_OPTIMIZATION TRUE)
+	else()
+		message(WARNING "link-time optimization not supported: ${ipo_output}")
+	endif()
+endif()
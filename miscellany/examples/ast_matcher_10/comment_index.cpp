@@ -0,0 +1,402 @@
+#include <algorithm>
+#include <format>
+#include <optional>
+#include <vector>
+#include <llvm/ADT/STLExtras.h>
+#include <llvm/ADT/SmallVector.h>
+#include <clang/AST/DeclCXX.h>
+#include <clang/AST/DeclObjC.h>
+#include <clang/AST/DeclTemplate.h>
+#include <clang/AST/RawCommentList.h>
+#include <clang/AST/RecursiveASTVisitor.h>
+
+#include "comment_index.hpp"
+
+// Get the declaration whose comment is used for a declaration (which is
+// the template for a templated declaration or an implicit instantiation,
+// and the member of the class template for an instantiated member).  This
+// is the same as adjustDeclToTemplate in ASTContext.cpp.
+static const clang::Decl& adjustDeclToTemplate(const clang::Decl& decl) {
+	if (auto function = llvm::dyn_cast<clang::FunctionDecl>(&decl)) {
+		if (auto functionTemplate = function->getDescribedFunctionTemplate()) {
+			return *functionTemplate;
+		}
+		if (function->getTemplateSpecializationKind() !=
+		  clang::TSK_ImplicitInstantiation) {
+			return decl;
+		}
+		if (auto functionTemplate = function->getPrimaryTemplate()) {
+			return *functionTemplate;
+		}
+		if (auto member = function->getInstantiatedFromMemberFunction()) {
+			return *member;
+		}
+		return decl;
+	}
+	if (auto var = llvm::dyn_cast<clang::VarDecl>(&decl)) {
+		if (var->isStaticDataMember()) {
+			if (auto member = var->getInstantiatedFromStaticDataMember()) {
+				return *member;
+			}
+		}
+		return decl;
+	}
+	if (auto record = llvm::dyn_cast<clang::CXXRecordDecl>(&decl)) {
+		if (auto classTemplate = record->getDescribedClassTemplate()) {
+			return *classTemplate;
+		}
+		if (auto specialization =
+		  llvm::dyn_cast<clang::ClassTemplateSpecializationDecl>(record)) {
+			if (specialization->getSpecializationKind() !=
+			  clang::TSK_ImplicitInstantiation) {
+				return decl;
+			}
+			auto from = specialization->getSpecializedTemplateOrPartial();
+			if (auto partial = llvm::dyn_cast<
+			  clang::ClassTemplatePartialSpecializationDecl*>(from)) {
+				return *partial;
+			}
+			return *llvm::cast<clang::ClassTemplateDecl*>(from);
+		}
+		if (auto info = record->getMemberSpecializationInfo()) {
+			return *info->getInstantiatedFrom();
+		}
+		return decl;
+	}
+	if (auto enumDecl = llvm::dyn_cast<clang::EnumDecl>(&decl)) {
+		if (auto member = enumDecl->getInstantiatedFromMemberEnum()) {
+			return *member;
+		}
+		return decl;
+	}
+	return decl;
+}
+
+// Get the location at which a comment attached to a declaration is
+// searched for (as in getDeclLocsForCommentSearch in ASTContext.cpp).  The
+// location is invalid if no comment can be attached to the declaration,
+// and nothing is returned if the name of the declaration is in a macro
+// expansion (for which the search is not mirrored here).
+static std::optional<clang::SourceLocation> getCommentSearchLoc(
+  const clang::Decl& decl) {
+	// No comment is attached to an implicit declaration, an implicit
+	// instantiation, a parameter, or a tag declared in a declarator.
+	if (decl.isImplicit()) {
+		return clang::SourceLocation();
+	}
+	if (auto function = llvm::dyn_cast<clang::FunctionDecl>(&decl)) {
+		if (function->getTemplateSpecializationKind() ==
+		  clang::TSK_ImplicitInstantiation) {
+			return clang::SourceLocation();
+		}
+	}
+	if (auto var = llvm::dyn_cast<clang::VarDecl>(&decl)) {
+		if (var->isStaticDataMember() && var->getTemplateSpecializationKind() ==
+		  clang::TSK_ImplicitInstantiation) {
+			return clang::SourceLocation();
+		}
+	}
+	if (auto record = llvm::dyn_cast<clang::CXXRecordDecl>(&decl)) {
+		if (record->getTemplateSpecializationKind() ==
+		  clang::TSK_ImplicitInstantiation) {
+			return clang::SourceLocation();
+		}
+	}
+	if (auto specialization =
+	  llvm::dyn_cast<clang::ClassTemplateSpecializationDecl>(&decl)) {
+		auto kind = specialization->getSpecializationKind();
+		if (kind == clang::TSK_ImplicitInstantiation ||
+		  kind == clang::TSK_Undeclared) {
+			return clang::SourceLocation();
+		}
+	}
+	if (auto enumDecl = llvm::dyn_cast<clang::EnumDecl>(&decl)) {
+		if (enumDecl->getTemplateSpecializationKind() ==
+		  clang::TSK_ImplicitInstantiation) {
+			return clang::SourceLocation();
+		}
+	}
+	if (auto tag = llvm::dyn_cast<clang::TagDecl>(&decl)) {
+		if (tag->isEmbeddedInDeclarator() && !tag->isCompleteDefinition()) {
+			return clang::SourceLocation();
+		}
+	}
+	if (llvm::isa<clang::ParmVarDecl, clang::TemplateTypeParmDecl,
+	  clang::NonTypeTemplateParmDecl, clang::TemplateTemplateParmDecl>(
+	  decl)) {
+		return clang::SourceLocation();
+	}
+	if (decl.getLocation().isMacroID()) {
+		return std::nullopt;
+	}
+	// The comment of a template or typedef (e.g., "typedef struct {...} S")
+	// precedes the start of the declaration, while for other declarations
+	// (which may have several declarators) the name is used.
+	if (llvm::isa<clang::ObjCMethodDecl, clang::ObjCContainerDecl,
+	  clang::ObjCPropertyDecl, clang::RedeclarableTemplateDecl,
+	  clang::ClassTemplateSpecializationDecl, clang::TypedefDecl>(decl)) {
+		return decl.getBeginLoc();
+	}
+	return decl.getLocation();
+}
+
+namespace {
+
+// A declaration to be matched with the comments of its file.
+struct IndexEntry {
+	unsigned offset;
+	const clang::Decl* decl;
+	// Whether a trailing comment can be attached to the declaration.
+	bool trailing;
+};
+
+class EntryCollector : public clang::RecursiveASTVisitor<EntryCollector> {
+public:
+	EntryCollector(const clang::SourceManager& sourceManager) :
+	  sourceManager_(sourceManager) {}
+	bool shouldVisitTemplateInstantiations() const {return true;}
+	bool shouldVisitImplicitCode() const {return true;}
+	bool VisitDecl(clang::Decl* decl) {
+		auto loc = getCommentSearchLoc(*decl);
+		if (!loc || !loc->isFileID()) {
+			return true;
+		}
+		auto [fileId, offset] = sourceManager_.getDecomposedLoc(*loc);
+		if (fileId.isInvalid()) {
+			return true;
+		}
+		entries_[fileId].push_back({offset, decl, llvm::isa<clang::FieldDecl,
+		  clang::EnumConstantDecl, clang::VarDecl, clang::ObjCMethodDecl,
+		  clang::ObjCPropertyDecl>(decl)});
+		return true;
+	}
+	llvm::DenseMap<clang::FileID, std::vector<IndexEntry>>& getEntries() {
+		return entries_;
+	}
+private:
+	const clang::SourceManager& sourceManager_;
+	llvm::DenseMap<clang::FileID, std::vector<IndexEntry>> entries_;
+};
+
+}
+
+void CommentIndex::reset() {
+	astContext_ = nullptr;
+	attached_.clear();
+	results_.clear();
+}
+
+void CommentIndex::build(clang::ASTContext& astContext) {
+	auto startTime = std::chrono::steady_clock::now();
+	reset();
+	astContext_ = &astContext;
+	const clang::SourceManager& sourceManager = astContext.getSourceManager();
+	EntryCollector collector(sourceManager);
+	collector.TraverseAST(astContext);
+	auto& entries = collector.getEntries();
+
+	// The comments of an AST file are only read when a comment is first
+	// looked up.
+	if (astContext.getExternalSource() && !entries.empty()) {
+		astContext.getRawCommentForAnyRedecl(
+		  entries.begin()->second.front().decl);
+	}
+	clang::RawCommentList& comments = astContext.getRawCommentList();
+	bool parseAllComments =
+	  astContext.getLangOpts().CommentOpts.ParseAllComments;
+
+	for (auto& [fileId, fileEntries] : entries) {
+		numIndexed_ += fileEntries.size();
+		auto fileComments = comments.getCommentsInFile(fileId);
+		bool invalid = false;
+		llvm::StringRef buffer = sourceManager.getBufferData(fileId, &invalid);
+		if (!fileComments || fileComments->empty() || invalid) {
+			for (const IndexEntry& entry : fileEntries) {
+				attached_[entry.decl] = false;
+			}
+			continue;
+		}
+		numComments_ += fileComments->size();
+		std::vector<std::pair<unsigned, clang::RawComment*>> sortedComments(
+		  fileComments->begin(), fileComments->end());
+		// For each comment, the offset of the first character after it that
+		// separates it from a following declaration (i.e., the end of a
+		// declaration or a preprocessor directive), which is only found
+		// when needed.
+		std::vector<std::optional<std::size_t>> separators(
+		  sortedComments.size());
+		auto getSeparator = [&](std::size_t i) {
+			if (!separators[i]) {
+				// A declaration after the next comment is matched with that
+				// comment instead, so the search stops there.
+				std::size_t end = std::min<std::size_t>(buffer.size(),
+				  i + 1 < sortedComments.size() ? sortedComments[i + 1].first :
+				  buffer.size());
+				std::size_t begin = std::min<std::size_t>(end,
+				  comments.getCommentEndOffset(sortedComments[i].second));
+				std::size_t found =
+				  buffer.slice(begin, end).find_first_of(";{}#@");
+				separators[i] = found == llvm::StringRef::npos ? end :
+				  begin + found;
+			}
+			return *separators[i];
+		};
+
+		std::stable_sort(fileEntries.begin(), fileEntries.end(),
+		  [](const IndexEntry& a, const IndexEntry& b) {
+			return a.offset < b.offset;
+		});
+		// The next comment that starts at or after the declaration.
+		std::size_t next = 0;
+		for (const IndexEntry& entry : fileEntries) {
+			while (next < sortedComments.size() &&
+			  sortedComments[next].first < entry.offset) {
+				++next;
+			}
+			bool attached = false;
+			if (entry.trailing && next < sortedComments.size()) {
+				auto [offset, comment] = sortedComments[next];
+				attached = (comment->isDocumentation() || parseAllComments) &&
+				  comment->isTrailingComment() &&
+				  sourceManager.getLineNumber(fileId, entry.offset) ==
+				  comments.getCommentBeginLine(comment, fileId, offset);
+			}
+			if (!attached && next > 0) {
+				clang::RawComment* comment = sortedComments[next - 1].second;
+				attached = (comment->isDocumentation() || parseAllComments) &&
+				  !comment->isTrailingComment() &&
+				  getSeparator(next - 1) >= entry.offset;
+			}
+			attached_[entry.decl] = attached;
+		}
+	}
+	buildTime_ += std::chrono::steady_clock::now() - startTime;
+}
+
+CommentIndex::Attachment CommentIndex::getAttachment(const clang::Decl& decl)
+  const {
+	auto loc = getCommentSearchLoc(decl);
+	if (!loc) {
+		return Attachment::unknown;
+	}
+	if (loc->isInvalid() || !loc->isFileID()) {
+		return Attachment::none;
+	}
+	auto iter = attached_.find(&decl);
+	if (iter == attached_.end()) {
+		return Attachment::unknown;
+	}
+	return iter->second ? Attachment::attached : Attachment::none;
+}
+
+bool CommentIndex::fallback(clang::ASTContext& astContext,
+  const clang::Decl& decl) {
+	++numFallbacks_;
+	return astContext.getCommentForDecl(&decl, nullptr);
+}
+
+bool CommentIndex::lookup(clang::ASTContext& astContext,
+  const clang::Decl& decl) {
+	if (decl.isInvalidDecl()) {
+		return false;
+	}
+	if (auto iter = results_.find(&decl); iter != results_.end()) {
+		return iter->second;
+	}
+	// A (malformed) cycle of base classes is broken by the entry for the
+	// declaration being queried.
+	results_[&decl] = false;
+	bool result = lookupUncached(astContext, decl);
+	results_[&decl] = result;
+	return result;
+}
+
+bool CommentIndex::lookupUncached(clang::ASTContext& astContext,
+  const clang::Decl& node) {
+	// This follows ASTContext::getCommentForDecl.
+	const clang::Decl& decl = adjustDeclToTemplate(node);
+	if (llvm::isa<clang::ObjCMethodDecl, clang::ObjCContainerDecl,
+	  clang::ObjCPropertyDecl>(decl)) {
+		return fallback(astContext, node);
+	}
+	bool unknown = false;
+	for (const clang::Decl* redecl : decl.redecls()) {
+		switch (getAttachment(*redecl)) {
+		case Attachment::attached:
+			return true;
+		case Attachment::unknown:
+			unknown = true;
+			break;
+		case Attachment::none:
+			break;
+		}
+	}
+	if (unknown) {
+		return fallback(astContext, node);
+	}
+
+	// Look for an inherited comment.
+	if (llvm::isa<clang::FunctionDecl>(decl)) {
+		llvm::SmallVector<const clang::NamedDecl*, 8> overridden;
+		astContext.getOverriddenMethods(llvm::cast<clang::NamedDecl>(&decl),
+		  overridden);
+		return llvm::any_of(overridden, [&](const clang::NamedDecl* method) {
+			return lookup(astContext, *method);
+		});
+	}
+	if (auto typedefName = llvm::dyn_cast<clang::TypedefNameDecl>(&decl)) {
+		auto tagType =
+		  typedefName->getUnderlyingType()->getAs<clang::TagType>();
+		return tagType && tagType->getDecl() &&
+		  lookup(astContext, *tagType->getDecl());
+	}
+	if (auto record = llvm::dyn_cast<clang::CXXRecordDecl>(&decl)) {
+		if (!(record = record->getDefinition())) {
+			return false;
+		}
+		auto baseHasComment = [&](const clang::CXXBaseSpecifier& base) {
+			if (base.getAccessSpecifier() != clang::AS_public ||
+			  base.getType().isNull()) {
+				return false;
+			}
+			auto baseRecord = base.getType()->getAsCXXRecordDecl();
+			return baseRecord && (baseRecord = baseRecord->getDefinition()) &&
+			  lookup(astContext, *baseRecord);
+		};
+		for (const clang::CXXBaseSpecifier& base : record->bases()) {
+			if (!base.isVirtual() && baseHasComment(base)) {
+				return true;
+			}
+		}
+		return llvm::any_of(record->vbases(), baseHasComment);
+	}
+	return false;
+}
+
+bool CommentIndex::hasComment(clang::ASTContext& astContext,
+  const clang::Decl& decl) {
+	if (astContext_ != &astContext) {
+		build(astContext);
+	}
+	++numQueries_;
+	bool result = lookup(astContext, decl);
+	if (verify_ && result != static_cast<bool>(
+	  astContext.getCommentForDecl(&decl, nullptr))) {
+		++numMismatches_;
+		llvm::errs() << std::format("comment index mismatch: {} at {} "
+		  "({} comment)\n", decl.getDeclKindName(),
+		  decl.getLocation().printToString(astContext.getSourceManager()),
+		  result ? "unexpected" : "missing");
+	}
+	return result;
+}
+
+void CommentIndex::printStats(llvm::raw_ostream& out) const {
+	out << std::format("comment index: {} queries ({} passed on to "
+	  "getCommentForDecl), {} declarations and {} comments indexed in "
+	  "{:.3f} s\n", numQueries_, numFallbacks_, numIndexed_, numComments_,
+	  buildTime_.count());
+	if (verify_) {
+		out << std::format("comment index mismatches: {}\n", numMismatches_);
+	}
+}
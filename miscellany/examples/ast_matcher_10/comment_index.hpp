@@ -0,0 +1,67 @@
+#pragma once
+
+#include <chrono>
+#include <llvm/ADT/DenseMap.h>
+#include <llvm/Support/raw_ostream.h>
+#include <clang/AST/ASTContext.h>
+#include <clang/AST/DeclBase.h>
+
+// An index of the declarations in a translation unit that have a
+// documentation comment.  A query answers whether
+// ASTContext::getCommentForDecl would return a comment for a declaration,
+// but without parsing any comment, and (once the index is built) without
+// searching the comments of the file.
+//
+// The index is built on the first query for a translation unit.  The
+// declarations are collected with the location at which Clang searches for
+// their comments, sorted by offset in each file, and merged with the raw
+// comments of the file (which are already sorted), so that each comment is
+// matched with the declarations it is attached to in a single pass.  The
+// rules for attaching a comment are those of ASTContext.cpp (i.e., a
+// trailing comment starting on the line of a field, variable, or
+// enumerator, or a preceding comment with no declaration or preprocessor
+// directive in between), and a comment inherited from an overridden
+// method, a base class, or the tag type of a typedef is found by querying
+// the index for the declaration from which it is inherited.  The queries
+// for which the search in Clang depends on details that are not mirrored
+// here (i.e., declarations whose names are in macro expansions, and
+// Objective-C declarations) are passed on to getCommentForDecl.
+class CommentIndex {
+public:
+	// Discard the index (which must be done at the start of each
+	// translation unit, since an ASTContext may be allocated at the address
+	// of a previous one).
+	void reset();
+
+	// Test if a declaration has a comment (building the index first if
+	// needed).
+	bool hasComment(clang::ASTContext& astContext, const clang::Decl& decl);
+
+	// Check each query against getCommentForDecl, and print any mismatch.
+	void setVerify(bool verify) {verify_ = verify;}
+
+	// Print the number of queries, and the time taken to build the index.
+	void printStats(llvm::raw_ostream& out) const;
+
+private:
+	enum class Attachment {none, attached, unknown};
+	void build(clang::ASTContext& astContext);
+	bool lookup(clang::ASTContext& astContext, const clang::Decl& decl);
+	bool lookupUncached(clang::ASTContext& astContext, const clang::Decl& decl);
+	Attachment getAttachment(const clang::Decl& decl) const;
+	bool fallback(clang::ASTContext& astContext, const clang::Decl& decl);
+
+	const clang::ASTContext* astContext_ = nullptr;
+	// Whether each indexed declaration has a comment attached to it.
+	llvm::DenseMap<const clang::Decl*, bool> attached_;
+	// The result of each query (including those made to find inherited
+	// comments).
+	llvm::DenseMap<const clang::Decl*, bool> results_;
+	bool verify_ = false;
+	unsigned long numQueries_ = 0;
+	unsigned long numFallbacks_ = 0;
+	unsigned long numMismatches_ = 0;
+	unsigned long numIndexed_ = 0;
+	unsigned long numComments_ = 0;
+	std::chrono::duration<double> buildTime_{0};
+};
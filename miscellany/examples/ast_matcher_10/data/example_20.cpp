@@ -0,0 +1,15 @@
+#include "example_20.hpp"
+
+/// Get the square of a number (again).
+int doc::square(int x) {
+	return x * x;
+}
+
+int main() {
+	doc::Square square(2.0);
+	doc::Buffer<int, 4> buffer;
+	doc::Buffer<double, 2> otherBuffer;
+	buffer[0] = doc::square(2);
+	return doc::max(buffer.size(), otherBuffer.size()) +
+	  static_cast<int>(square.area());
+}
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <cstddef>
+
+/// A namespace with documented declarations.
+namespace doc {
+
+/// A color.
+enum class Color {
+	red, ///< The color red.
+	green, ///< The color green.
+	/// The color blue.
+	blue,
+	other
+};
+
+/// A point in the plane.
+struct Point {
+	double x; ///< The x coordinate.
+	double y; ///< The y coordinate.
+	double z;
+};
+
+/// A point (with the comment of its tag type).
+typedef struct {
+	int x;
+	int y;
+} IntPoint;
+
+using Coord = Point;
+
+/// A shape.
+class Shape {
+public:
+	/// Destroy the shape.
+	virtual ~Shape() = default;
+	/// Get the area of the shape.
+	virtual double area() const = 0;
+	/// Get the number of sides of the shape.
+	virtual int sides() const {return 0;}
+	void undocumented();
+};
+
+// A square (whose comment is not a documentation comment).
+class Square : public Shape {
+public:
+	explicit Square(double side) : side_(side) {}
+	// The area (whose comment is inherited from Shape::area).
+	double area() const override {return side_ * side_;}
+	int sides() const override {return 4;}
+private:
+	double side_; ///< The length of a side.
+};
+
+class Rectangle : private Shape {
+public:
+	double area() const override {return 0.0;}
+};
+
+/// A fixed-size buffer.
+template <class T, std::size_t N>
+class Buffer {
+public:
+	/// Get the size of the buffer.
+	std::size_t size() const {return N;}
+	/// Get an element of the buffer.
+	T& operator[](std::size_t i) {return data_[i];}
+	/// The maximum size of a buffer.
+	static constexpr std::size_t maxSize = N;
+private:
+	T data_[N]; ///< The elements.
+};
+
+/// A buffer of one character.
+template <>
+class Buffer<char, 1> {
+public:
+	char c;
+};
+
+/// Get the larger of two values.
+template <class T>
+const T& max(const T& a, const T& b) {return a < b ? b : a;}
+
+/// Get the square of a number.
+int square(int x);
+
+int square(int x);
+
+/// A declaration separated from its comment by another declaration.
+int separated1; int separated2;
+
+/// A declaration separated from its comment by a directive.
+#define DOC_UNUSED
+int separated3;
+
+#define DOC_DECLARE_INT(name) int name
+
+/// A variable declared by a macro.
+DOC_DECLARE_INT(fromMacro);
+
+/** A variable with a block comment. */
+int blockComment;
+
+/*!
+ * A variable with a Qt-style comment.
+ */
+int qtComment;
+
+int trailing1; ///< A trailing comment.
+int trailing2; //!< A trailing comment.
+
+/// A function with a trailing comment on its parameter.
+void function(int x /**< The argument. */);
+
+}
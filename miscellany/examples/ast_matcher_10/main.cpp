@@ -1,5 +1,10 @@
 #include <format>
+#include <optional>
 #include <llvm/Support/raw_ostream.h>
+#include <cal/ast_cache.hpp>
+#include <cal/parent_map.hpp>
+#include <cal/perf_counters.hpp>
+#include <cal/time_trace.hpp>
 #include <clang/ASTMatchers/ASTMatchers.h>
 #include <clang/ASTMatchers/ASTMatchFinder.h>
 #include <clang/Frontend/FrontendActions.h>
@@ -9,6 +14,7 @@
 #include <cal/main.hpp>
 
 #include "clang_utility.hpp"
+#include "comment_index.hpp"
 #ifdef ENABLE_EXPERIMENTAL
 #include "clang_experimental.hpp"
 #endif
@@ -36,13 +42,25 @@ static llvm::cl::opt<bool> clIgnoreImplicit(
 static llvm::cl::opt<bool> clDumpAst(
   "dump-ast", llvm::cl::desc("Dump AST for match"),
   llvm::cl::cat(optionCategory), llvm::cl::init(false));
+static llvm::cl::opt<bool> clCommentIndex(
+  "comment-index", llvm::cl::desc("Use an index of the declarations with "
+  "comments for the hasComment matcher (experimental)"),
+  llvm::cl::cat(optionCategory), llvm::cl::init(false));
+static llvm::cl::opt<bool> clVerifyCommentIndex(
+  "verify-comment-index", llvm::cl::desc("Check the comment index against "
+  "ASTContext::getCommentForDecl (with -comment-index)"),
+  llvm::cl::cat(optionCategory), llvm::cl::init(false));
+
+// The index of the declarations with comments in the current translation
+// unit.
+static CommentIndex commentIndex;
 
-unsigned int getDepth(clang::ASTContext& astContext,
+unsigned int getDepth(cal::ParentMap& parentMap,
   const clang::DynTypedNode* node) {
 	unsigned int count = 0;
 	const clang::DynTypedNode* curNode = node;
 	for (;;) {
-		auto parents = astContext.getParents(*curNode);
+		auto parents = parentMap.getParents(*curNode);
 		if (parents.size() == 0) {
 			break;
 		}
@@ -56,12 +74,12 @@ unsigned int getDepth(clang::ASTContext& astContext,
 	return count;
 }
 
-clang::DynTypedNode getFarAncestor(clang::ASTContext& astContext,
+clang::DynTypedNode getFarAncestor(cal::ParentMap& parentMap,
   const clang::DynTypedNode* node) {
 	const clang::DynTypedNode* curNode = node;
 	clang::DynTypedNode parentNode;
 	for (;;) {
-		auto parents = astContext.getParents(*curNode);
+		auto parents = parentMap.getParents(*curNode);
 		if (parents.size() == 0) {
 			break;
 		}
@@ -75,9 +93,9 @@ clang::DynTypedNode getFarAncestor(clang::ASTContext& astContext,
 	return parentNode;
 }
 
-clang::DynTypedNode getParent(clang::ASTContext& astContext,
+clang::DynTypedNode getParent(cal::ParentMap& parentMap,
   const clang::DynTypedNode* node) {
-	auto parents = astContext.getParents(*node);
+	auto parents = parentMap.getParents(*node);
 	clang::DynTypedNode parentNode;
 	if (parents.size() > 0) {
 		if (parents.size() > 1) {
@@ -99,6 +117,9 @@ clang::SourceRange charSourceRangeToSourceRange(const clang::SourceManager&
 }
 
 AST_MATCHER(clang::Decl, hasComment) {
+	if (clCommentIndex) {
+		return commentIndex.hasComment(Finder->getASTContext(), Node);
+	}
 	if (auto p = Finder->getASTContext().getCommentForDecl(&Node, nullptr)) {
 		return true;
 	} else {
@@ -280,6 +301,8 @@ class MyMatchCallback : public cam::MatchFinder::MatchCallback {
 public:
 	MyMatchCallback() : count_(0) {}
 	void run(const cam::MatchFinder::MatchResult& result) override {
+		llvm::TimeTraceScope timeScope("MatchCallback");
+		cal::PerfScope perfScope("output");
 		clang::ASTContext& astContext = *result.Context;
 		clang::SourceManager& sourceManager = astContext.getSourceManager();
 		clang::SourceRange sourceRange;
@@ -421,11 +444,12 @@ public:
 		  << std::format("name: {}\n", name);
 
 		if (clVerbose >= 2) {
-			auto parents = astContext.getParents(node);
+			if (!parentMap_) {parentMap_.emplace(astContext);}
+			auto parents = parentMap_->getParents(node);
 			clang::DynTypedNode farthestAncestor =
-			  getFarAncestor(astContext, &node);
+			  getFarAncestor(*parentMap_, &node);
 			llvm::outs() << std::format("depth: {}\n",
-			  getDepth(astContext, &node));
+			  getDepth(*parentMap_, &node));
 			llvm::outs() << std::format("number of parents: {}\n",
 			  parents.size());
 			farthestAncestor.dump(llvm::outs(), astContext);
@@ -434,7 +458,7 @@ public:
 				clang::DynTypedNode curNode = node;
 				for (;;) {
 					clang::DynTypedNode parentNode =
-					  getParent(astContext, &curNode);
+					  getParent(*parentMap_, &curNode);
 					llvm::outs()
 					  << std::format("{}\n", std::string(80, '-'), count_);
 					llvm::outs()
@@ -482,15 +506,34 @@ public:
 		}
 		++count_;
 	}
+	void onStartOfTranslationUnit() override {
+		commentIndex.reset();
+		parentMap_.reset();
+	}
 	unsigned getNumMatches() const {
 		return count_;
 	}
 private:
 	unsigned count_;
+	// The parents of the nodes in the current translation unit.
+	std::optional<cal::ParentMap> parentMap_;
+};
+
+// Creates the consumers of the match finder, which are measured by the
+// performance counters (if enabled).
+struct MyConsumerFactory {
+	cam::MatchFinder* matchFinder;
+	std::unique_ptr<clang::ASTConsumer> newASTConsumer() {
+		return cal::makePerfConsumer(matchFinder->newASTConsumer(), "match");
+	}
 };
 
 int main(int argc, const char **argv) {
 	clClangIncludeDir = cal::getClangIncludeDirPathName();
+	cal::addTimeTraceOptions(optionCategory);
+	cal::addAstCacheOptions(optionCategory);
+	cal::addPerfCountersOptions(optionCategory);
+	cal::addParentMapOptions(optionCategory);
 	auto expectedParser = ct::CommonOptionsParser::create(argc, argv,
 	  optionCategory);
 	if (!expectedParser) {
@@ -498,6 +541,8 @@ int main(int argc, const char **argv) {
 		return 1;
 	}
 	ct::CommonOptionsParser& optionsParser = expectedParser.get();
+	commentIndex.setVerify(clVerifyCommentIndex);
+	cal::TimeTrace timeTrace(argv[0]);
 	ct::ClangTool tool(optionsParser.getCompilations(),
 	  optionsParser.getSourcePathList());
 	if (!clClangIncludeDir.empty()) {
@@ -532,7 +577,21 @@ int main(int argc, const char **argv) {
 		}
 		matchFinder.addMatcher(matcher, &matchCallback);
 	}
-	int status = tool.run(ct::newFrontendActionFactory(&matchFinder).get());
+	MyConsumerFactory consumerFactory{&matchFinder};
+	auto factory = ct::newFrontendActionFactory(&consumerFactory);
+	cal::AstCacheToolAction cacheAction([&]() {
+		return consumerFactory.newASTConsumer();
+	});
+	cal::TracedToolAction tracedAction(cal::isAstCacheEnabled() ?
+	  static_cast<ct::ToolAction*>(&cacheAction) : factory.get());
+	int status = tool.run(&tracedAction);
 	llvm::outs() << std::format("number of matches: {}\n",
 	  matchCallback.getNumMatches());
+	if (cal::isAstCacheEnabled()) {cacheAction.printStats(llvm::errs());}
+	if (clCommentIndex && (clVerbose >= 1 || clVerifyCommentIndex)) {
+		commentIndex.printStats(llvm::errs());
+	}
+	cal::printParentMapStats(llvm::errs());
+	cal::printPerfCounters(llvm::errs());
+	if (timeTrace.finish()) {return 1;}
 }
@@ -0,0 +1,130 @@
+#include <clang/AST/ASTContext.h>
+#include <clang/Basic/SourceManager.h>
+#include <clang/Lex/Preprocessor.h>
+#include <clang/Tooling/Tooling.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/TimeProfiler.h>
+#include <llvm/Support/VirtualFileSystem.h>
+#include "ast_store.hpp"
+
+namespace ct = clang::tooling;
+
+std::size_t getAstMemory(clang::ASTUnit& astUnit) {
+	const clang::ASTContext& astContext = astUnit.getASTContext();
+	const clang::SourceManager& sourceManager = astUnit.getSourceManager();
+	return astContext.getASTAllocatedMemory() +
+	  astContext.getSideTableAllocatedMemory() +
+	  sourceManager.getContentCacheSize() +
+	  sourceManager.getDataStructureSizes() +
+	  astUnit.getPreprocessor().getTotalMemory();
+}
+
+AstStore::AstStore(const ct::CompilationDatabase& compilations,
+  const std::vector<std::string>& sources, std::size_t memoryLimit) :
+  compilations_(&compilations), memoryLimit_(memoryLimit) {
+	for (const auto& source : sources) {
+		entries_.push_back(std::make_unique<Entry>());
+		entries_.back()->source = source;
+	}
+}
+
+AstStore::~AstStore() = default;
+
+std::unique_ptr<clang::ASTUnit> AstStore::load(const std::string& source) {
+	llvm::TimeTraceScope timeScope("LoadAST", source);
+	// The diagnostics for the TU are issued each time that it is parsed
+	// (i.e., when it is first used, and again when it is used after an
+	// eviction).  Since a TU that fails to parse is not parsed again until
+	// it is modified, its errors are not issued for every query.
+	// Loads run concurrently (on the worker threads), and ClangTool changes
+	// the working directory to that of the compile command, so each tool
+	// has a physical file system (with its own working directory) instead
+	// of the real one (whose working directory is process wide).
+	ct::ClangTool tool(*compilations_, {source},
+	  std::make_shared<clang::PCHContainerOperations>(),
+	  llvm::vfs::createPhysicalFileSystem());
+	std::vector<std::unique_ptr<clang::ASTUnit>> astUnits;
+	if (tool.buildASTs(astUnits) || astUnits.size() != 1) {return nullptr;}
+	return std::move(astUnits.front());
+}
+
+AstStore::Use AstStore::withAst(std::size_t index,
+  const std::function<void(clang::ASTUnit&)>& func) {
+	Entry& entry = *entries_[index];
+	Use use = Use::Hit;
+	{
+		std::scoped_lock entryLock(entry.mutex);
+		if (!entry.astUnit) {
+			// The modification time is obtained before parsing, so that a
+			// change made during the parse causes the TU to be parsed again.
+			llvm::sys::TimePoint<> modTime;
+			if (llvm::sys::fs::file_status status;
+			  !llvm::sys::fs::status(entry.source, status)) {
+				modTime = status.getLastModificationTime();
+			}
+			if (entry.failedTime && *entry.failedTime == modTime) {
+				return Use::Failed;
+			}
+			entry.failedTime.reset();
+			// The TU is parsed without holding the store mutex, so that
+			// other TUs can be parsed (and used) at the same time.
+			auto startTime = std::chrono::steady_clock::now();
+			std::unique_ptr<clang::ASTUnit> astUnit = load(entry.source);
+			auto loadTime = std::chrono::steady_clock::now() - startTime;
+			std::size_t memory = astUnit ? getAstMemory(*astUnit) : 0;
+			std::scoped_lock lock(mutex_);
+			stats_.loadTime += loadTime;
+			if (!astUnit) {
+				entry.failedTime = modTime;
+				++stats_.numLoadFailures;
+				return Use::Failed;
+			}
+			entry.astUnit = std::move(astUnit);
+			entry.memory = memory;
+			stats_.memory += memory;
+			++stats_.numLoaded;
+			++stats_.numMisses;
+			use = Use::Miss;
+		} else {
+			std::scoped_lock lock(mutex_);
+			++stats_.numHits;
+		}
+		{
+			std::scoped_lock lock(mutex_);
+			if (entry.inLru) {lru_.erase(entry.lruPos);}
+			entry.lruPos = lru_.insert(lru_.end(), &entry);
+			entry.inLru = true;
+		}
+		func(*entry.astUnit);
+	}
+	evict();
+	return use;
+}
+
+void AstStore::evict() {
+	std::scoped_lock lock(mutex_);
+	for (auto i = lru_.begin(); i != lru_.end() &&
+	  stats_.memory > memoryLimit_;) {
+		Entry& entry = **i;
+		// An AST that is in use (or being loaded) is skipped.  Since the
+		// store mutex is held, the entry mutex is only tried (and not
+		// waited for), which avoids a lock-order inversion with withAst.
+		std::unique_lock entryLock(entry.mutex, std::try_to_lock);
+		if (!entryLock.owns_lock()) {
+			++i;
+			continue;
+		}
+		entry.astUnit.reset();
+		stats_.memory -= entry.memory;
+		entry.memory = 0;
+		entry.inLru = false;
+		i = lru_.erase(i);
+		--stats_.numLoaded;
+		++stats_.numEvictions;
+	}
+}
+
+AstStore::Stats AstStore::getStats() const {
+	std::scoped_lock lock(mutex_);
+	return stats_;
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
+#include <clang/Frontend/ASTUnit.h>
+#include <clang/Tooling/CompilationDatabase.h>
+#include <llvm/Support/Chrono.h>
+#include <llvm/Support/raw_ostream.h>
+
+// Holds the ASTs of a fixed set of TUs in memory.  The AST of a TU is only
+// parsed when it is first used, and the least recently used ASTs are
+// evicted when the estimated memory used by the ASTs exceeds a limit (and
+// parsed again when next used).
+//
+// A TU that fails to parse is not parsed again (e.g., by every query) until
+// its source file is modified.
+//
+// At most one thread uses the AST of a given TU at any time (since an
+// ASTContext is not thread safe), but the ASTs of different TUs are used
+// concurrently.  An AST is never evicted while it is in use.
+class AstStore {
+public:
+	struct Stats {
+		std::size_t numLoaded = 0;
+		std::size_t memory = 0;
+		std::size_t numHits = 0;
+		std::size_t numMisses = 0;
+		std::size_t numEvictions = 0;
+		std::size_t numLoadFailures = 0;
+		std::chrono::nanoseconds loadTime{0};
+	};
+
+	// The result of using the AST of a TU.
+	enum class Use {Hit, Miss, Failed};
+
+	AstStore(const clang::tooling::CompilationDatabase& compilations,
+	  const std::vector<std::string>& sources, std::size_t memoryLimit);
+	AstStore(const AstStore&) = delete;
+	AstStore& operator=(const AstStore&) = delete;
+	~AstStore();
+
+	std::size_t size() const {return entries_.size();}
+	const std::string& getSource(std::size_t index) const
+	  {return entries_[index]->source;}
+
+	// Invoke a function on the AST of the TU with the specified index
+	// (parsing the TU first if necessary), with exclusive use of the AST.
+	Use withAst(std::size_t index,
+	  const std::function<void(clang::ASTUnit&)>& func);
+
+	Stats getStats() const;
+
+private:
+	struct Entry {
+		std::string source;
+		// Held while the AST is loaded or used.
+		std::mutex mutex;
+		// The AST (or null if not loaded).
+		std::unique_ptr<clang::ASTUnit> astUnit;
+		// If the last parse failed, the modification time of the source
+		// file at the time.
+		std::optional<llvm::sys::TimePoint<>> failedTime;
+		// The following are guarded by the store mutex.
+		std::size_t memory = 0;
+		bool inLru = false;
+		std::list<Entry*>::iterator lruPos;
+	};
+
+	std::unique_ptr<clang::ASTUnit> load(const std::string& source);
+	void evict();
+
+	const clang::tooling::CompilationDatabase* compilations_;
+	std::size_t memoryLimit_;
+	std::vector<std::unique_ptr<Entry>> entries_;
+	mutable std::mutex mutex_;
+	// The loaded ASTs from the least to the most recently used.
+	std::list<Entry*> lru_;
+	Stats stats_;
+};
+
+// Get an estimate of the memory used by an AST (i.e., by the ASTContext,
+// the source manager, and the preprocessor).
+std::size_t getAstMemory(clang::ASTUnit& astUnit);
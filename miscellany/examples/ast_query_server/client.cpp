@@ -0,0 +1,60 @@
+#include <algorithm>
+#include <format>
+#include <string>
+#include <unistd.h>
+#include <llvm/ADT/StringRef.h>
+#include <llvm/Support/CommandLine.h>
+#include <llvm/Support/raw_ostream.h>
+#include "socket.hpp"
+
+// A client for the query server, which sends each matcher expression
+// specified on the command line as a query, and prints the replies.
+
+static llvm::cl::OptionCategory optionCategory("Tool options");
+static llvm::cl::opt<std::string> clSocket("socket",
+  llvm::cl::desc("The pathname of the socket of the server"),
+  llvm::cl::value_desc("path"), llvm::cl::Required,
+  llvm::cl::cat(optionCategory));
+static llvm::cl::list<std::string> clExprs(llvm::cl::Positional,
+  llvm::cl::desc("<matcher expression>..."), llvm::cl::cat(optionCategory));
+static llvm::cl::opt<bool> clStats("server-stats",
+  llvm::cl::desc("Print the statistics of the server"),
+  llvm::cl::cat(optionCategory));
+static llvm::cl::opt<bool> clShutdown("shutdown",
+  llvm::cl::desc("Stop the server"), llvm::cl::cat(optionCategory));
+
+// Send a request and print the reply (which ends with a done or error
+// line).  Returns zero on success.
+int request(int fd, LineReader& reader, const std::string& line) {
+	if (!writeAll(fd, line + '\n')) {
+		llvm::errs() << "cannot send request\n";
+		return 1;
+	}
+	std::string reply;
+	while (reader.readLine(reply)) {
+		llvm::outs() << reply << '\n';
+		llvm::StringRef command = llvm::StringRef(reply).split(' ').first;
+		if (command == "done") {return 0;}
+		if (command == "error") {return 1;}
+	}
+	llvm::errs() << "server closed the connection\n";
+	return 1;
+}
+
+int main(int argc, const char **argv) {
+	llvm::cl::HideUnrelatedOptions(optionCategory);
+	llvm::cl::ParseCommandLineOptions(argc, argv);
+	int fd = connectUnixSocket(clSocket);
+	if (fd < 0) {return 1;}
+	LineReader reader(fd);
+	int status = 0;
+	for (auto expr : clExprs) {
+		// A request is one line.
+		std::replace(expr.begin(), expr.end(), '\n', ' ');
+		if (request(fd, reader, "match " + expr)) {status = 1;}
+	}
+	if (clStats && request(fd, reader, "stats")) {status = 1;}
+	if (clShutdown && request(fd, reader, "shutdown")) {status = 1;}
+	::close(fd);
+	return status;
+}
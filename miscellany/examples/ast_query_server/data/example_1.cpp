@@ -0,0 +1,35 @@
+#include <string>
+#include <vector>
+
+class Widget {
+public:
+	Widget(std::string name, int width, int height, bool visible) :
+	  name_(std::move(name)), width_(width), height_(height),
+	  visible_(visible) {}
+	void resize(int width, int height, bool keepAspect, bool redraw) {
+		if (keepAspect) {
+			height = width * height_ / width_;
+		}
+		width_ = width;
+		height_ = height;
+		if (redraw) {
+			draw();
+		}
+	}
+	void draw() const {}
+private:
+	std::string name_;
+	int width_;
+	int height_;
+	bool visible_;
+};
+
+int countVisible(const std::vector<Widget*>& widgets) {
+	int count = 0;
+	for (auto widget : widgets) {
+		if (widget) {
+			++count;
+		}
+	}
+	return count;
+}
@@ -0,0 +1,30 @@
+#include <map>
+#include <string>
+
+int classify(int x) {
+	if (x < 0) {
+		return -1;
+	} else if (x == 0) {
+		return 0;
+	}
+	return 1;
+}
+
+std::map<std::string, int> histogram(const std::string& text) {
+	std::map<std::string, int> result;
+	std::string word;
+	for (char c : text) {
+		if (c == ' ') {
+			if (!word.empty()) {
+				++result[word];
+			}
+			word.clear();
+		} else {
+			word += c;
+		}
+	}
+	if (!word.empty()) {
+		++result[word];
+	}
+	return result;
+}
@@ -0,0 +1,22 @@
+int gcd(int a, int b) {
+	while (b) {
+		int t = a % b;
+		a = b;
+		b = t;
+	}
+	return a;
+}
+
+int classify(int x);
+
+int main() {
+	int x = gcd(12, 18);
+	if (x != 6) {
+		return 1;
+	}
+	return classify(x);
+}
+
+int classify(int x) {
+	return x > 0;
+}
@@ -0,0 +1,400 @@
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <format>
+#include <functional>
+#include <list>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <cal/time_trace.hpp>
+#include <clang/ASTMatchers/ASTMatchFinder.h>
+#include <clang/ASTMatchers/Dynamic/Parser.h>
+#include <clang/Tooling/CommonOptionsParser.h>
+#include <llvm/ADT/StringRef.h>
+#include <llvm/Support/CommandLine.h>
+#include <llvm/Support/raw_ostream.h>
+#include "ast_store.hpp"
+#include "socket.hpp"
+
+// A server that holds the ASTs of a set of TUs in memory and answers
+// matcher queries from several clients over a Unix domain socket.  The
+// protocol is line oriented, with one request per line:
+//
+//   match EXPR  Match the matcher expression (in the syntax of clang-query)
+//               against every TU.  The reply is a "match" line per match
+//               (streamed as each TU is done) and then a "done" line with
+//               the statistics for the query (or an "error" line).
+//   stats       Reply with a "stat" line per server statistic, and then a
+//               "done" line.
+//   shutdown    Stop the server (after the current queries finish).
+//
+// The TUs of a query are matched concurrently by a pool of worker threads,
+// with each worker having exclusive use of the AST that it is matching.
+
+namespace ct = clang::tooling;
+namespace cam = clang::ast_matchers;
+
+static llvm::cl::OptionCategory optionCategory("Tool options");
+static llvm::cl::opt<std::string> clSocket("socket",
+  llvm::cl::desc("The pathname of the socket on which to listen"),
+  llvm::cl::value_desc("path"), llvm::cl::Required,
+  llvm::cl::cat(optionCategory));
+static llvm::cl::opt<unsigned> clMemoryLimit("memory-limit",
+  llvm::cl::desc("Evict the least recently used ASTs when the ASTs use "
+  "more than this much memory (in MiB)"), llvm::cl::value_desc("MiB"),
+  llvm::cl::init(2048), llvm::cl::cat(optionCategory));
+static llvm::cl::opt<unsigned> clNumThreads("j",
+  llvm::cl::desc("The number of worker threads (0 for one per core)"),
+  llvm::cl::init(0), llvm::cl::cat(optionCategory));
+
+namespace {
+
+double toMilliseconds(std::chrono::nanoseconds t) {
+	return std::chrono::duration<double, std::milli>(t).count();
+}
+
+// A fixed set of threads that run tasks in the order posted.
+class WorkerPool {
+public:
+	explicit WorkerPool(unsigned numThreads) {
+		for (unsigned i = 0; i < numThreads; ++i) {
+			threads_.emplace_back([this]() {work();});
+		}
+	}
+	WorkerPool(const WorkerPool&) = delete;
+	WorkerPool& operator=(const WorkerPool&) = delete;
+	~WorkerPool() {
+		{
+			std::scoped_lock lock(mutex_);
+			stop_ = true;
+		}
+		cv_.notify_all();
+		for (auto& thread : threads_) {thread.join();}
+	}
+	void post(std::function<void()> task) {
+		{
+			std::scoped_lock lock(mutex_);
+			tasks_.push_back(std::move(task));
+		}
+		cv_.notify_one();
+	}
+private:
+	void work() {
+		cal::TimeTraceThread timeTraceThread;
+		for (;;) {
+			std::function<void()> task;
+			{
+				std::unique_lock lock(mutex_);
+				cv_.wait(lock, [this]() {return stop_ || !tasks_.empty();});
+				if (tasks_.empty()) {return;}
+				task = std::move(tasks_.front());
+				tasks_.pop_front();
+			}
+			task();
+		}
+	}
+	std::mutex mutex_;
+	std::condition_variable cv_;
+	std::deque<std::function<void()>> tasks_;
+	bool stop_ = false;
+	std::vector<std::thread> threads_;
+};
+
+// Formats each match of the root node of a query.
+class MatchPrinter : public cam::MatchFinder::MatchCallback {
+public:
+	void run(const cam::MatchFinder::MatchResult& result) override {
+		const auto& nodes = result.Nodes.getMap();
+		auto i = nodes.find("root");
+		if (i == nodes.end()) {return;}
+		const clang::DynTypedNode& node = i->second;
+		const clang::SourceManager& sourceManager = *result.SourceManager;
+		std::string location = "[invalid]";
+		clang::PresumedLoc presumedLoc = sourceManager.getPresumedLoc(
+		  sourceManager.getExpansionLoc(node.getSourceRange().getBegin()));
+		if (presumedLoc.isValid()) {
+			location = std::format("{}:{}:{}", presumedLoc.getFilename(),
+			  presumedLoc.getLine(), presumedLoc.getColumn());
+		}
+		output_ += std::format("match {} {}", location,
+		  std::string(node.getNodeKind().asStringRef()));
+		if (auto namedDecl = node.get<clang::NamedDecl>()) {
+			output_ += ' ';
+			output_ += namedDecl->getQualifiedNameAsString();
+		}
+		output_ += '\n';
+		++numMatches_;
+	}
+	const std::string& getOutput() const {return output_;}
+	std::size_t getNumMatches() const {return numMatches_;}
+private:
+	std::string output_;
+	std::size_t numMatches_ = 0;
+};
+
+// A connection to a client, whose replies may be written by several
+// worker threads.
+class Connection {
+public:
+	explicit Connection(int fd) : fd_(fd) {}
+	// Returns false if the client has gone away.
+	bool write(std::string_view data) {
+		std::scoped_lock lock(mutex_);
+		if (broken_) {return false;}
+		if (!writeAll(fd_, data)) {broken_ = true;}
+		return !broken_;
+	}
+private:
+	int fd_;
+	std::mutex mutex_;
+	bool broken_ = false;
+};
+
+class Server {
+public:
+	Server(AstStore& store, unsigned numThreads, int listenFd) :
+	  store_(&store), pool_(numThreads), listenFd_(listenFd) {}
+	void run();
+	void printStats(llvm::raw_ostream& out) const;
+private:
+	void serve(int fd);
+	void match(Connection& connection, llvm::StringRef expr);
+	std::string getStats() const;
+	void stop();
+
+	AstStore* store_;
+	WorkerPool pool_;
+	int listenFd_;
+	std::atomic<bool> stopping_{false};
+	mutable std::mutex mutex_;
+	std::set<int> clientFds_;
+	std::size_t numQueries_ = 0;
+	std::size_t numFailedQueries_ = 0;
+	std::chrono::nanoseconds totalLatency_{0};
+	std::chrono::nanoseconds maxLatency_{0};
+};
+
+void Server::run() {
+	struct Client {
+		std::thread thread;
+		std::atomic<bool> done{false};
+	};
+	std::list<Client> clients;
+	while (!stopping_) {
+		int fd = ::accept4(listenFd_, nullptr, nullptr, SOCK_CLOEXEC);
+		if (fd < 0) {
+			if (errno == EINTR || errno == ECONNABORTED) {continue;}
+			break;
+		}
+		{
+			std::scoped_lock lock(mutex_);
+			clientFds_.insert(fd);
+			// A client accepted while stopping is stopped here (since stop
+			// may have already stopped the other clients).
+			if (stopping_) {::shutdown(fd, SHUT_RD);}
+		}
+		// The threads of the clients that have gone away are joined, so
+		// that they do not accumulate over a long run.
+		for (auto i = clients.begin(); i != clients.end();) {
+			if (i->done) {
+				i->thread.join();
+				i = clients.erase(i);
+			} else {++i;}
+		}
+		Client& client = clients.emplace_back();
+		client.thread = std::thread([this, fd, &client]() {
+			serve(fd);
+			client.done = true;
+		});
+	}
+	for (auto& client : clients) {client.thread.join();}
+}
+
+void Server::stop() {
+	stopping_ = true;
+	// This wakes the accept call, and ends the requests from each client
+	// (after any query in progress).
+	::shutdown(listenFd_, SHUT_RDWR);
+	std::scoped_lock lock(mutex_);
+	for (int fd : clientFds_) {::shutdown(fd, SHUT_RD);}
+}
+
+void Server::serve(int fd) {
+	Connection connection(fd);
+	LineReader reader(fd);
+	std::string line;
+	while (reader.readLine(line)) {
+		auto [command, arg] = llvm::StringRef(line).trim().split(' ');
+		if (command == "match") {
+			match(connection, arg.trim());
+		} else if (command == "stats") {
+			connection.write(getStats() + "done\n");
+		} else if (command == "shutdown") {
+			connection.write("done\n");
+			stop();
+			break;
+		} else if (!command.empty()) {
+			connection.write(std::format("error unknown command {}\n",
+			  command.str()));
+		}
+	}
+	{
+		std::scoped_lock lock(mutex_);
+		clientFds_.erase(fd);
+	}
+	::close(fd);
+}
+
+void Server::match(Connection& connection, llvm::StringRef expr) {
+	auto startTime = std::chrono::steady_clock::now();
+	cam::dynamic::Diagnostics diag;
+	llvm::StringRef code = expr;
+	auto matcher = cam::dynamic::Parser::parseMatcherExpression(code, &diag);
+	if (matcher) {
+		// The root node is bound (unless the expression binds it), so that
+		// it can be found in each match.
+		if (auto boundMatcher = matcher->tryBind("root")) {
+			matcher = *boundMatcher;
+		}
+		MatchPrinter printer;
+		cam::MatchFinder finder;
+		if (!finder.addDynamicMatcher(*matcher, &printer)) {
+			connection.write("error matcher cannot be used at the top "
+			  "level\n");
+			std::scoped_lock lock(mutex_);
+			++numFailedQueries_;
+			return;
+		}
+	} else {
+		// The diagnostics span several lines, but a reply is one line.
+		std::string message = diag.toStringFull();
+		std::replace(message.begin(), message.end(), '\n', ' ');
+		connection.write(std::format("error {}\n", message));
+		std::scoped_lock lock(mutex_);
+		++numFailedQueries_;
+		return;
+	}
+
+	// The TUs are matched by the worker pool, and the matches for each TU
+	// are written as soon as the TU is done.
+	std::mutex mutex;
+	std::condition_variable cv;
+	std::size_t numRemaining = store_->size();
+	std::size_t numMatches = 0;
+	std::size_t numUses[3] = {0, 0, 0};
+	for (std::size_t i = 0; i < store_->size(); ++i) {
+		pool_.post([&, i]() {
+			MatchPrinter printer;
+			AstStore::Use use = store_->withAst(i,
+			  [&](clang::ASTUnit& astUnit) {
+				cam::MatchFinder finder;
+				finder.addDynamicMatcher(*matcher, &printer);
+				finder.matchAST(astUnit.getASTContext());
+			});
+			if (use == AstStore::Use::Failed) {
+				connection.write(std::format("warning cannot parse {}\n",
+				  store_->getSource(i)));
+			} else if (!printer.getOutput().empty()) {
+				connection.write(printer.getOutput());
+			}
+			std::scoped_lock lock(mutex);
+			numMatches += printer.getNumMatches();
+			++numUses[static_cast<int>(use)];
+			if (!--numRemaining) {cv.notify_one();}
+		});
+	}
+	{
+		std::unique_lock lock(mutex);
+		cv.wait(lock, [&]() {return !numRemaining;});
+	}
+
+	auto latency = std::chrono::steady_clock::now() - startTime;
+	connection.write(std::format("done matches={} tus={} hits={} misses={} "
+	  "failed={} latency_ms={:.3f}\n", numMatches, store_->size(),
+	  numUses[static_cast<int>(AstStore::Use::Hit)],
+	  numUses[static_cast<int>(AstStore::Use::Miss)],
+	  numUses[static_cast<int>(AstStore::Use::Failed)],
+	  toMilliseconds(latency)));
+	std::scoped_lock lock(mutex_);
+	++numQueries_;
+	totalLatency_ += latency;
+	maxLatency_ = std::max<std::chrono::nanoseconds>(maxLatency_, latency);
+}
+
+std::string Server::getStats() const {
+	AstStore::Stats storeStats = store_->getStats();
+	std::scoped_lock lock(mutex_);
+	std::string s;
+	s += std::format("stat tus {}\n", store_->size());
+	s += std::format("stat loaded {}\n", storeStats.numLoaded);
+	s += std::format("stat memory_mib {:.1f}\n",
+	  storeStats.memory / (1024.0 * 1024.0));
+	s += std::format("stat memory_limit_mib {}\n",
+	  static_cast<unsigned>(clMemoryLimit));
+	s += std::format("stat hits {}\n", storeStats.numHits);
+	s += std::format("stat misses {}\n", storeStats.numMisses);
+	s += std::format("stat evictions {}\n", storeStats.numEvictions);
+	s += std::format("stat load_failures {}\n", storeStats.numLoadFailures);
+	s += std::format("stat load_time_ms {:.3f}\n",
+	  toMilliseconds(storeStats.loadTime));
+	s += std::format("stat queries {}\n", numQueries_);
+	s += std::format("stat failed_queries {}\n", numFailedQueries_);
+	s += std::format("stat mean_latency_ms {:.3f}\n", numQueries_ ?
+	  toMilliseconds(totalLatency_) / numQueries_ : 0.0);
+	s += std::format("stat max_latency_ms {:.3f}\n",
+	  toMilliseconds(maxLatency_));
+	return s;
+}
+
+void Server::printStats(llvm::raw_ostream& out) const {
+	std::string stats = getStats();
+	llvm::StringRef data(stats);
+	while (!data.empty()) {
+		auto [line, rest] = data.split('\n');
+		out << line.drop_front(5) << '\n';
+		data = rest;
+	}
+}
+
+}
+
+int main(int argc, const char **argv) {
+	cal::addTimeTraceOptions(optionCategory);
+	auto expectedParser = ct::CommonOptionsParser::create(argc, argv,
+	  optionCategory);
+	if (!expectedParser) {
+		llvm::errs() << llvm::toString(expectedParser.takeError());
+		return 1;
+	}
+	ct::CommonOptionsParser& optionsParser = expectedParser.get();
+	cal::TimeTrace timeTrace(argv[0]);
+	unsigned numThreads = clNumThreads;
+	if (!numThreads) {
+		numThreads = std::max(std::thread::hardware_concurrency(), 1U);
+	}
+	int listenFd = listenUnixSocket(clSocket);
+	if (listenFd < 0) {return 1;}
+	AstStore store(optionsParser.getCompilations(),
+	  optionsParser.getSourcePathList(),
+	  std::size_t(clMemoryLimit) * 1024 * 1024);
+	{
+		Server server(store, numThreads, listenFd);
+		llvm::errs() << std::format("listening on {} ({} TUs, {} threads)\n",
+		  std::string(clSocket), store.size(), numThreads);
+		server.run();
+		server.printStats(llvm::errs());
+	}
+	::close(listenFd);
+	::unlink(clSocket.c_str());
+	int status = 0;
+	if (timeTrace.finish()) {status = 1;}
+	return status;
+}
@@ -0,0 +1,102 @@
+#include <cerrno>
+#include <cstring>
+#include <format>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <llvm/Support/raw_ostream.h>
+#include "socket.hpp"
+
+namespace {
+
+// Make the address for a socket pathname.  Returns false (after printing
+// an error) if the pathname is too long.
+bool makeAddress(const std::string& pathName, sockaddr_un& address) {
+	std::memset(&address, 0, sizeof(address));
+	address.sun_family = AF_UNIX;
+	if (pathName.size() >= sizeof(address.sun_path)) {
+		llvm::errs() << std::format("socket pathname too long: {}\n",
+		  pathName);
+		return false;
+	}
+	std::memcpy(address.sun_path, pathName.data(), pathName.size());
+	return true;
+}
+
+int fail(std::string_view what, const std::string& pathName, int fd) {
+	llvm::errs() << std::format("cannot {} socket {} ({})\n", what, pathName,
+	  std::strerror(errno));
+	if (fd >= 0) {::close(fd);}
+	return -1;
+}
+
+}
+
+int listenUnixSocket(const std::string& pathName) {
+	sockaddr_un address;
+	if (!makeAddress(pathName, address)) {return -1;}
+	// A stale socket (e.g., left by a server that was killed) is removed,
+	// but anything else at the pathname (e.g., a regular file named by
+	// mistake) is left alone.
+	struct stat status;
+	if (!::lstat(pathName.c_str(), &status)) {
+		if (!S_ISSOCK(status.st_mode)) {
+			llvm::errs() << std::format("cannot listen on socket {} (the "
+			  "pathname exists and is not a socket)\n", pathName);
+			return -1;
+		}
+		if (::unlink(pathName.c_str())) {
+			return fail("remove old", pathName, -1);
+		}
+	}
+	int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	if (fd < 0) {return fail("create", pathName, fd);}
+	if (::bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address))) {
+		return fail("bind", pathName, fd);
+	}
+	if (::listen(fd, SOMAXCONN)) {return fail("listen on", pathName, fd);}
+	return fd;
+}
+
+int connectUnixSocket(const std::string& pathName) {
+	sockaddr_un address;
+	if (!makeAddress(pathName, address)) {return -1;}
+	int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	if (fd < 0) {return fail("create", pathName, fd);}
+	if (::connect(fd, reinterpret_cast<sockaddr*>(&address),
+	  sizeof(address))) {
+		return fail("connect to", pathName, fd);
+	}
+	return fd;
+}
+
+bool writeAll(int fd, std::string_view data) {
+	while (!data.empty()) {
+		ssize_t count = ::send(fd, data.data(), data.size(), MSG_NOSIGNAL);
+		if (count < 0) {
+			if (errno == EINTR) {continue;}
+			return false;
+		}
+		data.remove_prefix(count);
+	}
+	return true;
+}
+
+bool LineReader::readLine(std::string& line) {
+	for (;;) {
+		std::size_t end = buffer_.find('\n', pos_);
+		if (end != std::string::npos) {
+			line.assign(buffer_, pos_, end - pos_);
+			pos_ = end + 1;
+			return true;
+		}
+		buffer_.erase(0, pos_);
+		pos_ = 0;
+		char data[4096];
+		ssize_t count = ::read(fd_, data, sizeof(data));
+		if (count < 0 && errno == EINTR) {continue;}
+		if (count <= 0) {return false;}
+		buffer_.append(data, count);
+	}
+}
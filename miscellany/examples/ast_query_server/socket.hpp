@@ -0,0 +1,34 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+
+// Minimal support for a line-oriented protocol over a Unix domain socket
+// (as used by the query server and its client).
+
+// Create a socket that listens at the specified pathname (removing any
+// stale socket there first, but failing if anything other than a socket is
+// there).  Returns the file descriptor, or -1 (after printing an error) on
+// failure.
+int listenUnixSocket(const std::string& pathName);
+
+// Connect to the socket at the specified pathname.  Returns the file
+// descriptor, or -1 (after printing an error) on failure.
+int connectUnixSocket(const std::string& pathName);
+
+// Write all of the data to a socket.  Returns false if the peer has gone
+// away (which never raises SIGPIPE).
+bool writeAll(int fd, std::string_view data);
+
+// Reads lines from a socket (with buffering).
+class LineReader {
+public:
+	explicit LineReader(int fd) : fd_(fd) {}
+	// Read the next line (without its newline).  Returns false at the end
+	// of the stream (or on error).
+	bool readLine(std::string& line);
+private:
+	int fd_;
+	std::string buffer_;
+	std::size_t pos_ = 0;
+};
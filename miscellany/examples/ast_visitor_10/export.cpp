@@ -0,0 +1,286 @@
+#include <algorithm>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <cal/parallel.hpp>
+#include <cal/time_trace.hpp>
+#include <clang/AST/ASTConsumer.h>
+#include <clang/AST/RecursiveASTVisitor.h>
+#include <clang/Frontend/CompilerInstance.h>
+#include <clang/Frontend/FrontendAction.h>
+#include <clang/Tooling/Tooling.h>
+#include <llvm/ADT/DenseMap.h>
+#include <llvm/Support/JSON.h>
+
+#include "export.hpp"
+#include "utilities.hpp"
+
+namespace ct = clang::tooling;
+
+namespace {
+
+// The line tables for all files, shared by all threads, so that a header
+// included by many translation units is only scanned once.  The tables are
+// keyed by the real path of a file, since the same spelled name (e.g.,
+// util.h) may refer to different files in different translation units.
+class LineTableCache {
+public:
+	const LineTable& get(const std::string& realPathName,
+	  std::string_view buffer);
+private:
+	std::mutex mutex_;
+	std::unordered_map<std::string, std::unique_ptr<LineTable>> tables_;
+};
+
+const LineTable& LineTableCache::get(const std::string& realPathName,
+  std::string_view buffer) {
+	{
+		std::scoped_lock lock(mutex_);
+		if (auto i = tables_.find(realPathName); i != tables_.end()) {
+			return *i->second;
+		}
+	}
+	// Scan the file without holding the lock.
+	auto table = std::make_unique<LineTable>(buffer);
+	std::scoped_lock lock(mutex_);
+	return *tables_.try_emplace(realPathName, std::move(table)).first->second;
+}
+
+// Serializes the writing of the output for each translation unit.
+class JsonlSink {
+public:
+	JsonlSink(llvm::raw_ostream& out) : out_(&out) {}
+	void write(const std::string& s) {
+		std::scoped_lock lock(mutex_);
+		*out_ << s;
+	}
+private:
+	std::mutex mutex_;
+	llvm::raw_ostream* out_;
+};
+
+class ExportVisitor : public clang::RecursiveASTVisitor<ExportVisitor> {
+public:
+	ExportVisitor(clang::ASTContext& astContext, LineTableCache& cache,
+	  const ExportOptions& options, llvm::raw_ostream& out) :
+	  sourceManager_(&astContext.getSourceManager()), cache_(&cache),
+	  options_(&options), out_(&out) {}
+	bool VisitVarDecl(clang::VarDecl* varDecl);
+	bool VisitFunctionDecl(clang::FunctionDecl* funcDecl);
+	bool shouldVisitTemplateInstantiations() const {return true;}
+private:
+	bool isSelected(clang::SourceLocation loc) const;
+	const LineTable& getLineTable(clang::FileID fileId);
+	void writeLocation(llvm::json::OStream& json, llvm::StringRef name,
+	  clang::SourceLocation loc);
+	void writeRange(llvm::json::OStream& json, llvm::StringRef name,
+	  clang::SourceRange range);
+	void writeHeader(llvm::json::OStream& json, llvm::StringRef kind,
+	  const clang::NamedDecl* decl);
+	clang::SourceManager* sourceManager_;
+	LineTableCache* cache_;
+	const ExportOptions* options_;
+	llvm::raw_ostream* out_;
+	// The line tables for the files seen in this translation unit.
+	llvm::DenseMap<clang::FileID, const LineTable*> lineTables_;
+	// The line tables for buffers that do not correspond to a file (e.g.,
+	// scratch space), which cannot be shared with other translation units.
+	std::vector<std::unique_ptr<LineTable>> localLineTables_;
+	// The file containing the current declaration.
+	clang::FileID declFileId_;
+};
+
+bool ExportVisitor::isSelected(clang::SourceLocation loc) const {
+	return options_->processHeaders ||
+	  sourceManager_->getFileID(loc) == sourceManager_->getMainFileID();
+}
+
+const LineTable& ExportVisitor::getLineTable(clang::FileID fileId) {
+	auto [iter, inserted] = lineTables_.try_emplace(fileId, nullptr);
+	if (inserted) {
+		bool invalid = false;
+		llvm::StringRef buffer = sourceManager_->getBufferData(fileId,
+		  &invalid);
+		std::string_view bufferView(buffer.data(), buffer.size());
+		const clang::FileEntry* fileEntry =
+		  sourceManager_->getFileEntryForID(fileId);
+		llvm::StringRef realPathName = fileEntry ?
+		  fileEntry->tryGetRealPathName() : llvm::StringRef();
+		if (!invalid && !realPathName.empty()) {
+			iter->second = &cache_->get(realPathName.str(), bufferView);
+		} else {
+			localLineTables_.push_back(std::make_unique<LineTable>(
+			  bufferView));
+			iter->second = localLineTables_.back().get();
+		}
+	}
+	return *iter->second;
+}
+
+// A location is written as its offset, line, and column (for the spelling
+// location), with the file name only given if it differs from the file
+// containing the declaration.
+void ExportVisitor::writeLocation(llvm::json::OStream& json,
+  llvm::StringRef name, clang::SourceLocation loc) {
+	loc = sourceManager_->getSpellingLoc(loc);
+	std::pair<clang::FileID, unsigned> decomposedLoc =
+	  sourceManager_->getDecomposedLoc(loc);
+	std::pair<unsigned, unsigned> lineAndColumn = getLineTable(
+	  decomposedLoc.first).getLineAndColumn(decomposedLoc.second);
+	json.attributeObject(name, [&]() {
+		if (decomposedLoc.first != declFileId_) {
+			json.attribute("file", sourceManager_->getFilename(loc));
+		}
+		json.attribute("offset", decomposedLoc.second);
+		json.attribute("line", lineAndColumn.first);
+		json.attribute("column", lineAndColumn.second);
+	});
+}
+
+// As in Clang, the end of a range is the start of its last token.
+void ExportVisitor::writeRange(llvm::json::OStream& json,
+  llvm::StringRef name, clang::SourceRange range) {
+	if (range.isInvalid()) {return;}
+	json.attributeObject(name, [&]() {
+		writeLocation(json, "begin", range.getBegin());
+		writeLocation(json, "end", range.getEnd());
+	});
+}
+
+void ExportVisitor::writeHeader(llvm::json::OStream& json,
+  llvm::StringRef kind, const clang::NamedDecl* decl) {
+	clang::SourceLocation loc = sourceManager_->getSpellingLoc(
+	  decl->getLocation());
+	declFileId_ = sourceManager_->getFileID(loc);
+	json.attribute("kind", kind);
+	json.attribute("name", decl->getQualifiedNameAsString());
+	json.attribute("file", sourceManager_->getFilename(loc));
+	writeLocation(json, "location", loc);
+}
+
+bool ExportVisitor::VisitVarDecl(clang::VarDecl* varDecl) {
+	if (!options_->varDecls || !isSelected(varDecl->getLocation())) {
+		return true;
+	}
+	llvm::json::OStream json(*out_);
+	json.object([&]() {
+		writeHeader(json, "var", varDecl);
+		writeRange(json, "source", varDecl->getSourceRange());
+	});
+	*out_ << '\n';
+	return true;
+}
+
+bool ExportVisitor::VisitFunctionDecl(clang::FunctionDecl* funcDecl) {
+	if (!options_->functionDecls || !isSelected(funcDecl->getLocation())) {
+		return true;
+	}
+	llvm::json::OStream json(*out_);
+	json.object([&]() {
+		writeHeader(json, "function", funcDecl);
+		json.attribute("templatedKind", llvm::StringRef(
+		  functionDeclTemplatedKindToString(funcDecl->getTemplatedKind())));
+		json.attribute("definition",
+		  funcDecl->isThisDeclarationADefinition());
+		if (funcDecl->getPointOfInstantiation().isValid()) {
+			writeLocation(json, "pointOfInstantiation",
+			  funcDecl->getPointOfInstantiation());
+		}
+		json.attributeObject("ranges", [&]() {
+			writeRange(json, "source", funcDecl->getSourceRange());
+			writeRange(json, "returnType",
+			  funcDecl->getReturnTypeSourceRange());
+			writeRange(json, "parameters",
+			  funcDecl->getParametersSourceRange());
+			writeRange(json, "exceptionSpec",
+			  funcDecl->getExceptionSpecSourceRange());
+			writeRange(json, "ellipsis", clang::SourceRange(
+			  funcDecl->getEllipsisLoc()));
+			if (auto typeSourceInfo = funcDecl->getTypeSourceInfo()) {
+				clang::TypeLoc typeLoc = typeSourceInfo->getTypeLoc();
+				writeRange(json, "type", typeLoc.getSourceRange());
+				if (auto funcTypeLoc =
+				  typeLoc.getAs<clang::FunctionTypeLoc>()) {
+					writeRange(json, "typeReturn",
+					  funcTypeLoc.getReturnLoc().getSourceRange());
+					writeRange(json, "parens", funcTypeLoc.getParensRange());
+				}
+			}
+			if (funcDecl->hasBody()) {
+				writeRange(json, "body",
+				  funcDecl->getBody()->getSourceRange());
+			}
+		});
+	});
+	*out_ << '\n';
+	return true;
+}
+
+class ExportConsumer : public clang::ASTConsumer {
+public:
+	ExportConsumer(LineTableCache& cache, const ExportOptions& options,
+	  JsonlSink& sink) : cache_(&cache), options_(&options), sink_(&sink) {}
+	void HandleTranslationUnit(clang::ASTContext& astContext) final {
+		llvm::TimeTraceScope timeScope("HandleTranslationUnit");
+		// The output for the translation unit is buffered so that it is
+		// not interleaved with that of other translation units.
+		std::string buffer;
+		llvm::raw_string_ostream out(buffer);
+		ExportVisitor visitor(astContext, *cache_, *options_, out);
+		visitor.TraverseDecl(astContext.getTranslationUnitDecl());
+		out.flush();
+		sink_->write(buffer);
+	}
+private:
+	LineTableCache* cache_;
+	const ExportOptions* options_;
+	JsonlSink* sink_;
+};
+
+class ExportAction : public clang::ASTFrontendAction {
+public:
+	ExportAction(LineTableCache& cache, const ExportOptions& options,
+	  JsonlSink& sink) : cache_(&cache), options_(&options), sink_(&sink) {}
+	std::unique_ptr<clang::ASTConsumer> CreateASTConsumer(
+	  clang::CompilerInstance&, clang::StringRef) final {
+		return std::make_unique<ExportConsumer>(*cache_, *options_, *sink_);
+	}
+private:
+	LineTableCache* cache_;
+	const ExportOptions* options_;
+	JsonlSink* sink_;
+};
+
+// The factory is also the per-thread state of runParallel, since the
+// threads only share the line table cache and the output.
+class ExportActionFactory : public ct::FrontendActionFactory,
+  public cal::ParallelAction {
+public:
+	ExportActionFactory(LineTableCache& cache, const ExportOptions& options,
+	  JsonlSink& sink) : cache_(&cache), options_(&options), sink_(&sink) {}
+	std::unique_ptr<clang::FrontendAction> create() final {
+		return std::make_unique<ExportAction>(*cache_, *options_, *sink_);
+	}
+	ct::ToolAction& getToolAction() final {return *this;}
+private:
+	LineTableCache* cache_;
+	const ExportOptions* options_;
+	JsonlSink* sink_;
+};
+
+}
+
+int runJsonlExport(const ct::CompilationDatabase& compilations,
+  const std::vector<std::string>& sources, const ExportOptions& options,
+  llvm::raw_ostream& out) {
+	LineTableCache cache;
+	JsonlSink sink(out);
+	int status = cal::runParallel(compilations, sources, options.numThreads,
+	  [&]() {return std::make_unique<ExportActionFactory>(cache, options,
+	  sink);});
+	out.flush();
+	return status;
+}
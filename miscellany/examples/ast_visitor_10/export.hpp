@@ -0,0 +1,21 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <clang/Tooling/CompilationDatabase.h>
+#include <llvm/Support/raw_ostream.h>
+
+struct ExportOptions {
+	bool processHeaders = false;
+	bool varDecls = false;
+	bool functionDecls = true;
+	unsigned numThreads = 0;
+};
+
+// Write the source ranges of the selected declarations as JSON Lines (i.e.,
+// one JSON object per declaration), with each location given as an offset,
+// line, and column, and with no source text.  The source files are
+// processed in parallel.  Returns zero on success.
+int runJsonlExport(const clang::tooling::CompilationDatabase& compilations,
+  const std::vector<std::string>& sources, const ExportOptions& options,
+  llvm::raw_ostream& out);
@@ -1,4 +1,6 @@
 #include <format>
+#include <cal/ast_cache.hpp>
+#include <cal/time_trace.hpp>
 #include <clang/AST/ASTConsumer.h>
 #include <clang/AST/Decl.h>
 #include <clang/AST/RecursiveASTVisitor.h>
@@ -8,6 +10,7 @@
 #include <clang/Tooling/Tooling.h>
 #include <llvm/Config/llvm-config.h>
 #include <llvm/Support/CommandLine.h>
+#include "export.hpp"
 #include "utilities.hpp"
 
 namespace ct = clang::tooling;
@@ -20,8 +23,15 @@ static lc::opt<bool> clVisitVarDecl("varDecl", lc::cat(toolOptions),
   lc::init(false));
 static lc::opt<bool> clVisitFunctionDecl("functionDecl", lc::cat(toolOptions),
   lc::init(false));
+static lc::opt<std::string> clJsonlFile("jsonl", lc::cat(toolOptions),
+  lc::desc("Export the source ranges (without text) as JSON Lines to the "
+  "specified file (- for standard output)"), lc::value_desc("file"));
+static lc::opt<unsigned> clNumThreads("j", lc::cat(toolOptions),
+  lc::desc("Number of threads for the export (0 means automatic)"),
+  lc::init(0));
 
-void printVarDecl(clang::ASTContext* astContext, clang::VarDecl* varDecl) {
+void printVarDecl(clang::ASTContext* astContext, SourceRenderer& renderer,
+  clang::VarDecl* varDecl) {
 	auto& sourceManager = astContext->getSourceManager();
 
 	llvm::outs() << std::format("{:*<80s}\n", "");
@@ -37,13 +47,13 @@ void printVarDecl(clang::ASTContext* astContext, clang::VarDecl* varDecl) {
 	assert(allSourceRange.isValid());
 	assert(allSourceRange.getBegin() == varDecl->getBeginLoc());
 	assert(allSourceRange.getEnd() == varDecl->getEndLoc());
-	llvm::outs() << std::format("getSourceRange() [source]: {}\n{}",
-	  rangeToString(sourceManager, allSourceRange, false),
-	  getSourceTextWithLineNumbers(sourceManager, allSourceRange));
+	llvm::outs() << std::format("getSourceRange() [source]: {}\n",
+	  rangeToString(sourceManager, allSourceRange, false));
+	renderer.writeWithLineNumbers(llvm::outs(), allSourceRange);
 }
 
 void printFunctionDecl(clang::ASTContext* astContext,
-  clang::FunctionDecl* funcDecl) {
+  SourceRenderer& renderer, clang::FunctionDecl* funcDecl) {
 	auto& sourceManager = astContext->getSourceManager();
 
 	llvm::outs() << std::format("{:*<80s}\n", "");
@@ -64,9 +74,9 @@ void printFunctionDecl(clang::ASTContext* astContext,
 	assert(allSourceRange.isValid());
 	assert(allSourceRange.getBegin() == funcDecl->getBeginLoc());
 	assert(allSourceRange.getEnd() == funcDecl->getEndLoc());
-	llvm::outs() << std::format("getSourceRange() [source]: {}\n{}",
-	  rangeToString(sourceManager, allSourceRange, false),
-	  getSourceTextWithLineNumbers(sourceManager, allSourceRange));
+	llvm::outs() << std::format("getSourceRange() [source]: {}\n",
+	  rangeToString(sourceManager, allSourceRange, false));
+	renderer.writeWithLineNumbers(llvm::outs(), allSourceRange);
 
 #if 1
 	llvm::outs() << std::format("getLocation():\n    {}\n",
@@ -85,15 +95,9 @@ void printFunctionDecl(clang::ASTContext* astContext,
 	  funcDecl->getReturnTypeSourceRange();
 	if (returnTypeSourceRange.isValid()) {
 		llvm::outs() << std::format(
-		  "getReturnTypeSourceRange() [return type]: {}\n{}",
-		  rangeToString(sourceManager, funcDecl->getReturnTypeSourceRange(),
-		  false),
-		  addLineNumbers(getSourceText(sourceManager,
-		  funcDecl->getReturnTypeSourceRange()),
-		  sourceManager.getSpellingLineNumber(
-		  funcDecl->getReturnTypeSourceRange().getBegin()),
-		  sourceManager.getSpellingColumnNumber(
-		  funcDecl->getReturnTypeSourceRange().getBegin())));
+		  "getReturnTypeSourceRange() [return type]: {}\n",
+		  rangeToString(sourceManager, returnTypeSourceRange, false));
+		renderer.writeWithLineNumbers(llvm::outs(), returnTypeSourceRange);
 	} else {
 		llvm::outs() << "no return type\n";
 	}
@@ -102,9 +106,9 @@ void printFunctionDecl(clang::ASTContext* astContext,
 	  funcDecl->getParametersSourceRange()};
 	if (parametersSourceRange.isValid()) {
 		llvm::outs() << std::format(
-		  "getParametersSourceRange() [parameters]: {}\n{}",
-		  rangeToString(sourceManager, parametersSourceRange, false),
-		  getSourceTextWithLineNumbers(sourceManager, parametersSourceRange));
+		  "getParametersSourceRange() [parameters]: {}\n",
+		  rangeToString(sourceManager, parametersSourceRange, false));
+		renderer.writeWithLineNumbers(llvm::outs(), parametersSourceRange);
 	} else {
 		llvm::outs() << "no parameters\n";
 	}
@@ -113,9 +117,9 @@ void printFunctionDecl(clang::ASTContext* astContext,
 	  funcDecl->getExceptionSpecSourceRange()};
 	if (exceptSpecSourceRange.isValid()) {
 		llvm::outs() << std::format(
-		  "getExceptionSpecSourceRange() [exception specifier]: {}\n{}",
-		  rangeToString(sourceManager, exceptSpecSourceRange, false),
-		  getSourceTextWithLineNumbers(sourceManager, exceptSpecSourceRange));
+		  "getExceptionSpecSourceRange() [exception specifier]: {}\n",
+		  rangeToString(sourceManager, exceptSpecSourceRange, false));
+		renderer.writeWithLineNumbers(llvm::outs(), exceptSpecSourceRange);
 	} else {
 		llvm::outs() << "no exceptions specifier\n";
 	}
@@ -130,12 +134,10 @@ void printFunctionDecl(clang::ASTContext* astContext,
 
 	sourceLocation = funcDecl->getEllipsisLoc();
 	if (sourceLocation.isValid()) {
-		llvm::outs() << std::format("getEllipsisLoc() [ellipsis]: {}\n{}",
-		  locationToString(sourceManager, funcDecl->getEllipsisLoc(), false),
-		  getSourceTextWithLineNumbers(sourceManager,
-		  clang::SourceRange(funcDecl->getEllipsisLoc(),
-		  funcDecl->getEllipsisLoc()))
-		  );
+		llvm::outs() << std::format("getEllipsisLoc() [ellipsis]: {}\n",
+		  locationToString(sourceManager, funcDecl->getEllipsisLoc(), false));
+		renderer.writeWithLineNumbers(llvm::outs(),
+		  clang::SourceRange(sourceLocation, sourceLocation));
 	} else {
 		llvm::outs() << "no ellipsis\n";
 	}
@@ -143,10 +145,9 @@ void printFunctionDecl(clang::ASTContext* astContext,
 	clang::SourceRange typeRange{typeLoc.getSourceRange()};
 	if (typeRange.isValid()) {
 		llvm::outs() << std::format(
-		  "getTypeSourceInfo().getTypeLoc().getSourceRange(): {}\n{}",
-		  rangeToString(sourceManager, typeRange, false),
-		  getSourceTextWithLineNumbers(sourceManager, typeRange)
-		  );
+		  "getTypeSourceInfo().getTypeLoc().getSourceRange(): {}\n",
+		  rangeToString(sourceManager, typeRange, false));
+		renderer.writeWithLineNumbers(llvm::outs(), typeRange);
 	} else {
 		llvm::outs() << "no source information\n";
 	}
@@ -154,10 +155,9 @@ void printFunctionDecl(clang::ASTContext* astContext,
 	clang::SourceRange retSourceRange{returnLoc.getSourceRange()};
 	if (retSourceRange.isValid()) {
 		llvm::outs() << std::format(
-		  "getTypeSourceInfo().getTypeLoc().getAs<clang::FunctionTypeLoc>().getReturnLoc() [return type]: {}\n{}",
-		  rangeToString(sourceManager, retSourceRange, false),
-		  getSourceTextWithLineNumbers(sourceManager, retSourceRange)
-		  );
+		  "getTypeSourceInfo().getTypeLoc().getAs<clang::FunctionTypeLoc>().getReturnLoc() [return type]: {}\n",
+		  rangeToString(sourceManager, retSourceRange, false));
+		renderer.writeWithLineNumbers(llvm::outs(), retSourceRange);
 	} else {
 		llvm::outs() << "no return type from source info\n";
 	}
@@ -165,10 +165,9 @@ void printFunctionDecl(clang::ASTContext* astContext,
 	auto parensRange{typeLoc.getAs<clang::FunctionTypeLoc>().getParensRange()};
 	if (parensRange.isValid()) {
 		llvm::outs() << std::format(
-		  "getTypeSourceInfo().getTypeLoc().getAs<clang::FunctionTypeLoc>().getParensRange() [parentheses]: {}\n{}",
-		  rangeToString(sourceManager, parensRange, false),
-		  getSourceTextWithLineNumbers(sourceManager, parensRange)
-		  );
+		  "getTypeSourceInfo().getTypeLoc().getAs<clang::FunctionTypeLoc>().getParensRange() [parentheses]: {}\n",
+		  rangeToString(sourceManager, parensRange, false));
+		renderer.writeWithLineNumbers(llvm::outs(), parensRange);
 	} else {
 		llvm::outs() << "no parentheses\n";
 	}
@@ -176,16 +175,16 @@ void printFunctionDecl(clang::ASTContext* astContext,
 	if (funcDecl->hasBody()) {
 		clang::SourceRange bodyRange = funcDecl->getBody()->getSourceRange();
 		llvm::outs() <<
-		  std::format("getBody()->getSourceRange() [body]: {}\n{}",
-		  rangeToString(sourceManager, bodyRange, false),
-		  getSourceTextWithLineNumbers(sourceManager, bodyRange)
-		  );
+		  std::format("getBody()->getSourceRange() [body]: {}\n",
+		  rangeToString(sourceManager, bodyRange, false));
+		renderer.writeWithLineNumbers(llvm::outs(), bodyRange);
 	}
 }
 
 class MyAstVisitor : public clang::RecursiveASTVisitor<MyAstVisitor> {
 public:
-	MyAstVisitor(clang::ASTContext& astContext) : astContext_(&astContext) {}
+	MyAstVisitor(clang::ASTContext& astContext) : astContext_(&astContext),
+	  renderer_(astContext.getSourceManager()) {}
 	bool VisitVarDecl(clang::VarDecl* varDecl) {
 		if (!clVisitVarDecl) {
 			return true;
@@ -193,7 +192,7 @@ public:
 		auto& sourceManager = astContext_->getSourceManager();
 		const auto& fileId = sourceManager.getFileID(varDecl->getLocation());
 		if (clProcessHeaders || fileId == sourceManager.getMainFileID()) {
-			printVarDecl(astContext_, varDecl);
+			printVarDecl(astContext_, renderer_, varDecl);
 		}
 		return true;
 	}
@@ -204,7 +203,7 @@ public:
 		auto& sourceManager = astContext_->getSourceManager();
 		const auto& fileId = sourceManager.getFileID(funcDecl->getLocation());
 		if (clProcessHeaders || fileId == sourceManager.getMainFileID()) {
-			printFunctionDecl(astContext_, funcDecl);
+			printFunctionDecl(astContext_, renderer_, funcDecl);
 		}
 		return true;
 	}
@@ -213,11 +212,13 @@ public:
 	}
 private:
 	clang::ASTContext* astContext_;
+	SourceRenderer renderer_;
 };
 
 class MyAstConsumer : public clang::ASTConsumer {
 public:
 	void HandleTranslationUnit(clang::ASTContext& astContext) final {
+		llvm::TimeTraceScope timeScope("HandleTranslationUnit");
 		clang::TranslationUnitDecl* tuDecl =
 		  astContext.getTranslationUnitDecl();
 		MyAstVisitor visitor(astContext);
@@ -234,6 +235,8 @@ public:
 };
 
 int main(int argc, char** argv) {
+	cal::addTimeTraceOptions(toolOptions);
+	cal::addAstCacheOptions(toolOptions);
 	auto expectedOptionsParser = ct::CommonOptionsParser::create(argc,
 	  const_cast<const char**>(argv), toolOptions);
 	if (!expectedOptionsParser) {
@@ -242,10 +245,38 @@ int main(int argc, char** argv) {
 		return 1;
 	}
 	ct::CommonOptionsParser& optionsParser = *expectedOptionsParser;
+	cal::TimeTrace timeTrace(argv[0]);
+	if (!clJsonlFile.empty()) {
+		std::error_code errCode;
+		llvm::raw_fd_ostream out(clJsonlFile, errCode);
+		if (errCode) {
+			llvm::errs() << std::format("cannot open {} ({})\n",
+			  std::string(clJsonlFile), errCode.message());
+			return 1;
+		}
+		ExportOptions options;
+		options.processHeaders = clProcessHeaders;
+		options.varDecls = clVisitVarDecl;
+		// Export functions if nothing is selected.
+		options.functionDecls = clVisitFunctionDecl || !clVisitVarDecl;
+		options.numThreads = clNumThreads;
+		int status = runJsonlExport(optionsParser.getCompilations(),
+		  optionsParser.getSourcePathList(), options, out);
+		if (timeTrace.finish()) {status = 1;}
+		if (status) {llvm::errs() << "error detected\n";}
+		return !status ? 0 : 1;
+	}
 	ct::ClangTool tool(optionsParser.getCompilations(),
 	  optionsParser.getSourcePathList());
-	int status = tool.run(
-	  ct::newFrontendActionFactory<MyFrontendAction>().get());
+	auto factory = ct::newFrontendActionFactory<MyFrontendAction>();
+	cal::AstCacheToolAction cacheAction([]() {
+		return std::make_unique<MyAstConsumer>();
+	});
+	cal::TracedToolAction tracedAction(cal::isAstCacheEnabled() ?
+	  static_cast<ct::ToolAction*>(&cacheAction) : factory.get());
+	int status = tool.run(&tracedAction);
+	if (cal::isAstCacheEnabled()) {cacheAction.printStats(llvm::errs());}
+	if (timeTrace.finish()) {status = 1;}
 	if (status) {llvm::errs() << "error detected\n";}
 	return !status ? 0 : 1;
 }
@@ -0,0 +1,75 @@
+// Measure the throughput of rendering source text with line numbers using
+// addLineNumbers (which builds a string) and writeWithLineNumbers (which
+// writes directly to a stream), and check that their output is identical.
+
+#include <chrono>
+#include <cstdlib>
+#include <format>
+#include <string>
+#include <llvm/Support/CommandLine.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/raw_ostream.h>
+#include "utilities.hpp"
+
+namespace lc = llvm::cl;
+
+static lc::OptionCategory toolOptions("Tool Options");
+static lc::list<std::string> clFiles(lc::Positional, lc::cat(toolOptions),
+  lc::desc("<file>..."), lc::OneOrMore);
+static lc::opt<unsigned> clIterations("n", lc::cat(toolOptions),
+  lc::desc("Number of times to render each file"), lc::init(100));
+
+template <class F>
+double measure(unsigned iterations, F func) {
+	auto startTime = std::chrono::steady_clock::now();
+	for (unsigned i = 0; i < iterations; ++i) {func();}
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() -
+	  startTime).count();
+}
+
+int main(int argc, char** argv) {
+	lc::HideUnrelatedOptions(toolOptions);
+	lc::ParseCommandLineOptions(argc, argv);
+	int status = 0;
+	for (const auto& file : clFiles) {
+		auto buffer = llvm::MemoryBuffer::getFile(file);
+		if (!buffer) {
+			llvm::errs() << std::format("cannot read {}\n", file);
+			status = 1;
+			continue;
+		}
+		llvm::StringRef text = (*buffer)->getBuffer();
+		std::string source(text);
+
+		// Check that the output is identical for each combination of the
+		// starting column and the header flag.
+		for (unsigned startCol : {1, 5}) {
+			for (bool includeHeader : {false, true}) {
+				std::string expected = addLineNumbers(source, 1, startCol,
+				  includeHeader);
+				std::string actual;
+				llvm::raw_string_ostream out(actual);
+				writeWithLineNumbers(out, text, 1, startCol, includeHeader);
+				out.flush();
+				if (actual != expected) {
+					llvm::errs() << std::format("{}: output differs (start "
+					  "column {}, header {})\n", file, startCol, includeHeader);
+					status = 1;
+				}
+			}
+		}
+
+		llvm::raw_null_ostream out;
+		double oldTime = measure(clIterations, [&]() {
+			out << addLineNumbers(source, 1, 1, true);
+		});
+		double newTime = measure(clIterations, [&]() {
+			writeWithLineNumbers(out, text, 1, 1, true);
+		});
+		double megabytes = double(text.size()) * clIterations / 1e6;
+		llvm::outs() << std::format("{}: addLineNumbers {:.1f} MB/s, "
+		  "writeWithLineNumbers {:.1f} MB/s ({:.1f}x)\n", file,
+		  megabytes / oldTime, megabytes / newTime, oldTime / newTime);
+	}
+	return status;
+}
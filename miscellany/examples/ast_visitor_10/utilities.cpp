@@ -1,9 +1,13 @@
+#include <algorithm>
 #include <format>
 #include <string>
+#include <string_view>
 
+#include <cal/enum_names.hpp>
 #include <clang/Basic/SourceManager.h>
 #include <clang/Basic/SourceLocation.h>
 #include <clang/Lex/Lexer.h>
+#include <llvm/Support/Format.h>
 
 #include "utilities.hpp"
 
@@ -103,21 +107,119 @@ std::string getSourceTextWithLineNumbers(clang::SourceManager& sourceManager,
 	  includeHeader);
 }
 
-std::string functionDeclTemplatedKindToString(
+std::string_view functionDeclTemplatedKindToString(
   clang::FunctionDecl::TemplatedKind kind) {
-	std::map<clang::FunctionDecl::TemplatedKind, std::string> lut{
-		{clang::FunctionDecl::TemplatedKind::TK_NonTemplate,
-		  "nontemplate"},
-		{clang::FunctionDecl::TemplatedKind::TK_FunctionTemplate,
-		  "function template"},
-		{clang::FunctionDecl::TemplatedKind::TK_MemberSpecialization,
-		  "member specialization"},
-		{clang::FunctionDecl::TemplatedKind::TK_FunctionTemplateSpecialization,
+	using TK = clang::FunctionDecl::TemplatedKind;
+	static constexpr auto lut = cal::makeEnumNames<TK>({
+		{TK::TK_NonTemplate, "nontemplate"},
+		{TK::TK_FunctionTemplate, "function template"},
+		{TK::TK_MemberSpecialization, "member specialization"},
+		{TK::TK_FunctionTemplateSpecialization,
 		  "function template specialization"},
-		{clang::FunctionDecl::TemplatedKind::TK_DependentFunctionTemplateSpecialization,
-		  "dependent function template specialization"}
-	};
-	auto i = lut.find(kind);
-	assert(i != lut.end());
-	return i != lut.end() ? i->second : "";
+		{TK::TK_DependentFunctionTemplateSpecialization,
+		  "dependent function template specialization"},
+		{TK::TK_DependentNonTemplate, "dependent nontemplate"},
+	}, "");
+	static_assert(lut.covers(TK::TK_NonTemplate, TK::TK_DependentNonTemplate));
+	assert(lut.contains(kind));
+	return lut(kind);
+}
+
+LineTable::LineTable(std::string_view buffer) {
+	lineStarts_.push_back(0);
+	for (std::size_t i = 0; i < buffer.size(); ++i) {
+		if (buffer[i] == '\r' && i + 1 < buffer.size() &&
+		  buffer[i + 1] == '\n') {
+			++i;
+		} else if (buffer[i] != '\n' && buffer[i] != '\r') {
+			continue;
+		}
+		lineStarts_.push_back(i + 1);
+	}
+}
+
+std::pair<unsigned, unsigned> LineTable::getLineAndColumn(unsigned offset)
+  const {
+	auto i = std::upper_bound(lineStarts_.begin(), lineStarts_.end(),
+	  offset);
+	unsigned line = i - lineStarts_.begin();
+	return {line, offset - lineStarts_[line - 1] + 1};
+}
+
+void writeWithLineNumbers(llvm::raw_ostream& out, llvm::StringRef source,
+  unsigned int startLine, unsigned int startCol, bool includeHeader) {
+	if (source.empty()) {
+		if (startCol > 1) {out << '\n';}
+		return;
+	}
+	if (includeHeader) {
+		out << "      "
+		  "0000000001111111111222222222233333333334444444444"
+		  "555555555566666666667\n"
+		  "      "
+		  "12345678901234567890123456789012345678901234567890"
+		  "12345678901234567890\n";
+	}
+	while (!source.empty()) {
+		std::size_t lineEnd = source.find('\n');
+		llvm::StringRef line = (lineEnd != llvm::StringRef::npos) ?
+		  source.take_front(lineEnd + 1) : source;
+		out << llvm::format_decimal(startLine, 4) << ": ";
+		out.indent(startCol - 1);
+		out << line;
+		source = source.drop_front(line.size());
+		if (line.back() == '\n') {
+			++startLine;
+			startCol = 1;
+		} else {
+			// The last line is not terminated.
+			out << '\n';
+		}
+	}
+}
+
+const LineTable& SourceRenderer::getLineTable(clang::FileID fileId) {
+	std::unique_ptr<LineTable>& table = lineTables_[fileId];
+	if (!table) {
+		bool invalid = false;
+		llvm::StringRef buffer = sourceManager_->getBufferData(fileId,
+		  &invalid);
+		table = std::make_unique<LineTable>(std::string_view(buffer.data(),
+		  buffer.size()));
+	}
+	return *table;
+}
+
+llvm::StringRef SourceRenderer::getText(clang::SourceRange sourceRange) {
+	assert(sourceRange.isValid());
+	// As in getSourceText, the end of the last token is found using the
+	// default language options.  These are only constructed once.
+	static const clang::LangOptions langOpts;
+	clang::SourceLocation startLoc = sourceManager_->getSpellingLoc(
+	  sourceRange.getBegin());
+	clang::SourceLocation lastTokenLoc = sourceManager_->getSpellingLoc(
+	  sourceRange.getEnd());
+	auto [fileId, beginOffset] = sourceManager_->getDecomposedLoc(startLoc);
+	auto [endFileId, endOffset] = sourceManager_->getDecomposedLoc(
+	  lastTokenLoc);
+	if (fileId != endFileId) {return {};}
+	endOffset += clang::Lexer::MeasureTokenLength(lastTokenLoc,
+	  *sourceManager_, langOpts);
+	bool invalid = false;
+	llvm::StringRef buffer = sourceManager_->getBufferData(fileId, &invalid);
+	if (invalid || beginOffset > endOffset || endOffset > buffer.size()) {
+		return {};
+	}
+	return buffer.slice(beginOffset, endOffset);
+}
+
+void SourceRenderer::writeWithLineNumbers(llvm::raw_ostream& out,
+  clang::SourceRange sourceRange, bool includeHeader) {
+	assert(sourceRange.isValid());
+	clang::SourceLocation startLoc = sourceManager_->getSpellingLoc(
+	  sourceRange.getBegin());
+	auto [fileId, offset] = sourceManager_->getDecomposedLoc(startLoc);
+	auto [line, column] = getLineTable(fileId).getLineAndColumn(offset);
+	::writeWithLineNumbers(out, getText(sourceRange), line, column,
+	  includeHeader);
 }
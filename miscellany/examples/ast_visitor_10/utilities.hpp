@@ -1,7 +1,14 @@
+#include <memory>
 #include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
 #include <clang/AST/Decl.h>
 #include <clang/Basic/SourceManager.h>
 #include <clang/Basic/SourceLocation.h>
+#include <llvm/ADT/DenseMap.h>
+#include <llvm/ADT/StringRef.h>
+#include <llvm/Support/raw_ostream.h>
 
 std::string locationToString(const clang::SourceManager& sourceManager,
   clang::SourceLocation sourceLoc, bool includeFileName = true);
@@ -21,4 +28,48 @@ std::string addLineNumbers(const std::string& source, unsigned int startLine,
 std::string getSourceTextWithLineNumbers(clang::SourceManager& sourceManager,
   clang::SourceRange sourceRange, bool includeHeader = true);
 
-std::string functionDeclTemplatedKindToString(clang::FunctionDecl::TemplatedKind kind);
+std::string_view functionDeclTemplatedKindToString(
+  clang::FunctionDecl::TemplatedKind kind);
+
+// The offset of the start of each line in a file, so that offsets can be
+// mapped to line and column numbers without rescanning the file.
+// As in Clang, each of LF, CR, and CRLF ends a line, and columns are
+// numbered in bytes.
+class LineTable {
+public:
+	explicit LineTable(std::string_view buffer);
+	// Get the (one-based) line and column numbers for an offset.
+	std::pair<unsigned, unsigned> getLineAndColumn(unsigned offset) const;
+	// Get the offset of the start of a (one-based) line.
+	unsigned getLineStart(unsigned line) const
+	  {return lineStarts_[line - 1];}
+	unsigned getNumLines() const {return lineStarts_.size();}
+private:
+	std::vector<unsigned> lineStarts_;
+};
+
+// Write source text with line numbers (and optionally a column-number
+// header).  The output is identical to that of addLineNumbers, but it is
+// written directly to the stream without building any strings.
+void writeWithLineNumbers(llvm::raw_ostream& out, llvm::StringRef source,
+  unsigned int startLine, unsigned int startCol = 1,
+  bool includeHeader = true);
+
+// Renders the source text for ranges in one translation unit.
+// The text is a view of the source manager's buffer, and line and column
+// numbers are found using a line table for each file, so that rendering a
+// range allocates no memory (after the line table for its file is built).
+class SourceRenderer {
+public:
+	explicit SourceRenderer(const clang::SourceManager& sourceManager) :
+	  sourceManager_(&sourceManager) {}
+	// Get the same text as getSourceText.
+	llvm::StringRef getText(clang::SourceRange sourceRange);
+	// Write the same text as getSourceTextWithLineNumbers.
+	void writeWithLineNumbers(llvm::raw_ostream& out,
+	  clang::SourceRange sourceRange, bool includeHeader = true);
+private:
+	const LineTable& getLineTable(clang::FileID fileId);
+	const clang::SourceManager* sourceManager_;
+	llvm::DenseMap<clang::FileID, std::unique_ptr<LineTable>> lineTables_;
+};
@@ -0,0 +1,77 @@
+// Compare the per-call cost of translating an enumerator to a name using a
+// std::map constructed on each call (as was formerly done in several of the
+// example programs) with that of using a cal::EnumNames table.
+
+#include <cal/enum_names.hpp>
+#include <chrono>
+#include <cstdlib>
+#include <format>
+#include <iostream>
+#include <map>
+#include <string>
+#include <string_view>
+#include <vector>
+
+enum class Kind {
+	nonTemplate,
+	functionTemplate,
+	memberSpecialization,
+	functionTemplateSpecialization,
+	dependentFunctionTemplateSpecialization,
+	dependentNonTemplate,
+};
+
+std::string mapToString(Kind kind) {
+	std::map<Kind, std::string> lut{
+		{Kind::nonTemplate, "nontemplate"},
+		{Kind::functionTemplate, "function template"},
+		{Kind::memberSpecialization, "member specialization"},
+		{Kind::functionTemplateSpecialization,
+		  "function template specialization"},
+		{Kind::dependentFunctionTemplateSpecialization,
+		  "dependent function template specialization"},
+		{Kind::dependentNonTemplate, "dependent nontemplate"},
+	};
+	auto i = lut.find(kind);
+	return i != lut.end() ? i->second : "unknown";
+}
+
+constexpr auto kindNames = cal::makeEnumNames<Kind>({
+	{Kind::nonTemplate, "nontemplate"},
+	{Kind::functionTemplate, "function template"},
+	{Kind::memberSpecialization, "member specialization"},
+	{Kind::functionTemplateSpecialization,
+	  "function template specialization"},
+	{Kind::dependentFunctionTemplateSpecialization,
+	  "dependent function template specialization"},
+	{Kind::dependentNonTemplate, "dependent nontemplate"},
+});
+static_assert(kindNames.covers(Kind::nonTemplate,
+  Kind::dependentNonTemplate));
+
+std::string_view tableToString(Kind kind) {return kindNames(kind);}
+
+template <class F>
+void run(std::string_view name, const std::vector<Kind>& kinds, F func) {
+	auto startTime = std::chrono::steady_clock::now();
+	std::size_t total = 0;
+	for (auto kind : kinds) {total += func(kind).size();}
+	std::chrono::duration<double, std::nano> elapsed =
+	  std::chrono::steady_clock::now() - startTime;
+	std::cout << std::format("{:<8} {:10.2f} ns/call (checksum {})\n", name,
+	  elapsed.count() / kinds.size(), total);
+}
+
+int main(int argc, char** argv) {
+	std::size_t numCalls = (argc >= 2) ? std::atol(argv[1]) : 1'000'000;
+	if (!numCalls) {numCalls = 1;}
+	std::vector<Kind> kinds;
+	kinds.reserve(numCalls);
+	unsigned seed = 1;
+	for (std::size_t i = 0; i < numCalls; ++i) {
+		seed = seed * 1103515245 + 12345;
+		kinds.push_back(static_cast<Kind>((seed >> 16) % 6));
+	}
+	run("map", kinds, mapToString);
+	run("table", kinds, tableToString);
+}
@@ -0,0 +1,257 @@
+#include <cstdint>
+#include <format>
+#include <optional>
+#include <string>
+#include <clang/Basic/SourceManager.h>
+#include <clang/Frontend/ASTUnit.h>
+#include <clang/Frontend/CompilerInstance.h>
+#include <clang/Frontend/CompilerInvocation.h>
+#include <clang/Lex/HeaderSearchOptions.h>
+#include <llvm/ADT/SmallString.h>
+#include <llvm/Config/llvm-config.h>
+#include <llvm/Support/Error.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/Path.h>
+#include <llvm/Support/TimeProfiler.h>
+#include <llvm/Support/VirtualFileSystem.h>
+#include <llvm/Support/xxhash.h>
+#include "cal/ast_cache.hpp"
+
+namespace cal {
+
+static llvm::cl::opt<std::string> clAstCacheDir("ast-cache",
+  llvm::cl::desc("Keep the AST of each TU in the specified directory (so "
+  "that an unchanged TU is not parsed again)"), llvm::cl::value_desc("dir"));
+
+void addAstCacheOptions(llvm::cl::OptionCategory& category)
+{
+	clAstCacheDir.addCategory(category);
+}
+
+bool isAstCacheEnabled()
+{
+	return !clAstCacheDir.empty();
+}
+
+static double toSeconds(std::chrono::nanoseconds t)
+{
+	return std::chrono::duration<double>(t).count();
+}
+
+// Get a hash of the contents of a file (or nothing if the file cannot be
+// read).  The file system of the tool is used, so that a relative pathname
+// is relative to the working directory of the compile command.
+static std::optional<std::uint64_t> hashFile(
+  llvm::vfs::FileSystem& fileSystem, const llvm::Twine& pathName)
+{
+	auto buffer = fileSystem.getBufferForFile(pathName);
+	if (!buffer) {return std::nullopt;}
+	return llvm::xxHash64((*buffer)->getBuffer());
+}
+
+// Get the key for a TU, which is a hash of the compile command (including
+// the working directory) and the contents of the main file.
+static std::optional<std::string> getCacheKey(
+  const clang::CompilerInvocation& invocation,
+  llvm::vfs::FileSystem& fileSystem)
+{
+	const auto& inputs = invocation.getFrontendOpts().Inputs;
+	if (inputs.size() != 1 || !inputs.front().isFile()) {return std::nullopt;}
+	auto mainFileHash = hashFile(fileSystem, inputs.front().getFile());
+	if (!mainFileHash) {return std::nullopt;}
+	std::string command;
+	if (auto workingDir = fileSystem.getCurrentWorkingDirectory()) {
+		command = *workingDir;
+	}
+	for (const auto& arg : invocation.getCC1CommandLine()) {
+		command += '\0';
+		command += arg;
+	}
+	return std::format("{:016x}{:016x}", llvm::xxHash64(command),
+	  *mainFileHash);
+}
+
+// Test if none of the files listed in a manifest has changed.  The
+// manifest has one line per file, with the hash of its contents (in hex)
+// followed by a space and its absolute pathname.
+static bool isManifestValid(llvm::vfs::FileSystem& fileSystem,
+  const std::string& pathName)
+{
+	auto buffer = fileSystem.getBufferForFile(pathName);
+	if (!buffer) {return false;}
+	llvm::StringRef data = (*buffer)->getBuffer();
+	while (!data.empty()) {
+		auto [line, rest] = data.split('\n');
+		data = rest;
+		auto [hashString, depPathName] = line.split(' ');
+		std::uint64_t hash;
+		if (hashString.getAsInteger(16, hash) || depPathName.empty()) {
+			return false;
+		}
+		auto depHash = hashFile(fileSystem, depPathName);
+		if (!depHash || *depHash != hash) {return false;}
+	}
+	return true;
+}
+
+// Get the manifest for a parsed TU (or nothing if one of the files that
+// the TU depends on cannot be read).
+static std::optional<std::string> makeManifest(clang::ASTUnit& astUnit,
+  llvm::vfs::FileSystem& fileSystem)
+{
+	const clang::SourceManager& sourceManager = astUnit.getSourceManager();
+	std::string manifest;
+	for (auto i = sourceManager.fileinfo_begin();
+	  i != sourceManager.fileinfo_end(); ++i) {
+#if LLVM_VERSION_MAJOR >= 18
+		llvm::SmallString<256> pathName(i->first.getName());
+#else
+		llvm::SmallString<256> pathName(i->first->getName());
+#endif
+		if (fileSystem.makeAbsolute(pathName)) {return std::nullopt;}
+		auto hash = hashFile(fileSystem, pathName);
+		if (!hash) {return std::nullopt;}
+		manifest += std::format("{:016x} {}\n", *hash,
+		  std::string(pathName));
+	}
+	return manifest;
+}
+
+// Save the AST of a TU and then its manifest (so that the presence of a
+// manifest implies that of the AST file).  Both files are written to
+// temporary files and then renamed, so that a concurrent run never sees a
+// partially written file.  Returns zero on success.
+static int saveAst(clang::ASTUnit& astUnit, const std::string& astPathName,
+  const std::string& manifest)
+{
+	llvm::StringRef cacheDir = llvm::sys::path::parent_path(astPathName);
+	if (std::error_code errCode =
+	  llvm::sys::fs::create_directories(cacheDir)) {
+		llvm::errs() << std::format("cannot create directory {} ({})\n",
+		  cacheDir.str(), errCode.message());
+		return 1;
+	}
+	if (astUnit.Save(astPathName)) {
+		llvm::errs() << std::format("cannot save AST file {}\n",
+		  astPathName);
+		return 1;
+	}
+	std::string manifestPathName = astPathName + ".deps";
+	if (auto error = llvm::writeToOutput(manifestPathName,
+	  [&](llvm::raw_ostream& out) {
+		out << manifest;
+		return llvm::Error::success();
+	})) {
+		llvm::errs() << std::format("cannot write {} ({})\n",
+		  manifestPathName, llvm::toString(std::move(error)));
+		return 1;
+	}
+	return 0;
+}
+
+static void runConsumer(clang::ASTConsumer& consumer, clang::ASTUnit& astUnit)
+{
+	clang::ASTContext& astContext = astUnit.getASTContext();
+	consumer.Initialize(astContext);
+	consumer.HandleTranslationUnit(astContext);
+}
+
+// The cache directory is made absolute when the action is created (i.e.,
+// before the tool runs), since a relative pathname would otherwise be
+// resolved against the working directory of each compile command.
+AstCacheToolAction::AstCacheToolAction(ConsumerFactory consumerFactory) :
+  consumerFactory_(std::move(consumerFactory))
+{
+	llvm::SmallString<256> cacheDir(clAstCacheDir);
+	if (!cacheDir.empty()) {llvm::sys::fs::make_absolute(cacheDir);}
+	cacheDir_ = std::string(cacheDir);
+}
+
+bool AstCacheToolAction::runInvocation(
+  std::shared_ptr<clang::CompilerInvocation> invocation,
+  clang::FileManager* files,
+  std::shared_ptr<clang::PCHContainerOperations> pchContainerOps,
+  clang::DiagnosticConsumer* diagConsumer)
+{
+	llvm::vfs::FileSystem& fileSystem = files->getVirtualFileSystem();
+	std::string astPathName;
+	if (auto key = getCacheKey(*invocation, fileSystem)) {
+		llvm::SmallString<256> pathName(cacheDir_);
+		llvm::sys::path::append(pathName, *key + ".ast");
+		astPathName = std::string(pathName);
+	}
+
+	// On a hit, load the AST.  If the AST file cannot be loaded (e.g.,
+	// since it was written by a different version of Clang), the TU is
+	// parsed as for a miss.
+	if (!astPathName.empty() &&
+	  isManifestValid(fileSystem, astPathName + ".deps")) {
+		llvm::TimeTraceScope timeScope("LoadAST", astPathName);
+		auto startTime = std::chrono::steady_clock::now();
+		auto diags = clang::CompilerInstance::createDiagnostics(
+		  &invocation->getDiagnosticOpts(), diagConsumer, false);
+		std::unique_ptr<clang::ASTUnit> astUnit =
+		  clang::ASTUnit::LoadFromASTFile(astPathName,
+		  pchContainerOps->getRawReader(), clang::ASTUnit::LoadEverything,
+		  diags, invocation->getFileSystemOpts()
+#if LLVM_VERSION_MAJOR >= 17
+		  , std::make_shared<clang::HeaderSearchOptions>(
+		  invocation->getHeaderSearchOpts())
+#endif
+		  );
+		if (astUnit) {
+			loadTime_ += std::chrono::steady_clock::now() - startTime;
+			++numHits_;
+			runConsumer(*consumerFactory_(), *astUnit);
+			return true;
+		}
+	}
+
+	++numMisses_;
+	auto startTime = std::chrono::steady_clock::now();
+	auto diags = clang::CompilerInstance::createDiagnostics(
+	  &invocation->getDiagnosticOpts(), diagConsumer, false);
+	std::unique_ptr<clang::ASTUnit> astUnit =
+	  clang::ASTUnit::LoadFromCompilerInvocation(invocation,
+	  std::move(pchContainerOps), diags, files);
+	parseTime_ += std::chrono::steady_clock::now() - startTime;
+	if (!astUnit) {return false;}
+	runConsumer(*consumerFactory_(), *astUnit);
+	// A TU with errors is not cached, so that its diagnostics are issued
+	// again by the next run.
+	if (astUnit->getDiagnostics().hasErrorOccurred()) {return false;}
+	if (!astPathName.empty()) {
+		llvm::TimeTraceScope timeScope("SaveAST", astPathName);
+		startTime = std::chrono::steady_clock::now();
+		auto manifest = makeManifest(*astUnit, fileSystem);
+		if (!manifest || saveAst(*astUnit, astPathName, *manifest)) {
+			++numSaveFailures_;
+		}
+		saveTime_ += std::chrono::steady_clock::now() - startTime;
+	}
+	return true;
+}
+
+void AstCacheToolAction::printStats(llvm::raw_ostream& out) const
+{
+	double loadTime = toSeconds(loadTime_);
+	double parseTime = toSeconds(parseTime_);
+	out << std::format("AST cache: {} hits, {} misses ({} not saved)\n",
+	  numHits_, numMisses_, numSaveFailures_);
+	if (numHits_) {
+		out << std::format("load time: {:.3f} s ({:.3f} s per TU)\n",
+		  loadTime, loadTime / numHits_);
+	}
+	if (numMisses_) {
+		out << std::format("parse time: {:.3f} s ({:.3f} s per TU)\n",
+		  parseTime, parseTime / numMisses_);
+		out << std::format("save time: {:.3f} s\n", toSeconds(saveTime_));
+	}
+	if (numHits_ && numMisses_ && loadTime > 0) {
+		out << std::format("load speedup per TU: {:.1f}x\n",
+		  (parseTime / numMisses_) / (loadTime / numHits_));
+	}
+}
+
+} // namespace cal
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <string>
+#include <clang/AST/ASTConsumer.h>
+#include <clang/Tooling/Tooling.h>
+#include <llvm/Support/CommandLine.h>
+#include <llvm/Support/raw_ostream.h>
+
+namespace cal {
+
+// Support for the -ast-cache option, which keeps the AST of each
+// translation unit in a directory (as an AST file), so that a later run of
+// a tool over an unchanged TU loads the AST instead of parsing the TU.
+//
+// The AST file for a TU is keyed by a hash of the compile command (i.e.,
+// the cc1 arguments) and the contents of the main file.  A manifest stored
+// with the AST file lists every file that the TU depends on (e.g., the
+// headers that it includes) along with a hash of its contents, and the
+// cached AST is only used if none of these files has changed.
+//
+// Only the HandleTranslationUnit member of the consumer is invoked for a
+// loaded AST, which suffices for a consumer that does all of its work
+// there (e.g., the consumer for a MatchFinder).
+//
+// A tool uses this as follows:
+//
+//   cal::addAstCacheOptions(toolCategory);
+//   ... parse the command line ...
+//   cal::AstCacheToolAction cacheAction([&]() {return ...consumer...;});
+//   ... run the tool with cacheAction if isAstCacheEnabled() ...
+//   cacheAction.printStats(llvm::errs());
+
+// Add the -ast-cache option to the specified option category.
+void addAstCacheOptions(llvm::cl::OptionCategory& category);
+
+// Test if the AST cache is enabled.
+bool isAstCacheEnabled();
+
+// A tool action that runs an AST consumer on the AST of each TU, where the
+// AST is loaded from the cache if possible, and otherwise parsed and then
+// saved in the cache.
+class AstCacheToolAction : public clang::tooling::ToolAction {
+public:
+	// A function that creates the consumer for one TU.
+	using ConsumerFactory =
+	  std::function<std::unique_ptr<clang::ASTConsumer>()>;
+	explicit AstCacheToolAction(ConsumerFactory consumerFactory);
+	bool runInvocation(std::shared_ptr<clang::CompilerInvocation> invocation,
+	  clang::FileManager* files,
+	  std::shared_ptr<clang::PCHContainerOperations> pchContainerOps,
+	  clang::DiagnosticConsumer* diagConsumer) override;
+	// Print the number of hits and misses, and the time spent loading
+	// (for hits) versus parsing (for misses).
+	void printStats(llvm::raw_ostream& out) const;
+private:
+	ConsumerFactory consumerFactory_;
+	// The absolute pathname of the cache directory.
+	std::string cacheDir_;
+	unsigned numHits_ = 0;
+	unsigned numMisses_ = 0;
+	unsigned numSaveFailures_ = 0;
+	std::chrono::nanoseconds loadTime_{0};
+	std::chrono::nanoseconds parseTime_{0};
+	std::chrono::nanoseconds saveTime_{0};
+};
+
+} // namespace cal
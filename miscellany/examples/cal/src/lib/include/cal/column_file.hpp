@@ -0,0 +1,274 @@
+#pragma once
+
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <format>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include <llvm/ADT/StringMap.h>
+#include <llvm/Support/Endian.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/SwapByteOrder.h>
+#include <llvm/Support/raw_ostream.h>
+
+// Support for files that hold a table of 32-bit unsigned integers in
+// columnar form (i.e., with the values of each column stored
+// contiguously), with the string values dictionary encoded (with ID 0
+// being the empty string).  Such a file (e.g., an index written by a tool)
+// is meant to be memory mapped and queried in place by a tool that does
+// not use Clang, so this header only depends on LLVM.
+//
+// A file has the following layout (with all integers stored as 32-bit
+// little endian):
+//   header: magic (8 bytes), version, column count, row count, string
+//     count, string pool size
+//   string offsets: one per string (into the string pool)
+//   columns: each with one entry per row
+//   string pool: null-terminated strings
+// Since every integer is 4-byte aligned, the columns of a memory-mapped
+// file are used in place as arrays.
+
+namespace cal {
+
+// The kind of a column file, which is checked when a file is opened.
+struct ColumnFileFormat {
+	// The magic string (of exactly 8 characters, including any padding).
+	std::string_view magic;
+	std::uint32_t version;
+	std::size_t numColumns;
+	// A description of the kind of file for error messages (e.g., "a call
+	// index").
+	std::string_view description;
+};
+
+// Collects the rows of a table and writes them to a file.
+class ColumnFileWriter {
+public:
+	explicit ColumnFileWriter(std::size_t numColumns) : columns_(numColumns)
+	  {getStringId("");}
+
+	// Get the ID of a string (adding it to the dictionary if necessary).
+	std::uint32_t getStringId(std::string_view s) {
+		auto [iter, inserted] = ids_.try_emplace(s, stringOffsets_.size());
+		if (inserted) {
+			stringOffsets_.push_back(stringPool_.size());
+			stringPool_.append(s);
+			stringPool_.push_back('\0');
+		}
+		return iter->second;
+	}
+
+	// Add a row (with one value per column) and return its index.
+	std::uint32_t addRow(std::span<const std::uint32_t> row) {
+		assert(row.size() == columns_.size());
+		std::uint32_t index = size();
+		for (std::size_t i = 0; i < columns_.size(); ++i) {
+			columns_[i].push_back(row[i]);
+		}
+		return index;
+	}
+
+	std::size_t size() const
+	  {return !columns_.empty() ? columns_[0].size() : 0;}
+	std::uint32_t getInt(std::size_t column, std::size_t row) const
+	  {return columns_[column][row];}
+	// Get a string from its ID.
+	std::string_view getString(std::uint32_t id) const
+	  {return std::string_view(stringPool_.data() + stringOffsets_[id]);}
+
+	// Reserve space for the specified number of rows.
+	void reserve(std::size_t numRows) {
+		for (auto& column : columns_) {column.reserve(numRows);}
+	}
+
+	// Write the file.  Returns zero on success.
+	int write(const std::string& pathName, const ColumnFileFormat& format)
+	  const {
+		assert(format.magic.size() == 8 &&
+		  format.numColumns == columns_.size());
+		std::error_code errCode;
+		llvm::raw_fd_ostream out(pathName, errCode);
+		if (errCode) {
+			llvm::errs() << std::format("cannot open {} ({})\n", pathName,
+			  errCode.message());
+			return 1;
+		}
+		out << format.magic;
+		writeInt(out, format.version);
+		writeInt(out, columns_.size());
+		writeInt(out, size());
+		writeInt(out, stringOffsets_.size());
+		writeInt(out, stringPool_.size());
+		for (auto offset : stringOffsets_) {writeInt(out, offset);}
+		for (const auto& column : columns_) {
+			for (auto value : column) {writeInt(out, value);}
+		}
+		out << stringPool_;
+		out.close();
+		if (out.has_error()) {
+			llvm::errs() << std::format("cannot write {} ({})\n", pathName,
+			  out.error().message());
+			out.clear_error();
+			return 1;
+		}
+		return 0;
+	}
+
+private:
+	static void writeInt(llvm::raw_ostream& out, std::uint32_t value) {
+		char buffer[4];
+		llvm::support::endian::write32le(buffer, value);
+		out.write(buffer, sizeof(buffer));
+	}
+
+	llvm::StringMap<std::uint32_t> ids_;
+	std::vector<std::uint32_t> stringOffsets_;
+	std::string stringPool_;
+	std::vector<std::vector<std::uint32_t>> columns_;
+};
+
+// A read-only view of a memory-mapped file.
+class ColumnFile {
+public:
+	// Returns null (and sets the error message) if the file cannot be
+	// read or is not a valid file of the specified format.
+	static std::unique_ptr<ColumnFile> open(const std::string& pathName,
+	  const ColumnFileFormat& format, std::string& error) {
+		// The columns are used in place, which requires a little-endian
+		// host.
+		if (!llvm::sys::IsLittleEndianHost) {
+			error = "column files require a little-endian host";
+			return nullptr;
+		}
+		// The file is memory mapped (when it is large enough for this to
+		// be worthwhile), so only the pages touched by a query are read.
+		auto buffer = llvm::MemoryBuffer::getFile(pathName, false, false);
+		if (!buffer) {
+			error = std::format("cannot open {} ({})", pathName,
+			  buffer.getError().message());
+			return nullptr;
+		}
+		const char* data = (*buffer)->getBufferStart();
+		std::size_t size = (*buffer)->getBufferSize();
+		if (size < headerSize || std::string_view(data, 8) != format.magic) {
+			error = std::format("{} is not {}", pathName, format.description);
+			return nullptr;
+		}
+		const char* header = data + 8;
+		if (llvm::support::endian::read32le(header) != format.version ||
+		  llvm::support::endian::read32le(header + 4) != format.numColumns) {
+			error = std::format("{} has an unsupported version", pathName);
+			return nullptr;
+		}
+		std::size_t numRows = llvm::support::endian::read32le(header + 8);
+		std::size_t numStrings = llvm::support::endian::read32le(header + 12);
+		std::size_t stringPoolSize =
+		  llvm::support::endian::read32le(header + 16);
+		std::size_t columnsSize = std::size_t(4) * format.numColumns *
+		  numRows;
+		if (size != headerSize + 4 * numStrings + columnsSize +
+		  stringPoolSize || (stringPoolSize && data[size - 1] != '\0')) {
+			error = std::format("{} is corrupt", pathName);
+			return nullptr;
+		}
+		// A memory buffer is at least page (or 16-byte) aligned, so the
+		// columns are suitably aligned for use as arrays.
+		if (reinterpret_cast<std::uintptr_t>(data) % alignof(std::uint32_t)) {
+			error = std::format("{} is not aligned", pathName);
+			return nullptr;
+		}
+		std::unique_ptr<ColumnFile> file(new ColumnFile);
+		file->stringOffsets_ = reinterpret_cast<const std::uint32_t*>(data +
+		  headerSize);
+		file->columns_ = file->stringOffsets_ + numStrings;
+		file->stringPool_ = data + headerSize + 4 * numStrings + columnsSize;
+		file->numRows_ = numRows;
+		file->numStrings_ = numStrings;
+		file->stringPoolSize_ = stringPoolSize;
+		file->buffer_ = std::move(*buffer);
+		return file;
+	}
+
+	std::size_t size() const {return numRows_;}
+	const std::uint32_t* getColumn(std::size_t column) const
+	  {return columns_ + column * numRows_;}
+	std::uint32_t getInt(std::size_t column, std::size_t row) const
+	  {return getColumn(column)[row];}
+
+	std::size_t getNumStrings() const {return numStrings_;}
+	// Get a string from its ID (or the empty string for an invalid ID).
+	std::string_view getString(std::uint32_t id) const {
+		// Since the string pool is null terminated, any in-range offset
+		// yields a valid string.
+		if (id >= numStrings_ || stringOffsets_[id] >= stringPoolSize_) {
+			return std::string_view();
+		}
+		return std::string_view(stringPool_ + stringOffsets_[id]);
+	}
+	std::string_view getString(std::size_t column, std::size_t row) const
+	  {return getString(getInt(column, row));}
+
+	// Get the ID of a string (if it is in the dictionary).
+	std::optional<std::uint32_t> findString(std::string_view s) const {
+		// The dictionary is small relative to the columns (and is only
+		// searched once per query), so a linear search suffices.
+		for (std::uint32_t id = 0; id < numStrings_; ++id) {
+			if (getString(id) == s) {return id;}
+		}
+		return std::nullopt;
+	}
+
+	// Get the half-open range of the rows whose string in a column is s,
+	// where the rows are sorted by the strings in that column.
+	std::pair<std::size_t, std::size_t> equalRange(std::size_t column,
+	  std::string_view s) const {
+		auto lowerBound = [&](auto pred) {
+			std::size_t first = 0;
+			std::size_t count = numRows_;
+			while (count > 0) {
+				std::size_t step = count / 2;
+				if (pred(getString(column, first + step))) {
+					first += step + 1;
+					count -= step + 1;
+				} else {
+					count = step;
+				}
+			}
+			return first;
+		};
+		return {lowerBound([&](std::string_view t) {return t < s;}),
+		  lowerBound([&](std::string_view t) {return t <= s;})};
+	}
+
+	// Test if all of the values in a column are less than a bound (e.g.,
+	// so that a column of string IDs can be used to index a table with one
+	// entry per string, even for a corrupt file).  This reads the whole
+	// column.
+	bool isColumnBounded(std::size_t column, std::uint32_t bound) const {
+		const std::uint32_t* values = getColumn(column);
+		for (std::size_t i = 0; i < numRows_; ++i) {
+			if (values[i] >= bound) {return false;}
+		}
+		return true;
+	}
+
+private:
+	static constexpr std::size_t headerSize = 8 + 5 * 4;
+
+	ColumnFile() = default;
+	std::unique_ptr<llvm::MemoryBuffer> buffer_;
+	const std::uint32_t* stringOffsets_ = nullptr;
+	const std::uint32_t* columns_ = nullptr;
+	const char* stringPool_ = nullptr;
+	std::size_t numRows_ = 0;
+	std::size_t numStrings_ = 0;
+	std::size_t stringPoolSize_ = 0;
+};
+
+} // namespace cal
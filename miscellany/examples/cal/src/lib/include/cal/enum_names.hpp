@@ -0,0 +1,113 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+namespace cal {
+
+// A table (built at compile time) that maps the enumerators of an
+// enumeration type to names.
+//
+// When the enumerator values in the table are contiguous (which is the
+// common case), a lookup is a single array index.  Otherwise, a lookup
+// is a binary search.  An enumerator that is not in the table maps to the
+// name given for unknown values.
+//
+// A table with the same enumerator listed more than once is rejected at
+// compile time.  Since C++ provides no means to enumerate the enumerators
+// of an enumeration type, a table is checked for missing enumerators by
+// asserting that it covers a range of enumerators.  For example:
+//
+//   constexpr auto colorNames = cal::makeEnumNames<Color>({
+//     {Color::red, "red"},
+//     {Color::green, "green"},
+//     {Color::blue, "blue"},
+//   });
+//   static_assert(colorNames.covers(Color::red, Color::blue));
+template <class E, std::size_t N>
+class EnumNames {
+public:
+	static_assert(std::is_enum_v<E>);
+	static_assert(N > 0);
+	using Entry = std::pair<E, std::string_view>;
+
+	consteval EnumNames(const Entry (&entries)[N], std::string_view unknown) :
+	  entries_(), unknown_(unknown), dense_(true) {
+		std::copy(std::begin(entries), std::end(entries), entries_.begin());
+		std::sort(entries_.begin(), entries_.end(),
+		  [](const Entry& a, const Entry& b) {
+			return toUnderlying(a.first) < toUnderlying(b.first);
+		});
+		for (std::size_t i = 1; i < N; ++i) {
+			auto prev = toUnderlying(entries_[i - 1].first);
+			auto cur = toUnderlying(entries_[i].first);
+			if (cur == prev) {
+				// Not a constant expression, so this is a compile error.
+				throw "enumerator listed more than once in name table";
+			}
+			if (cur != prev + 1) {dense_ = false;}
+		}
+	}
+
+	// Get the name of an enumerator.
+	constexpr std::string_view operator()(E value) const {
+		if (const Entry* entry = find(value)) {return entry->second;}
+		return unknown_;
+	}
+
+	// Test if the table has an entry for an enumerator.
+	constexpr bool contains(E value) const {return find(value);}
+
+	// Test if the table has an entry for every value from first to last
+	// (inclusive).
+	constexpr bool covers(E first, E last) const {
+		for (auto v = toUnderlying(first); v <= toUnderlying(last); ++v) {
+			if (!contains(static_cast<E>(v))) {return false;}
+		}
+		return true;
+	}
+
+	constexpr std::size_t size() const {return N;}
+
+private:
+	using Underlying = std::underlying_type_t<E>;
+
+	static constexpr Underlying toUnderlying(E value)
+	  {return static_cast<Underlying>(value);}
+
+	constexpr const Entry* find(E value) const {
+		auto v = toUnderlying(value);
+		auto first = toUnderlying(entries_.front().first);
+		if (dense_) {
+			if (v < first || v > toUnderlying(entries_.back().first)) {
+				return nullptr;
+			}
+			return &entries_[static_cast<std::size_t>(v - first)];
+		}
+		auto i = std::lower_bound(entries_.begin(), entries_.end(), v,
+		  [](const Entry& entry, Underlying v) {
+			return toUnderlying(entry.first) < v;
+		});
+		return (i != entries_.end() && toUnderlying(i->first) == v) ? &*i :
+		  nullptr;
+	}
+
+	std::array<Entry, N> entries_;
+	std::string_view unknown_;
+	bool dense_;
+};
+
+// Make a name table for the enumeration type E (which must be specified
+// explicitly).
+template <class E, std::size_t N>
+consteval EnumNames<E, N> makeEnumNames(
+  const std::pair<E, std::string_view> (&entries)[N],
+  std::string_view unknown = "unknown") {
+	return EnumNames<E, N>(entries, unknown);
+}
+
+} // namespace cal
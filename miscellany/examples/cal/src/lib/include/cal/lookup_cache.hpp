@@ -0,0 +1,121 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <utility>
+#include <llvm/ADT/IntrusiveRefCntPtr.h>
+#include <llvm/ADT/StringMap.h>
+#include <llvm/ADT/StringSet.h>
+#include <llvm/ADT/Twine.h>
+#include <llvm/Support/CommandLine.h>
+#include <llvm/Support/VirtualFileSystem.h>
+#include <llvm/Support/raw_ostream.h>
+
+namespace cal {
+
+// A file system that answers repeated lookups of nonexistent files (e.g.,
+// the lookups of a header in each of the include directories that precede
+// the one containing it) from memory.
+//
+// When a lookup of a file fails because it does not exist, the directory
+// that would contain it is read (once), and any later lookup of a file in
+// that directory that is not one of its entries fails without accessing
+// the underlying file system.  The lookups of the files that do exist are
+// always passed through.  The directories are assumed not to change while
+// the tool runs.
+//
+// The directories can be saved to a cache file, so that the lookups fail
+// without accessing the underlying file system in later runs.  When the
+// cache file is loaded, each directory is validated with a single status
+// call, and is discarded if its modification time has changed (i.e., if
+// an entry was added or removed).  A directory that was modified shortly
+// before it was read is not saved, since a later change may not alter its
+// modification time (given the granularity of the time).
+//
+// The number of operations passed through to the underlying file system
+// (which correspond roughly to system calls) are counted, so a tool can
+// also use this (with caching disabled) to count them without the cache.
+// The member functions may be called concurrently.
+class LookupCacheFileSystem : public llvm::vfs::FileSystem {
+public:
+	LookupCacheFileSystem(llvm::IntrusiveRefCntPtr<llvm::vfs::FileSystem> base,
+	  bool caching);
+
+	llvm::ErrorOr<llvm::vfs::Status> status(const llvm::Twine& path) override;
+	llvm::ErrorOr<std::unique_ptr<llvm::vfs::File>> openFileForRead(
+	  const llvm::Twine& path) override;
+	llvm::vfs::directory_iterator dir_begin(const llvm::Twine& dir,
+	  std::error_code& ec) override;
+	std::error_code setCurrentWorkingDirectory(const llvm::Twine& path)
+	  override;
+	llvm::ErrorOr<std::string> getCurrentWorkingDirectory() const override;
+	std::error_code getRealPath(const llvm::Twine& path,
+	  llvm::SmallVectorImpl<char>& output) const override;
+	std::error_code isLocal(const llvm::Twine& path, bool& result) override;
+
+	// Load the directories from a cache file, discarding those that have
+	// changed.  A missing cache file is not an error.  Returns zero on
+	// success.
+	int load(const std::string& pathName);
+
+	// Save the directories to a cache file (atomically).  Returns zero on
+	// success.
+	int save(const std::string& pathName) const;
+
+	// Print the number of lookups, and the number of operations passed
+	// through to the underlying file system.
+	void printStats(llvm::raw_ostream& out) const;
+
+private:
+	struct Directory {
+		bool exists = false;
+		std::int64_t modificationTime = 0;
+		// Whether the directory was modified too recently to be saved.
+		bool recentlyModified = false;
+		llvm::StringSet<> entries;
+	};
+	// Get the directory and the name of the file for a lookup (or nothing
+	// if the lookup is not cached).
+	std::optional<std::pair<std::string, std::string>> splitPath(
+	  const llvm::Twine& path) const;
+	// Test if a lookup is known to fail.  If the directory is not cached,
+	// returns nothing.
+	std::optional<bool> isKnownMissing(const std::string& dir,
+	  const std::string& name) const;
+	void readDirectory(const std::string& dir);
+	std::optional<Directory> statDirectory(const std::string& dir);
+
+	llvm::IntrusiveRefCntPtr<llvm::vfs::FileSystem> base_;
+	bool caching_;
+	mutable std::mutex mutex_;
+	llvm::StringMap<Directory> directories_;
+	std::atomic<unsigned long> numLookups_{0};
+	std::atomic<unsigned long> numCachedMisses_{0};
+	std::atomic<unsigned long> numStatus_{0};
+	std::atomic<unsigned long> numOpens_{0};
+	std::atomic<unsigned long> numDirectoryReads_{0};
+	unsigned long numLoaded_ = 0;
+	unsigned long numDiscarded_ = 0;
+};
+
+// Add the -lookup-cache, -lookup-cache-file, and -lookup-stats options to
+// the specified option category.
+void addLookupCacheOptions(llvm::cl::OptionCategory& category);
+
+// Create the file system for a tool, which is layered on the real file
+// system, caches lookups (if enabled by the options), and is loaded from
+// the cache file (if specified).  If caching is not enabled, the lookups
+// are only counted.
+llvm::IntrusiveRefCntPtr<LookupCacheFileSystem> createLookupCacheFileSystem();
+
+// Save the cache file (if specified) and print the statistics (if
+// enabled).  Returns zero on success.
+int finishLookupCache(const LookupCacheFileSystem& fileSystem,
+  llvm::raw_ostream& out);
+
+} // namespace cal
@@ -1,3 +1,16 @@
 #pragma once
 
+#include <cal/ast_cache.hpp>
+#include <cal/column_file.hpp>
+#include <cal/enum_names.hpp>
+#include <cal/lookup_cache.hpp>
+#include <cal/modules.hpp>
+#include <cal/parallel.hpp>
+#include <cal/parent_map.hpp>
+#include <cal/perf_counters.hpp>
+#include <cal/prefilter.hpp>
+#include <cal/sidecar.hpp>
+#include <cal/startup_profile.hpp>
+#include <cal/time_trace.hpp>
+#include <cal/tool_options.hpp>
 #include <cal/utility.hpp>
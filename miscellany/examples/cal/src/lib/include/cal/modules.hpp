@@ -0,0 +1,88 @@
+#pragma once
+
+#include <chrono>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <clang/Tooling/ArgumentsAdjusters.h>
+#include <clang/Tooling/Tooling.h>
+#include <llvm/Support/CommandLine.h>
+#include <llvm/Support/raw_ostream.h>
+
+namespace cal {
+
+// Support for the -modules option, which parses each translation unit with
+// Clang modules (instead of textual inclusion), so that a header used by
+// many TUs is parsed once (into a PCM file in a module cache that is shared
+// by all of the TUs and worker threads) instead of once per TU.  Unlike a
+// PCH, this helps even if the TUs include the headers in different orders.
+//
+// The headers of a library that has no module map of its own (e.g., the
+// project headers or libstdc++) are made available as modules by
+// generating a module map (with one module per public header, including
+// those with no extension, such as <vector>) for each directory specified
+// with -modules-header-dir.  The internal headers of a library (e.g., those
+// in bits) are included textually by the modules that use them.  Headers
+// that already have a module map (e.g., those of libc++) are found with
+// -fimplicit-module-maps.
+//
+// With the -parse-times option, the time for each TU is recorded in a file
+// for the mode used (i.e., textual or modules), and compared with the time
+// recorded for the other mode by an earlier run.
+//
+// A tool uses this as follows:
+//
+//   cal::addModulesOptions(toolCategory);
+//   ... parse the command line ...
+//   if (cal::prepareModules()) {... error ...}
+//   tool.appendArgumentsAdjuster(cal::getModulesArgumentsAdjuster());
+//   cal::ParseTimes parseTimes;
+//   cal::TimedToolAction timedAction(action, parseTimes);
+//   ... run the tool with timedAction ...
+//   status |= parseTimes.finish(llvm::errs());
+
+// Add the -modules, -modules-cache-path, -modules-header-dir, and
+// -parse-times options to the specified option category.
+void addModulesOptions(llvm::cl::OptionCategory& category);
+
+// Test if modules mode is enabled.
+bool isModulesEnabled();
+
+// Generate the module maps (if modules mode is enabled).  Returns zero on
+// success.
+int prepareModules();
+
+// Get the arguments adjuster that adds the options for modules mode (which
+// does nothing if modules mode is not enabled).
+clang::tooling::ArgumentsAdjuster getModulesArgumentsAdjuster();
+
+// The time for each TU (which may be shared by several worker threads).
+class ParseTimes {
+public:
+	void add(const std::string& pathName, std::chrono::nanoseconds time);
+	// Record the times in the -parse-times file (if specified) and print
+	// a comparison with the times recorded for the other mode.  Returns
+	// zero on success.
+	int finish(llvm::raw_ostream& out);
+private:
+	std::mutex mutex_;
+	std::map<std::string, std::chrono::nanoseconds> times_;
+};
+
+// A tool action that measures the time for each invocation of another tool
+// action.
+class TimedToolAction : public clang::tooling::ToolAction {
+public:
+	TimedToolAction(clang::tooling::ToolAction* action,
+	  ParseTimes& parseTimes) : action_(action), parseTimes_(&parseTimes) {}
+	bool runInvocation(std::shared_ptr<clang::CompilerInvocation> invocation,
+	  clang::FileManager* files,
+	  std::shared_ptr<clang::PCHContainerOperations> pchContainerOps,
+	  clang::DiagnosticConsumer* diagConsumer) override;
+private:
+	clang::tooling::ToolAction* action_;
+	ParseTimes* parseTimes_;
+};
+
+} // namespace cal
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+#include <clang/Tooling/CompilationDatabase.h>
+#include <clang/Tooling/Tooling.h>
+
+namespace cal {
+
+// The per-thread state of runParallel (e.g., a match finder and the
+// records collected by its callbacks).
+class ParallelAction {
+public:
+	virtual ~ParallelAction() = default;
+
+	// Get the tool action that is run on each source file processed by the
+	// thread.
+	virtual clang::tooling::ToolAction& getToolAction() = 0;
+
+	// Merge the results of the thread into the shared results.  This is
+	// called once, after the last source file processed by the thread, with
+	// a lock held (so that the merges of different threads are serialized).
+	virtual void merge() {}
+};
+
+// Process the source files with a pool of threads (with one thread per
+// hardware thread if numThreads is zero), each with its own ClangTool for
+// each source file, and its own action, created by makeAction (which is
+// called by the thread itself).  The source files are handed out one at a
+// time, so that a thread that finishes early takes more of them.  Each
+// thread is a separate track in the time trace.  Returns zero if all of
+// the source files are processed successfully.
+int runParallel(const clang::tooling::CompilationDatabase& compilations,
+  const std::vector<std::string>& sources, unsigned numThreads,
+  const std::function<std::unique_ptr<ParallelAction>()>& makeAction);
+
+} // namespace cal
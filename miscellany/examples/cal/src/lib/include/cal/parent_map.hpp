@@ -0,0 +1,114 @@
+#pragma once
+
+#include <memory>
+#include <optional>
+#include <vector>
+#include <clang/AST/ASTContext.h>
+#include <clang/AST/ASTTypeTraits.h>
+#include <clang/AST/ParentMapContext.h>
+#include <llvm/ADT/DenseMap.h>
+#include <llvm/ADT/DenseSet.h>
+#include <llvm/ADT/PointerUnion.h>
+#include <llvm/ADT/SmallVector.h>
+#include <llvm/Support/CommandLine.h>
+#include <llvm/Support/raw_ostream.h>
+
+namespace cal {
+
+// A map from the nodes of an AST to their parents, which answers the same
+// queries as ParentMapContext (i.e., ASTContext::getParents), but is built
+// lazily for each subtree that is queried.
+//
+// The first query to ParentMapContext builds the map for the whole TU,
+// including all of the (often much larger) headers, while a tool usually
+// queries the nodes of a few functions in the main file.  Here, the map is
+// built (and cached) separately for each top-level declaration (i.e., a
+// declaration at namespace scope, such as a function, class, or variable,
+// together with all of its template instantiations).  The top-level
+// declaration containing a declaration is found from its lexical
+// declaration contexts, and that containing any other node (e.g., a
+// statement) is found from its location.  The parent of a namespace (or
+// linkage specification) is simply its declaration context.
+//
+// A query is passed on to ParentMapContext if the node is not found in
+// the subtree (e.g., if it has no valid location, or is a statement of a
+// template instantiation whose definition is outside of the template), or
+// if the traversal kind of ParentMapContext is not TK_AsIs (e.g., in a
+// match callback of a matcher with TK_IgnoreUnlessSpelledInSource).
+// Unlike ParentMapContext, a node that is shared by several top-level
+// declarations (e.g., a default argument, which is also a child of each
+// call that uses it) only has the parents in the subtree in which it was
+// found.
+//
+// With the -parent-map-context option, all of the queries are passed on
+// to ParentMapContext (so that the two can be compared), and with the
+// -parent-map-stats option, the time taken to build the maps and the
+// memory used by them are counted, and printed by printParentMapStats.  A
+// map is used by one thread, although the maps of different TUs may be
+// used concurrently.
+class ParentMap {
+public:
+	explicit ParentMap(clang::ASTContext& astContext);
+	ParentMap(const ParentMap&) = delete;
+	ParentMap& operator=(const ParentMap&) = delete;
+	~ParentMap();
+
+	clang::ASTContext& getASTContext() const {return *astContext_;}
+
+	// Get the parents of a node.
+	template <class NodeType>
+	clang::DynTypedNodeList getParents(const NodeType& node) {
+		return getParents(clang::DynTypedNode::create(node));
+	}
+	clang::DynTypedNodeList getParents(const clang::DynTypedNode& node);
+
+private:
+	class Builder;
+	using ParentVector = llvm::SmallVector<clang::DynTypedNode, 2>;
+	// The parents of a node, which are stored without a vector in the usual
+	// case of a single parent that is a declaration or statement.
+	using Parents = llvm::PointerUnion<const clang::Decl*, const clang::Stmt*,
+	  ParentVector*>;
+	// The parents of the nodes of a subtree, keyed by the address of a node
+	// (for a declaration, statement, or attribute) or by the node itself
+	// (for a type location or nested-name-specifier location).
+	struct Subtree {
+		llvm::DenseMap<const void*, Parents> pointerParents;
+		llvm::DenseMap<clang::DynTypedNode, Parents> otherParents;
+		std::vector<std::unique_ptr<ParentVector>> vectors;
+	};
+	// The range (of offsets in a file) of a top-level declaration.
+	struct RootRange {
+		unsigned begin;
+		unsigned end;
+		const clang::Decl* root;
+	};
+
+	clang::DynTypedNodeList getContextParents(const clang::DynTypedNode& node);
+	std::optional<clang::DynTypedNodeList> findParents(const Subtree& subtree,
+	  const clang::DynTypedNode& node) const;
+	const Subtree& getSubtree(const clang::Decl& root);
+	const clang::Decl* getRootOfDecl(const clang::Decl& decl);
+	void getRootsAt(clang::SourceLocation loc,
+	  llvm::SmallVectorImpl<const clang::Decl*>& roots);
+	void indexRoots();
+	void indexRoots(const clang::DeclContext& context);
+
+	clang::ASTContext* astContext_;
+	llvm::DenseMap<const clang::Decl*, std::unique_ptr<Subtree>> subtrees_;
+	bool rootsIndexed_ = false;
+	llvm::DenseSet<const clang::Decl*> roots_;
+	llvm::DenseMap<clang::FileID, std::vector<RootRange>> rootRanges_;
+	bool contextUsed_ = false;
+};
+
+// Add the -parent-map-context and -parent-map-stats options to the
+// specified option category.
+void addParentMapOptions(llvm::cl::OptionCategory& category);
+
+// Print the number of queries, and the time taken to build the parent maps
+// (of all TUs) and the memory used by them (if -parent-map-stats is
+// specified).
+void printParentMapStats(llvm::raw_ostream& out);
+
+} // namespace cal
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <clang/AST/ASTConsumer.h>
+#include <llvm/Support/CommandLine.h>
+#include <llvm/Support/raw_ostream.h>
+
+namespace cal {
+
+// Support for the -perf-counters option, which measures each phase of a
+// tool (e.g., parsing, traversing the AST, and writing the output) with
+// the hardware performance counters of the CPU, and prints a summary per
+// phase and per TU.  The counters (i.e., cycles, instructions, L1 data
+// cache misses, last-level cache misses, and branch misses) show whether
+// a phase is bound by cache misses or branch mispredictions, which a
+// wall-clock time cannot.
+//
+// The counters are read with the Linux perf_event_open system call, and
+// count the user-mode events of the thread running a phase.  If they are
+// unavailable (e.g., on another OS, under a restrictive perf_event_paranoid
+// setting, or in a container or VM without a PMU), only the times are
+// reported (along with the reason).
+//
+// Phases may be nested, in which case the counts of the outer phase
+// include those of the inner phase.
+//
+// A tool uses this as follows:
+//
+//   cal::addPerfCountersOptions(toolCategory);
+//   ... parse the command line ...
+//   ... create each consumer with cal::makePerfConsumer(...) ...
+//   ... wrap the other phases with cal::PerfScope objects ...
+//   cal::printPerfCounters(llvm::errs());
+
+// The number of hardware counters.
+inline constexpr std::size_t numPerfCounters = 5;
+
+// Add the -perf-counters option to the specified option category.
+void addPerfCountersOptions(llvm::cl::OptionCategory& category);
+
+// Test if the counters are enabled.
+bool isPerfCountersEnabled();
+
+// The values of the counters (for the calling thread) at a point in time.
+struct PerfSample {
+	std::chrono::steady_clock::time_point time;
+	std::array<std::uint64_t, numPerfCounters> counts{};
+};
+
+// Measures a phase for the lifetime of the object (if the counters are
+// enabled).  The phase is attributed to the TU being handled by the
+// calling thread (i.e., that of the innermost perf consumer).
+class PerfScope {
+public:
+	explicit PerfScope(std::string_view phase);
+	PerfScope(const PerfScope&) = delete;
+	PerfScope& operator=(const PerfScope&) = delete;
+	~PerfScope();
+private:
+	bool active_;
+	std::string phase_;
+	std::string tu_;
+	PerfSample start_;
+};
+
+// Wrap a consumer so that the parsing of each TU (i.e., everything up to
+// the end of the TU) is measured as the "parse" phase, and (if a phase is
+// specified) the handling of the complete TU by the consumer is measured
+// as that phase.  The consumer is returned unchanged if the counters are
+// not enabled.
+std::unique_ptr<clang::ASTConsumer> makePerfConsumer(
+  std::unique_ptr<clang::ASTConsumer> consumer, std::string phase = {});
+
+// Print the counters per phase and per TU (if the counters are enabled).
+void printPerfCounters(llvm::raw_ostream& out);
+
+} // namespace cal
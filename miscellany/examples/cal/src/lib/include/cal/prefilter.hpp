@@ -0,0 +1,110 @@
+#pragma once
+
+#include <cstddef>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+#include <clang/AST/Decl.h>
+#include <clang/AST/Expr.h>
+#include <clang/ASTMatchers/ASTMatchers.h>
+#include <clang/Basic/SourceManager.h>
+#include <clang/Tooling/CompilationDatabase.h>
+#include <llvm/Support/raw_ostream.h>
+
+namespace cal {
+
+// Find the first occurrence of pattern in text (using SSE2 when available).
+// Returns std::string_view::npos if there is no occurrence.
+std::size_t findSubstring(std::string_view text, std::string_view pattern);
+
+// A cheap textual test for whether a translation unit can possibly contain
+// a match, so that the full Clang parse of the TU can be skipped when it
+// cannot.
+//
+// A TU is considered a possible match if any of the given tokens appears
+// as a substring (including in comments, string literals, and inactive
+// preprocessor blocks) in the main file, in any file that it includes
+// (transitively) via a non-system include directory, or on the compiler
+// command line (e.g., in a -D option).  To remain conservative in the
+// presence of the preprocessor, a TU is also considered a possible match
+// if any scanned file uses token pasting (##), has an include directive
+// with a computed (i.e., macro) operand or continued over several lines
+// (with backslash-newlines), or cannot be read, or if the command line
+// includes a file with -imacros (since such files are not scanned).
+// Tokens that only arise from expanding macros defined in system headers
+// are not seen by the prefilter, so it should only be used by tools that
+// ignore matches spelled in system headers (e.g., with the
+// isSpelledInSystemHeader matcher below), or where this does not matter.
+//
+// The scan results for each file are cached, so headers shared by many
+// TUs are only scanned once.  The member functions may be called
+// concurrently.
+class TokenPrefilter {
+public:
+	explicit TokenPrefilter(std::vector<std::string> tokens);
+	TokenPrefilter(const TokenPrefilter&) = delete;
+	TokenPrefilter& operator=(const TokenPrefilter&) = delete;
+
+	// Test if the TU for the specified compile command may match.
+	bool mayMatch(const clang::tooling::CompileCommand& command);
+
+	// Remove the source files that cannot match.
+	std::vector<std::string> filterSources(
+	  const clang::tooling::CompilationDatabase& compilations,
+	  const std::vector<std::string>& sources);
+
+	unsigned long getNumChecked() const;
+	unsigned long getNumSkipped() const;
+
+	// Print the number and fraction of skipped TUs.
+	void printSummary(llvm::raw_ostream& out) const;
+
+private:
+	struct Include {
+		std::string name;
+		bool angled;
+	};
+	struct FileInfo {
+		bool readable = false;
+		bool hasToken = false;
+		bool hasMacroHazard = false;
+		std::vector<Include> includes;
+	};
+	bool containsToken(std::string_view text) const;
+	const FileInfo& getFileInfo(const std::string& pathName);
+	std::vector<std::string> tokens_;
+	mutable std::mutex mutex_;
+	std::unordered_map<std::string, FileInfo> files_;
+	unsigned long numChecked_;
+	unsigned long numSkipped_;
+};
+
+// Test if a node is spelled in a system header, for tools that use the
+// prefilter.  Unlike the standard isExpansionInSystemHeader matcher, this
+// uses the spelling location, so a node spelled in the body of a macro
+// defined in a system header is in a system header (even if the macro is
+// expanded in user code), but one spelled in a macro argument in user code
+// is not.  The location of a declaration is that of its name, and that of
+// an expression is that of its operator or name (e.g., the member name of
+// a member call, or the keyword of a named cast), which is the token that
+// the prefilter looks for.
+AST_POLYMORPHIC_MATCHER(isSpelledInSystemHeader,
+  AST_POLYMORPHIC_SUPPORTED_TYPES(clang::Decl, clang::Stmt)) {
+	const clang::SourceManager& sourceManager =
+	  Finder->getASTContext().getSourceManager();
+	clang::SourceLocation loc;
+	if constexpr (std::is_base_of_v<clang::Decl, NodeType>) {
+		loc = Node.getLocation();
+	} else if (auto expr = llvm::dyn_cast<clang::Expr>(&Node)) {
+		loc = expr->getExprLoc();
+	} else {
+		loc = Node.getBeginLoc();
+	}
+	loc = sourceManager.getSpellingLoc(loc);
+	return loc.isValid() && sourceManager.isInSystemHeader(loc);
+}
+
+} // namespace cal
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <format>
+#include <string>
+#include <string_view>
+#include <clang/Basic/Diagnostic.h>
+#include <clang/Frontend/CompilerInstance.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/Path.h>
+#include <llvm/Support/raw_ostream.h>
+#include <llvm/Support/xxhash.h>
+
+namespace cal {
+
+// Support for Clang plugins that run an analysis as part of the normal
+// compilation of a translation unit (instead of reparsing the TU with a
+// separate tool) and write their results to a sidecar file for the TU.
+// The sidecar files for an analysis are combined with merge_sidecars.
+//
+// A sidecar file holds one JSON object per line.  By default, it is
+// placed next to the object file (e.g., foo.o.<analysis>.jsonl), or next
+// to the source file if there is no object file (e.g., with
+// -fsyntax-only).  With the plugin argument out-dir=DIR, it is placed in
+// DIR instead, with a name made unique by a hash of the source and output
+// file names.
+//
+// This code is header only, so that a plugin need not link with any
+// library other than those already loaded into the compiler.
+
+// Test if a plugin argument is of the form name=value, and if so, get the
+// value.
+inline bool getPluginArg(std::string_view arg, std::string_view name,
+  std::string& value) {
+	if (arg.size() <= name.size() || arg.substr(0, name.size()) != name ||
+	  arg[name.size()] != '=') {
+		return false;
+	}
+	value = arg.substr(name.size() + 1);
+	return true;
+}
+
+// Get the pathname of the sidecar file for the TU being compiled.
+inline std::string getSidecarPathName(
+  const clang::CompilerInstance& compilerInstance, std::string_view analysis,
+  const std::string& outputDir) {
+	const auto& frontendOpts = compilerInstance.getFrontendOpts();
+	std::string inFile = !frontendOpts.Inputs.empty() &&
+	  frontendOpts.Inputs.front().isFile() ?
+	  std::string(frontendOpts.Inputs.front().getFile()) : std::string("-");
+	const std::string& outFile = frontendOpts.OutputFile;
+	if (!outputDir.empty()) {
+		std::string key = inFile + '\0' + outFile;
+		llvm::SmallString<256> pathName(outputDir);
+		llvm::sys::path::append(pathName, std::format("{}-{:016x}.{}.jsonl",
+		  std::string(llvm::sys::path::filename(inFile)),
+		  llvm::xxHash64(key), analysis));
+		return std::string(pathName);
+	}
+	const std::string& base = !outFile.empty() && outFile != "-" ? outFile :
+	  inFile;
+	return std::format("{}.{}.jsonl", base, analysis);
+}
+
+// Write a sidecar file (replacing any existing one).  The file is written
+// to a temporary file that is then renamed, so that a reader never sees a
+// partially written sidecar.  An error is reported as a compiler
+// diagnostic.  Returns zero on success.
+inline int writeSidecar(clang::CompilerInstance& compilerInstance,
+  const std::string& pathName, std::string_view data) {
+	clang::DiagnosticsEngine& diags = compilerInstance.getDiagnostics();
+	auto report = [&](std::error_code errCode) {
+		diags.Report(diags.getCustomDiagID(clang::DiagnosticsEngine::Error,
+		  "cannot write sidecar file '%0' (%1)")) << pathName <<
+		  errCode.message();
+		return 1;
+	};
+	llvm::StringRef dir = llvm::sys::path::parent_path(pathName);
+	if (!dir.empty()) {
+		if (auto errCode = llvm::sys::fs::create_directories(dir)) {
+			return report(errCode);
+		}
+	}
+	int fd;
+	llvm::SmallString<256> tmpPathName;
+	if (auto errCode = llvm::sys::fs::createUniqueFile(
+	  pathName + ".%%%%%%.tmp", fd, tmpPathName)) {
+		return report(errCode);
+	}
+	{
+		llvm::raw_fd_ostream out(fd, true);
+		out << data;
+		out.close();
+		if (out.has_error()) {
+			std::error_code errCode = out.error();
+			out.clear_error();
+			llvm::sys::fs::remove(tmpPathName);
+			return report(errCode);
+		}
+	}
+	if (auto errCode = llvm::sys::fs::rename(tmpPathName, pathName)) {
+		llvm::sys::fs::remove(tmpPathName);
+		return report(errCode);
+	}
+	return 0;
+}
+
+} // namespace cal
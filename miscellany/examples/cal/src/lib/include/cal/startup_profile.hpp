@@ -0,0 +1,76 @@
+#pragma once
+
+#include <chrono>
+#include <string>
+#include <string_view>
+#include <llvm/Support/CommandLine.h>
+#include <llvm/Support/raw_ostream.h>
+
+namespace cal {
+
+// Support for the -startup-profile option, which breaks down the time
+// that a tool spends before it starts on its first TU.  For a tool that
+// is run on a single file, this time can exceed the time spent on the TU.
+// The phases are as follows:
+//
+//   - loading: from the start of the process until the first static
+//     initializer of the executable runs, which includes exec, dynamic
+//     linking, and the static initializers of the shared libraries (e.g.,
+//     the registration of the LLVM command-line options when LLVM is
+//     linked as a shared library).  The start of the process is only known
+//     to the resolution of the kernel clock tick (typically, 10 ms).
+//   - static initialization: the static initializers of the executable
+//     (until main is entered).
+//   - the phases marked with StartupScope objects (e.g., parsing the
+//     command line, loading the compilation database, and running the
+//     clang++ program to find its include directory).
+//   - other: the remaining time until the first TU (or until the profile
+//     is printed, if no TU is processed).
+//
+// The times are recorded regardless of whether the option is specified
+// (since this is not known until the command line is parsed), which is
+// cheap.  This assumes that the CAL library is linked statically (so that
+// its static initializer runs before the others in the executable).
+//
+// A tool uses this as follows:
+//
+//   int main(int argc, char** argv) {
+//   	cal::markStartupMain();
+//   	cal::addStartupProfileOptions(toolCategory);
+//   	... parse the command line (e.g., with cal::ToolOptionsParser) ...
+//   	... run the tool (with cal::TracedToolAction, which marks the
+//   	    start of the first TU) ...
+//   	cal::printStartupProfile(llvm::errs());
+//   }
+
+// Add the -startup-profile option to the specified option category.
+void addStartupProfileOptions(llvm::cl::OptionCategory& category);
+
+// Test if the startup profile is enabled.
+bool isStartupProfileEnabled();
+
+// Record that main has been entered.  This should be called first thing
+// in main.
+void markStartupMain();
+
+// Record that the tool has started on its first TU, which ends the
+// startup.  Only the first call has any effect.
+void markStartupDone();
+
+// Measures a startup phase for the lifetime of the object.  The phases
+// should not be nested.
+class StartupScope {
+public:
+	explicit StartupScope(std::string_view name);
+	StartupScope(const StartupScope&) = delete;
+	StartupScope& operator=(const StartupScope&) = delete;
+	~StartupScope();
+private:
+	std::string name_;
+	std::chrono::steady_clock::time_point begin_;
+};
+
+// Print the startup profile (if it is enabled).
+void printStartupProfile(llvm::raw_ostream& out);
+
+} // namespace cal
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <string_view>
+#include <clang/Tooling/Tooling.h>
+#include <llvm/Support/CommandLine.h>
+#include <llvm/Support/TimeProfiler.h>
+
+namespace cal {
+
+// Support for the -time-trace option, which writes a Chrome trace (i.e., a
+// JSON file that can be loaded into chrome://tracing or Perfetto) showing
+// where the time is spent in a run of a tool.  The trace includes the
+// events recorded by Clang itself (e.g., parsing and template
+// instantiation) as well as the events for any llvm::TimeTraceScope
+// objects in the tool.  Each thread that is initialized for tracing (with
+// a TimeTraceThread object) appears as a separate track in the trace.
+//
+// A tool uses this as follows:
+//
+//   cal::addTimeTraceOptions(toolCategory);
+//   ... parse the command line ...
+//   cal::TimeTrace timeTrace(argv[0]);
+//   ... run the tool (with TimeTraceThread objects in worker threads) ...
+//   status |= timeTrace.finish();
+
+// Add the -time-trace and -time-trace-granularity options to the specified
+// option category (so that they are shown in the help for a tool that
+// hides unrelated options).
+void addTimeTraceOptions(llvm::cl::OptionCategory& category);
+
+// Test if tracing is enabled.
+bool isTimeTraceEnabled();
+
+// Enables tracing for the calling (i.e., main) thread if the -time-trace
+// option was specified, and writes the trace (merged from all threads) on
+// finish.
+class TimeTrace {
+public:
+	explicit TimeTrace(std::string_view processName);
+	TimeTrace(const TimeTrace&) = delete;
+	TimeTrace& operator=(const TimeTrace&) = delete;
+	~TimeTrace();
+	// Write the trace (if tracing is enabled).  All worker threads must
+	// have finished tracing before this is called.  Returns zero on
+	// success.
+	int finish();
+private:
+	bool active_;
+};
+
+// Enables tracing for a worker thread for the lifetime of the object (if
+// tracing is enabled).
+class TimeTraceThread {
+public:
+	TimeTraceThread();
+	TimeTraceThread(const TimeTraceThread&) = delete;
+	TimeTraceThread& operator=(const TimeTraceThread&) = delete;
+	~TimeTraceThread();
+private:
+	bool active_;
+};
+
+// A tool action that adds a trace event (named after the main source
+// file) around each invocation of another tool action.  The first
+// invocation also marks the end of the startup profile.
+class TracedToolAction : public clang::tooling::ToolAction {
+public:
+	explicit TracedToolAction(clang::tooling::ToolAction* action) :
+	  action_(action) {}
+	bool runInvocation(std::shared_ptr<clang::CompilerInvocation> invocation,
+	  clang::FileManager* files,
+	  std::shared_ptr<clang::PCHContainerOperations> pchContainerOps,
+	  clang::DiagnosticConsumer* diagConsumer) override;
+private:
+	clang::tooling::ToolAction* action_;
+};
+
+} // namespace cal
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <clang/Tooling/CompilationDatabase.h>
+#include <llvm/ADT/StringRef.h>
+#include <llvm/Support/CommandLine.h>
+#include <llvm/Support/Error.h>
+
+namespace cal {
+
+// A JSON compilation database that is loaded from its file on first use
+// (instead of when it is created).  This allows a tool that does not use
+// the database (e.g., because it exits early) to avoid the cost of parsing
+// it, which can be large for a big project.  If the file cannot be
+// loaded, this is reported, and the database has no entries.  The member
+// functions may be called concurrently.
+class LazyCompilationDatabase : public clang::tooling::CompilationDatabase {
+public:
+	explicit LazyCompilationDatabase(std::string pathName);
+	std::vector<clang::tooling::CompileCommand> getCompileCommands(
+	  llvm::StringRef filePath) const override;
+	std::vector<std::string> getAllFiles() const override;
+	std::vector<clang::tooling::CompileCommand> getAllCompileCommands()
+	  const override;
+private:
+	const clang::tooling::CompilationDatabase& getDatabase() const;
+	std::string pathName_;
+	mutable std::once_flag loaded_;
+	mutable std::unique_ptr<clang::tooling::CompilationDatabase> database_;
+};
+
+// A replacement for clang::tooling::CommonOptionsParser, which has the
+// same options (i.e., the source paths, -p, -extra-arg, and
+// -extra-arg-before) and the same behavior, except that when the build
+// directory specified with -p contains a compile_commands.json file, the
+// database is loaded lazily from that file.  In this case, the search of
+// the parent directories, and of each of the registered
+// compilation-database plugins, is also skipped.  The time taken to parse
+// the command line and to load the database are recorded in the startup
+// profile.
+class ToolOptionsParser {
+public:
+	static llvm::Expected<ToolOptionsParser> create(int& argc,
+	  const char** argv, llvm::cl::OptionCategory& category,
+	  llvm::cl::NumOccurrencesFlag occurrencesFlag = llvm::cl::OneOrMore,
+	  const char* overview = nullptr);
+	clang::tooling::CompilationDatabase& getCompilations()
+	  {return *compilations_;}
+	const std::vector<std::string>& getSourcePathList() const
+	  {return sourcePathList_;}
+private:
+	ToolOptionsParser() = default;
+	std::unique_ptr<clang::tooling::CompilationDatabase> compilations_;
+	std::vector<std::string> sourcePathList_;
+};
+
+} // namespace cal
@@ -0,0 +1,343 @@
+#include <format>
+#include <vector>
+#include <llvm/ADT/SmallString.h>
+#include <llvm/Support/Errc.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/Path.h>
+#include "cal/lookup_cache.hpp"
+
+namespace cal {
+
+static llvm::cl::opt<bool> clLookupCache("lookup-cache",
+  llvm::cl::desc("Cache the failed lookups of files (e.g., in the header "
+  "search)"));
+static llvm::cl::opt<std::string> clLookupCacheFile("lookup-cache-file",
+  llvm::cl::desc("Load and save the cached lookups in the specified file "
+  "(which implies -lookup-cache)"), llvm::cl::value_desc("file"));
+static llvm::cl::opt<bool> clLookupStats("lookup-stats",
+  llvm::cl::desc("Print the number of file lookups and of operations on "
+  "the file system"));
+
+// The header of a cache file.
+static constexpr const char* cacheFileHeader = "cal-lookup-cache 1";
+
+// A directory that was modified this recently (when it is read) may be
+// modified again without changing its modification time.
+static constexpr std::chrono::seconds timeGranularity{2};
+
+LookupCacheFileSystem::LookupCacheFileSystem(
+  llvm::IntrusiveRefCntPtr<llvm::vfs::FileSystem> base, bool caching) :
+  base_(std::move(base)), caching_(caching) {}
+
+std::optional<std::pair<std::string, std::string>>
+  LookupCacheFileSystem::splitPath(const llvm::Twine& path) const
+{
+	if (!caching_) {return std::nullopt;}
+	llvm::SmallString<256> pathName;
+	path.toVector(pathName);
+	if (!llvm::sys::path::is_absolute(pathName) && makeAbsolute(pathName)) {
+		return std::nullopt;
+	}
+	// Removing .. from a path is not valid in the presence of symbolic
+	// links, so such a path is not cached.
+	for (auto i = llvm::sys::path::begin(pathName),
+	  end = llvm::sys::path::end(pathName); i != end; ++i) {
+		if (*i == "..") {return std::nullopt;}
+	}
+	llvm::sys::path::remove_dots(pathName);
+	llvm::StringRef dir = llvm::sys::path::parent_path(pathName);
+	llvm::StringRef name = llvm::sys::path::filename(pathName);
+	if (dir.empty() || name.empty() || dir == pathName) {
+		return std::nullopt;
+	}
+	return std::pair(dir.str(), name.str());
+}
+
+std::optional<bool> LookupCacheFileSystem::isKnownMissing(
+  const std::string& dir, const std::string& name) const
+{
+	std::scoped_lock lock(mutex_);
+	auto iter = directories_.find(dir);
+	if (iter == directories_.end()) {return std::nullopt;}
+	return !iter->second.exists || !iter->second.entries.contains(name);
+}
+
+std::optional<LookupCacheFileSystem::Directory>
+  LookupCacheFileSystem::statDirectory(const std::string& dir)
+{
+	++numDirectoryReads_;
+	Directory directory;
+	auto status = base_->status(dir);
+	if (!status) {
+		if (status.getError() != llvm::errc::no_such_file_or_directory) {
+			return std::nullopt;
+		}
+		directory.exists = false;
+		return directory;
+	}
+	if (!status->isDirectory()) {return std::nullopt;}
+	directory.exists = true;
+	auto modificationTime = status->getLastModificationTime();
+	directory.modificationTime = std::chrono::duration_cast<
+	  std::chrono::nanoseconds>(modificationTime.time_since_epoch()).count();
+	directory.recentlyModified = modificationTime + timeGranularity >
+	  std::chrono::system_clock::now();
+	std::error_code ec;
+	for (auto iter = base_->dir_begin(dir, ec), end = decltype(iter)();
+	  !ec && iter != end; iter.increment(ec)) {
+		directory.entries.insert(llvm::sys::path::filename(iter->path()));
+	}
+	if (ec) {return std::nullopt;}
+	return directory;
+}
+
+void LookupCacheFileSystem::readDirectory(const std::string& dir)
+{
+	std::optional<Directory> directory = statDirectory(dir);
+	if (!directory) {return;}
+	std::scoped_lock lock(mutex_);
+	directories_.try_emplace(dir, std::move(*directory));
+}
+
+llvm::ErrorOr<llvm::vfs::Status> LookupCacheFileSystem::status(
+  const llvm::Twine& path)
+{
+	++numLookups_;
+	auto split = splitPath(path);
+	std::optional<bool> missing;
+	if (split) {missing = isKnownMissing(split->first, split->second);}
+	if (missing && *missing) {
+		++numCachedMisses_;
+		return llvm::errc::no_such_file_or_directory;
+	}
+	++numStatus_;
+	auto result = base_->status(path);
+	if (split && !missing && !result &&
+	  result.getError() == llvm::errc::no_such_file_or_directory) {
+		readDirectory(split->first);
+	}
+	return result;
+}
+
+llvm::ErrorOr<std::unique_ptr<llvm::vfs::File>>
+  LookupCacheFileSystem::openFileForRead(const llvm::Twine& path)
+{
+	++numLookups_;
+	auto split = splitPath(path);
+	std::optional<bool> missing;
+	if (split) {missing = isKnownMissing(split->first, split->second);}
+	if (missing && *missing) {
+		++numCachedMisses_;
+		return llvm::errc::no_such_file_or_directory;
+	}
+	++numOpens_;
+	auto result = base_->openFileForRead(path);
+	if (split && !missing && !result &&
+	  result.getError() == llvm::errc::no_such_file_or_directory) {
+		readDirectory(split->first);
+	}
+	return result;
+}
+
+llvm::vfs::directory_iterator LookupCacheFileSystem::dir_begin(
+  const llvm::Twine& dir, std::error_code& ec)
+{
+	++numDirectoryReads_;
+	return base_->dir_begin(dir, ec);
+}
+
+std::error_code LookupCacheFileSystem::setCurrentWorkingDirectory(
+  const llvm::Twine& path)
+{
+	return base_->setCurrentWorkingDirectory(path);
+}
+
+llvm::ErrorOr<std::string>
+  LookupCacheFileSystem::getCurrentWorkingDirectory() const
+{
+	return base_->getCurrentWorkingDirectory();
+}
+
+std::error_code LookupCacheFileSystem::getRealPath(const llvm::Twine& path,
+  llvm::SmallVectorImpl<char>& output) const
+{
+	return base_->getRealPath(path, output);
+}
+
+std::error_code LookupCacheFileSystem::isLocal(const llvm::Twine& path,
+  bool& result)
+{
+	return base_->isLocal(path, result);
+}
+
+int LookupCacheFileSystem::load(const std::string& pathName)
+{
+	auto buffer = llvm::MemoryBuffer::getFile(pathName);
+	if (!buffer) {
+		if (buffer.getError() == llvm::errc::no_such_file_or_directory) {
+			return 0;
+		}
+		llvm::errs() << std::format("cannot read lookup cache {} ({})\n",
+		  pathName, buffer.getError().message());
+		return 1;
+	}
+	// A cache file that is invalid (e.g., truncated) is ignored as a whole,
+	// since a directory with missing entries would cause files that exist
+	// to be reported as missing.
+	auto ignoreInvalid = [&]() {
+		llvm::errs() << std::format("invalid lookup cache {} (ignored)\n",
+		  pathName);
+		return 0;
+	};
+	llvm::StringRef text = (*buffer)->getBuffer();
+	if (!text.ends_with("\n")) {return ignoreInvalid();}
+	auto [header, rest] = text.split('\n');
+	if (header != cacheFileHeader) {return ignoreInvalid();}
+	// Each directory is a line of the form "exists time count path", which
+	// is followed by a line for each of its entries.
+	std::vector<std::pair<std::string, Directory>> loaded;
+	while (!rest.empty()) {
+		llvm::StringRef line;
+		std::tie(line, rest) = rest.split('\n');
+		auto [existsField, line1] = line.split(' ');
+		auto [timeField, line2] = line1.split(' ');
+		auto [countField, dir] = line2.split(' ');
+		unsigned exists;
+		std::int64_t modificationTime;
+		std::size_t count;
+		if (existsField.getAsInteger(10, exists) ||
+		  timeField.getAsInteger(10, modificationTime) ||
+		  countField.getAsInteger(10, count) || dir.empty()) {
+			return ignoreInvalid();
+		}
+		Directory directory;
+		directory.exists = exists;
+		directory.modificationTime = modificationTime;
+		for (std::size_t i = 0; i < count; ++i) {
+			if (rest.empty()) {return ignoreInvalid();}
+			llvm::StringRef entry;
+			std::tie(entry, rest) = rest.split('\n');
+			directory.entries.insert(entry);
+		}
+		loaded.emplace_back(dir.str(), std::move(directory));
+	}
+	// The directories are validated after the file is parsed, so that an
+	// invalid file is ignored without accessing any directory.
+	for (auto& [dir, directory] : loaded) {
+		++numStatus_;
+		auto status = base_->status(dir);
+		bool valid;
+		if (directory.exists) {
+			valid = status && status->isDirectory() &&
+			  std::chrono::duration_cast<std::chrono::nanoseconds>(
+			  status->getLastModificationTime().time_since_epoch()).count() ==
+			  directory.modificationTime;
+		} else {
+			valid = !status &&
+			  status.getError() == llvm::errc::no_such_file_or_directory;
+		}
+		if (!valid) {
+			++numDiscarded_;
+			continue;
+		}
+		++numLoaded_;
+		std::scoped_lock lock(mutex_);
+		directories_.try_emplace(dir, std::move(directory));
+	}
+	return 0;
+}
+
+int LookupCacheFileSystem::save(const std::string& pathName) const
+{
+	// The cache is written to a temporary file that is then renamed, so
+	// that a concurrent run never reads a partial file.
+	int fd;
+	llvm::SmallString<256> tempPathName;
+	if (auto ec = llvm::sys::fs::createUniqueFile(pathName + "-%%%%%%.tmp",
+	  fd, tempPathName)) {
+		llvm::errs() << std::format("cannot create lookup cache {} ({})\n",
+		  pathName, ec.message());
+		return 1;
+	}
+	{
+		llvm::raw_fd_ostream out(fd, true);
+		out << cacheFileHeader << '\n';
+		std::scoped_lock lock(mutex_);
+		for (const auto& entry : directories_) {
+			const Directory& directory = entry.getValue();
+			if (directory.recentlyModified ||
+			  entry.getKey().contains('\n')) {
+				continue;
+			}
+			out << std::format("{} {} {} {}\n", directory.exists ? 1 : 0,
+			  directory.modificationTime, directory.entries.size(),
+			  entry.getKey().str());
+			for (const auto& name : directory.entries) {
+				// A name cannot contain a slash, but may contain a newline
+				// (in which case the name cannot match a lookup anyway).
+				out << (name.getKey().contains('\n') ? "/" :
+				  name.getKey()) << '\n';
+			}
+		}
+		out.close();
+		if (out.has_error()) {
+			llvm::errs() << std::format("cannot write lookup cache {} "
+			  "({})\n", pathName, out.error().message());
+			out.clear_error();
+			llvm::sys::fs::remove(tempPathName);
+			return 1;
+		}
+	}
+	if (auto ec = llvm::sys::fs::rename(tempPathName, pathName)) {
+		llvm::errs() << std::format("cannot write lookup cache {} ({})\n",
+		  pathName, ec.message());
+		llvm::sys::fs::remove(tempPathName);
+		return 1;
+	}
+	return 0;
+}
+
+void LookupCacheFileSystem::printStats(llvm::raw_ostream& out) const
+{
+	out << std::format("file lookups: {} ({} answered from the cache)\n",
+	  numLookups_.load(), numCachedMisses_.load());
+	out << std::format("file-system operations: {} status, {} open, "
+	  "{} directory reads\n", numStatus_.load(), numOpens_.load(),
+	  numDirectoryReads_.load());
+	if (caching_) {
+		std::scoped_lock lock(mutex_);
+		out << std::format("cached directories: {} ({} loaded from the "
+		  "cache file, {} discarded as changed)\n", directories_.size(),
+		  numLoaded_, numDiscarded_);
+	}
+}
+
+void addLookupCacheOptions(llvm::cl::OptionCategory& category)
+{
+	clLookupCache.addCategory(category);
+	clLookupCacheFile.addCategory(category);
+	clLookupStats.addCategory(category);
+}
+
+llvm::IntrusiveRefCntPtr<LookupCacheFileSystem> createLookupCacheFileSystem()
+{
+	auto fileSystem = llvm::makeIntrusiveRefCnt<LookupCacheFileSystem>(
+	  llvm::vfs::getRealFileSystem(), clLookupCache ||
+	  !clLookupCacheFile.empty());
+	if (!clLookupCacheFile.empty()) {fileSystem->load(clLookupCacheFile);}
+	return fileSystem;
+}
+
+int finishLookupCache(const LookupCacheFileSystem& fileSystem,
+  llvm::raw_ostream& out)
+{
+	int status = 0;
+	if (!clLookupCacheFile.empty() && fileSystem.save(clLookupCacheFile)) {
+		status = 1;
+	}
+	if (clLookupStats) {fileSystem.printStats(out);}
+	return status;
+}
+
+} // namespace cal
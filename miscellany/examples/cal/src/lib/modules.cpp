@@ -0,0 +1,284 @@
+#include <algorithm>
+#include <cctype>
+#include <format>
+#include <set>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <clang/Frontend/CompilerInvocation.h>
+#include <llvm/ADT/SmallString.h>
+#include <llvm/Support/Error.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/JSON.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/Path.h>
+#include <llvm/Support/xxhash.h>
+#include "cal/modules.hpp"
+
+namespace cal {
+
+static llvm::cl::opt<bool> clModules("modules",
+  llvm::cl::desc("Parse with Clang modules (instead of textual inclusion)"));
+static llvm::cl::opt<std::string> clModulesCachePath("modules-cache-path",
+  llvm::cl::desc("The module cache directory (shared by all TUs)"),
+  llvm::cl::value_desc("dir"));
+static llvm::cl::list<std::string> clModulesHeaderDirs("modules-header-dir",
+  llvm::cl::desc("Generate a module for each header in the specified "
+  "directory"), llvm::cl::value_desc("dir"));
+static llvm::cl::opt<std::string> clParseTimesFile("parse-times",
+  llvm::cl::desc("Record the time for each TU in the specified file (and "
+  "compare it with the time recorded for the other mode)"),
+  llvm::cl::value_desc("file"));
+
+// The module map files generated by prepareModules.
+static std::vector<std::string> moduleMapFiles;
+
+void addModulesOptions(llvm::cl::OptionCategory& category)
+{
+	clModules.addCategory(category);
+	clModulesCachePath.addCategory(category);
+	clModulesHeaderDirs.addCategory(category);
+	clParseTimesFile.addCategory(category);
+}
+
+bool isModulesEnabled()
+{
+	return clModules;
+}
+
+// The path is made absolute, since the compilations run in the working
+// directories of their compile commands.
+static std::string getModulesCachePath()
+{
+	llvm::SmallString<256> pathName;
+	if (!clModulesCachePath.empty()) {
+		pathName = clModulesCachePath;
+		llvm::sys::fs::make_absolute(pathName);
+	} else {
+		llvm::sys::path::system_temp_directory(true, pathName);
+		llvm::sys::path::append(pathName, "cal-modules-cache");
+	}
+	return std::string(pathName);
+}
+
+// Test if a file is a header (where the standard library headers, such as
+// <vector>, have no extension).
+static bool isHeader(llvm::StringRef pathName)
+{
+	llvm::StringRef fileName = llvm::sys::path::filename(pathName);
+	llvm::StringRef ext = llvm::sys::path::extension(fileName);
+	return !fileName.starts_with(".") && (ext.empty() || ext == ".h" ||
+	  ext == ".hh" || ext == ".hpp" || ext == ".hxx");
+}
+
+// Test if a directory holds the internal headers of a library (e.g., bits,
+// debug, and pstl in libstdc++, or __algorithm in libc++), which are not
+// meant to be included on their own, and so are not made into modules
+// (instead, they are included textually by the modules for the public
+// headers).
+static bool isInternalHeaderDir(llvm::StringRef pathName)
+{
+	llvm::StringRef dirName = llvm::sys::path::filename(pathName);
+	return dirName == "bits" || dirName == "debug" || dirName == "detail" ||
+	  dirName == "pstl" || dirName.starts_with("__");
+}
+
+// Make a module name (i.e., an identifier) for a header.
+static std::string getModuleName(llvm::StringRef relPathName,
+  std::set<std::string>& names)
+{
+	std::string name = "cal_";
+	for (char c : relPathName) {
+		name += std::isalnum(static_cast<unsigned char>(c)) ? c : '_';
+	}
+	std::string uniqueName = name;
+	for (int i = 2; !names.insert(uniqueName).second; ++i) {
+		uniqueName = std::format("{}_{}", name, i);
+	}
+	return uniqueName;
+}
+
+// Generate a module map with one module for each header in a directory
+// (so that the headers need not be modular as a group).  Returns zero on
+// success.
+static int generateModuleMap(const std::string& dir,
+  const std::string& mapDir)
+{
+	llvm::SmallString<256> absDir(dir);
+	if (std::error_code errCode = llvm::sys::fs::make_absolute(absDir)) {
+		llvm::errs() << std::format("invalid directory {} ({})\n", dir,
+		  errCode.message());
+		return 1;
+	}
+	std::vector<std::string> headers;
+	std::error_code errCode;
+	for (llvm::sys::fs::recursive_directory_iterator i(absDir, errCode), end;
+	  i != end && !errCode; i.increment(errCode)) {
+		auto status = i->status();
+		if (!status) {continue;}
+		if (status->type() == llvm::sys::fs::file_type::directory_file) {
+			if (isInternalHeaderDir(i->path())) {i.no_push();}
+		} else if (status->type() == llvm::sys::fs::file_type::regular_file &&
+		  isHeader(i->path())) {
+			headers.push_back(i->path());
+		}
+	}
+	if (errCode) {
+		llvm::errs() << std::format("cannot read directory {} ({})\n", dir,
+		  errCode.message());
+		return 1;
+	}
+	std::sort(headers.begin(), headers.end());
+
+	std::string moduleMap;
+	std::set<std::string> names;
+	for (const auto& header : headers) {
+		llvm::StringRef relPathName = llvm::StringRef(header).drop_front(
+		  absDir.size());
+		moduleMap += std::format("module {} {{\n\theader \"{}\"\n\t"
+		  "export *\n}}\n", getModuleName(relPathName, names), header);
+	}
+	llvm::SmallString<256> mapPathName(mapDir);
+	llvm::sys::path::append(mapPathName, std::format("{:016x}.modulemap",
+	  llvm::xxHash64(absDir.str())));
+	if (auto error = llvm::writeToOutput(mapPathName,
+	  [&](llvm::raw_ostream& out) {
+		out << moduleMap;
+		return llvm::Error::success();
+	})) {
+		llvm::errs() << std::format("cannot write {} ({})\n",
+		  std::string(mapPathName), llvm::toString(std::move(error)));
+		return 1;
+	}
+	moduleMapFiles.push_back(std::string(mapPathName));
+	return 0;
+}
+
+int prepareModules()
+{
+	if (!clModules) {return 0;}
+	llvm::SmallString<256> mapDir(getModulesCachePath());
+	llvm::sys::path::append(mapDir, "module_maps");
+	if (std::error_code errCode = llvm::sys::fs::create_directories(mapDir)) {
+		llvm::errs() << std::format("cannot create directory {} ({})\n",
+		  std::string(mapDir), errCode.message());
+		return 1;
+	}
+	for (const auto& dir : clModulesHeaderDirs) {
+		if (generateModuleMap(dir, std::string(mapDir))) {return 1;}
+	}
+	return 0;
+}
+
+clang::tooling::ArgumentsAdjuster getModulesArgumentsAdjuster()
+{
+	if (!clModules) {
+		return [](const clang::tooling::CommandLineArguments& args,
+		  llvm::StringRef) {return args;};
+	}
+	clang::tooling::CommandLineArguments extraArgs{"-fmodules",
+	  "-fimplicit-module-maps",
+	  std::format("-fmodules-cache-path={}", getModulesCachePath())};
+	for (const auto& mapFile : moduleMapFiles) {
+		extraArgs.push_back(std::format("-fmodule-map-file={}", mapFile));
+	}
+	return clang::tooling::getInsertArgumentAdjuster(extraArgs,
+	  clang::tooling::ArgumentInsertPosition::BEGIN);
+}
+
+void ParseTimes::add(const std::string& pathName,
+  std::chrono::nanoseconds time)
+{
+	std::scoped_lock lock(mutex_);
+	times_[pathName] += time;
+}
+
+static double toSeconds(std::chrono::nanoseconds t)
+{
+	return std::chrono::duration<double>(t).count();
+}
+
+int ParseTimes::finish(llvm::raw_ostream& out)
+{
+	std::scoped_lock lock(mutex_);
+	if (clParseTimesFile.empty()) {return 0;}
+	std::string_view mode = clModules ? "modules" : "textual";
+	std::string_view otherMode = clModules ? "textual" : "modules";
+
+	// The file holds an object for each mode that maps the pathname of
+	// each TU to its time in seconds.
+	llvm::json::Object record;
+	if (auto buffer = llvm::MemoryBuffer::getFile(clParseTimesFile)) {
+		auto value = llvm::json::parse((*buffer)->getBuffer());
+		if (!value || !value->getAsObject()) {
+			if (!value) {llvm::consumeError(value.takeError());}
+			llvm::errs() << std::format("invalid parse times file {}\n",
+			  std::string(clParseTimesFile));
+			return 1;
+		}
+		record = std::move(*value->getAsObject());
+	}
+	llvm::json::Object* modeTimes = record.getObject(mode);
+	if (!modeTimes) {
+		record[llvm::StringRef(mode)] = llvm::json::Object();
+		modeTimes = record.getObject(mode);
+	}
+	for (const auto& [pathName, time] : times_) {
+		(*modeTimes)[pathName] = toSeconds(time);
+	}
+
+	// Compare the times of the TUs in this run with those for the other
+	// mode (from an earlier run).
+	if (const llvm::json::Object* otherTimes = record.getObject(otherMode)) {
+		double textualTotal = 0;
+		double modulesTotal = 0;
+		unsigned count = 0;
+		for (const auto& [pathName, time] : times_) {
+			auto otherTime = otherTimes->getNumber(pathName);
+			if (!otherTime) {continue;}
+			double textualTime = clModules ? *otherTime : toSeconds(time);
+			double modulesTime = clModules ? toSeconds(time) : *otherTime;
+			out << std::format("{}: textual {:.3f} s, modules {:.3f} s, "
+			  "saved {:.3f} s\n", pathName, textualTime, modulesTime,
+			  textualTime - modulesTime);
+			textualTotal += textualTime;
+			modulesTotal += modulesTime;
+			++count;
+		}
+		if (count) {
+			out << std::format("total for {} TUs: textual {:.3f} s, modules "
+			  "{:.3f} s, saved {:.3f} s ({:.1f}%)\n", count, textualTotal,
+			  modulesTotal, textualTotal - modulesTotal, textualTotal > 0 ?
+			  100 * (textualTotal - modulesTotal) / textualTotal : 0.0);
+		}
+	}
+
+	if (auto error = llvm::writeToOutput(clParseTimesFile,
+	  [&](llvm::raw_ostream& fileOut) {
+		fileOut << llvm::json::Value(std::move(record)) << '\n';
+		return llvm::Error::success();
+	})) {
+		llvm::errs() << std::format("cannot write {} ({})\n",
+		  std::string(clParseTimesFile), llvm::toString(std::move(error)));
+		return 1;
+	}
+	return 0;
+}
+
+bool TimedToolAction::runInvocation(
+  std::shared_ptr<clang::CompilerInvocation> invocation,
+  clang::FileManager* files,
+  std::shared_ptr<clang::PCHContainerOperations> pchContainerOps,
+  clang::DiagnosticConsumer* diagConsumer)
+{
+	const auto& inputs = invocation->getFrontendOpts().Inputs;
+	std::string pathName = !inputs.empty() && inputs.front().isFile() ?
+	  std::string(inputs.front().getFile()) : std::string();
+	auto startTime = std::chrono::steady_clock::now();
+	bool result = action_->runInvocation(std::move(invocation), files,
+	  std::move(pchContainerOps), diagConsumer);
+	parseTimes_->add(pathName, std::chrono::steady_clock::now() - startTime);
+	return result;
+}
+
+} // namespace cal
@@ -0,0 +1,50 @@
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <llvm/Support/VirtualFileSystem.h>
+#include "cal/parallel.hpp"
+#include "cal/time_trace.hpp"
+
+namespace cal {
+
+int runParallel(const clang::tooling::CompilationDatabase& compilations,
+  const std::vector<std::string>& sources, unsigned numThreads,
+  const std::function<std::unique_ptr<ParallelAction>()>& makeAction)
+{
+	if (!numThreads) {
+		numThreads = std::max(std::thread::hardware_concurrency(), 1U);
+	}
+	numThreads = std::min<unsigned>(numThreads,
+	  std::max<std::size_t>(sources.size(), 1));
+	std::atomic<std::size_t> nextSource{0};
+	std::atomic<int> status{0};
+	std::mutex mutex;
+	std::vector<std::thread> threads;
+	for (unsigned i = 0; i < numThreads; ++i) {
+		threads.emplace_back([&]() {
+			TimeTraceThread timeTraceThread;
+			std::unique_ptr<ParallelAction> action = makeAction();
+			TracedToolAction tracedAction(&action->getToolAction());
+			std::size_t index;
+			while ((index = nextSource++) < sources.size()) {
+				// ClangTool changes the working directory to that of each
+				// compile command, which for the real file system is process
+				// wide, so each tool has a physical file system (with its own
+				// working directory) instead.
+				clang::tooling::ClangTool tool(compilations, {sources[index]},
+				  std::make_shared<clang::PCHContainerOperations>(),
+				  llvm::vfs::createPhysicalFileSystem());
+				if (tool.run(&tracedAction)) {status = 1;}
+			}
+			std::scoped_lock lock(mutex);
+			action->merge();
+		});
+	}
+	for (auto& thread : threads) {thread.join();}
+	return status;
+}
+
+} // namespace cal
@@ -0,0 +1,419 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <format>
+#include <limits>
+#include <clang/AST/DeclCXX.h>
+#include <clang/AST/DeclTemplate.h>
+#include <clang/AST/RecursiveASTVisitor.h>
+#include <llvm/ADT/STLExtras.h>
+#include <llvm/Support/Process.h>
+#include "cal/parent_map.hpp"
+
+namespace cal {
+
+static llvm::cl::opt<bool> clParentMapContext("parent-map-context",
+  llvm::cl::desc("Use the parent map of the whole TU (i.e., "
+  "ParentMapContext) for all parent queries"));
+static llvm::cl::opt<bool> clParentMapStats("parent-map-stats",
+  llvm::cl::desc("Print the time taken to build the parent maps and the "
+  "memory used by them"));
+
+namespace {
+
+// The statistics of the parent maps of all TUs.
+struct ParentMapStats {
+	std::atomic<unsigned long> numQueries{0};
+	std::atomic<unsigned long> numPassedOn{0};
+	std::atomic<unsigned long> numContextMaps{0};
+	std::atomic<unsigned long> numSubtrees{0};
+	std::atomic<unsigned long> numNodes{0};
+	std::atomic<unsigned long> numBytes{0};
+	std::atomic<std::int64_t> buildTime{0};
+	std::atomic<std::int64_t> heapGrowth{0};
+};
+
+ParentMapStats stats;
+
+// Measures the time taken to build a map and the growth of the heap (which
+// also includes the allocations of other threads, if any, so it is only
+// approximate for a tool that processes several TUs concurrently).
+class BuildScope {
+public:
+	BuildScope()
+	{
+		if (clParentMapStats) {
+			startTime_ = std::chrono::steady_clock::now();
+			startHeap_ = llvm::sys::Process::GetMallocUsage();
+		}
+	}
+	~BuildScope()
+	{
+		if (clParentMapStats) {
+			stats.buildTime += std::chrono::duration_cast<
+			  std::chrono::nanoseconds>(std::chrono::steady_clock::now() -
+			  startTime_).count();
+			stats.heapGrowth += static_cast<std::int64_t>(
+			  llvm::sys::Process::GetMallocUsage()) -
+			  static_cast<std::int64_t>(startHeap_);
+		}
+	}
+	BuildScope(const BuildScope&) = delete;
+	BuildScope& operator=(const BuildScope&) = delete;
+private:
+	std::chrono::steady_clock::time_point startTime_;
+	std::size_t startHeap_ = 0;
+};
+
+}
+
+// The traversal that builds the map of a subtree, which is the same as
+// that of ParentMapContext.
+class ParentMap::Builder : public clang::RecursiveASTVisitor<Builder> {
+public:
+	explicit Builder(Subtree& subtree) : subtree_(&subtree) {}
+	void pushParent(const clang::Decl& decl)
+	{
+		stack_.push_back(clang::DynTypedNode::create(decl));
+	}
+	bool shouldVisitTemplateInstantiations() const {return true;}
+	bool shouldVisitImplicitCode() const {return true;}
+	bool TraverseDecl(clang::Decl* decl)
+	{
+		if (!decl) {return true;}
+		return traverseNode(clang::DynTypedNode::create(*decl),
+		  [&]() {return Base::TraverseDecl(decl);});
+	}
+	bool TraverseTypeLoc(clang::TypeLoc typeLoc)
+	{
+		if (!typeLoc) {return true;}
+		return traverseNode(clang::DynTypedNode::create(typeLoc),
+		  [&]() {return Base::TraverseTypeLoc(typeLoc);});
+	}
+	bool TraverseNestedNameSpecifierLoc(clang::NestedNameSpecifierLoc loc)
+	{
+		if (!loc) {return true;}
+		return traverseNode(clang::DynTypedNode::create(loc),
+		  [&]() {return Base::TraverseNestedNameSpecifierLoc(loc);});
+	}
+	bool TraverseAttr(clang::Attr* attr)
+	{
+		if (!attr) {return true;}
+		return traverseNode(clang::DynTypedNode::create(*attr),
+		  [&]() {return Base::TraverseAttr(attr);});
+	}
+	bool TraverseObjCProtocolLoc(clang::ObjCProtocolLoc loc)
+	{
+		return traverseNode(clang::DynTypedNode::create(loc),
+		  [&]() {return Base::TraverseObjCProtocolLoc(loc);});
+	}
+	// The statements are handled here (rather than in TraverseStmt) so as
+	// not to prevent the data recursion of the traversal.
+	bool dataTraverseStmtPre(clang::Stmt* stmt)
+	{
+		auto node = clang::DynTypedNode::create(*stmt);
+		addParent(node);
+		stack_.push_back(node);
+		return true;
+	}
+	bool dataTraverseStmtPost(clang::Stmt*)
+	{
+		stack_.pop_back();
+		return true;
+	}
+private:
+	using Base = clang::RecursiveASTVisitor<Builder>;
+	template <class Traverse>
+	bool traverseNode(const clang::DynTypedNode& node, Traverse traverse)
+	{
+		addParent(node);
+		stack_.push_back(node);
+		bool result = traverse();
+		stack_.pop_back();
+		return result;
+	}
+	ParentVector* newVector(const clang::DynTypedNode& node)
+	{
+		subtree_->vectors.push_back(std::make_unique<ParentVector>(1, node));
+		return subtree_->vectors.back().get();
+	}
+	// Add the node on the top of the stack as a parent of a node.
+	void addParent(const clang::DynTypedNode& node)
+	{
+		if (stack_.empty()) {return;}
+		const clang::DynTypedNode& parent = stack_.back();
+		Parents& parents = node.getNodeKind().hasPointerIdentity() ?
+		  subtree_->pointerParents[node.getMemoizationData()] :
+		  subtree_->otherParents[node];
+		if (parents.isNull()) {
+			if (auto decl = parent.get<clang::Decl>()) {
+				parents = decl;
+			} else if (auto stmt = parent.get<clang::Stmt>()) {
+				parents = stmt;
+			} else {
+				parents = newVector(parent);
+			}
+			return;
+		}
+		auto vector = llvm::dyn_cast<ParentVector*>(parents);
+		if (!vector) {
+			auto decl = llvm::dyn_cast<const clang::Decl*>(parents);
+			vector = newVector(decl ? clang::DynTypedNode::create(*decl) :
+			  clang::DynTypedNode::create(*llvm::cast<const clang::Stmt*>(
+			  parents)));
+			parents = vector;
+		}
+		// As in ParentMapContext, a node is visited more than once in some
+		// cases (e.g., in template instantiations), and the duplicates are
+		// skipped if they can be compared.
+		if (!parent.getMemoizationData() ||
+		  !llvm::is_contained(*vector, parent)) {
+			vector->push_back(parent);
+		}
+	}
+	Subtree* subtree_;
+	llvm::SmallVector<clang::DynTypedNode, 16> stack_;
+};
+
+ParentMap::ParentMap(clang::ASTContext& astContext) :
+  astContext_(&astContext) {}
+
+ParentMap::~ParentMap() = default;
+
+clang::DynTypedNodeList ParentMap::getContextParents(
+  const clang::DynTypedNode& node)
+{
+	++stats.numPassedOn;
+	if (!contextUsed_) {
+		// The first query builds the map of the whole TU (unless it has
+		// already been built, e.g., by a matcher).
+		contextUsed_ = true;
+		++stats.numContextMaps;
+		BuildScope buildScope;
+		return astContext_->getParents(node);
+	}
+	return astContext_->getParents(node);
+}
+
+std::optional<clang::DynTypedNodeList> ParentMap::findParents(
+  const Subtree& subtree, const clang::DynTypedNode& node) const
+{
+	const Parents* parents = nullptr;
+	if (node.getNodeKind().hasPointerIdentity()) {
+		auto iter = subtree.pointerParents.find(node.getMemoizationData());
+		if (iter != subtree.pointerParents.end()) {parents = &iter->second;}
+	} else {
+		auto iter = subtree.otherParents.find(node);
+		if (iter != subtree.otherParents.end()) {parents = &iter->second;}
+	}
+	if (!parents) {return std::nullopt;}
+	if (auto decl = llvm::dyn_cast<const clang::Decl*>(*parents)) {
+		return clang::DynTypedNodeList(clang::DynTypedNode::create(*decl));
+	}
+	if (auto stmt = llvm::dyn_cast<const clang::Stmt*>(*parents)) {
+		return clang::DynTypedNodeList(clang::DynTypedNode::create(*stmt));
+	}
+	return clang::DynTypedNodeList(llvm::ArrayRef<clang::DynTypedNode>(
+	  *llvm::cast<ParentVector*>(*parents)));
+}
+
+const ParentMap::Subtree& ParentMap::getSubtree(const clang::Decl& root)
+{
+	std::unique_ptr<Subtree>& subtree = subtrees_[&root];
+	if (!subtree) {
+		BuildScope buildScope;
+		subtree = std::make_unique<Subtree>();
+		Builder builder(*subtree);
+		// A top-level declaration is a child of its declaration context.
+		builder.pushParent(*clang::Decl::castFromDeclContext(
+		  root.getLexicalDeclContext()));
+		builder.TraverseDecl(const_cast<clang::Decl*>(&root));
+		++stats.numSubtrees;
+		stats.numNodes += subtree->pointerParents.size() +
+		  subtree->otherParents.size();
+		std::size_t numBytes = subtree->pointerParents.getMemorySize() +
+		  subtree->otherParents.getMemorySize() +
+		  subtree->vectors.capacity() * sizeof(subtree->vectors[0]);
+		for (const auto& vector : subtree->vectors) {
+			// The vector has storage for two parents (without allocating).
+			numBytes += sizeof(ParentVector) + (vector->capacity() > 2 ?
+			  vector->capacity_in_bytes() : 0);
+		}
+		stats.numBytes += numBytes;
+	}
+	return *subtree;
+}
+
+const clang::Decl* ParentMap::getRootOfDecl(const clang::Decl& decl)
+{
+	indexRoots();
+	const clang::Decl* root = &decl;
+	for (;;) {
+		for (;;) {
+			const clang::DeclContext* context = root->getLexicalDeclContext();
+			if (!context) {return nullptr;}
+			if (llvm::isa<clang::TranslationUnitDecl, clang::NamespaceDecl,
+			  clang::LinkageSpecDecl, clang::ExportDecl>(context)) {
+				break;
+			}
+			root = clang::Decl::castFromDeclContext(context);
+		}
+		// A templated declaration is traversed from its template, and an
+		// implicit instantiation from the first declaration of its template.
+		const clang::Decl* from = root->getDescribedTemplate();
+		if (auto specialization =
+		  llvm::dyn_cast<clang::ClassTemplateSpecializationDecl>(root)) {
+			if (!specialization->isExplicitInstantiationOrSpecialization()) {
+				from = specialization->getSpecializedTemplate()->
+				  getCanonicalDecl();
+			}
+		} else if (auto specialization =
+		  llvm::dyn_cast<clang::VarTemplateSpecializationDecl>(root)) {
+			if (!specialization->isExplicitInstantiationOrSpecialization()) {
+				from = specialization->getSpecializedTemplate()->
+				  getCanonicalDecl();
+			}
+		} else if (auto function = llvm::dyn_cast<clang::FunctionDecl>(root)) {
+			if (function->getTemplateSpecializationKind() ==
+			  clang::TSK_ImplicitInstantiation &&
+			  function->getPrimaryTemplate()) {
+				from = function->getPrimaryTemplate()->getCanonicalDecl();
+			}
+		}
+		if (!from) {break;}
+		root = from;
+	}
+	// A declaration that is not traversed from its declaration context
+	// (e.g., a lambda class or a template parameter) is not a root.
+	return roots_.contains(root) ? root : nullptr;
+}
+
+void ParentMap::getRootsAt(clang::SourceLocation loc,
+  llvm::SmallVectorImpl<const clang::Decl*>& roots)
+{
+	if (loc.isInvalid()) {return;}
+	indexRoots();
+	auto [fileId, offset] =
+	  astContext_->getSourceManager().getDecomposedExpansionLoc(loc);
+	auto iter = rootRanges_.find(fileId);
+	if (iter == rootRanges_.end()) {return;}
+	const std::vector<RootRange>& ranges = iter->second;
+	auto rangeIter = std::upper_bound(ranges.begin(), ranges.end(), offset,
+	  [](unsigned offset, const RootRange& range) {
+		return offset < range.begin;
+	});
+	// The top-level declarations seldom overlap (except in cases such as
+	// "struct S {...} s;"), so only a few of those that start before the
+	// location are checked.
+	for (int i = 0; i < 4 && rangeIter != ranges.begin(); ++i) {
+		--rangeIter;
+		if (rangeIter->end >= offset) {roots.push_back(rangeIter->root);}
+	}
+}
+
+void ParentMap::indexRoots()
+{
+	if (rootsIndexed_) {return;}
+	rootsIndexed_ = true;
+	BuildScope buildScope;
+	indexRoots(*astContext_->getTranslationUnitDecl());
+	std::size_t numBytes = roots_.getMemorySize() +
+	  rootRanges_.getMemorySize();
+	for (auto& [fileId, ranges] : rootRanges_) {
+		std::stable_sort(ranges.begin(), ranges.end(),
+		  [](const RootRange& a, const RootRange& b) {
+			return a.begin < b.begin;
+		});
+		numBytes += ranges.capacity() * sizeof(RootRange);
+	}
+	stats.numBytes += numBytes;
+}
+
+void ParentMap::indexRoots(const clang::DeclContext& context)
+{
+	const clang::SourceManager& sourceManager =
+	  astContext_->getSourceManager();
+	for (const clang::Decl* decl : context.decls()) {
+		if (llvm::isa<clang::NamespaceDecl, clang::LinkageSpecDecl,
+		  clang::ExportDecl>(decl)) {
+			indexRoots(*llvm::cast<clang::DeclContext>(decl));
+			continue;
+		}
+		// These are traversed from the expressions in which they appear
+		// (as in RecursiveASTVisitor).
+		if (llvm::isa<clang::BlockDecl, clang::CapturedDecl>(decl)) {
+			continue;
+		}
+		if (auto record = llvm::dyn_cast<clang::CXXRecordDecl>(decl);
+		  record && record->isLambda()) {
+			continue;
+		}
+		roots_.insert(decl);
+		clang::SourceRange range = decl->getSourceRange();
+		if (range.isInvalid()) {continue;}
+		auto [fileId, begin] =
+		  sourceManager.getDecomposedExpansionLoc(range.getBegin());
+		auto [endFileId, end] = sourceManager.getDecomposedLoc(
+		  sourceManager.getExpansionRange(range.getEnd()).getEnd());
+		rootRanges_[fileId].push_back({begin, endFileId == fileId ? end :
+		  std::numeric_limits<unsigned>::max(), decl});
+	}
+}
+
+clang::DynTypedNodeList ParentMap::getParents(const clang::DynTypedNode& node)
+{
+	++stats.numQueries;
+	if (clParentMapContext || astContext_->getParentMapContext().
+	  getTraversalKind() != clang::TK_AsIs) {
+		return getContextParents(node);
+	}
+	if (auto decl = node.get<clang::Decl>()) {
+		if (llvm::isa<clang::TranslationUnitDecl>(decl)) {
+			return clang::DynTypedNodeList(
+			  llvm::ArrayRef<clang::DynTypedNode>());
+		}
+		if (llvm::isa<clang::NamespaceDecl, clang::LinkageSpecDecl,
+		  clang::ExportDecl>(decl)) {
+			return clang::DynTypedNodeList(clang::DynTypedNode::create(
+			  *clang::Decl::castFromDeclContext(
+			  decl->getLexicalDeclContext())));
+		}
+		if (auto root = getRootOfDecl(*decl)) {
+			if (auto parents = findParents(getSubtree(*root), node)) {
+				return *parents;
+			}
+		}
+	}
+	llvm::SmallVector<const clang::Decl*, 4> roots;
+	getRootsAt(node.getSourceRange().getBegin(), roots);
+	for (const clang::Decl* root : roots) {
+		if (auto parents = findParents(getSubtree(*root), node)) {
+			return *parents;
+		}
+	}
+	return getContextParents(node);
+}
+
+void addParentMapOptions(llvm::cl::OptionCategory& category)
+{
+	clParentMapContext.addCategory(category);
+	clParentMapStats.addCategory(category);
+}
+
+void printParentMapStats(llvm::raw_ostream& out)
+{
+	if (!clParentMapStats) {return;}
+	out << std::format("parent map: {} queries ({} passed on to "
+	  "ParentMapContext, with {} maps of whole TUs)\n",
+	  stats.numQueries.load(), stats.numPassedOn.load(),
+	  stats.numContextMaps.load());
+	out << std::format("parent map: {} subtrees with {} nodes ({:.1f} MB)\n",
+	  stats.numSubtrees.load(), stats.numNodes.load(),
+	  stats.numBytes.load() / 1e6);
+	out << std::format("parent map: built in {:.3f} s (heap growth "
+	  "{:.1f} MB)\n", stats.buildTime.load() / 1e9,
+	  stats.heapGrowth.load() / 1e6);
+}
+
+} // namespace cal
@@ -0,0 +1,318 @@
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <format>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <utility>
+#include <vector>
+#include <clang/AST/ASTContext.h>
+#include <clang/Basic/SourceManager.h>
+#include <clang/Frontend/MultiplexConsumer.h>
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+#include "cal/perf_counters.hpp"
+
+namespace cal {
+
+static llvm::cl::opt<bool> clPerfCounters("perf-counters",
+  llvm::cl::desc("Measure each phase with the hardware performance "
+  "counters (and print a summary per phase and per TU)"));
+
+static const char* const counterNames[numPerfCounters] = {
+	"cycles", "instructions", "L1d misses", "LLC misses", "branch misses",
+};
+
+// The totals for a phase.
+struct PhaseTotals {
+	unsigned count = 0;
+	std::chrono::nanoseconds time{0};
+	std::array<std::uint64_t, numPerfCounters> counts{};
+};
+
+// The state shared by all threads (which is guarded by the mutex).
+static std::mutex mutex;
+static std::map<std::string, PhaseTotals> phaseTotals;
+static std::map<std::pair<std::string, std::string>, PhaseTotals> tuTotals;
+static std::array<bool, numPerfCounters> available{};
+static std::string unavailableReason;
+
+// The TU being handled by the calling thread.
+static thread_local std::string currentTu;
+
+void addPerfCountersOptions(llvm::cl::OptionCategory& category)
+{
+	clPerfCounters.addCategory(category);
+}
+
+bool isPerfCountersEnabled()
+{
+	return clPerfCounters;
+}
+
+namespace {
+
+// The counters for one thread, which are opened as a group (so that they
+// are scheduled onto the PMU together) when the thread first samples
+// them.
+class CounterGroup {
+public:
+	CounterGroup();
+	CounterGroup(const CounterGroup&) = delete;
+	CounterGroup& operator=(const CounterGroup&) = delete;
+	~CounterGroup();
+	// Add the (cumulative) counts to a sample.
+	void read(PerfSample& sample) const;
+private:
+	int leaderFd_ = -1;
+	std::vector<int> fds_;
+	// The counter for each value read from the group.
+	std::vector<std::size_t> counters_;
+};
+
+#if defined(__linux__)
+
+struct CounterConfig {
+	std::uint32_t type;
+	std::uint64_t config;
+};
+
+const CounterConfig counterConfigs[numPerfCounters] = {
+	{PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+	{PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+	{PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D |
+	  (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+	  (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)},
+	{PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+	{PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+};
+
+int openCounter(const CounterConfig& config, int groupFd)
+{
+	perf_event_attr attr;
+	std::memset(&attr, 0, sizeof(attr));
+	attr.size = sizeof(attr);
+	attr.type = config.type;
+	attr.config = config.config;
+	attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED |
+	  PERF_FORMAT_TOTAL_TIME_RUNNING;
+	// Only user-mode events are counted, which is allowed with the default
+	// perf_event_paranoid setting.
+	attr.exclude_kernel = 1;
+	attr.exclude_hv = 1;
+	// The counters measure the calling thread on any CPU.
+	return static_cast<int>(::syscall(SYS_perf_event_open, &attr, 0, -1,
+	  groupFd, PERF_FLAG_FD_CLOEXEC));
+}
+
+CounterGroup::CounterGroup()
+{
+	std::array<bool, numPerfCounters> opened{};
+	std::string reason;
+	for (std::size_t i = 0; i < numPerfCounters; ++i) {
+		int fd = openCounter(counterConfigs[i], leaderFd_);
+		if (fd < 0) {
+			if (reason.empty()) {
+				reason = std::format("perf_event_open failed for {} ({})",
+				  counterNames[i], std::strerror(errno));
+			}
+			continue;
+		}
+		if (leaderFd_ < 0) {leaderFd_ = fd;}
+		fds_.push_back(fd);
+		counters_.push_back(i);
+		opened[i] = true;
+	}
+	std::scoped_lock lock(mutex);
+	for (std::size_t i = 0; i < numPerfCounters; ++i) {
+		available[i] = available[i] || opened[i];
+	}
+	if (unavailableReason.empty()) {unavailableReason = reason;}
+}
+
+CounterGroup::~CounterGroup()
+{
+	for (int fd : fds_) {::close(fd);}
+}
+
+void CounterGroup::read(PerfSample& sample) const
+{
+	if (leaderFd_ < 0) {return;}
+	// The format is the number of values, the times enabled and running,
+	// and then the values.
+	std::uint64_t data[3 + numPerfCounters];
+	ssize_t size = ::read(leaderFd_, data, sizeof(data));
+	if (size < static_cast<ssize_t>(3 * sizeof(std::uint64_t))) {return;}
+	std::uint64_t numValues = std::min<std::uint64_t>(data[0],
+	  counters_.size());
+	// If the PMU was shared with other events (i.e., multiplexed), the
+	// values are scaled to estimate the counts for the whole time.
+	double scale = data[2] && data[2] < data[1] ?
+	  static_cast<double>(data[1]) / data[2] : 1.0;
+	for (std::uint64_t i = 0; i < numValues; ++i) {
+		sample.counts[counters_[i]] = static_cast<std::uint64_t>(
+		  data[3 + i] * scale);
+	}
+}
+
+#else
+
+CounterGroup::CounterGroup()
+{
+	std::scoped_lock lock(mutex);
+	unavailableReason = "perf_event_open is only supported on Linux";
+}
+
+CounterGroup::~CounterGroup() = default;
+
+void CounterGroup::read(PerfSample&) const {}
+
+#endif
+
+PerfSample takeSample()
+{
+	static thread_local CounterGroup group;
+	PerfSample sample;
+	group.read(sample);
+	sample.time = std::chrono::steady_clock::now();
+	return sample;
+}
+
+// A consumer that measures the parsing of a TU (i.e., from when the
+// consumer is initialized until the end of the TU) and the handling of
+// the complete TU by another consumer.
+class PerfConsumer : public clang::MultiplexConsumer {
+public:
+	PerfConsumer(std::vector<std::unique_ptr<clang::ASTConsumer>> consumers,
+	  std::string phase) : clang::MultiplexConsumer(std::move(consumers)),
+	  phase_(std::move(phase)) {}
+	~PerfConsumer() override
+	{
+		parseScope_.reset();
+		if (initialized_) {currentTu = std::move(previousTu_);}
+	}
+	void Initialize(clang::ASTContext& astContext) override
+	{
+		const clang::SourceManager& sourceManager =
+		  astContext.getSourceManager();
+		previousTu_ = std::move(currentTu);
+		currentTu = std::string(sourceManager.getFilename(
+		  sourceManager.getLocForStartOfFile(sourceManager.getMainFileID())));
+		initialized_ = true;
+		parseScope_.emplace("parse");
+		clang::MultiplexConsumer::Initialize(astContext);
+	}
+	void HandleTranslationUnit(clang::ASTContext& astContext) override
+	{
+		parseScope_.reset();
+		std::optional<PerfScope> scope;
+		if (!phase_.empty()) {scope.emplace(phase_);}
+		clang::MultiplexConsumer::HandleTranslationUnit(astContext);
+	}
+private:
+	std::string phase_;
+	std::string previousTu_;
+	bool initialized_ = false;
+	std::optional<PerfScope> parseScope_;
+};
+
+void add(PhaseTotals& totals, const PerfSample& start, const PerfSample& end)
+{
+	++totals.count;
+	totals.time += end.time - start.time;
+	for (std::size_t i = 0; i < numPerfCounters; ++i) {
+		totals.counts[i] += end.counts[i] - start.counts[i];
+	}
+}
+
+void printTotals(llvm::raw_ostream& out, std::string_view name,
+  const PhaseTotals& totals)
+{
+	out << std::format("{:<12} {:>6} {:>10.3f}", name, totals.count,
+	  std::chrono::duration<double, std::milli>(totals.time).count());
+	for (std::size_t i = 0; i < numPerfCounters; ++i) {
+		if (available[i]) {
+			out << std::format(" {:>14}", totals.counts[i]);
+		} else {
+			out << std::format(" {:>14}", "-");
+		}
+	}
+	// The instructions per cycle.
+	if (available[0] && available[1] && totals.counts[0]) {
+		out << std::format(" {:>6.2f}",
+		  static_cast<double>(totals.counts[1]) / totals.counts[0]);
+	} else {
+		out << std::format(" {:>6}", "-");
+	}
+	out << '\n';
+}
+
+void printHeader(llvm::raw_ostream& out)
+{
+	out << std::format("{:<12} {:>6} {:>10}", "phase", "count", "time (ms)");
+	for (const char* name : counterNames) {
+		out << std::format(" {:>14}", name);
+	}
+	out << std::format(" {:>6}\n", "IPC");
+}
+
+}
+
+PerfScope::PerfScope(std::string_view phase) : active_(clPerfCounters)
+{
+	if (!active_) {return;}
+	phase_ = phase;
+	tu_ = currentTu;
+	start_ = takeSample();
+}
+
+PerfScope::~PerfScope()
+{
+	if (!active_) {return;}
+	PerfSample end = takeSample();
+	std::scoped_lock lock(mutex);
+	add(phaseTotals[phase_], start_, end);
+	add(tuTotals[{tu_, phase_}], start_, end);
+}
+
+std::unique_ptr<clang::ASTConsumer> makePerfConsumer(
+  std::unique_ptr<clang::ASTConsumer> consumer, std::string phase)
+{
+	if (!clPerfCounters) {return consumer;}
+	std::vector<std::unique_ptr<clang::ASTConsumer>> consumers;
+	consumers.push_back(std::move(consumer));
+	return std::make_unique<PerfConsumer>(std::move(consumers),
+	  std::move(phase));
+}
+
+void printPerfCounters(llvm::raw_ostream& out)
+{
+	if (!clPerfCounters) {return;}
+	std::scoped_lock lock(mutex);
+	if (!unavailableReason.empty()) {
+		out << std::format("note: some counters are unavailable: {}\n",
+		  unavailableReason);
+	}
+	out << "performance counters per phase:\n";
+	printHeader(out);
+	for (const auto& [phase, totals] : phaseTotals) {
+		printTotals(out, phase, totals);
+	}
+	// The totals are ordered by TU, so each TU has one table.
+	const std::string* tu = nullptr;
+	for (const auto& [key, totals] : tuTotals) {
+		if (!tu || key.first != *tu) {
+			tu = &key.first;
+			out << std::format("performance counters for TU {}:\n",
+			  !tu->empty() ? *tu : "[none]");
+			printHeader(out);
+		}
+		printTotals(out, key.second, totals);
+	}
+}
+
+} // namespace cal
@@ -0,0 +1,405 @@
+#include <bit>
+#include <cstring>
+#include <format>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#include <llvm/ADT/SmallString.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/Path.h>
+#include "cal/prefilter.hpp"
+
+namespace cal {
+
+/****************************************************************************\
+Substring Search
+\****************************************************************************/
+
+// This uses the approach of comparing the first and last characters of the
+// pattern against 16 candidate positions at once, and only comparing the
+// remaining characters for the candidates where both of these match.
+std::size_t findSubstring(std::string_view text, std::string_view pattern)
+{
+	const std::size_t n = text.size();
+	const std::size_t k = pattern.size();
+	if (k == 0) {
+		return 0;
+	}
+	if (n < k) {
+		return std::string_view::npos;
+	}
+	if (k == 1) {
+		auto p = static_cast<const char*>(std::memchr(text.data(),
+		  pattern[0], n));
+		return p ? p - text.data() : std::string_view::npos;
+	}
+	std::size_t i = 0;
+#if defined(__SSE2__)
+	const __m128i first = _mm_set1_epi8(pattern[0]);
+	const __m128i last = _mm_set1_epi8(pattern[k - 1]);
+	for (; i + k - 1 + 16 <= n; i += 16) {
+		const __m128i blockFirst = _mm_loadu_si128(
+		  reinterpret_cast<const __m128i*>(text.data() + i));
+		const __m128i blockLast = _mm_loadu_si128(
+		  reinterpret_cast<const __m128i*>(text.data() + i + k - 1));
+		unsigned mask = _mm_movemask_epi8(_mm_and_si128(
+		  _mm_cmpeq_epi8(first, blockFirst), _mm_cmpeq_epi8(last, blockLast)));
+		while (mask) {
+			unsigned offset = std::countr_zero(mask);
+			if (!std::memcmp(text.data() + i + offset + 1, pattern.data() + 1,
+			  k - 2)) {
+				return i + offset;
+			}
+			mask &= mask - 1;
+		}
+	}
+#endif
+	std::size_t pos = text.substr(i).find(pattern);
+	return pos != std::string_view::npos ? i + pos : std::string_view::npos;
+}
+
+/****************************************************************************\
+Include Directive Scanning
+\****************************************************************************/
+
+namespace {
+
+bool isHorizontalSpace(char c)
+{
+	return c == ' ' || c == '\t' || c == '\f' || c == '\v' || c == '\r';
+}
+
+std::string_view skipSpace(std::string_view s)
+{
+	std::size_t i = 0;
+	while (i < s.size() && isHorizontalSpace(s[i])) {
+		++i;
+	}
+	return s.substr(i);
+}
+
+enum class DirectiveKind {
+	None,
+	Include,
+	ComputedInclude,
+};
+
+// Parse an include directive (i.e., #include, #include_next, or #import)
+// on a single line of text.
+DirectiveKind parseIncludeLine(std::string_view line, std::string& name,
+  bool& angled)
+{
+	line = skipSpace(line);
+	if (line.empty() || line[0] != '#') {
+		return DirectiveKind::None;
+	}
+	line = skipSpace(line.substr(1));
+	bool found = false;
+	for (std::string_view keyword : {"include_next", "include", "import"}) {
+		if (line.starts_with(keyword)) {
+			line = line.substr(keyword.size());
+			found = true;
+			break;
+		}
+	}
+	if (!found) {
+		return DirectiveKind::None;
+	}
+	if (!line.empty() && !isHorizontalSpace(line[0]) && line[0] != '"' &&
+	  line[0] != '<') {
+		// This is some other directive (e.g., #includes).
+		return DirectiveKind::None;
+	}
+	line = skipSpace(line);
+	if (line.empty() || (line[0] != '"' && line[0] != '<')) {
+		return DirectiveKind::ComputedInclude;
+	}
+	angled = (line[0] == '<');
+	std::size_t end = line.find(angled ? '>' : '"', 1);
+	if (end == std::string_view::npos) {
+		return DirectiveKind::ComputedInclude;
+	}
+	name = line.substr(1, end - 1);
+	return DirectiveKind::Include;
+}
+
+std::string makeAbsolute(const std::string& workingDir,
+  llvm::StringRef pathName)
+{
+	llvm::SmallString<256> result;
+	if (llvm::sys::path::is_absolute(pathName)) {
+		result = pathName;
+	} else {
+		result = workingDir;
+		llvm::sys::path::append(result, pathName);
+	}
+	llvm::sys::path::remove_dots(result, true);
+	return std::string(result);
+}
+
+// The directories searched for quoted and angled includes, excluding the
+// system directories.
+struct SearchPath {
+	std::vector<std::string> quoteDirs;
+	std::vector<std::string> userDirs;
+	std::vector<std::string> forcedIncludes;
+	std::vector<std::string> otherArgs;
+	// Whether files are included with -imacros (which are not scanned).
+	bool hasMacroFiles = false;
+};
+
+SearchPath getSearchPath(const clang::tooling::CompileCommand& command)
+{
+	SearchPath searchPath;
+	const auto& args = command.CommandLine;
+	auto getValue = [&](std::size_t& i, std::string_view option,
+	  std::string& value) {
+		std::string_view arg = args[i];
+		if (!arg.starts_with(option)) {
+			return false;
+		}
+		if (arg.size() > option.size()) {
+			value = arg.substr(option.size());
+		} else if (i + 1 < args.size()) {
+			value = args[++i];
+		} else {
+			value.clear();
+		}
+		return true;
+	};
+	for (std::size_t i = 1; i < args.size(); ++i) {
+		std::string value;
+		if (std::string_view(args[i]).starts_with("-include-")) {
+			// Options such as -include-pch are not of interest.
+			searchPath.otherArgs.push_back(args[i]);
+		} else if (getValue(i, "-imacros", value) ||
+		  getValue(i, "--imacros", value)) {
+			searchPath.hasMacroFiles = true;
+		} else if (getValue(i, "-iquote", value)) {
+			searchPath.quoteDirs.push_back(makeAbsolute(command.Directory,
+			  value));
+		} else if (getValue(i, "-include", value)) {
+			searchPath.forcedIncludes.push_back(makeAbsolute(
+			  command.Directory, value));
+		} else if (getValue(i, "-I", value)) {
+			searchPath.userDirs.push_back(makeAbsolute(command.Directory,
+			  value));
+		} else {
+			searchPath.otherArgs.push_back(args[i]);
+		}
+	}
+	return searchPath;
+}
+
+std::string findInclude(const std::vector<std::string>& dirs,
+  const std::string& name)
+{
+	for (const auto& dir : dirs) {
+		llvm::SmallString<256> pathName(dir);
+		llvm::sys::path::append(pathName, name);
+		if (llvm::sys::fs::is_regular_file(pathName)) {
+			return std::string(pathName);
+		}
+	}
+	return {};
+}
+
+} // namespace
+
+/****************************************************************************\
+Token Prefilter
+\****************************************************************************/
+
+TokenPrefilter::TokenPrefilter(std::vector<std::string> tokens) :
+  tokens_(std::move(tokens)), numChecked_(0), numSkipped_(0) {}
+
+bool TokenPrefilter::containsToken(std::string_view text) const
+{
+	for (const auto& token : tokens_) {
+		if (findSubstring(text, token) != std::string_view::npos) {
+			return true;
+		}
+	}
+	return false;
+}
+
+const TokenPrefilter::FileInfo& TokenPrefilter::getFileInfo(
+  const std::string& pathName)
+{
+	{
+		std::scoped_lock lock(mutex_);
+		if (auto i = files_.find(pathName); i != files_.end()) {
+			return i->second;
+		}
+	}
+
+	// Scan the file without holding the lock.
+	FileInfo info;
+	auto buffer = llvm::MemoryBuffer::getFile(pathName, false, false);
+	if (buffer) {
+		info.readable = true;
+		std::string_view text((*buffer)->getBufferStart(),
+		  (*buffer)->getBufferSize());
+		info.hasToken = containsToken(text);
+		info.hasMacroHazard = (findSubstring(text, "##") !=
+		  std::string_view::npos);
+		std::size_t lineStart = 0;
+		while (lineStart < text.size()) {
+			// A line continued with a backslash-newline is joined with the
+			// following lines (as in translation phase 2).
+			std::string joinedLine;
+			bool continued = false;
+			std::size_t lineEnd;
+			for (;;) {
+				lineEnd = text.find('\n', lineStart);
+				if (lineEnd == std::string_view::npos) {
+					lineEnd = text.size();
+				}
+				std::string_view part = text.substr(lineStart,
+				  lineEnd - lineStart);
+				if (part.ends_with('\r')) {
+					part.remove_suffix(1);
+				}
+				if (lineEnd == text.size() || !part.ends_with('\\')) {
+					if (continued) {
+						joinedLine += part;
+					}
+					break;
+				}
+				part.remove_suffix(1);
+				joinedLine += part;
+				continued = true;
+				lineStart = lineEnd + 1;
+			}
+			std::string_view line = continued ? std::string_view(joinedLine) :
+			  text.substr(lineStart, lineEnd - lineStart);
+			std::string name;
+			bool angled = false;
+			DirectiveKind kind = parseIncludeLine(line, name, angled);
+			// An include directive that is continued over several lines is
+			// rare, so it is not followed (and the TU is not prefiltered).
+			if (continued && kind == DirectiveKind::Include) {
+				kind = DirectiveKind::ComputedInclude;
+			}
+			switch (kind) {
+			case DirectiveKind::Include:
+				info.includes.push_back({std::move(name), angled});
+				break;
+			case DirectiveKind::ComputedInclude:
+				info.hasMacroHazard = true;
+				break;
+			case DirectiveKind::None:
+				break;
+			}
+			lineStart = lineEnd + 1;
+		}
+	}
+
+	std::scoped_lock lock(mutex_);
+	return files_.try_emplace(pathName, std::move(info)).first->second;
+}
+
+bool TokenPrefilter::mayMatch(const clang::tooling::CompileCommand& command)
+{
+	SearchPath searchPath = getSearchPath(command);
+	bool result = searchPath.hasMacroFiles;
+	for (const auto& arg : searchPath.otherArgs) {
+		if (containsToken(arg)) {
+			result = true;
+			break;
+		}
+	}
+
+	std::vector<std::string> pending;
+	pending.push_back(makeAbsolute(command.Directory, command.Filename));
+	pending.insert(pending.end(), searchPath.forcedIncludes.begin(),
+	  searchPath.forcedIncludes.end());
+	std::unordered_set<std::string> visited(pending.begin(), pending.end());
+	while (!result && !pending.empty()) {
+		std::string pathName = std::move(pending.back());
+		pending.pop_back();
+		const FileInfo& info = getFileInfo(pathName);
+		if (!info.readable || info.hasToken || info.hasMacroHazard) {
+			result = true;
+			break;
+		}
+		std::string dir(llvm::sys::path::parent_path(pathName));
+		for (const auto& include : info.includes) {
+			std::string includePath;
+			if (!include.angled) {
+				includePath = findInclude({dir}, include.name);
+				if (includePath.empty()) {
+					includePath = findInclude(searchPath.quoteDirs,
+					  include.name);
+				}
+			}
+			if (includePath.empty()) {
+				includePath = findInclude(searchPath.userDirs, include.name);
+			}
+			// An include that is not found in any of the non-system
+			// directories is assumed to be a system header.
+			if (!includePath.empty() && visited.insert(includePath).second) {
+				pending.push_back(std::move(includePath));
+			}
+		}
+	}
+
+	std::scoped_lock lock(mutex_);
+	++numChecked_;
+	if (!result) {
+		++numSkipped_;
+	}
+	return result;
+}
+
+std::vector<std::string> TokenPrefilter::filterSources(
+  const clang::tooling::CompilationDatabase& compilations,
+  const std::vector<std::string>& sources)
+{
+	std::vector<std::string> result;
+	for (const auto& source : sources) {
+		llvm::SmallString<256> pathName(source);
+		llvm::sys::fs::make_absolute(pathName);
+		std::vector<clang::tooling::CompileCommand> commands =
+		  compilations.getCompileCommands(pathName);
+		bool keep = commands.empty();
+		for (const auto& command : commands) {
+			if (mayMatch(command)) {
+				keep = true;
+				break;
+			}
+		}
+		if (keep) {
+			result.push_back(source);
+		}
+	}
+	return result;
+}
+
+unsigned long TokenPrefilter::getNumChecked() const
+{
+	std::scoped_lock lock(mutex_);
+	return numChecked_;
+}
+
+unsigned long TokenPrefilter::getNumSkipped() const
+{
+	std::scoped_lock lock(mutex_);
+	return numSkipped_;
+}
+
+void TokenPrefilter::printSummary(llvm::raw_ostream& out) const
+{
+	unsigned long numChecked = getNumChecked();
+	unsigned long numSkipped = getNumSkipped();
+	out << std::format("prefilter: skipped {} of {} translation units "
+	  "({:.1f}%)\n", numSkipped, numChecked, numChecked ?
+	  100.0 * numSkipped / numChecked : 0.0);
+}
+
+} // namespace cal
@@ -0,0 +1,185 @@
+#include <algorithm>
+#include <format>
+#include <fstream>
+#include <mutex>
+#include <optional>
+#include <sstream>
+#include <vector>
+#if defined(__linux__)
+#include <time.h>
+#include <unistd.h>
+#endif
+#include "cal/startup_profile.hpp"
+
+namespace cal {
+
+static llvm::cl::opt<bool> clStartupProfile("startup-profile",
+  llvm::cl::desc("Print the time taken by each phase of startup (i.e., "
+  "until the first TU)"));
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+using Milliseconds = std::chrono::duration<double, std::milli>;
+
+struct Phase {
+	std::string name;
+	Clock::time_point begin;
+	Clock::time_point end;
+};
+
+struct StartupState {
+	std::mutex mutex;
+	// The time at which the first static initializer of the executable ran
+	// (on the steady clock and on the boot-time clock, which is the clock
+	// used for the start time of the process).
+	Clock::time_point init;
+	std::optional<double> initBootSeconds;
+	std::optional<Clock::time_point> main;
+	std::optional<Clock::time_point> done;
+	std::vector<Phase> phases;
+};
+
+StartupState& getState()
+{
+	static StartupState state;
+	return state;
+}
+
+// Records the time of the first static initializer of the executable.
+struct StartupRecorder {
+	StartupRecorder()
+	{
+		StartupState& state = getState();
+		state.init = Clock::now();
+#if defined(__linux__)
+		timespec ts;
+		if (!clock_gettime(CLOCK_BOOTTIME, &ts)) {
+			state.initBootSeconds = ts.tv_sec + ts.tv_nsec * 1e-9;
+		}
+#endif
+	}
+};
+
+// The highest priority that is available to a program, so that this runs
+// before the other static initializers of the executable.
+[[gnu::init_priority(101)]] StartupRecorder startupRecorder;
+
+// Get the time (in seconds since boot) at which the process started, or
+// nothing if it is not known.
+std::optional<double> getProcessStartBootSeconds()
+{
+#if defined(__linux__)
+	std::ifstream in("/proc/self/stat");
+	std::string stat;
+	if (!std::getline(in, stat)) {return std::nullopt;}
+	// The command name (i.e., the second field) is parenthesized, and may
+	// contain spaces, so the fields are counted from the last parenthesis.
+	std::size_t pos = stat.rfind(')');
+	if (pos == std::string::npos) {return std::nullopt;}
+	std::istringstream fields(stat.substr(pos + 1));
+	std::string field;
+	// The start time is the 22nd field (and the 3rd is the first after
+	// the command name).
+	for (int i = 3; i < 22; ++i) {fields >> field;}
+	unsigned long long ticks;
+	long ticksPerSecond = sysconf(_SC_CLK_TCK);
+	if (!(fields >> ticks) || ticksPerSecond <= 0) {return std::nullopt;}
+	return static_cast<double>(ticks) / ticksPerSecond;
+#else
+	return std::nullopt;
+#endif
+}
+
+}
+
+void addStartupProfileOptions(llvm::cl::OptionCategory& category)
+{
+	clStartupProfile.addCategory(category);
+}
+
+bool isStartupProfileEnabled()
+{
+	return clStartupProfile;
+}
+
+void markStartupMain()
+{
+	StartupState& state = getState();
+	std::scoped_lock lock(state.mutex);
+	if (!state.main) {state.main = Clock::now();}
+}
+
+void markStartupDone()
+{
+	StartupState& state = getState();
+	std::scoped_lock lock(state.mutex);
+	if (!state.done) {state.done = Clock::now();}
+}
+
+StartupScope::StartupScope(std::string_view name) : name_(name),
+  begin_(Clock::now()) {}
+
+StartupScope::~StartupScope()
+{
+	Clock::time_point end = Clock::now();
+	StartupState& state = getState();
+	std::scoped_lock lock(state.mutex);
+	// Only the phases that begin before the first TU are part of startup.
+	if (!state.done || begin_ < *state.done) {
+		state.phases.push_back({std::move(name_), begin_, end});
+	}
+}
+
+void printStartupProfile(llvm::raw_ostream& out)
+{
+	if (!clStartupProfile) {return;}
+	Clock::time_point now = Clock::now();
+	StartupState& state = getState();
+	std::scoped_lock lock(state.mutex);
+	// The times are relative to the start of the process (if known), and
+	// otherwise to the first static initializer.
+	double loading = 0;
+	std::optional<double> startSeconds = getProcessStartBootSeconds();
+	if (startSeconds && state.initBootSeconds) {
+		loading = std::max(1e3 * (*state.initBootSeconds - *startSeconds),
+		  0.0);
+	}
+	auto toMs = [&](Clock::time_point t) {
+		return loading + Milliseconds(t - state.init).count();
+	};
+	Clock::time_point main = state.main.value_or(state.init);
+	Clock::time_point done = state.done.value_or(now);
+
+	out << "startup profile:\n";
+	out << std::format("{:<32} {:>10} {:>10}\n", "phase", "start (ms)",
+	  "time (ms)");
+	auto printPhase = [&](std::string_view name, double start, double time) {
+		out << std::format("{:<32} {:>10.3f} {:>10.3f}\n", name, start, time);
+	};
+	if (startSeconds && state.initBootSeconds) {
+		printPhase("loading", 0, loading);
+	}
+	printPhase("static initialization", toMs(state.init),
+	  Milliseconds(main - state.init).count());
+	std::vector<Phase> phases = state.phases;
+	std::sort(phases.begin(), phases.end(),
+	  [](const Phase& a, const Phase& b) {return a.begin < b.begin;});
+	Clock::duration phasesTime{0};
+	for (const auto& phase : phases) {
+		printPhase(phase.name, toMs(phase.begin),
+		  Milliseconds(phase.end - phase.begin).count());
+		phasesTime += phase.end - phase.begin;
+	}
+	printPhase("other", toMs(main),
+	  std::max(Milliseconds(done - main - phasesTime).count(), 0.0));
+	printPhase(state.done ? "total (until the first TU)" : "total", 0,
+	  toMs(done));
+	if (!startSeconds || !state.initBootSeconds) {
+		out << "note: the time taken to load the program is unknown\n";
+	}
+	out << std::format("number of registered command-line options: {}\n",
+	  llvm::cl::getRegisteredOptions().size());
+}
+
+} // namespace cal
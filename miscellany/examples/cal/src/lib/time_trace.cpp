@@ -0,0 +1,97 @@
+#include <atomic>
+#include <format>
+#include <string>
+#include <clang/Frontend/CompilerInvocation.h>
+#include <llvm/Support/Error.h>
+#include <llvm/Support/raw_ostream.h>
+#include "cal/startup_profile.hpp"
+#include "cal/time_trace.hpp"
+
+namespace cal {
+
+static llvm::cl::opt<std::string> clTimeTraceFile("time-trace",
+  llvm::cl::desc("Write a Chrome trace of the run to the specified file"),
+  llvm::cl::value_desc("file"));
+static llvm::cl::opt<unsigned> clTimeTraceGranularity(
+  "time-trace-granularity",
+  llvm::cl::desc("Minimum duration (in microseconds) of a traced event"),
+  llvm::cl::init(500));
+
+// The process name for the trace, which is needed to initialize tracing in
+// each thread.
+static std::string processName;
+static std::atomic<bool> enabled{false};
+
+void addTimeTraceOptions(llvm::cl::OptionCategory& category)
+{
+	clTimeTraceFile.addCategory(category);
+	clTimeTraceGranularity.addCategory(category);
+}
+
+bool isTimeTraceEnabled()
+{
+	return enabled;
+}
+
+TimeTrace::TimeTrace(std::string_view name) : active_(false)
+{
+	if (clTimeTraceFile.empty()) {return;}
+	processName = name;
+	llvm::timeTraceProfilerInitialize(clTimeTraceGranularity, processName);
+	enabled = true;
+	active_ = true;
+}
+
+TimeTrace::~TimeTrace()
+{
+	finish();
+}
+
+int TimeTrace::finish()
+{
+	if (!active_) {return 0;}
+	active_ = false;
+	enabled = false;
+	int status = 0;
+	// The events for the threads that have finished tracing are merged
+	// with those of this thread.
+	if (auto error = llvm::timeTraceProfilerWrite(clTimeTraceFile,
+	  clTimeTraceFile)) {
+		llvm::errs() << std::format("cannot write time trace {} ({})\n",
+		  std::string(clTimeTraceFile), llvm::toString(std::move(error)));
+		status = 1;
+	}
+	llvm::timeTraceProfilerCleanup();
+	return status;
+}
+
+TimeTraceThread::TimeTraceThread() : active_(enabled)
+{
+	if (active_) {
+		llvm::timeTraceProfilerInitialize(clTimeTraceGranularity,
+		  processName);
+	}
+}
+
+TimeTraceThread::~TimeTraceThread()
+{
+	if (active_) {llvm::timeTraceProfilerFinishThread();}
+}
+
+bool TracedToolAction::runInvocation(
+  std::shared_ptr<clang::CompilerInvocation> invocation,
+  clang::FileManager* files,
+  std::shared_ptr<clang::PCHContainerOperations> pchContainerOps,
+  clang::DiagnosticConsumer* diagConsumer)
+{
+	markStartupDone();
+	const auto& inputs = invocation->getFrontendOpts().Inputs;
+	llvm::TimeTraceScope scope("ToolAction", [&]() {
+		return !inputs.empty() && inputs.front().isFile() ?
+		  std::string(inputs.front().getFile()) : std::string();
+	});
+	return action_->runInvocation(std::move(invocation), files,
+	  std::move(pchContainerOps), diagConsumer);
+}
+
+} // namespace cal
@@ -0,0 +1,143 @@
+#include <format>
+#include <utility>
+#include <clang/Tooling/ArgumentsAdjusters.h>
+#include <clang/Tooling/CommonOptionsParser.h>
+#include <clang/Tooling/JSONCompilationDatabase.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/Path.h>
+#include <llvm/Support/VirtualFileSystem.h>
+#include <llvm/Support/raw_ostream.h>
+#include "cal/startup_profile.hpp"
+#include "cal/tool_options.hpp"
+
+namespace ct = clang::tooling;
+
+namespace cal {
+
+LazyCompilationDatabase::LazyCompilationDatabase(std::string pathName) :
+  pathName_(std::move(pathName)) {}
+
+const ct::CompilationDatabase& LazyCompilationDatabase::getDatabase() const
+{
+	std::call_once(loaded_, [this]() {
+		StartupScope startupScope("compilation database");
+		std::string error;
+		auto database = ct::JSONCompilationDatabase::loadFromFile(pathName_,
+		  error, ct::JSONCommandLineSyntax::AutoDetect);
+		if (database) {
+			// This is the same as what the JSON compilation-database plugin
+			// does.
+			database_ = ct::inferTargetAndDriverMode(
+			  ct::inferMissingCompileCommands(ct::expandResponseFiles(
+			  std::move(database), llvm::vfs::getRealFileSystem())));
+		} else {
+			llvm::errs() << std::format("Error while trying to load a "
+			  "compilation database:\n{}\nRunning without flags.\n", error);
+			database_ = std::make_unique<ct::FixedCompilationDatabase>(".",
+			  std::vector<std::string>());
+		}
+	});
+	return *database_;
+}
+
+std::vector<ct::CompileCommand> LazyCompilationDatabase::getCompileCommands(
+  llvm::StringRef filePath) const
+{
+	return getDatabase().getCompileCommands(filePath);
+}
+
+std::vector<std::string> LazyCompilationDatabase::getAllFiles() const
+{
+	return getDatabase().getAllFiles();
+}
+
+std::vector<ct::CompileCommand>
+  LazyCompilationDatabase::getAllCompileCommands() const
+{
+	return getDatabase().getAllCompileCommands();
+}
+
+llvm::Expected<ToolOptionsParser> ToolOptionsParser::create(int& argc,
+  const char** argv, llvm::cl::OptionCategory& category,
+  llvm::cl::NumOccurrencesFlag occurrencesFlag, const char* overview)
+{
+	// As in CommonOptionsParser, the options are only registered if this
+	// function is called (so that they do not clash with those of
+	// CommonOptionsParser in a tool that uses it instead).
+	static llvm::cl::opt<std::string> buildPath("p",
+	  llvm::cl::desc("Build path"), llvm::cl::Optional, llvm::cl::cat(category));
+	static llvm::cl::list<std::string> sourcePaths(llvm::cl::Positional,
+	  llvm::cl::desc("<source0> [... <sourceN>]"), occurrencesFlag,
+	  llvm::cl::cat(category));
+	static llvm::cl::list<std::string> argsAfter("extra-arg",
+	  llvm::cl::desc("Additional argument to append to the compiler "
+	  "command line"), llvm::cl::cat(category));
+	static llvm::cl::list<std::string> argsBefore("extra-arg-before",
+	  llvm::cl::desc("Additional argument to prepend to the compiler "
+	  "command line"), llvm::cl::cat(category));
+
+	ToolOptionsParser parser;
+	std::unique_ptr<ct::CompilationDatabase> compilations;
+	{
+		StartupScope startupScope("command line");
+		llvm::cl::ResetAllOptionOccurrences();
+		llvm::cl::HideUnrelatedOptions(category);
+		// The arguments after -- (if any) specify a fixed compilation
+		// database, and are removed from the command line.
+		std::string error;
+		compilations = ct::FixedCompilationDatabase::loadFromCommandLine(argc,
+		  argv, error);
+		if (!error.empty()) {error += '\n';}
+		llvm::raw_string_ostream errorStream(error);
+		if (!llvm::cl::ParseCommandLineOptions(argc, argv, overview,
+		  &errorStream)) {
+			errorStream.flush();
+			return llvm::make_error<llvm::StringError>(error,
+			  llvm::inconvertibleErrorCode());
+		}
+		llvm::cl::PrintOptionValues();
+		parser.sourcePathList_ = sourcePaths;
+	}
+	if ((occurrencesFlag == llvm::cl::ZeroOrMore ||
+	  occurrencesFlag == llvm::cl::Optional) &&
+	  parser.sourcePathList_.empty()) {
+		return parser;
+	}
+
+	if (!compilations) {
+		llvm::SmallString<256> jsonPath(buildPath.getValue());
+		llvm::sys::path::append(jsonPath, "compile_commands.json");
+		if (!buildPath.empty() && llvm::sys::fs::is_regular_file(jsonPath)) {
+			compilations = std::make_unique<LazyCompilationDatabase>(
+			  std::string(jsonPath));
+		} else {
+			StartupScope startupScope("compilation database");
+			std::string error;
+			if (!buildPath.empty()) {
+				compilations = ct::CompilationDatabase::autoDetectFromDirectory(
+				  buildPath, error);
+			} else {
+				compilations = ct::CompilationDatabase::autoDetectFromSource(
+				  parser.sourcePathList_[0], error);
+			}
+			if (!compilations) {
+				llvm::errs() << std::format("Error while trying to load a "
+				  "compilation database:\n{}Running without flags.\n", error);
+				compilations = std::make_unique<ct::FixedCompilationDatabase>(
+				  ".", std::vector<std::string>());
+			}
+		}
+	}
+	auto adjustingCompilations =
+	  std::make_unique<ct::ArgumentsAdjustingCompilations>(
+	  std::move(compilations));
+	adjustingCompilations->appendArgumentsAdjuster(ct::combineAdjusters(
+	  ct::getInsertArgumentAdjuster(argsBefore,
+	  ct::ArgumentInsertPosition::BEGIN),
+	  ct::getInsertArgumentAdjuster(argsAfter,
+	  ct::ArgumentInsertPosition::END)));
+	parser.compilations_ = std::move(adjustingCompilations);
+	return parser;
+}
+
+} // namespace cal
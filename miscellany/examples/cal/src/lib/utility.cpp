@@ -220,6 +220,7 @@ std::string getClangVersion(const std::string& pathname)
 
 std::string getClangIncludeDirPathName()
 {
+	StartupScope startupScope("clang++ include directory");
 	bf::path clangProgramPath = getClangProgramPath();
 	if (clangProgramPath.empty()) {
 #if defined(CAL_DEBUG)
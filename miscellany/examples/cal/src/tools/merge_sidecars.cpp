@@ -0,0 +1,166 @@
+#include <algorithm>
+#include <format>
+#include <map>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <llvm/ADT/StringRef.h>
+#include <llvm/Support/CommandLine.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/JSON.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/raw_ostream.h>
+
+// Merge the sidecar files written by the analysis plugins (i.e., one JSON
+// object per line for each translation unit) into a single result.
+// Directories are searched recursively for the sidecar files of the
+// specified analysis.  Identical records (e.g., for code in a header
+// included by several translation units) are only output once.
+
+static llvm::cl::OptionCategory optionCategory("Tool options");
+static llvm::cl::list<std::string> clPaths(llvm::cl::Positional,
+  llvm::cl::desc("<sidecar file or directory>..."), llvm::cl::OneOrMore,
+  llvm::cl::cat(optionCategory));
+static llvm::cl::opt<std::string> clAnalysis("analysis",
+  llvm::cl::desc("The analysis whose sidecar files are to be merged (i.e., "
+  "files named *.<analysis>.jsonl)"), llvm::cl::Required,
+  llvm::cl::cat(optionCategory));
+static llvm::cl::list<std::string> clCountBy("count-by",
+  llvm::cl::desc("Instead of the records, print the number of records for "
+  "each distinct value of the specified fields"), llvm::cl::CommaSeparated,
+  llvm::cl::cat(optionCategory));
+static llvm::cl::opt<std::string> clOutputFile("o",
+  llvm::cl::desc("Output file"), llvm::cl::value_desc("file"),
+  llvm::cl::init("-"), llvm::cl::cat(optionCategory));
+
+static int findSidecars(const std::string& dir, std::string_view suffix,
+  std::vector<std::string>& pathNames)
+{
+	std::error_code errCode;
+	for (llvm::sys::fs::recursive_directory_iterator i(dir, errCode), end;
+	  i != end && !errCode; i.increment(errCode)) {
+		const std::string& pathName = i->path();
+		if (std::string_view(pathName).ends_with(suffix) &&
+		  i->type() != llvm::sys::fs::file_type::directory_file) {
+			pathNames.push_back(pathName);
+		}
+	}
+	if (errCode) {
+		llvm::errs() << std::format("cannot read directory {} ({})\n", dir,
+		  errCode.message());
+		return 1;
+	}
+	return 0;
+}
+
+// Get the value of a field of a record as a string (with strings
+// unquoted).
+static std::string getField(const llvm::json::Object& record,
+  llvm::StringRef name)
+{
+	const llvm::json::Value* value = record.get(name);
+	if (!value) {return {};}
+	if (auto s = value->getAsString()) {return std::string(*s);}
+	std::string buffer;
+	llvm::raw_string_ostream out(buffer);
+	out << *value;
+	return out.str();
+}
+
+static int printCounts(llvm::raw_ostream& out,
+  const std::vector<llvm::StringRef>& records)
+{
+	std::map<std::vector<std::string>, unsigned long> counts;
+	for (auto line : records) {
+		auto value = llvm::json::parse(line);
+		if (!value) {
+			llvm::errs() << std::format("invalid record ({})\n",
+			  llvm::toString(value.takeError()));
+			return 1;
+		}
+		const llvm::json::Object* record = value->getAsObject();
+		if (!record) {
+			llvm::errs() << "invalid record (not an object)\n";
+			return 1;
+		}
+		std::vector<std::string> key;
+		for (const auto& field : clCountBy) {
+			key.push_back(getField(*record, field));
+		}
+		++counts[std::move(key)];
+	}
+	std::vector<decltype(counts)::const_pointer> entries;
+	for (const auto& entry : counts) {entries.push_back(&entry);}
+	std::stable_sort(entries.begin(), entries.end(), [](auto a, auto b) {
+		return a->second > b->second;
+	});
+	for (auto entry : entries) {
+		out << std::format("{:>8}", entry->second);
+		for (const auto& value : entry->first) {out << ' ' << value;}
+		out << '\n';
+	}
+	return 0;
+}
+
+int main(int argc, char** argv)
+{
+	llvm::cl::HideUnrelatedOptions(optionCategory);
+	llvm::cl::ParseCommandLineOptions(argc, argv);
+	std::string suffix = std::format(".{}.jsonl", std::string(clAnalysis));
+	std::vector<std::string> pathNames;
+	for (const auto& path : clPaths) {
+		if (llvm::sys::fs::is_directory(path)) {
+			if (findSidecars(path, suffix, pathNames)) {return 1;}
+		} else {
+			pathNames.push_back(path);
+		}
+	}
+	std::sort(pathNames.begin(), pathNames.end());
+
+	// Each record is one line, so records are compared as text.
+	std::vector<std::unique_ptr<llvm::MemoryBuffer>> buffers;
+	std::vector<llvm::StringRef> records;
+	for (const auto& pathName : pathNames) {
+		auto buffer = llvm::MemoryBuffer::getFile(pathName);
+		if (!buffer) {
+			llvm::errs() << std::format("cannot open {} ({})\n", pathName,
+			  buffer.getError().message());
+			return 1;
+		}
+		llvm::StringRef data = (*buffer)->getBuffer();
+		while (!data.empty()) {
+			auto [line, rest] = data.split('\n');
+			if (!line.empty()) {records.push_back(line);}
+			data = rest;
+		}
+		buffers.push_back(std::move(*buffer));
+	}
+	std::size_t numRecords = records.size();
+	std::sort(records.begin(), records.end());
+	records.erase(std::unique(records.begin(), records.end()), records.end());
+	llvm::errs() << std::format("{} records ({} duplicates) from {} sidecar "
+	  "files\n", records.size(), numRecords - records.size(),
+	  pathNames.size());
+
+	std::error_code errCode;
+	llvm::raw_fd_ostream out(clOutputFile, errCode);
+	if (errCode) {
+		llvm::errs() << std::format("cannot open {} ({})\n",
+		  std::string(clOutputFile), errCode.message());
+		return 1;
+	}
+	if (!clCountBy.empty()) {
+		if (printCounts(out, records)) {return 1;}
+	} else {
+		for (auto line : records) {out << line << '\n';}
+	}
+	out.close();
+	if (out.has_error()) {
+		llvm::errs() << std::format("cannot write {} ({})\n",
+		  std::string(clOutputFile), out.error().message());
+		out.clear_error();
+		return 1;
+	}
+	return 0;
+}
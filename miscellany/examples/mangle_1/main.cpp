@@ -4,7 +4,10 @@
 
 #include <format>
 #include <string>
+#include <string_view>
 
+#include <cal/enum_names.hpp>
+#include <cal/time_trace.hpp>
 #include <clang/AST/Mangle.h>
 #include <clang/ASTMatchers/ASTMatchers.h>
 #include <clang/ASTMatchers/ASTMatchFinder.h>
@@ -31,16 +34,16 @@ enum class MatcherId {
 	Dtor,
 };
 
-std::string matcherIdToName(MatcherId id) {
-	std::map<MatcherId, std::string> lut{
+std::string_view matcherIdToName(MatcherId id) {
+	static constexpr auto lut = cal::makeEnumNames<MatcherId>({
 		{MatcherId::Type, "type"},
 		{MatcherId::Var, "var"},
 		{MatcherId::Func, "func"},
 		{MatcherId::Ctor, "ctor"},
 		{MatcherId::Dtor, "dtor"},
-	};
-	auto i = lut.find(id);
-	return i != lut.end() ? i->second : "";
+	}, "");
+	static_assert(lut.covers(MatcherId::Type, MatcherId::Dtor));
+	return lut(id);
 }
 
 /****************************************************************************\
@@ -242,6 +245,7 @@ struct MyMatchCallback : public cam::MatchFinder::MatchCallback {
 
 void MyMatchCallback::run(const cam::MatchFinder::MatchResult& result)
 {
+	llvm::TimeTraceScope timeScope("MatchCallback");
 	++count;
 	clang::ASTContext& astContext = *result.Context;
 	clang::SourceManager& sourceManager = astContext.getSourceManager();
@@ -368,12 +372,14 @@ void MyMatchCallback::run(const cam::MatchFinder::MatchResult& result)
 
 int main(int argc, const char **argv)
 {
+	cal::addTimeTraceOptions(optionCategory);
 	auto optParser = ct::CommonOptionsParser::create(argc, argv,
 	  optionCategory);
 	if (!optParser) {
 		llvm::errs() << llvm::toString(optParser.takeError());
 		return 1;
 	}
+	cal::TimeTrace timeTrace(argv[0]);
 	if (clVerbosityLevel >= 1) {
 		llvm::outs() << std::format("verbosity level: {}\n",
 		  clVerbosityLevel);
@@ -392,8 +398,11 @@ int main(int argc, const char **argv)
 		matchFinder.addDynamicMatcher(*getMatcher(id).getSingleMatcher(),
 		  &matchCallback);
 	}
-	int status = tool.run(ct::newFrontendActionFactory(&matchFinder).get());
+	auto factory = ct::newFrontendActionFactory(&matchFinder);
+	cal::TracedToolAction tracedAction(factory.get());
+	int status = tool.run(&tracedAction);
 	llvm::outs() << std::format("number of matches: {}\n",
 	  matchCallback.count);
+	if (timeTrace.finish()) {status = 1;}
 	return !status ? 0 : 1;
 }
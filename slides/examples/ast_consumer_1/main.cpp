@@ -1,4 +1,5 @@
 #include <format>
+#include <cal/time_trace.hpp>
 #include <clang/AST/ASTConsumer.h>
 #include <clang/Frontend/CompilerInstance.h>
 #include <clang/Frontend/FrontendAction.h>
@@ -13,6 +14,7 @@ class MyAstConsumer : public clang::ASTConsumer {
 public:
 	MyAstConsumer(const std::string& fileName) : fileName_(fileName) {}
 	void HandleTranslationUnit(clang::ASTContext& astContext) override {
+		llvm::TimeTraceScope timeScope("HandleTranslationUnit", fileName_);
 		llvm::outs() << std::format("input file: {}\nAST size: {}\n",
 		  fileName_, astContext.getASTAllocatedMemory());
 	}
@@ -30,6 +32,7 @@ struct MyAstFrontendAction : public clang::ASTFrontendAction {
 static llvm::cl::OptionCategory toolOptions("Tool Options");
 
 int main(int argc, char** argv) {
+	cal::addTimeTraceOptions(toolOptions);
 	auto expectedOptionsParser = ct::CommonOptionsParser::create(argc,
 	  const_cast<const char**>(argv), toolOptions);
 	if (!expectedOptionsParser) {
@@ -38,10 +41,13 @@ int main(int argc, char** argv) {
 		return 1;
 	}
 	ct::CommonOptionsParser& optionsParser = *expectedOptionsParser;
+	cal::TimeTrace timeTrace(argv[0]);
 	ct::ClangTool tool(optionsParser.getCompilations(),
 	  optionsParser.getSourcePathList());
-	int status = tool.run(
-	  ct::newFrontendActionFactory<MyAstFrontendAction>().get());
+	auto factory = ct::newFrontendActionFactory<MyAstFrontendAction>();
+	cal::TracedToolAction tracedAction(factory.get());
+	int status = tool.run(&tracedAction);
+	if (timeTrace.finish()) {status = 1;}
 	if (status) {llvm::errs() << "error occurred\n";}
 	return !status ? 0 : 1;
 }
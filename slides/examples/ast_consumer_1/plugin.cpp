@@ -0,0 +1,78 @@
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <cal/sidecar.hpp>
+#include <clang/AST/ASTConsumer.h>
+#include <clang/AST/ASTContext.h>
+#include <clang/Frontend/CompilerInstance.h>
+#include <clang/Frontend/FrontendPluginRegistry.h>
+#include <llvm/Support/JSON.h>
+#include <llvm/Support/raw_ostream.h>
+
+// The AST size analysis as a Clang plugin, which runs after the main
+// action of a normal compilation (so the TU is only parsed once) and
+// writes the AST size of the TU to a sidecar file.  For example:
+//   clang++ -fplugin=./ast_size_plugin.so -c foo.cpp
+// writes foo.o.ast_size.jsonl.  The plugin arguments are:
+//   out-dir=DIR  write the sidecar file in DIR
+
+namespace {
+
+class AstSizeConsumer : public clang::ASTConsumer {
+public:
+	AstSizeConsumer(clang::CompilerInstance& compilerInstance,
+	  const std::string& fileName, const std::string& outputDir) :
+	  compilerInstance_(&compilerInstance), fileName_(fileName),
+	  outputDir_(outputDir) {}
+	void HandleTranslationUnit(clang::ASTContext& astContext) final {
+		// The results for a TU that failed to compile are of no use.
+		if (compilerInstance_->getDiagnostics().hasErrorOccurred()) {return;}
+		std::string buffer;
+		llvm::raw_string_ostream out(buffer);
+		llvm::json::OStream json(out);
+		json.object([&]() {
+			json.attribute("file", fileName_);
+			json.attribute("astSize", static_cast<std::int64_t>(
+			  astContext.getASTAllocatedMemory()));
+		});
+		out << '\n';
+		out.flush();
+		cal::writeSidecar(*compilerInstance_, cal::getSidecarPathName(
+		  *compilerInstance_, "ast_size", outputDir_), buffer);
+	}
+private:
+	clang::CompilerInstance* compilerInstance_;
+	std::string fileName_;
+	std::string outputDir_;
+};
+
+class AstSizePluginAction : public clang::PluginASTAction {
+protected:
+	std::unique_ptr<clang::ASTConsumer> CreateASTConsumer(
+	  clang::CompilerInstance& compilerInstance, llvm::StringRef inFile)
+	  final {
+		return std::make_unique<AstSizeConsumer>(compilerInstance,
+		  std::string(inFile), outputDir_);
+	}
+	bool ParseArgs(const clang::CompilerInstance& compilerInstance,
+	  const std::vector<std::string>& args) final {
+		clang::DiagnosticsEngine& diags = compilerInstance.getDiagnostics();
+		for (const auto& arg : args) {
+			if (!cal::getPluginArg(arg, "out-dir", outputDir_)) {
+				diags.Report(diags.getCustomDiagID(
+				  clang::DiagnosticsEngine::Error,
+				  "invalid argument '%0' for ast-size plugin")) << arg;
+				return false;
+			}
+		}
+		return true;
+	}
+	ActionType getActionType() final {return AddAfterMainAction;}
+private:
+	std::string outputDir_;
+};
+
+}
+
+static clang::FrontendPluginRegistry::Add<AstSizePluginAction>
+  registration("ast-size", "Write the AST size to a sidecar file");
@@ -0,0 +1,59 @@
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include "call_index.hpp"
+
+namespace {
+
+const cal::ColumnFileFormat indexFormat{std::string_view("CALLIDX", 8), 2,
+  9, "a call index"};
+
+}
+
+int writeCallIndex(const std::string& pathName,
+  std::vector<CallRecord>& records) {
+	std::sort(records.begin(), records.end());
+	records.erase(std::unique(records.begin(), records.end()), records.end());
+	cal::ColumnFileWriter writer(indexFormat.numColumns);
+	writer.reserve(records.size());
+	for (const auto& record : records) {
+		writer.addRow(std::array<std::uint32_t, 9>{
+			writer.getStringId(record.name),
+			writer.getStringId(record.qualifiedName),
+			writer.getStringId(record.calleeUsr),
+			writer.getStringId(record.callerUsr),
+			writer.getStringId(record.file),
+			record.line,
+			record.column,
+			record.endLine,
+			record.lineOffset
+		});
+	}
+	return writer.write(pathName, indexFormat);
+}
+
+std::unique_ptr<CallIndex> CallIndex::open(const std::string& pathName,
+  std::string& error) {
+	std::unique_ptr<cal::ColumnFile> file = cal::ColumnFile::open(pathName,
+	  indexFormat, error);
+	if (!file) {return nullptr;}
+	return std::unique_ptr<CallIndex>(new CallIndex(std::move(file)));
+}
+
+std::pair<std::size_t, std::size_t> CallIndex::find(std::string_view name)
+  const {
+	return file_->equalRange(0, name);
+}
+
+bool CallIndex::matches(std::size_t i, std::string_view funcName) const {
+	// A fully-qualified name (i.e., with a leading "::") must match
+	// exactly.  Otherwise, the name must match a suffix of the qualified
+	// name that starts after a "::".
+	std::string_view qualifiedName = this->qualifiedName(i);
+	if (funcName.starts_with("::")) {
+		return funcName.substr(2) == qualifiedName;
+	}
+	return qualifiedName == funcName || (qualifiedName.ends_with(funcName) &&
+	  qualifiedName.substr(0, qualifiedName.size() - funcName.size())
+	  .ends_with("::"));
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include <cal/column_file.hpp>
+
+// One call site (i.e., an edge in the call graph).  For a call outside of
+// any function (e.g., in the initializer of a global variable), the caller
+// USR is empty.
+struct CallRecord {
+	// The unqualified and qualified names (as used by hasName) and the USR
+	// of the callee.
+	std::string name;
+	std::string qualifiedName;
+	std::string calleeUsr;
+	std::string callerUsr;
+	// The (spelling) location of the start of the call, the line on which
+	// the call ends, and the file offset of the start of the line on which
+	// the call starts.
+	std::string file;
+	unsigned line;
+	unsigned column;
+	unsigned endLine;
+	unsigned lineOffset;
+	auto asTuple() const {
+		return std::tie(name, qualifiedName, file, line, column, calleeUsr,
+		  callerUsr, endLine, lineOffset);
+	}
+	bool operator<(const CallRecord& other) const
+	  {return asTuple() < other.asTuple();}
+	bool operator==(const CallRecord& other) const
+	  {return asTuple() == other.asTuple();}
+};
+
+// The index file is a column file (see cal/column_file.hpp) with the
+// columns name, qualified name, callee USR, caller USR, file, line, column,
+// end line, and line offset.  The records are sorted by the unqualified
+// name of the callee (and then by qualified name and location), so that all
+// of the calls to functions with a given name can be found by binary search
+// on the name column.
+
+// Sort and deduplicate the records and write them to an index file.
+// Returns zero on success.
+int writeCallIndex(const std::string& pathName,
+  std::vector<CallRecord>& records);
+
+// A read-only view of a memory-mapped index file.
+class CallIndex {
+public:
+	// Returns null (and sets the error message) if the file cannot be
+	// read or is not a valid index.
+	static std::unique_ptr<CallIndex> open(const std::string& pathName,
+	  std::string& error);
+	std::size_t size() const {return file_->size();}
+	std::string_view name(std::size_t i) const
+	  {return file_->getString(0, i);}
+	std::string_view qualifiedName(std::size_t i) const
+	  {return file_->getString(1, i);}
+	std::string_view calleeUsr(std::size_t i) const
+	  {return file_->getString(2, i);}
+	std::string_view callerUsr(std::size_t i) const
+	  {return file_->getString(3, i);}
+	std::string_view file(std::size_t i) const
+	  {return file_->getString(4, i);}
+	unsigned line(std::size_t i) const {return file_->getInt(5, i);}
+	unsigned column(std::size_t i) const {return file_->getInt(6, i);}
+	unsigned endLine(std::size_t i) const {return file_->getInt(7, i);}
+	unsigned lineOffset(std::size_t i) const {return file_->getInt(8, i);}
+	// Get the half-open range of records with the specified unqualified
+	// callee name.
+	std::pair<std::size_t, std::size_t> find(std::string_view name) const;
+	// Test if a record matches a function name in the same way as the
+	// hasName matcher (i.e., the name may be partially qualified).
+	bool matches(std::size_t i, std::string_view funcName) const;
+private:
+	explicit CallIndex(std::unique_ptr<cal::ColumnFile> file) :
+	  file_(std::move(file)) {}
+	std::unique_ptr<cal::ColumnFile> file_;
+};
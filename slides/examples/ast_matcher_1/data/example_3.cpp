@@ -0,0 +1,21 @@
+namespace ns {
+
+template <class T>
+struct A {
+	void foo(T) {}
+	static int bar() {return 0;}
+};
+
+}
+
+struct B {
+	void foo() {}
+};
+
+int main() {
+	ns::A<int> a;
+	a.foo(1);
+	ns::A<double>().foo(2.0);
+	B().foo();
+	return ns::A<char>::bar();
+}
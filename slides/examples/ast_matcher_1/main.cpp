@@ -1,10 +1,24 @@
+#include <algorithm>
 #include <format>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cal/parallel.hpp>
+#include <cal/prefilter.hpp>
+#include <cal/startup_profile.hpp>
+#include <cal/time_trace.hpp>
+#include <cal/tool_options.hpp>
 #include <clang/ASTMatchers/ASTMatchers.h>
 #include <clang/ASTMatchers/ASTMatchFinder.h>
 #include <clang/Frontend/FrontendActions.h>
+#include <clang/Index/USRGeneration.h>
 #include <clang/Tooling/CommonOptionsParser.h>
 #include <clang/Tooling/Tooling.h>
 #include <llvm/Support/CommandLine.h>
+#include "call_index.hpp"
+#include "name_set.hpp"
 #include "utilities.hpp"
 
 namespace ct = clang::tooling;
@@ -23,13 +37,19 @@ clang::SourceLocation getLineEnd(const clang::SourceManager& sourceManager,
 }
 
 struct MyMatchCallback : public cam::MatchFinder::MatchCallback {
+	MyMatchCallback(const FunctionNameSet& funcNames) :
+	  funcNames_(&funcNames) {}
 	void run(const cam::MatchFinder::MatchResult& result) override {
+		llvm::TimeTraceScope timeScope("MatchCallback");
 		clang::SourceManager& sourceManager = *result.SourceManager;
-		if (auto p = result.Nodes.getNodeAs<clang::CallExpr>("call")) {
+		auto p = result.Nodes.getNodeAs<clang::CallExpr>("call");
+		auto callee = result.Nodes.getNodeAs<clang::FunctionDecl>("callee");
+		if (p && callee) {
 			clang::SourceLocation startLoc = p->getBeginLoc();
 			clang::SourceLocation endLoc = p->getEndLoc();
-			llvm::outs() << std::format("match at {}:\n", rangeToString(
-			  sourceManager, clang::SourceRange(startLoc, endLoc)));
+			llvm::outs() << std::format("match for {} at {}:\n",
+			  funcNames_->match(*callee), rangeToString(sourceManager,
+			  clang::SourceRange(startLoc, endLoc)));
 			clang::SourceLocation lineStartLoc = getLineStart(sourceManager,
 			  startLoc);
 			clang::SourceLocation lineEndLoc = getLineEnd(sourceManager,
@@ -41,32 +61,248 @@ struct MyMatchCallback : public cam::MatchFinder::MatchCallback {
 			llvm::outs() << addLineNumbers(text, startLineNo) << "\n";
 		}
 	}
+private:
+	const FunctionNameSet* funcNames_;
 };
 
-cam::StatementMatcher getMatcher(const std::string& funcName) {
+// Test if a declaration matches any of the names in a set.
+AST_MATCHER_P(clang::NamedDecl, hasNameInSet, const FunctionNameSet*,
+  funcNames) {
+	return !funcNames->match(Node).empty();
+}
+
+// A single matcher finds the calls to all of the functions, so each
+// translation unit is only parsed once (regardless of the number of names).
+// If the TUs were prefiltered, the calls whose function name is spelled in
+// a system header (e.g., in inline functions of the standard library, or
+// in the body of a macro defined there) are not reported, since the
+// prefilter skips the TUs in which the names only appear in system
+// headers.
+cam::StatementMatcher getMatcher(const FunctionNameSet& funcNames,
+  bool prefiltered) {
 	using namespace cam;
-	return callExpr(callee(functionDecl(hasName(funcName)))).bind("call");
+	auto calleeMatcher = callee(functionDecl(hasNameInSet(&funcNames))
+	  .bind("callee"));
+	if (prefiltered) {
+		return callExpr(callee(stmt(unless(cal::isSpelledInSystemHeader()))),
+		  calleeMatcher).bind("call");
+	}
+	return callExpr(calleeMatcher).bind("call");
 }
 
 static llvm::cl::OptionCategory optionCategory("Tool options");
-static llvm::cl::opt<std::string> clFuncName(
-  "f", llvm::cl::desc("Function name"), llvm::cl::value_desc("function_name"),
-  llvm::cl::cat(optionCategory), llvm::cl::Required);
-;
+static llvm::cl::list<std::string> clFuncNames(
+  "f", llvm::cl::desc("Function name (may be repeated or comma separated)"),
+  llvm::cl::value_desc("function_name"), llvm::cl::CommaSeparated,
+  llvm::cl::cat(optionCategory));
+static llvm::cl::opt<std::string> clNamesFile("names-file",
+  llvm::cl::desc("File listing function names (one per line)"),
+  llvm::cl::value_desc("file"), llvm::cl::cat(optionCategory));
+static llvm::cl::opt<bool> clPrefilter("prefilter",
+  llvm::cl::desc("Skip translation units that cannot contain any of the "
+  "function names"), llvm::cl::cat(optionCategory), llvm::cl::init(false));
+static llvm::cl::opt<std::string> clIndexFile("index",
+  llvm::cl::desc("Write an index of all call sites to the specified file "
+  "(instead of finding the calls to the named functions)"),
+  llvm::cl::value_desc("file"), llvm::cl::cat(optionCategory));
+static llvm::cl::opt<unsigned> clNumThreads("j",
+  llvm::cl::desc("Number of threads for indexing (0 means automatic)"),
+  llvm::cl::cat(optionCategory), llvm::cl::init(0));
+
+// Get the token that must appear in the source of a translation unit for a
+// call to the named function to be possible (i.e., the unqualified name).
+// Returns an empty string if no such token can be determined, which is the
+// case for functions that can be called without their name being spelled
+// (e.g., operators, and begin/end via range-based for loops).
+std::string getPrefilterToken(std::string_view funcName) {
+	if (auto pos = funcName.rfind("::"); pos != std::string_view::npos) {
+		funcName.remove_prefix(pos + 2);
+	}
+	static constexpr std::string_view implicitNames[] = {
+		"begin", "end", "get", "swap", "await_ready", "await_suspend",
+		"await_resume", "await_transform", "get_return_object",
+		"get_return_object_on_allocation_failure", "initial_suspend",
+		"final_suspend", "return_value", "return_void", "yield_value",
+		"unhandled_exception",
+	};
+	if (funcName.empty() || funcName.starts_with("operator") ||
+	  funcName.starts_with("~")) {
+		return {};
+	}
+	for (auto name : implicitNames) {
+		if (funcName == name) {return {};}
+	}
+	return std::string(funcName);
+}
+
+// Collects a record for each call (outside of system headers) to a
+// function.
+class IndexMatchCallback : public cam::MatchFinder::MatchCallback {
+public:
+	void run(const cam::MatchFinder::MatchResult& result) override;
+	std::vector<CallRecord>& getRecords() {return records_;}
+private:
+	std::vector<CallRecord> records_;
+};
+
+std::string getUsr(const clang::Decl* decl) {
+	llvm::SmallString<128> usr;
+	if (clang::index::generateUSRForDecl(decl, usr)) {return {};}
+	return std::string(usr);
+}
+
+// Get the absolute (and, if possible, real) path of the file containing a
+// location, so that the query tool can open the file from any directory.
+std::string getAbsolutePathName(const clang::SourceManager& sourceManager,
+  clang::SourceLocation loc) {
+	if (const clang::FileEntry* fileEntry = sourceManager.getFileEntryForID(
+	  sourceManager.getFileID(loc))) {
+		llvm::StringRef realPathName = fileEntry->tryGetRealPathName();
+		if (!realPathName.empty()) {return std::string(realPathName);}
+	}
+	llvm::SmallString<256> pathName(sourceManager.getFilename(loc));
+	sourceManager.getFileManager().makeAbsolutePath(pathName);
+	return std::string(pathName);
+}
+
+void IndexMatchCallback::run(const cam::MatchFinder::MatchResult& result) {
+	llvm::TimeTraceScope timeScope("MatchCallback");
+	const clang::SourceManager& sourceManager = *result.SourceManager;
+	auto call = result.Nodes.getNodeAs<clang::CallExpr>("call");
+	auto callee = result.Nodes.getNodeAs<clang::FunctionDecl>("callee");
+	auto caller = result.Nodes.getNodeAs<clang::FunctionDecl>("caller");
+	if (!call || !callee) {return;}
+	clang::SourceLocation loc = sourceManager.getSpellingLoc(
+	  call->getBeginLoc());
+	clang::SourceLocation endLoc = sourceManager.getSpellingLoc(
+	  call->getEndLoc());
+	if (loc.isInvalid()) {return;}
+	unsigned line = sourceManager.getSpellingLineNumber(loc);
+	unsigned column = sourceManager.getSpellingColumnNumber(loc);
+	// The column number is a byte offset within the line (plus one).
+	unsigned lineOffset = sourceManager.getFileOffset(loc) - (column - 1);
+	unsigned endLine = line;
+	if (endLoc.isValid() && sourceManager.isWrittenInSameFile(loc, endLoc)) {
+		endLine = std::max(line, sourceManager.getSpellingLineNumber(endLoc));
+	}
+	// The qualified name is that used by hasName, so that the queries
+	// match the same calls as the matcher.
+	llvm::SmallString<128> qualifiedName;
+	getQualifiedName(*callee, qualifiedName);
+	records_.push_back({
+		callee->getNameAsString(),
+		std::string(qualifiedName),
+		getUsr(callee),
+		caller ? getUsr(caller) : std::string(),
+		getAbsolutePathName(sourceManager, loc),
+		line,
+		column,
+		endLine,
+		lineOffset
+	});
+}
+
+// The per-thread state of the indexing, with the records of the thread
+// appended to those of all of the threads at the end.
+class IndexAction : public cal::ParallelAction {
+public:
+	explicit IndexAction(std::vector<CallRecord>& records) :
+	  records_(&records) {
+		using namespace cam;
+		matchFinder_.addMatcher(callExpr(unless(isExpansionInSystemHeader()),
+		  callee(functionDecl().bind("callee")), optionally(forFunction(
+		  functionDecl().bind("caller")))).bind("call"), &matchCallback_);
+		factory_ = ct::newFrontendActionFactory(&matchFinder_);
+	}
+	ct::ToolAction& getToolAction() override {return *factory_;}
+	void merge() override {
+		std::vector<CallRecord>& localRecords = matchCallback_.getRecords();
+		records_->insert(records_->end(),
+		  std::make_move_iterator(localRecords.begin()),
+		  std::make_move_iterator(localRecords.end()));
+	}
+private:
+	std::vector<CallRecord>* records_;
+	IndexMatchCallback matchCallback_;
+	cam::MatchFinder matchFinder_;
+	std::unique_ptr<ct::FrontendActionFactory> factory_;
+};
+
+int runIndex(const ct::CompilationDatabase& compilations,
+  const std::vector<std::string>& sources, unsigned numThreads,
+  std::vector<CallRecord>& records) {
+	return cal::runParallel(compilations, sources, numThreads, [&]() {
+		return std::make_unique<IndexAction>(records);
+	});
+}
 
 int main(int argc, const char **argv) {
-	auto expectedParser = ct::CommonOptionsParser::create(argc, argv,
+	cal::markStartupMain();
+	cal::addTimeTraceOptions(optionCategory);
+	cal::addStartupProfileOptions(optionCategory);
+	auto expectedParser = cal::ToolOptionsParser::create(argc, argv,
 	  optionCategory);
 	if (!expectedParser) {
 		llvm::errs() << llvm::toString(expectedParser.takeError());
 		return 1;
 	}
-	ct::CommonOptionsParser& optionsParser = expectedParser.get();
-	ct::ClangTool tool(optionsParser.getCompilations(),
-	  optionsParser.getSourcePathList());
-	MyMatchCallback matchCallback;
-	cam::StatementMatcher matcher = getMatcher(clFuncName);
+	cal::ToolOptionsParser& optionsParser = expectedParser.get();
+	cal::TimeTrace timeTrace(argv[0]);
+	std::vector<std::string> sources = optionsParser.getSourcePathList();
+	if (!clIndexFile.empty()) {
+		std::vector<CallRecord> records;
+		int status = runIndex(optionsParser.getCompilations(), sources,
+		  clNumThreads, records);
+		cal::printStartupProfile(llvm::errs());
+		{
+			llvm::TimeTraceScope timeScope("WriteIndex");
+			if (writeCallIndex(clIndexFile, records)) {return 1;}
+		}
+		llvm::errs() << std::format("indexed {} calls\n", records.size());
+		if (timeTrace.finish()) {status = 1;}
+		return !status ? 0 : 1;
+	}
+	std::vector<std::string> names(clFuncNames.begin(), clFuncNames.end());
+	if (!clNamesFile.empty() && !readNames(clNamesFile, names)) {return 1;}
+	FunctionNameSet funcNames;
+	for (const auto& name : names) {
+		if (!name.empty()) {funcNames.add(name);}
+	}
+	if (funcNames.empty()) {
+		llvm::errs() << "no function name specified\n";
+		return 1;
+	}
+	bool prefiltered = false;
+	if (clPrefilter) {
+		llvm::TimeTraceScope timeScope("Prefilter");
+		std::vector<std::string> tokens;
+		for (const auto& name : funcNames.getNames()) {
+			std::string token = getPrefilterToken(name);
+			if (token.empty()) {
+				llvm::errs() << std::format("warning: prefilter disabled "
+				  "(function {} can be called implicitly)\n", name);
+				tokens.clear();
+				break;
+			}
+			tokens.push_back(std::move(token));
+		}
+		if (!tokens.empty()) {
+			cal::TokenPrefilter prefilter(std::move(tokens));
+			sources = prefilter.filterSources(optionsParser.getCompilations(),
+			  sources);
+			prefilter.printSummary(llvm::errs());
+			prefiltered = true;
+		}
+	}
+	ct::ClangTool tool(optionsParser.getCompilations(), sources);
+	MyMatchCallback matchCallback(funcNames);
+	cam::StatementMatcher matcher = getMatcher(funcNames, prefiltered);
 	cam::MatchFinder matchFinder;
 	matchFinder.addMatcher(matcher, &matchCallback);
-	return tool.run(ct::newFrontendActionFactory(&matchFinder).get());
+	auto factory = ct::newFrontendActionFactory(&matchFinder);
+	cal::TracedToolAction tracedAction(factory.get());
+	int status = tool.run(&tracedAction);
+	cal::printStartupProfile(llvm::errs());
+	if (timeTrace.finish()) {status = 1;}
+	return status;
 }
@@ -0,0 +1,100 @@
+#include <format>
+#include <clang/AST/ASTContext.h>
+#include <clang/AST/DeclCXX.h>
+#include <llvm/ADT/SmallString.h>
+#include <llvm/ADT/SmallVector.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/raw_ostream.h>
+#include "name_set.hpp"
+
+void FunctionNameSet::add(std::string_view name) {
+	names_.emplace_back(name);
+	std::string_view unqualifiedName = name;
+	if (auto pos = name.rfind("::"); pos != std::string_view::npos) {
+		unqualifiedName.remove_prefix(pos + 2);
+	}
+	unqualifiedNames_.insert(unqualifiedName);
+	if (name.starts_with("::")) {
+		fullNames_.try_emplace(name.substr(2), name);
+	} else {
+		partialNames_.try_emplace(name, name);
+	}
+}
+
+void getQualifiedName(const clang::NamedDecl& decl,
+  llvm::SmallVectorImpl<char>& qualifiedName) {
+	llvm::SmallVector<llvm::StringRef, 8> names;
+	const clang::DeclContext* context = decl.getDeclContext();
+	for (; context && !context->isTranslationUnit();
+	  context = context->getParent()) {
+		if (auto ns = llvm::dyn_cast<clang::NamespaceDecl>(context)) {
+			if (!ns->isInline() && !ns->isAnonymousNamespace()) {
+				names.push_back(ns->getName());
+			}
+		} else if (auto record = llvm::dyn_cast<clang::RecordDecl>(context);
+		  record && record->getIdentifier()) {
+			names.push_back(record->getName());
+		} else if (!llvm::isa<clang::LinkageSpecDecl>(context) &&
+		  !llvm::isa<clang::ExportDecl>(context)) {
+			break;
+		}
+	}
+	qualifiedName.clear();
+	llvm::raw_svector_ostream out(qualifiedName);
+	if (context && !context->isTranslationUnit()) {
+		// Any other context (e.g., an anonymous class or a function) is
+		// named in the same way as by printQualifiedName.
+		clang::PrintingPolicy policy =
+		  decl.getASTContext().getPrintingPolicy();
+		policy.SuppressUnwrittenScope = true;
+		policy.SuppressInlineNamespace = true;
+		decl.printQualifiedName(out, policy);
+		return;
+	}
+	for (auto i = names.rbegin(); i != names.rend(); ++i) {out << *i << "::";}
+	decl.printName(out);
+}
+
+std::string_view FunctionNameSet::match(const clang::NamedDecl& decl) const {
+	if (const clang::IdentifierInfo* id = decl.getIdentifier()) {
+		if (!unqualifiedNames_.count(id->getName())) {return {};}
+	} else if (!unqualifiedNames_.count(decl.getNameAsString())) {
+		return {};
+	}
+	llvm::SmallString<128> qualifiedName;
+	getQualifiedName(decl, qualifiedName);
+	if (auto i = fullNames_.find(qualifiedName); i != fullNames_.end()) {
+		return i->second;
+	}
+	// Try each suffix of the qualified name that starts at a scope boundary
+	// (from longest to shortest).
+	llvm::StringRef suffix = qualifiedName;
+	for (;;) {
+		if (auto i = partialNames_.find(suffix); i != partialNames_.end()) {
+			return i->second;
+		}
+		auto pos = suffix.find("::");
+		if (pos == llvm::StringRef::npos) {break;}
+		suffix = suffix.drop_front(pos + 2);
+	}
+	return {};
+}
+
+bool readNames(const std::string& pathName, std::vector<std::string>& names) {
+	auto buffer = llvm::MemoryBuffer::getFile(pathName);
+	if (!buffer) {
+		llvm::errs() << std::format("cannot open {} ({})\n", pathName,
+		  buffer.getError().message());
+		return false;
+	}
+	llvm::StringRef text = (*buffer)->getBuffer();
+	while (!text.empty()) {
+		llvm::StringRef line;
+		std::tie(line, text) = text.split('\n');
+		line = line.trim();
+		if (!line.empty() && line.front() != '#') {
+			names.push_back(line.str());
+		}
+	}
+	return true;
+}
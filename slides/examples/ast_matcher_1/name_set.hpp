@@ -0,0 +1,46 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <clang/AST/Decl.h>
+#include <llvm/ADT/SmallVector.h>
+#include <llvm/ADT/StringMap.h>
+#include <llvm/ADT/StringSet.h>
+
+// A set of function names that is matched against declarations in the same
+// way as the hasName matcher (i.e., a name may be partially qualified, or
+// fully qualified with a leading "::"), but with a cost that does not
+// depend on the number of names.  A declaration is first checked against
+// the set of unqualified names, so the qualified name of a declaration is
+// only built when its unqualified name is in the set.
+class FunctionNameSet {
+public:
+	void add(std::string_view name);
+	bool empty() const {return names_.empty();}
+	const std::vector<std::string>& getNames() const {return names_;}
+	// Get the name (as added) matched by a declaration.  If more than one
+	// name matches, the most qualified one is returned.  Returns an empty
+	// string if no name matches.
+	std::string_view match(const clang::NamedDecl& decl) const;
+private:
+	std::vector<std::string> names_;
+	llvm::StringSet<> unqualifiedNames_;
+	// The fully-qualified names (without the leading "::") and the
+	// partially-qualified names, each mapped to the name as added.
+	llvm::StringMap<std::string> fullNames_;
+	llvm::StringMap<std::string> partialNames_;
+};
+
+// Get the qualified name of a declaration as used by hasName (i.e., with
+// the names of the enclosing namespaces and classes, but without template
+// arguments, so that a member of a class template specialization such as
+// A<int>::foo is named A::foo).  As for hasName, inline and anonymous
+// namespaces are not part of the qualified name.
+void getQualifiedName(const clang::NamedDecl& decl,
+  llvm::SmallVectorImpl<char>& qualifiedName);
+
+// Read a list of names (one per line, ignoring blank lines and lines
+// starting with "#") from a file.  Returns false if the file cannot be
+// read.
+bool readNames(const std::string& pathName, std::vector<std::string>& names);
@@ -0,0 +1,93 @@
+#include <format>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <llvm/ADT/StringMap.h>
+#include <llvm/Support/CommandLine.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/raw_ostream.h>
+#include "call_index.hpp"
+
+// Answer "who calls this function" queries against a call index without
+// invoking Clang.  For each call, the source lines spanned by the call are
+// printed from the (memory-mapped) source file.
+
+static llvm::cl::OptionCategory optionCategory("Tool options");
+static llvm::cl::opt<std::string> clIndexFile(llvm::cl::Positional,
+  llvm::cl::desc("<index file>"), llvm::cl::Required,
+  llvm::cl::cat(optionCategory));
+static llvm::cl::list<std::string> clFuncNames(llvm::cl::Positional,
+  llvm::cl::desc("<function name>..."), llvm::cl::OneOrMore,
+  llvm::cl::cat(optionCategory));
+
+// The source files, each of which is opened (at most) once.
+class SourceFiles {
+public:
+	// Returns null if the file cannot be read.
+	const llvm::MemoryBuffer* get(std::string_view pathName) {
+		auto [iter, inserted] = buffers_.try_emplace(pathName, nullptr);
+		if (inserted) {
+			auto buffer = llvm::MemoryBuffer::getFile(pathName, false, false);
+			if (buffer) {
+				iter->second = std::move(*buffer);
+			} else {
+				llvm::errs() << std::format("cannot open {} ({})\n", pathName,
+				  buffer.getError().message());
+			}
+		}
+		return iter->second.get();
+	}
+private:
+	llvm::StringMap<std::unique_ptr<llvm::MemoryBuffer>> buffers_;
+};
+
+// Write the lines from the start of a line (at the specified offset) up to
+// and including the specified end line, with line numbers.
+void writeLines(llvm::raw_ostream& out, std::string_view text,
+  std::size_t offset, unsigned line, unsigned endLine) {
+	if (offset > text.size()) {return;}
+	text.remove_prefix(offset);
+	for (; line <= endLine && !text.empty(); ++line) {
+		std::size_t n = text.find('\n');
+		std::string_view lineText = text.substr(0, n);
+		if (lineText.ends_with('\r')) {lineText.remove_suffix(1);}
+		out << std::format("{:4d}: {}\n", line, lineText);
+		text.remove_prefix(n != std::string_view::npos ? n + 1 : text.size());
+	}
+}
+
+int main(int argc, const char **argv) {
+	llvm::cl::HideUnrelatedOptions(optionCategory);
+	llvm::cl::ParseCommandLineOptions(argc, argv);
+	std::string error;
+	std::unique_ptr<CallIndex> index = CallIndex::open(clIndexFile, error);
+	if (!index) {
+		llvm::errs() << error << '\n';
+		return 1;
+	}
+	llvm::raw_ostream& out = llvm::outs();
+	SourceFiles sourceFiles;
+	int status = 0;
+	for (std::string_view funcName : clFuncNames) {
+		std::string_view name = funcName;
+		if (auto pos = name.rfind("::"); pos != std::string_view::npos) {
+			name.remove_prefix(pos + 2);
+		}
+		auto [begin, end] = index->find(name);
+		for (std::size_t i = begin; i < end; ++i) {
+			if (!index->matches(i, funcName)) {continue;}
+			out << std::format("match at {}:{}({}) calling {} from {}:\n",
+			  index->file(i), index->line(i), index->column(i),
+			  index->qualifiedName(i), !index->callerUsr(i).empty() ?
+			  index->callerUsr(i) : "(no function)");
+			if (auto buffer = sourceFiles.get(index->file(i))) {
+				writeLines(out, std::string_view(buffer->getBufferStart(),
+				  buffer->getBufferSize()), index->lineOffset(i),
+				  index->line(i), index->endLine(i));
+			} else {
+				status = 1;
+			}
+		}
+	}
+	return status;
+}
@@ -0,0 +1,53 @@
+#include <format>
+#include "ast_columns.hpp"
+
+namespace {
+
+const cal::ColumnFileFormat columnsFormat{std::string_view("ASTCOLS", 8), 1,
+  numAstColumns, "an AST column file"};
+
+constexpr std::string_view columnNames[numAstColumns] = {
+	"kind", "parent", "depth", "begin", "end", "file", "name", "params",
+	"flags",
+};
+
+}
+
+std::string_view astColumnToName(AstColumn column) {
+	return columnNames[static_cast<std::size_t>(column)];
+}
+
+std::optional<AstColumn> nameToAstColumn(std::string_view name) {
+	for (std::size_t i = 0; i < numAstColumns; ++i) {
+		if (columnNames[i] == name) {return static_cast<AstColumn>(i);}
+	}
+	return std::nullopt;
+}
+
+bool isStringAstColumn(AstColumn column) {
+	return column == AstColumn::Kind || column == AstColumn::File ||
+	  column == AstColumn::Name;
+}
+
+int AstColumnsWriter::write(const std::string& pathName) const {
+	return writer_.write(pathName, columnsFormat);
+}
+
+std::unique_ptr<AstColumns> AstColumns::open(const std::string& pathName,
+  std::string& error) {
+	std::unique_ptr<cal::ColumnFile> file = cal::ColumnFile::open(pathName,
+	  columnsFormat, error);
+	if (!file) {return nullptr;}
+	// The string columns are used to index tables with one entry per
+	// string (e.g., the group kinds in a query), so a string ID that is out
+	// of range is rejected here (instead of being checked on every use).
+	for (std::size_t i = 0; i < numAstColumns; ++i) {
+		auto column = static_cast<AstColumn>(i);
+		if (isStringAstColumn(column) &&
+		  !file->isColumnBounded(i, file->getNumStrings())) {
+			error = std::format("{} is corrupt", pathName);
+			return nullptr;
+		}
+	}
+	return std::unique_ptr<AstColumns>(new AstColumns(std::move(file)));
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <cal/column_file.hpp>
+
+// A flat, columnar form of the AST (i.e., of its declarations and
+// statements), which can be queried without Clang.  Each node has one
+// entry in each column, with the nodes in preorder (so that the parent of
+// a node always precedes it).  The string values (i.e., kinds, file names,
+// and declaration names) are dictionary encoded, with ID 0 being the empty
+// string.  The file is a column file (see cal/column_file.hpp) with the
+// columns in the order of AstColumn.
+
+enum class AstColumn : unsigned {
+	Kind, // the node kind (e.g., IfStmt or CXXMethodDecl) as a string ID
+	Parent, // the index of the parent node (or noAstNode)
+	Depth, // the depth of the node (with the TU at depth 0)
+	Begin, // the file offset of the start of the node (or noOffset)
+	End, // the file offset of the end of the node (or noOffset)
+	File, // the file containing the node as a string ID
+	Name, // the name of a declaration (or referenced declaration) as a
+	  // string ID
+	Params, // the number of parameters of a function
+	Flags, // the flags in AstNodeFlags
+	Count
+};
+
+inline constexpr std::size_t numAstColumns =
+  static_cast<std::size_t>(AstColumn::Count);
+inline constexpr std::uint32_t noAstNode = 0xffffffff;
+inline constexpr std::uint32_t noOffset = 0xffffffff;
+
+struct AstNodeFlags {
+	static constexpr std::uint32_t definition = 1;
+	static constexpr std::uint32_t implicit = 2;
+	static constexpr std::uint32_t mainFile = 4;
+};
+
+// Get the name of a column (e.g., params) or a column from its name.
+std::string_view astColumnToName(AstColumn column);
+std::optional<AstColumn> nameToAstColumn(std::string_view name);
+
+// Test if the values of a column are string IDs.
+bool isStringAstColumn(AstColumn column);
+
+// Collects the nodes of one or more TUs and writes them to a file.
+class AstColumnsWriter {
+public:
+	using Node = std::array<std::uint32_t, numAstColumns>;
+	AstColumnsWriter() : writer_(numAstColumns) {}
+	// Get the ID of a string (adding it to the dictionary if necessary).
+	std::uint32_t getStringId(std::string_view s)
+	  {return writer_.getStringId(s);}
+	// Add a node and return its index.
+	std::uint32_t addNode(const Node& node) {return writer_.addRow(node);}
+	std::size_t size() const {return writer_.size();}
+	// Write the file.  Returns zero on success.
+	int write(const std::string& pathName) const;
+private:
+	cal::ColumnFileWriter writer_;
+};
+
+// A read-only view of a memory-mapped file.
+class AstColumns {
+public:
+	// Returns null (and sets the error message) if the file cannot be
+	// read or is not valid.
+	static std::unique_ptr<AstColumns> open(const std::string& pathName,
+	  std::string& error);
+	std::size_t size() const {return file_->size();}
+	const std::uint32_t* getColumn(AstColumn column) const
+	  {return file_->getColumn(static_cast<std::size_t>(column));}
+	std::size_t getNumStrings() const {return file_->getNumStrings();}
+	std::string_view getString(std::uint32_t id) const
+	  {return file_->getString(id);}
+	// Get the ID of a string (if it is in the dictionary).
+	std::optional<std::uint32_t> findString(std::string_view s) const
+	  {return file_->findString(s);}
+private:
+	explicit AstColumns(std::unique_ptr<cal::ColumnFile> file) :
+	  file_(std::move(file)) {}
+	std::unique_ptr<cal::ColumnFile> file_;
+};
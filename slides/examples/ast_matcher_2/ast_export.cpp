@@ -0,0 +1,136 @@
+#include <string>
+#include <vector>
+#include <clang/AST/RecursiveASTVisitor.h>
+#include <clang/Basic/SourceManager.h>
+#include <llvm/ADT/DenseMap.h>
+#include "ast_export.hpp"
+
+namespace {
+
+class ColumnsVisitor : public clang::RecursiveASTVisitor<ColumnsVisitor> {
+public:
+	using Base = clang::RecursiveASTVisitor<ColumnsVisitor>;
+	ColumnsVisitor(clang::ASTContext& astContext, AstColumnsWriter& writer) :
+	  sourceManager_(&astContext.getSourceManager()), writer_(&writer) {}
+	bool shouldVisitTemplateInstantiations() const {return true;}
+	bool shouldVisitImplicitCode() const {return true;}
+
+	bool TraverseDecl(clang::Decl* decl) {
+		if (!decl) {return true;}
+		AstColumnsWriter::Node node = makeNode(std::string(
+		  decl->getDeclKindName()) + "Decl", decl->getSourceRange());
+		if (auto namedDecl = llvm::dyn_cast<clang::NamedDecl>(decl)) {
+			node[col(AstColumn::Name)] = getNameId(namedDecl);
+		}
+		if (auto funcDecl = llvm::dyn_cast<clang::FunctionDecl>(decl)) {
+			node[col(AstColumn::Params)] = funcDecl->param_size();
+		}
+		if (isDefinition(decl)) {
+			node[col(AstColumn::Flags)] |= AstNodeFlags::definition;
+		}
+		if (decl->isImplicit()) {
+			node[col(AstColumn::Flags)] |= AstNodeFlags::implicit;
+		}
+		return traverse(node, [&]() {return Base::TraverseDecl(decl);});
+	}
+
+	// Since this is overridden, the children of a statement are traversed
+	// recursively (instead of with a queue), so that the parent of each
+	// statement is on the stack.
+	bool TraverseStmt(clang::Stmt* stmt) {
+		if (!stmt) {return true;}
+		AstColumnsWriter::Node node = makeNode(stmt->getStmtClassName(),
+		  stmt->getSourceRange());
+		if (auto declRefExpr = llvm::dyn_cast<clang::DeclRefExpr>(stmt)) {
+			node[col(AstColumn::Name)] = getNameId(declRefExpr->getDecl());
+		} else if (auto memberExpr = llvm::dyn_cast<clang::MemberExpr>(
+		  stmt)) {
+			node[col(AstColumn::Name)] = getNameId(
+			  memberExpr->getMemberDecl());
+		}
+		return traverse(node, [&]() {return Base::TraverseStmt(stmt);});
+	}
+
+private:
+	static constexpr std::size_t col(AstColumn column)
+	  {return static_cast<std::size_t>(column);}
+
+	static bool isDefinition(const clang::Decl* decl) {
+		if (auto funcDecl = llvm::dyn_cast<clang::FunctionDecl>(decl)) {
+			return funcDecl->isThisDeclarationADefinition();
+		} else if (auto tagDecl = llvm::dyn_cast<clang::TagDecl>(decl)) {
+			return tagDecl->isThisDeclarationADefinition();
+		} else if (auto varDecl = llvm::dyn_cast<clang::VarDecl>(decl)) {
+			return varDecl->isThisDeclarationADefinition() ==
+			  clang::VarDecl::Definition;
+		}
+		return false;
+	}
+
+	std::uint32_t getNameId(const clang::NamedDecl* namedDecl) {
+		// Only identifiers are recorded, which avoids building a string for
+		// every special name (e.g., of a constructor or an operator).
+		return namedDecl && namedDecl->getIdentifier() ?
+		  writer_->getStringId(namedDecl->getName()) : 0;
+	}
+
+	// Get the file offset of a location (after macro expansion), and
+	// the file containing it.
+	std::pair<std::uint32_t, clang::FileID> getOffset(
+	  clang::SourceLocation loc) const {
+		if (loc.isInvalid()) {return {noOffset, clang::FileID()};}
+		auto [fileId, offset] = sourceManager_->getDecomposedExpansionLoc(
+		  loc);
+		return {offset, fileId};
+	}
+
+	std::uint32_t getFileId(clang::FileID fileId) {
+		if (fileId.isInvalid()) {return 0;}
+		auto [iter, inserted] = fileIds_.try_emplace(fileId, 0);
+		if (inserted) {
+			iter->second = writer_->getStringId(
+			  sourceManager_->getFilename(sourceManager_->getLocForStartOfFile(
+			  fileId)));
+		}
+		return iter->second;
+	}
+
+	AstColumnsWriter::Node makeNode(std::string_view kind,
+	  clang::SourceRange range) {
+		AstColumnsWriter::Node node{};
+		node[col(AstColumn::Kind)] = writer_->getStringId(kind);
+		node[col(AstColumn::Parent)] = parents_.empty() ? noAstNode :
+		  parents_.back();
+		node[col(AstColumn::Depth)] = parents_.size();
+		auto [begin, fileId] = getOffset(range.getBegin());
+		auto [end, endFileId] = getOffset(range.getEnd());
+		node[col(AstColumn::Begin)] = begin;
+		node[col(AstColumn::End)] = endFileId == fileId ? end : noOffset;
+		node[col(AstColumn::File)] = getFileId(fileId);
+		if (fileId.isValid() && fileId == sourceManager_->getMainFileID()) {
+			node[col(AstColumn::Flags)] |= AstNodeFlags::mainFile;
+		}
+		return node;
+	}
+
+	template <class F>
+	bool traverse(const AstColumnsWriter::Node& node, F traverseChildren) {
+		parents_.push_back(writer_->addNode(node));
+		bool result = traverseChildren();
+		parents_.pop_back();
+		return result;
+	}
+
+	const clang::SourceManager* sourceManager_;
+	AstColumnsWriter* writer_;
+	std::vector<std::uint32_t> parents_;
+	llvm::DenseMap<clang::FileID, std::uint32_t> fileIds_;
+};
+
+}
+
+void exportAstColumns(clang::ASTContext& astContext,
+  AstColumnsWriter& writer) {
+	ColumnsVisitor visitor(astContext, writer);
+	visitor.TraverseAST(astContext);
+}
@@ -0,0 +1,9 @@
+#pragma once
+
+#include <clang/AST/ASTContext.h>
+#include "ast_columns.hpp"
+
+// Append the declarations and statements of a TU (in preorder) to the
+// columns being written.
+void exportAstColumns(clang::ASTContext& astContext,
+  AstColumnsWriter& writer);
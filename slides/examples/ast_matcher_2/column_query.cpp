@@ -0,0 +1,296 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <format>
+#include <map>
+#include <numeric>
+#include <optional>
+#include <set>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <llvm/ADT/StringRef.h>
+#include <llvm/Support/CommandLine.h>
+#include <llvm/Support/raw_ostream.h>
+#include "ast_columns.hpp"
+
+// Answer queries against an AST column file (written by matcher -columns)
+// without invoking Clang.  A query selects the nodes that satisfy all of
+// the -where predicates (e.g., kind=CXXMethodDecl and params>=4), and then
+// counts them, lists them, or counts them per enclosing node of the kinds
+// given by -group-by (e.g., the number of IfStmt nodes per function).
+//
+// The predicates are evaluated a block of nodes at a time, with one pass
+// over the block of each column used.  Each pass is a branch-free loop
+// over a contiguous array (which the compiler vectorizes), and a block of
+// the selection fits in the L1 cache.
+
+static llvm::cl::OptionCategory optionCategory("Tool options");
+static llvm::cl::opt<std::string> clColumnsFile(llvm::cl::Positional,
+  llvm::cl::desc("<AST column file>"), llvm::cl::Required,
+  llvm::cl::cat(optionCategory));
+static llvm::cl::list<std::string> clPredicates("where",
+  llvm::cl::desc("Select the nodes that satisfy the predicate (e.g., "
+  "kind=IfStmt, params>=4, or flags&definition)"),
+  llvm::cl::value_desc("predicate"), llvm::cl::cat(optionCategory));
+static llvm::cl::list<std::string> clGroupKinds("group-by",
+  llvm::cl::desc("Count the selected nodes per nearest enclosing node of "
+  "one of the specified kinds"), llvm::cl::value_desc("kind,..."),
+  llvm::cl::CommaSeparated, llvm::cl::cat(optionCategory));
+static llvm::cl::opt<unsigned> clMinCount("min-count",
+  llvm::cl::desc("Only print the groups with at least this many nodes"),
+  llvm::cl::init(1), llvm::cl::cat(optionCategory));
+static llvm::cl::opt<bool> clList("list",
+  llvm::cl::desc("List the selected nodes"), llvm::cl::cat(optionCategory));
+static llvm::cl::opt<bool> clTiming("timing",
+  llvm::cl::desc("Print the time taken by the scan"),
+  llvm::cl::cat(optionCategory));
+static llvm::cl::opt<unsigned> clRepeat("repeat",
+  llvm::cl::desc("Repeat the scan (for timing)"), llvm::cl::init(1),
+  llvm::cl::cat(optionCategory));
+
+enum class Op {Eq, Ne, Lt, Le, Gt, Ge, And};
+
+struct Predicate {
+	AstColumn column;
+	Op op;
+	std::uint32_t value;
+};
+
+// The number of nodes per block, which keeps the selection for a block
+// (and the parts of the columns being compared) in the L1 cache.
+constexpr std::size_t blockSize = 4096;
+
+// Parse a predicate of the form column op value, where the value of a
+// string column is looked up in the dictionary.  Returns nothing (after
+// printing an error) if the predicate is invalid.
+std::optional<Predicate> parsePredicate(const AstColumns& columns,
+  llvm::StringRef s) {
+	static constexpr std::pair<const char*, Op> ops[] = {
+		{"!=", Op::Ne}, {"<=", Op::Le}, {">=", Op::Ge}, {"=", Op::Eq},
+		{"<", Op::Lt}, {">", Op::Gt}, {"&", Op::And},
+	};
+	std::size_t pos = s.find_first_of("!=<>&");
+	if (pos == llvm::StringRef::npos) {
+		llvm::errs() << std::format("invalid predicate {}\n", s.str());
+		return std::nullopt;
+	}
+	auto column = nameToAstColumn(s.substr(0, pos).trim());
+	if (!column) {
+		llvm::errs() << std::format("unknown column {}\n",
+		  s.substr(0, pos).trim().str());
+		return std::nullopt;
+	}
+	std::optional<Op> predOp;
+	llvm::StringRef value;
+	for (auto [opName, op] : ops) {
+		llvm::StringRef rest = s.substr(pos);
+		if (rest.consume_front(opName)) {
+			predOp = op;
+			value = rest.trim();
+			break;
+		}
+	}
+	if (!predOp) {
+		llvm::errs() << std::format("invalid operator in predicate {}\n",
+		  s.str());
+		return std::nullopt;
+	}
+	Predicate pred{*column, *predOp, 0};
+	if (isStringAstColumn(*column)) {
+		if (pred.op != Op::Eq && pred.op != Op::Ne) {
+			llvm::errs() << std::format("only = and != apply to the {} "
+			  "column\n", astColumnToName(*column));
+			return std::nullopt;
+		}
+		// A string that is not in the dictionary matches no node.
+		pred.value = columns.findString(value).value_or(noAstNode);
+	} else if (*column == AstColumn::Flags && value == "definition") {
+		pred.value = AstNodeFlags::definition;
+	} else if (*column == AstColumn::Flags && value == "implicit") {
+		pred.value = AstNodeFlags::implicit;
+	} else if (*column == AstColumn::Flags && value == "main") {
+		pred.value = AstNodeFlags::mainFile;
+	} else if (value.getAsInteger(0, pred.value)) {
+		llvm::errs() << std::format("invalid value in predicate {}\n",
+		  s.str());
+		return std::nullopt;
+	}
+	return pred;
+}
+
+// Clear the selection of each node in a block whose value does not
+// satisfy a comparison.  The selection has one byte per node (instead of
+// one bit) so that this loop is vectorized.
+template <class Cmp>
+void narrow(const std::uint32_t* values, std::size_t n,
+  std::uint8_t* selection, Cmp cmp) {
+	for (std::size_t i = 0; i < n; ++i) {selection[i] &= cmp(values[i]);}
+}
+
+void applyPredicate(const Predicate& pred, const std::uint32_t* values,
+  std::size_t n, std::uint8_t* selection) {
+	std::uint32_t v = pred.value;
+	// The operator is dispatched once per block (and not per node).
+	switch (pred.op) {
+	case Op::Eq:
+		narrow(values, n, selection, [v](std::uint32_t x) {return x == v;});
+		break;
+	case Op::Ne:
+		narrow(values, n, selection, [v](std::uint32_t x) {return x != v;});
+		break;
+	case Op::Lt:
+		narrow(values, n, selection, [v](std::uint32_t x) {return x < v;});
+		break;
+	case Op::Le:
+		narrow(values, n, selection, [v](std::uint32_t x) {return x <= v;});
+		break;
+	case Op::Gt:
+		narrow(values, n, selection, [v](std::uint32_t x) {return x > v;});
+		break;
+	case Op::Ge:
+		narrow(values, n, selection, [v](std::uint32_t x) {return x >= v;});
+		break;
+	case Op::And:
+		narrow(values, n, selection,
+		  [v](std::uint32_t x) {return (x & v) != 0;});
+		break;
+	}
+}
+
+// Select the nodes that satisfy all of the predicates.  The indices of the
+// selected nodes are only collected if needed (since counting them is
+// much cheaper).
+std::size_t scan(const AstColumns& columns,
+  const std::vector<Predicate>& preds, std::vector<std::uint32_t>* matches) {
+	std::size_t numNodes = columns.size();
+	std::vector<std::uint8_t> selection(blockSize);
+	std::size_t count = 0;
+	for (std::size_t begin = 0; begin < numNodes; begin += blockSize) {
+		std::size_t n = std::min(blockSize, numNodes - begin);
+		std::fill_n(selection.data(), n, 1);
+		for (const auto& pred : preds) {
+			applyPredicate(pred, columns.getColumn(pred.column) + begin, n,
+			  selection.data());
+		}
+		if (matches) {
+			for (std::size_t i = 0; i < n; ++i) {
+				if (selection[i]) {matches->push_back(begin + i);}
+			}
+		} else {
+			count += std::accumulate(selection.data(), selection.data() + n,
+			  std::size_t(0));
+		}
+	}
+	return matches ? matches->size() : count;
+}
+
+std::string nodeToString(const AstColumns& columns, std::uint32_t i) {
+	auto get = [&](AstColumn column) {return columns.getColumn(column)[i];};
+	std::string location(columns.getString(get(AstColumn::File)));
+	if (get(AstColumn::Begin) != noOffset) {
+		location += std::format(":{}", get(AstColumn::Begin));
+		if (get(AstColumn::End) != noOffset) {
+			location += std::format("-{}", get(AstColumn::End));
+		}
+	}
+	std::string s = std::format("{} {}", location,
+	  columns.getString(get(AstColumn::Kind)));
+	if (get(AstColumn::Name)) {
+		s += std::format(" {}", columns.getString(get(AstColumn::Name)));
+	}
+	return s;
+}
+
+// Get the nearest proper ancestor of a node whose kind is one of those
+// specified (or noAstNode if there is none).
+std::uint32_t getGroup(const AstColumns& columns,
+  const std::vector<bool>& isGroupKind, std::uint32_t i) {
+	const std::uint32_t* kinds = columns.getColumn(AstColumn::Kind);
+	const std::uint32_t* parents = columns.getColumn(AstColumn::Parent);
+	// Since a parent precedes its children, this always terminates (even
+	// for a corrupt file).  The kinds are valid string IDs, since they are
+	// checked when the file is opened.
+	for (std::uint32_t p = parents[i]; p < i; i = p, p = parents[p]) {
+		if (isGroupKind[kinds[p]]) {return p;}
+	}
+	return noAstNode;
+}
+
+void printGroups(const AstColumns& columns,
+  const std::vector<std::uint32_t>& matches, llvm::raw_ostream& out) {
+	std::vector<bool> isGroupKind(columns.getNumStrings());
+	for (const auto& kind : clGroupKinds) {
+		if (auto id = columns.findString(kind)) {isGroupKind[*id] = true;}
+	}
+	std::map<std::uint32_t, std::size_t> counts;
+	std::size_t numUngrouped = 0;
+	for (auto i : matches) {
+		std::uint32_t group = getGroup(columns, isGroupKind, i);
+		if (group != noAstNode) {
+			++counts[group];
+		} else {
+			++numUngrouped;
+		}
+	}
+	std::vector<std::pair<std::uint32_t, std::size_t>> groups(counts.begin(),
+	  counts.end());
+	std::stable_sort(groups.begin(), groups.end(),
+	  [](const auto& a, const auto& b) {return a.second > b.second;});
+	for (const auto& [group, count] : groups) {
+		if (count < clMinCount) {break;}
+		out << std::format("{} {}\n", count, nodeToString(columns, group));
+	}
+	out << std::format("number of groups: {}\n", groups.size());
+	out << std::format("number of nodes outside any group: {}\n",
+	  numUngrouped);
+}
+
+int main(int argc, const char **argv) {
+	llvm::cl::HideUnrelatedOptions(optionCategory);
+	llvm::cl::ParseCommandLineOptions(argc, argv);
+	std::string error;
+	std::unique_ptr<AstColumns> columns = AstColumns::open(clColumnsFile,
+	  error);
+	if (!columns) {
+		llvm::errs() << error << '\n';
+		return 1;
+	}
+	std::vector<Predicate> preds;
+	for (const auto& s : clPredicates) {
+		auto pred = parsePredicate(*columns, s);
+		if (!pred) {return 1;}
+		preds.push_back(*pred);
+	}
+
+	bool needMatches = clList || !clGroupKinds.empty();
+	std::vector<std::uint32_t> matches;
+	std::size_t count = 0;
+	auto startTime = std::chrono::steady_clock::now();
+	for (unsigned i = 0; i < std::max(clRepeat.getValue(), 1u); ++i) {
+		matches.clear();
+		count = scan(*columns, preds, needMatches ? &matches : nullptr);
+	}
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() -
+	  startTime;
+
+	llvm::raw_ostream& out = llvm::outs();
+	if (clList) {
+		for (auto i : matches) {out << nodeToString(*columns, i) << '\n';}
+	}
+	if (!clGroupKinds.empty()) {printGroups(*columns, matches, out);}
+	out << std::format("number of nodes: {}\n", columns->size());
+	out << std::format("number of selected nodes: {}\n", count);
+	if (clTiming) {
+		// Each column used by a predicate is read once per scan.
+		std::set<AstColumn> usedColumns;
+		for (const auto& pred : preds) {usedColumns.insert(pred.column);}
+		double bytes = 4.0 * columns->size() * usedColumns.size() *
+		  std::max(clRepeat.getValue(), 1u);
+		double seconds = elapsed.count();
+		out << std::format("scanned {:.1f} MB in {:.3f} ms ({:.2f} GB/s)\n",
+		  bytes / 1e6, 1e3 * seconds, seconds > 0 ? bytes / seconds / 1e9 :
+		  0.0);
+	}
+	return 0;
+}
@@ -0,0 +1,41 @@
+#include <vector>
+
+// Many declarations are generated by (nested) macro expansions, so that
+// most source locations are macro locations.
+
+#define FIELD(type, name) type name##_ = type();
+#define GETTER(type, name) type get_##name() const {return name##_;}
+#define SETTER(type, name) void set_##name(type x) {name##_ = x;}
+#define MEMBER(type, name) \
+	FIELD(type, name) \
+	GETTER(type, name) \
+	SETTER(type, name)
+#define MEMBERS(type, prefix) \
+	MEMBER(type, prefix##0) MEMBER(type, prefix##1) MEMBER(type, prefix##2) \
+	MEMBER(type, prefix##3) MEMBER(type, prefix##4) MEMBER(type, prefix##5) \
+	MEMBER(type, prefix##6) MEMBER(type, prefix##7)
+#define CLASS(name) \
+	class name { \
+	public: \
+		MEMBERS(int, i) \
+		MEMBERS(double, d) \
+		MEMBERS(std::vector<int>, v) \
+		int sum() const { \
+			return get_i0() + get_i1() + get_i2() + get_i3() + get_i4() + \
+			  get_i5() + get_i6() + get_i7(); \
+		} \
+	};
+#define CLASSES(prefix) \
+	CLASS(prefix##0) CLASS(prefix##1) CLASS(prefix##2) CLASS(prefix##3) \
+	CLASS(prefix##4) CLASS(prefix##5) CLASS(prefix##6) CLASS(prefix##7)
+
+CLASSES(A)
+CLASSES(B)
+CLASSES(C)
+CLASSES(D)
+
+int main() {
+	A0 a;
+	a.set_i0(42);
+	return a.sum() - 42;
+}
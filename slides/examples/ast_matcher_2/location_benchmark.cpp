@@ -0,0 +1,140 @@
+// Measure the time taken to resolve the file name, line, and column of
+// every source location of the declarations and statements in a
+// translation unit, using getFlc (one location at a time) and
+// resolveLocations (all locations at once), and check that the results are
+// identical.
+
+#include <chrono>
+#include <format>
+#include <string>
+#include <vector>
+#include <clang/AST/ASTConsumer.h>
+#include <clang/AST/RecursiveASTVisitor.h>
+#include <clang/Frontend/CompilerInstance.h>
+#include <clang/Frontend/FrontendAction.h>
+#include <clang/Tooling/CommonOptionsParser.h>
+#include <clang/Tooling/Tooling.h>
+#include <llvm/Support/CommandLine.h>
+#include "utilities2.hpp"
+
+namespace ct = clang::tooling;
+
+static llvm::cl::OptionCategory optionCategory("Tool options");
+static llvm::cl::opt<unsigned> clIterations("n",
+  llvm::cl::desc("Number of times to resolve the locations"),
+  llvm::cl::cat(optionCategory), llvm::cl::init(10));
+
+template <class F>
+double measure(unsigned iterations, F func) {
+	auto startTime = std::chrono::steady_clock::now();
+	for (unsigned i = 0; i < iterations; ++i) {func();}
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() -
+	  startTime).count();
+}
+
+class LocationCollector : public clang::RecursiveASTVisitor<LocationCollector> {
+public:
+	LocationCollector(std::vector<clang::SourceLocation>& locations) :
+	  locations_(&locations) {}
+	bool VisitDecl(clang::Decl* decl) {
+		locations_->push_back(decl->getBeginLoc());
+		locations_->push_back(decl->getLocation());
+		locations_->push_back(decl->getEndLoc());
+		return true;
+	}
+	bool VisitStmt(clang::Stmt* stmt) {
+		locations_->push_back(stmt->getBeginLoc());
+		locations_->push_back(stmt->getEndLoc());
+		return true;
+	}
+	bool shouldVisitTemplateInstantiations() const {return true;}
+	bool shouldVisitImplicitCode() const {return true;}
+private:
+	std::vector<clang::SourceLocation>* locations_;
+};
+
+class BenchmarkConsumer : public clang::ASTConsumer {
+public:
+	BenchmarkConsumer(int& status) : status_(&status) {}
+	void HandleTranslationUnit(clang::ASTContext& astContext) final;
+private:
+	int* status_;
+};
+
+void BenchmarkConsumer::HandleTranslationUnit(clang::ASTContext& astContext) {
+	const clang::SourceManager& sourceManager = astContext.getSourceManager();
+	std::vector<clang::SourceLocation> locations;
+	LocationCollector collector(locations);
+	collector.TraverseDecl(astContext.getTranslationUnitDecl());
+	std::size_t numMacroLocations = 0;
+	for (auto loc : locations) {
+		if (loc.isMacroID()) {++numMacroLocations;}
+	}
+	llvm::outs() << std::format("{}: {} locations ({} in macros)\n",
+	  std::string(sourceManager.getFilename(sourceManager.getLocForStartOfFile(
+	  sourceManager.getMainFileID()))), locations.size(), numMacroLocations);
+	for (bool spelling : {true, false}) {
+		LocationTable table;
+		resolveLocations(sourceManager, locations, spelling, table);
+		for (std::size_t i = 0; i < locations.size(); ++i) {
+			auto [fileName, line, column] = getFlc(sourceManager, locations[i],
+			  spelling);
+			if (table.getFileName(i) != fileName || table.lines[i] != line ||
+			  table.columns[i] != column) {
+				llvm::errs() << std::format("location {} differs\n", i);
+				*status_ = 1;
+				break;
+			}
+		}
+		double oldTime = measure(clIterations, [&]() {
+			for (auto loc : locations) {
+				getFlc(sourceManager, loc, spelling);
+			}
+		});
+		double newTime = measure(clIterations, [&]() {
+			resolveLocations(sourceManager, locations, spelling, table);
+		});
+		double count = double(locations.size()) * clIterations;
+		llvm::outs() << std::format("  {}: getFlc {:.1f} ns/location, "
+		  "resolveLocations {:.1f} ns/location ({:.1f}x)\n",
+		  spelling ? "spelling" : "expansion", 1e9 * oldTime / count,
+		  1e9 * newTime / count, oldTime / newTime);
+	}
+}
+
+class BenchmarkAction : public clang::ASTFrontendAction {
+public:
+	BenchmarkAction(int& status) : status_(&status) {}
+	std::unique_ptr<clang::ASTConsumer> CreateASTConsumer(
+	  clang::CompilerInstance&, clang::StringRef) final {
+		return std::make_unique<BenchmarkConsumer>(*status_);
+	}
+private:
+	int* status_;
+};
+
+class BenchmarkActionFactory : public ct::FrontendActionFactory {
+public:
+	BenchmarkActionFactory(int& status) : status_(&status) {}
+	std::unique_ptr<clang::FrontendAction> create() final {
+		return std::make_unique<BenchmarkAction>(*status_);
+	}
+private:
+	int* status_;
+};
+
+int main(int argc, const char **argv) {
+	auto expectedParser = ct::CommonOptionsParser::create(argc, argv,
+	  optionCategory);
+	if (!expectedParser) {
+		llvm::errs() << llvm::toString(expectedParser.takeError());
+		return 1;
+	}
+	ct::CommonOptionsParser& optionsParser = expectedParser.get();
+	ct::ClangTool tool(optionsParser.getCompilations(),
+	  optionsParser.getSourcePathList());
+	int status = 0;
+	BenchmarkActionFactory factory(status);
+	if (tool.run(&factory)) {status = 1;}
+	return status;
+}
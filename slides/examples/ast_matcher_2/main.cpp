@@ -1,10 +1,14 @@
 #include <format>
+#include <memory>
+#include <cal/time_trace.hpp>
+#include <clang/AST/ASTConsumer.h>
 #include <clang/ASTMatchers/ASTMatchers.h>
 #include <clang/ASTMatchers/ASTMatchFinder.h>
 #include <clang/Frontend/FrontendActions.h>
 #include <clang/Tooling/CommonOptionsParser.h>
 #include <clang/Tooling/Tooling.h>
 #include <llvm/Support/CommandLine.h>
+#include "ast_export.hpp"
 #include "utilities2.hpp"
 
 namespace ct = clang::tooling;
@@ -16,6 +20,10 @@ static llvm::cl::opt<int> clMatcherId("m", llvm::cl::desc("Matcher ID"),
   llvm::cl::init(0));
 static llvm::cl::opt<bool> clAllNodes("a", llvm::cl::desc("all nodes"),
   llvm::cl::cat(optionCategory), llvm::cl::init(false));
+static llvm::cl::opt<std::string> clColumnsFile("columns",
+  llvm::cl::desc("Export the AST of each TU to the specified AST column file "
+  "(instead of matching)"), llvm::cl::value_desc("file"),
+  llvm::cl::cat(optionCategory));
 
 AST_MATCHER(clang::CXXMethodDecl, isSpecialMember) {
 	if (auto p = llvm::dyn_cast<clang::CXXConstructorDecl>(&Node)) {
@@ -56,6 +64,7 @@ class MyMatchCallback : public cam::MatchFinder::MatchCallback {
 public:
 	MyMatchCallback() : count_(0) {}
 	void run(const cam::MatchFinder::MatchResult& result) override {
+		llvm::TimeTraceScope timeScope("MatchCallback");
 		const clang::SourceManager& sourceManager = *result.SourceManager;
 		clang::SourceRange sourceRange;
 		std::string nodeType;
@@ -84,7 +93,40 @@ private:
 	unsigned count_;
 };
 
+// Exports the AST of each TU (in turn) to the same AST column file, so
+// that it can be queried without Clang (with column_query).
+class ColumnsExporter {
+public:
+	class Consumer : public clang::ASTConsumer {
+	public:
+		explicit Consumer(AstColumnsWriter& writer) : writer_(&writer) {}
+		void HandleTranslationUnit(clang::ASTContext& astContext) override {
+			llvm::TimeTraceScope timeScope("ExportAstColumns");
+			exportAstColumns(astContext, *writer_);
+		}
+	private:
+		AstColumnsWriter* writer_;
+	};
+	std::unique_ptr<clang::ASTConsumer> newASTConsumer()
+	  {return std::make_unique<Consumer>(writer_);}
+	const AstColumnsWriter& getWriter() const {return writer_;}
+private:
+	AstColumnsWriter writer_;
+};
+
+int exportColumns(ct::ClangTool& tool) {
+	ColumnsExporter exporter;
+	auto factory = ct::newFrontendActionFactory(&exporter);
+	cal::TracedToolAction tracedAction(factory.get());
+	int status = tool.run(&tracedAction);
+	if (exporter.getWriter().write(clColumnsFile)) {status = 1;}
+	llvm::outs() << std::format("number of nodes exported: {}\n",
+	  exporter.getWriter().size());
+	return status;
+}
+
 int main(int argc, const char **argv) {
+	cal::addTimeTraceOptions(optionCategory);
 	auto expectedParser = ct::CommonOptionsParser::create(argc, argv,
 	  optionCategory);
 	if (!expectedParser) {
@@ -92,8 +134,14 @@ int main(int argc, const char **argv) {
 		return 1;
 	}
 	ct::CommonOptionsParser& optionsParser = expectedParser.get();
+	cal::TimeTrace timeTrace(argv[0]);
 	ct::ClangTool tool(optionsParser.getCompilations(),
 	  optionsParser.getSourcePathList());
+	if (!clColumnsFile.empty()) {
+		int status = exportColumns(tool);
+		if (timeTrace.finish()) {status = 1;}
+		return !status ? 0 : 1;
+	}
 	cam::DeclarationMatcher matcher = getMatcher(clMatcherId);
 	if (!clAllNodes) {
 		matcher = cam::traverse(clang::TK_IgnoreUnlessSpelledInSource,
@@ -102,8 +150,11 @@ int main(int argc, const char **argv) {
 	MyMatchCallback matchCallback;
 	cam::MatchFinder matchFinder;
 	matchFinder.addMatcher(matcher, &matchCallback);
-	int status = tool.run(ct::newFrontendActionFactory(&matchFinder).get());
+	auto factory = ct::newFrontendActionFactory(&matchFinder);
+	cal::TracedToolAction tracedAction(factory.get());
+	int status = tool.run(&tracedAction);
 	llvm::outs() << std::format("number of matches: {}\n",
 	  matchCallback.getCount());
+	if (timeTrace.finish()) {status = 1;}
 	return !status ? 0 : 1;
 }
@@ -1,7 +1,12 @@
+#include <algorithm>
+#include <cstdint>
 #include <format>
+#include <numeric>
 #include <tuple>
 #include <string>
+#include <utility>
 #include <clang/Lex/Lexer.h>
+#include <llvm/ADT/StringMap.h>
 #include "utilities2.hpp"
 
 clang::SourceLocation getEndOfToken(const clang::SourceManager& sourceManager,
@@ -26,6 +31,55 @@ std::tuple<std::string, unsigned, unsigned> getFlc(const clang::SourceManager&
 	}
 }
 
+void resolveLocations(const clang::SourceManager& sourceManager,
+  llvm::ArrayRef<clang::SourceLocation> locations, bool spelling,
+  LocationTable& table) {
+	std::size_t n = locations.size();
+	std::vector<std::pair<clang::FileID, unsigned>> decomposed;
+	decomposed.reserve(n);
+	for (auto loc : locations) {
+		decomposed.push_back(spelling ?
+		  sourceManager.getDecomposedSpellingLoc(loc) :
+		  sourceManager.getDecomposedExpansionLoc(loc));
+	}
+	std::vector<std::uint32_t> order(n);
+	std::iota(order.begin(), order.end(), 0);
+	std::sort(order.begin(), order.end(), [&](auto i, auto j) {
+		return decomposed[i] < decomposed[j];
+	});
+	table.fileIndexes.assign(n, 0);
+	table.lines.assign(n, 0);
+	table.columns.assign(n, 0);
+	table.fileNames.clear();
+	// Since the locations are sorted by file, the file name changes at most
+	// once per file.
+	llvm::StringMap<unsigned> fileIndexes;
+	clang::FileID currentFileId;
+	unsigned currentFileIndex = 0;
+	bool first = true;
+	for (auto i : order) {
+		auto [fileId, offset] = decomposed[i];
+		if (first || fileId != currentFileId) {
+			llvm::StringRef fileName;
+			if (fileId.isValid()) {
+				fileName = sourceManager.getFilename(
+				  sourceManager.getLocForStartOfFile(fileId));
+			}
+			auto [iter, inserted] = fileIndexes.try_emplace(fileName,
+			  table.fileNames.size());
+			if (inserted) {table.fileNames.push_back(std::string(fileName));}
+			currentFileId = fileId;
+			currentFileIndex = iter->second;
+			first = false;
+		}
+		table.fileIndexes[i] = currentFileIndex;
+		if (fileId.isValid()) {
+			table.lines[i] = sourceManager.getLineNumber(fileId, offset);
+			table.columns[i] = sourceManager.getColumnNumber(fileId, offset);
+		}
+	}
+}
+
 std::string locationToString(const clang::SourceManager& sourceManager,
   clang::SourceLocation sourceLocation, bool spelling) {
 	auto [filename, lineNum, columnNum] = getFlc(sourceManager,
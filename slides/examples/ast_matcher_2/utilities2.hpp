@@ -1,11 +1,40 @@
 #include <string>
+#include <string_view>
+#include <tuple>
+#include <vector>
 #include <clang/Basic/SourceManager.h>
 #include <clang/Basic/SourceLocation.h>
+#include <llvm/ADT/ArrayRef.h>
+
+// The file names, line numbers, and column numbers of a batch of source
+// locations, stored as a struct of arrays (with element i corresponding to
+// the i-th location in the batch).  Each distinct file name is stored once.
+// An invalid location has an empty file name and a line and column of 0.
+struct LocationTable {
+	std::vector<unsigned> fileIndexes;
+	std::vector<unsigned> lines;
+	std::vector<unsigned> columns;
+	std::vector<std::string> fileNames;
+	std::size_t size() const {return lines.size();}
+	std::string_view getFileName(std::size_t i) const
+	  {return fileNames[fileIndexes[i]];}
+};
 
 std::string getSourceTextRaw(const clang::SourceManager& sourceManager,
   clang::SourceRange sourceRange);
 clang::SourceLocation getEndOfToken(const clang::SourceManager& sourceManager,
   clang::SourceLocation startOfToken);
+std::tuple<std::string, unsigned, unsigned> getFlc(const clang::SourceManager&
+  sourceManager, clang::SourceLocation sourceLocation, bool spelling);
+// Resolve the (spelling or expansion) file name, line, and column of many
+// locations at once.  This gives the same results as calling getFlc for
+// each location, but each macro expansion chain is only walked once per
+// location, the locations are processed in file and offset order (so each
+// file's line table is traversed once, in order), and each file name is
+// only looked up once per file.
+void resolveLocations(const clang::SourceManager& sourceManager,
+  llvm::ArrayRef<clang::SourceLocation> locations, bool spelling,
+  LocationTable& table);
 std::string locationToString(const clang::SourceManager& sourceManager,
   clang::SourceLocation sourceLoc, bool spelling);
 std::string rangeToString(const clang::SourceManager& sourceManager,
@@ -1,4 +1,5 @@
 #include <format>
+#include <cal/time_trace.hpp>
 #include <string>
 #include <clang/ASTMatchers/ASTMatchers.h>
 #include <clang/ASTMatchers/ASTMatchFinder.h>
@@ -50,6 +51,7 @@ struct MyMatchCallback : public cam::MatchFinder::MatchCallback {
 };
 
 void MyMatchCallback::run(const cam::MatchFinder::MatchResult& result) {
+	llvm::TimeTraceScope timeScope("MatchCallback");
 	llvm::outs() << std::format("MATCH {}:\n", count);
 	if (auto qualTypePtr = result.Nodes.getNodeAs<clang::QualType>("qt")) {
 		llvm::outs() << "dump for QualType:\n";
@@ -76,12 +78,14 @@ static lc::opt<bool> clAsIs("i", lc::desc("Implicit nodes"),
   lc::cat(optionCategory));
 
 int main(int argc, const char **argv) {
+	cal::addTimeTraceOptions(optionCategory);
 	auto optParser = ct::CommonOptionsParser::create(argc, argv,
 	  optionCategory);
 	if (!optParser) {
 		llvm::errs() << llvm::toString(optParser.takeError());
 		return 1;
 	}
+	cal::TimeTrace timeTrace(argv[0]);
 	ct::ClangTool tool(optParser->getCompilations(),
 	  optParser->getSourcePathList());
 	MyMatchCallback matchCallback;
@@ -91,8 +95,11 @@ int main(int argc, const char **argv) {
 		  clAsIs ? clang::TK_AsIs : clang::TK_IgnoreUnlessSpelledInSource,
 		  getMatcher(id)).getSingleMatcher(), &matchCallback);
 	}
-	int status = tool.run(ct::newFrontendActionFactory(&matchFinder).get());
+	auto factory = ct::newFrontendActionFactory(&matchFinder);
+	cal::TracedToolAction tracedAction(factory.get());
+	int status = tool.run(&tracedAction);
 	llvm::outs() << std::format("number of matches: {}\n",
 	  matchCallback.count);
+	if (timeTrace.finish()) {status = 1;}
 	return !status ? 0 : 1;
 }
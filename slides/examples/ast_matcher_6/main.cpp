@@ -1,4 +1,5 @@
 #include <format>
+#include <cal/time_trace.hpp>
 #include <string_view>
 #include <clang/ASTMatchers/ASTMatchers.h>
 #include <clang/ASTMatchers/ASTMatchFinder.h>
@@ -32,6 +33,7 @@ struct MyMatchCallback : public cam::MatchFinder::MatchCallback {
 };
 
 void MyMatchCallback::run(const cam::MatchFinder::MatchResult& result) {
+	llvm::TimeTraceScope timeScope("MatchCallback");
 	auto decl = result.Nodes.getNodeAs<clang::CXXRecordDecl>("decl");
 	auto baseDecl = result.Nodes.getNodeAs<clang::CXXRecordDecl>(
 	  "baseDecl");
@@ -43,12 +45,14 @@ void MyMatchCallback::run(const cam::MatchFinder::MatchResult& result) {
 static llvm::cl::OptionCategory optionCategory("Tool options");
 
 int main(int argc, const char **argv) {
+	cal::addTimeTraceOptions(optionCategory);
 	auto optParser = ct::CommonOptionsParser::create(argc, argv,
 	  optionCategory);
 	if (!optParser) {
 		llvm::errs() << llvm::toString(optParser.takeError());
 		return 1;
 	}
+	cal::TimeTrace timeTrace(argv[0]);
 	ct::ClangTool tool(optParser->getCompilations(),
 	  optParser->getSourcePathList());
 	cam::DeclarationMatcher matcher = [](){
@@ -60,5 +64,9 @@ int main(int argc, const char **argv) {
 	MyMatchCallback matchCallback;
 	cam::MatchFinder matchFinder;
 	matchFinder.addMatcher(matcher, &matchCallback);
-	return tool.run(ct::newFrontendActionFactory(&matchFinder).get());
+	auto factory = ct::newFrontendActionFactory(&matchFinder);
+	cal::TracedToolAction tracedAction(factory.get());
+	int status = tool.run(&tracedAction);
+	if (timeTrace.finish()) {status = 1;}
+	return status;
 }
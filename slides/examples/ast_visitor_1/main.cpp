@@ -1,4 +1,8 @@
 #include <format>
+#include <cal/modules.hpp>
+#include <cal/parent_map.hpp>
+#include <cal/perf_counters.hpp>
+#include <cal/time_trace.hpp>
 #include <clang/AST/ASTConsumer.h>
 #include <clang/AST/RecursiveASTVisitor.h>
 #include <clang/AST/ASTTypeTraits.h>
@@ -23,21 +27,27 @@ namespace ct = clang::tooling;
 class MyAstVisitor : public clang::RecursiveASTVisitor<MyAstVisitor> {
 public:
 	MyAstVisitor(clang::ASTContext& astContext, std::string filename)
-        : astContext_(&astContext), filename_(std::move(filename)) {
+        : astContext_(&astContext), parentMap_(astContext),
+          filename_(std::move(filename)) {
     }
 
 	bool VisitVarDecl(clang::VarDecl* varDecl)  {
         const auto &fileId = astContext_->getSourceManager().getFileID(
                 varDecl->getLocation());
         const auto &decl = *varDecl;
-        const auto &parents = astContext_->getParents(decl);
-        bool isSingleParent = parents.size() == 1 && parents[0].get<clang::TranslationUnitDecl>() == astContext_->getTranslationUnitDecl();
+        // The parents are only found for a variable that passes the
+        // preceding checks, so that the parent map is not built for the
+        // functions in the headers.
+        auto isSingleParent = [&]() {
+            const auto &parents = parentMap_.getParents(decl);
+            return parents.size() == 1 && parents[0].get<clang::TranslationUnitDecl>() == astContext_->getTranslationUnitDecl();
+        };
         auto type = varDecl->getType();
         bool containsDots = varDecl->getQualifiedNameAsString().find("::") != std::string::npos; // check for namespace variable (e.g. std::cout)
         if (fileId == astContext_->getSourceManager().getMainFileID()
             && varDecl->getParentFunctionOrMethod() == nullptr // check parent
             && !type.isConstQualified() // check for const
-            && isSingleParent // check parent
+            && isSingleParent() // check parent
             && !varDecl->isLocalVarDeclOrParm() // check if variable is not in function (same as check parent)
             && !varDecl->isStaticLocal() && !varDecl->isStaticDataMember() // static variables are not suitable
             && varDecl->getLanguageLinkage() != clang::LanguageLinkage::CLanguageLinkage // check for extern
@@ -52,6 +62,7 @@ public:
     }
 private:
 	clang::ASTContext* astContext_;
+    cal::ParentMap parentMap_;
     std::vector<std::string> names_;
     std::string filename_;
 };
@@ -66,14 +77,20 @@ public:
     }
 
 	void HandleTranslationUnit(clang::ASTContext& astContext) final {
+		llvm::TimeTraceScope timeScope("HandleTranslationUnit", filename_);
 		clang::TranslationUnitDecl* tuDecl =
 		  astContext.getTranslationUnitDecl();
 		MyAstVisitor visitor(astContext, filename_);
-		visitor.TraverseDecl(tuDecl);
+		{
+			cal::PerfScope perfScope("traverse");
+			visitor.TraverseDecl(tuDecl);
+		}
         flushToFile(visitor.getNames());
 	}
 
     void flushToFile(std::vector<std::string> names) {
+        llvm::TimeTraceScope timeScope("WriteOutput");
+        cal::PerfScope perfScope("output");
         std::sort(names.begin(), names.end(), [](const std::string& a, const std::string& b){
             for (size_t i = 0; i < a.size() && i < b.size(); i++) {
                 if (std::tolower(a[i]) != std::tolower(b[i]))
@@ -98,7 +115,8 @@ public:
 
 	std::unique_ptr<clang::ASTConsumer> CreateASTConsumer(
 	  clang::CompilerInstance&, clang::StringRef filename) final {
-		return std::unique_ptr<clang::ASTConsumer>{new MyAstConsumer(out, std::string(filename))};
+		return cal::makePerfConsumer(std::unique_ptr<clang::ASTConsumer>{
+		  new MyAstConsumer(out, std::string(filename))});
 	}
 private:
     std::shared_ptr<std::ofstream> out;
@@ -122,15 +140,25 @@ std::unique_ptr<ct::FrontendActionFactory> newFrontendActionFactory(std::shared_
             new SimpleFrontendActionFactory(std::move(out)));
 }
 
-void run_tool(ct::CommonOptionsParser* parser, const std::vector<std::string>& sources, const std::shared_ptr<std::ofstream>& out) {
+void run_tool(ct::CommonOptionsParser* parser, const std::vector<std::string>& sources, const std::shared_ptr<std::ofstream>& out, cal::ParseTimes* parseTimes) {
+    // Each worker thread is a separate track in the time trace.
+    cal::TimeTraceThread timeTraceThread;
     ct::ClangTool tool(parser->getCompilations(), sources);
-    int status = tool.run(
-            newFrontendActionFactory(out).get());
+    // In modules mode, all of the workers share one module cache.
+    tool.appendArgumentsAdjuster(cal::getModulesArgumentsAdjuster());
+    auto factory = newFrontendActionFactory(out);
+    cal::TimedToolAction timedAction(factory.get(), *parseTimes);
+    cal::TracedToolAction tracedAction(&timedAction);
+    int status = tool.run(&tracedAction);
     llvm::outs() << "tool exited with " << status << " status\n";
     out->flush();
 }
 
 int main(int argc, char** argv) {
+	cal::addTimeTraceOptions(toolOptions);
+	cal::addModulesOptions(toolOptions);
+	cal::addPerfCountersOptions(toolOptions);
+	cal::addParentMapOptions(toolOptions);
 	auto expectedOptionsParser = ct::CommonOptionsParser::create(argc,
 	  const_cast<const char**>(argv), toolOptions);
 	if (!expectedOptionsParser) {
@@ -140,6 +168,11 @@ int main(int argc, char** argv) {
 	}
 	ct::CommonOptionsParser& optionsParser = *expectedOptionsParser;
 	const std::vector<std::string>& sources = optionsParser.getSourcePathList();
+	cal::TimeTrace timeTrace(argv[0]);
+    if (cal::prepareModules()) {
+        return 1;
+    }
+    cal::ParseTimes parseTimes;
     const int kThreadsCount = 4;
     std::vector<std::thread> threads;
     threads.reserve(kThreadsCount);
@@ -160,7 +193,8 @@ int main(int argc, char** argv) {
                 run_tool,
                 &optionsParser,
                 vec,
-                stream_ptr);
+                stream_ptr,
+                &parseTimes);
         threads.push_back(std::move(thr));
     }
     for (std::thread& thread : threads) {
@@ -168,5 +202,11 @@ int main(int argc, char** argv) {
     }
     std::string command = std::format("cat {} | sort > output.txt", filenames_in_line); // unite files
     system(command.c_str());
-    return 0;
+    int status = parseTimes.finish(llvm::errs());
+    cal::printParentMapStats(llvm::errs());
+    cal::printPerfCounters(llvm::errs());
+    if (timeTrace.finish()) {
+        status = 1;
+    }
+    return status;
 }
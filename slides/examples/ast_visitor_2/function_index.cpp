@@ -0,0 +1,101 @@
+#include <format>
+#include <string>
+#include <vector>
+#include <llvm/ADT/StringExtras.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/Path.h>
+#include <llvm/Support/SHA256.h>
+#include <llvm/Support/raw_ostream.h>
+#include "function_index.hpp"
+
+// The index is a text file with a header line followed by one line per
+// function of the form:
+//   has_text begin_offset end_offset line <TAB> name <TAB> range
+static const char indexHeader[] = "ast_visitor_2 function index 1";
+
+std::string getFunctionIndexName(const std::string& pathName,
+  llvm::StringRef content, const std::vector<std::string>& commands) {
+	llvm::SHA256 hasher;
+	auto update = [&](llvm::StringRef s) {
+		hasher.update(s);
+		// Separate the fields so that they cannot run together.
+		hasher.update(llvm::StringRef("\0", 1));
+	};
+	update(pathName);
+	for (const auto& command : commands) {update(command);}
+	update(content);
+	return llvm::toHex(hasher.final(), true) + ".idx";
+}
+
+bool readFunctionIndex(const std::string& pathName,
+  std::vector<FunctionEntry>& entries) {
+	auto buffer = llvm::MemoryBuffer::getFile(pathName);
+	if (!buffer) {return false;}
+	llvm::StringRef text = (*buffer)->getBuffer();
+	auto [header, rest] = text.split('\n');
+	if (header != indexHeader) {return false;}
+	entries.clear();
+	while (!rest.empty()) {
+		llvm::StringRef line;
+		std::tie(line, rest) = rest.split('\n');
+		llvm::SmallVector<llvm::StringRef, 3> fields;
+		line.split(fields, '\t');
+		llvm::SmallVector<llvm::StringRef, 4> numbers;
+		if (fields.size() == 3) {fields[0].split(numbers, ' ');}
+		FunctionEntry entry;
+		unsigned hasText;
+		if (numbers.size() != 4 || numbers[0].getAsInteger(10, hasText) ||
+		  numbers[1].getAsInteger(10, entry.beginOffset) ||
+		  numbers[2].getAsInteger(10, entry.endOffset) ||
+		  numbers[3].getAsInteger(10, entry.line)) {
+			return false;
+		}
+		entry.hasText = hasText;
+		entry.name = fields[1].str();
+		entry.range = fields[2].str();
+		entries.push_back(std::move(entry));
+	}
+	return true;
+}
+
+int writeFunctionIndex(const std::string& pathName,
+  const std::vector<FunctionEntry>& entries) {
+	if (auto errCode = llvm::sys::fs::create_directories(
+	  llvm::sys::path::parent_path(pathName))) {
+		llvm::errs() << std::format("cannot create directory for {} ({})\n",
+		  pathName, errCode.message());
+		return 1;
+	}
+	// Write to a temporary file and rename it, so that a concurrent reader
+	// never sees a partial index.
+	std::string tempPathName = pathName + ".tmp";
+	{
+		std::error_code errCode;
+		llvm::raw_fd_ostream out(tempPathName, errCode);
+		if (errCode) {
+			llvm::errs() << std::format("cannot open {} ({})\n", tempPathName,
+			  errCode.message());
+			return 1;
+		}
+		out << indexHeader << '\n';
+		for (const auto& entry : entries) {
+			out << std::format("{} {} {} {}\t{}\t{}\n", int(entry.hasText),
+			  entry.beginOffset, entry.endOffset, entry.line, entry.name,
+			  entry.range);
+		}
+		out.close();
+		if (out.has_error()) {
+			llvm::errs() << std::format("cannot write {} ({})\n", tempPathName,
+			  out.error().message());
+			out.clear_error();
+			return 1;
+		}
+	}
+	if (auto errCode = llvm::sys::fs::rename(tempPathName, pathName)) {
+		llvm::errs() << std::format("cannot rename {} ({})\n", tempPathName,
+		  errCode.message());
+		return 1;
+	}
+	return 0;
+}
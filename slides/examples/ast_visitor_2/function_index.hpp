@@ -0,0 +1,38 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <llvm/ADT/StringRef.h>
+
+// The information needed to extract one function from a source file
+// without parsing it.
+struct FunctionEntry {
+	// The qualified name of the function.
+	std::string name;
+	// The source range (as printed by rangeToString).
+	std::string range;
+	// The byte range of the function's source text (as returned by
+	// getSourceText) and the line number of its start.  If hasText is
+	// false, the text does not lie within the file (e.g., it starts in a
+	// header via a macro) and cannot be extracted from the index.
+	bool hasText;
+	unsigned beginOffset;
+	unsigned endOffset;
+	unsigned line;
+};
+
+// Get the name of the index file for a source file.  The name is derived
+// from a hash of the file's path, its content, and its compile commands,
+// so a changed file (or build configuration) yields a different index.
+// Changes to included headers are not detected.
+std::string getFunctionIndexName(const std::string& pathName,
+  llvm::StringRef content, const std::vector<std::string>& commands);
+
+// Read an index file.  Returns false if the file does not exist or is not
+// a valid index.
+bool readFunctionIndex(const std::string& pathName,
+  std::vector<FunctionEntry>& entries);
+
+// Write an index file.  Returns zero on success.
+int writeFunctionIndex(const std::string& pathName,
+  const std::vector<FunctionEntry>& entries);
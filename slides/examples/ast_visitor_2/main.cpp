@@ -1,11 +1,18 @@
 #include <format>
+#include <string>
+#include <vector>
+#include <cal/time_trace.hpp>
 #include <clang/AST/ASTConsumer.h>
 #include <clang/AST/RecursiveASTVisitor.h>
 #include <clang/Frontend/CompilerInstance.h>
 #include <clang/Frontend/FrontendAction.h>
+#include <clang/Lex/Lexer.h>
 #include <clang/Tooling/CommonOptionsParser.h>
 #include <clang/Tooling/Tooling.h>
 #include <llvm/Support/CommandLine.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/Path.h>
+#include "function_index.hpp"
 #include "utilities.hpp" // header for utilities.cpp
 
 namespace ct = clang::tooling;
@@ -34,6 +41,7 @@ private:
 class MyAstConsumer : public clang::ASTConsumer {
 public:
 	void HandleTranslationUnit(clang::ASTContext& astContext) final {
+		llvm::TimeTraceScope timeScope("HandleTranslationUnit");
 		clang::TranslationUnitDecl* tuDecl =
 		  astContext.getTranslationUnitDecl();
 		MyAstVisitor astVisitor(astContext);
@@ -49,9 +57,154 @@ public:
 	}
 };
 
+// Collects the information needed to extract each function (with a body)
+// in the main file.
+class IndexAstVisitor : public clang::RecursiveASTVisitor<IndexAstVisitor> {
+public:
+	IndexAstVisitor(clang::ASTContext& astContext,
+	  std::vector<FunctionEntry>& entries) : astContext_(&astContext),
+	  entries_(&entries) {}
+	bool VisitFunctionDecl(clang::FunctionDecl* funcDecl) {
+		clang::SourceManager& sm = astContext_->getSourceManager();
+		clang::FileID mainFileId = sm.getMainFileID();
+		if (!funcDecl->hasBody() ||
+		  sm.getFileID(funcDecl->getLocation()) != mainFileId) {
+			return true;
+		}
+		clang::SourceRange sourceRange = funcDecl->getSourceRange();
+		FunctionEntry entry{funcDecl->getQualifiedNameAsString(),
+		  rangeToString(sm, sourceRange), false, 0, 0,
+		  sm.getSpellingLineNumber(sourceRange.getBegin())};
+		// This is the range of the text returned by getSourceText.
+		clang::CharSourceRange fileRange = clang::Lexer::makeFileCharRange(
+		  clang::CharSourceRange::getTokenRange(sourceRange), sm,
+		  clang::LangOptions());
+		if (fileRange.isValid()) {
+			auto [beginFileId, beginOffset] = sm.getDecomposedLoc(
+			  fileRange.getBegin());
+			auto [endFileId, endOffset] = sm.getDecomposedLoc(
+			  fileRange.getEnd());
+			if (beginFileId == mainFileId && endFileId == mainFileId &&
+			  beginOffset <= endOffset) {
+				entry.hasText = true;
+				entry.beginOffset = beginOffset;
+				entry.endOffset = endOffset;
+			}
+		}
+		entries_->push_back(std::move(entry));
+		return true;
+	}
+private:
+	clang::ASTContext* astContext_;
+	std::vector<FunctionEntry>* entries_;
+};
+
+class IndexAstConsumer : public clang::ASTConsumer {
+public:
+	IndexAstConsumer(std::vector<FunctionEntry>& entries) :
+	  entries_(&entries) {}
+	void HandleTranslationUnit(clang::ASTContext& astContext) final {
+		llvm::TimeTraceScope timeScope("HandleTranslationUnit");
+		IndexAstVisitor astVisitor(astContext, *entries_);
+		astVisitor.TraverseDecl(astContext.getTranslationUnitDecl());
+	}
+private:
+	std::vector<FunctionEntry>* entries_;
+};
+
+class IndexFrontendAction : public clang::ASTFrontendAction {
+public:
+	IndexFrontendAction(std::vector<FunctionEntry>& entries) :
+	  entries_(&entries) {}
+	std::unique_ptr<clang::ASTConsumer> CreateASTConsumer(
+	  clang::CompilerInstance&, clang::StringRef) final {
+		return std::make_unique<IndexAstConsumer>(*entries_);
+	}
+private:
+	std::vector<FunctionEntry>* entries_;
+};
+
+class IndexFrontendActionFactory : public ct::FrontendActionFactory {
+public:
+	IndexFrontendActionFactory(std::vector<FunctionEntry>& entries) :
+	  entries_(&entries) {}
+	std::unique_ptr<clang::FrontendAction> create() final {
+		return std::make_unique<IndexFrontendAction>(*entries_);
+	}
+private:
+	std::vector<FunctionEntry>* entries_;
+};
+
 static llvm::cl::OptionCategory toolOptions("Tool Options");
+static llvm::cl::list<std::string> clExtract("extract",
+  llvm::cl::desc("Extract the function(s) with the specified qualified "
+  "name, using the function index (may be repeated)"),
+  llvm::cl::cat(toolOptions));
+static llvm::cl::opt<std::string> clIndexDir("index-dir",
+  llvm::cl::desc("Directory holding the function index files"),
+  llvm::cl::init("function_index"), llvm::cl::cat(toolOptions));
+
+// Extract the specified functions from a source file.  The functions are
+// found using an index of the file, which is built (by parsing the file)
+// only if no index exists for the current content of the file.  The
+// function text is then simply a slice of the (memory-mapped) file.
+int extractFunctions(const ct::CompilationDatabase& compilations,
+  const std::string& source, const std::vector<std::string>& names) {
+	std::string pathName = ct::getAbsolutePath(source);
+	auto buffer = llvm::MemoryBuffer::getFile(pathName, false, false);
+	if (!buffer) {
+		llvm::errs() << std::format("cannot open {} ({})\n", pathName,
+		  buffer.getError().message());
+		return 1;
+	}
+	llvm::StringRef content = (*buffer)->getBuffer();
+	std::vector<std::string> commands;
+	for (const auto& command : compilations.getCompileCommands(pathName)) {
+		commands.push_back(command.Directory);
+		commands.insert(commands.end(), command.CommandLine.begin(),
+		  command.CommandLine.end());
+	}
+	llvm::SmallString<256> indexPathName(clIndexDir.getValue());
+	llvm::sys::path::append(indexPathName, getFunctionIndexName(pathName,
+	  content, commands));
+	std::vector<FunctionEntry> entries;
+	if (!readFunctionIndex(std::string(indexPathName), entries)) {
+		entries.clear();
+		ct::ClangTool tool(compilations, {pathName});
+		IndexFrontendActionFactory factory(entries);
+		cal::TracedToolAction tracedAction(&factory);
+		if (tool.run(&tracedAction)) {return 1;}
+		llvm::TimeTraceScope timeScope("WriteIndex");
+		if (writeFunctionIndex(std::string(indexPathName), entries)) {
+			return 1;
+		}
+	}
+	llvm::TimeTraceScope timeScope("ExtractFunctions");
+	int status = 0;
+	for (const auto& name : names) {
+		bool found = false;
+		for (const auto& entry : entries) {
+			if (entry.name != name) {continue;}
+			found = true;
+			std::string text;
+			if (entry.hasText && entry.endOffset <= content.size()) {
+				text = content.slice(entry.beginOffset, entry.endOffset).str();
+			}
+			std::string delim("----------\n");
+			llvm::outs() << std::format("{}\n{}\n{}{}\n{}\n", entry.name,
+			  entry.range, delim, addLineNumbers(text, entry.line), delim);
+		}
+		if (!found) {
+			llvm::errs() << std::format("function {} not found in {}\n", name,
+			  pathName);
+			status = 1;
+		}
+	}
+	return status;
+}
 
 int main(int argc, char** argv) {
+	cal::addTimeTraceOptions(toolOptions);
 	auto expectedOptionsParser = ct::CommonOptionsParser::create(argc,
 	  const_cast<const char**>(argv), toolOptions);
 	if (!expectedOptionsParser) {
@@ -60,10 +213,25 @@ int main(int argc, char** argv) {
 		return 1;
 	}
 	ct::CommonOptionsParser& optionsParser = *expectedOptionsParser;
+	cal::TimeTrace timeTrace(argv[0]);
+	if (!clExtract.empty()) {
+		int status = 0;
+		for (const auto& source : optionsParser.getSourcePathList()) {
+			if (extractFunctions(optionsParser.getCompilations(), source,
+			  clExtract)) {
+				status = 1;
+			}
+		}
+		if (timeTrace.finish()) {status = 1;}
+		if (status) {llvm::errs() << "error detected\n";}
+		return status;
+	}
 	ct::ClangTool tool(optionsParser.getCompilations(),
 	  optionsParser.getSourcePathList());
-	int status = tool.run(
-	  ct::newFrontendActionFactory<MyFrontendAction>().get());
+	auto factory = ct::newFrontendActionFactory<MyFrontendAction>();
+	cal::TracedToolAction tracedAction(factory.get());
+	int status = tool.run(&tracedAction);
+	if (timeTrace.finish()) {status = 1;}
 	if (status) {llvm::errs() << "error detected\n";}
 	return !status ? 0 : 1;
 }
@@ -1,5 +1,6 @@
 #include <format>
 #include <vector>
+#include <cal/time_trace.hpp>
 #include <clang/AST/ASTConsumer.h>
 #include <clang/AST/RecursiveASTVisitor.h>
 #include <clang/Frontend/CompilerInstance.h>
@@ -7,6 +8,7 @@
 #include <clang/Tooling/CommonOptionsParser.h>
 #include <clang/Tooling/Tooling.h>
 #include <llvm/Support/CommandLine.h>
+#include "record_table.hpp"
 
 namespace ct = clang::tooling;
 
@@ -45,6 +47,7 @@ void MyAstVisitor::printStack() const {
 class MyAstConsumer : public clang::ASTConsumer {
 public:
 	void HandleTranslationUnit(clang::ASTContext& astContext) final {
+		llvm::TimeTraceScope timeScope("HandleTranslationUnit");
 		clang::TranslationUnitDecl* tuDecl =
 		  astContext.getTranslationUnitDecl();
 		MyAstVisitor astVisitor(astContext);
@@ -60,9 +63,88 @@ public:
 	}
 };
 
+// Adds each record to a record table (instead of keeping a stack of
+// records), with the IDs of the records in the main file collected in the
+// order in which their paths are to be output.
+class TableAstVisitor : public clang::RecursiveASTVisitor<TableAstVisitor> {
+public:
+	TableAstVisitor(clang::ASTContext& astContext, RecordTable& table,
+	  std::vector<std::uint32_t>& outputIds) : astContext_(&astContext),
+	  table_(&table), outputIds_(&outputIds),
+	  parent_(RecordTable::noParent) {}
+	bool TraverseCXXRecordDecl(clang::CXXRecordDecl* recDecl);
+private:
+	using Base = clang::RecursiveASTVisitor<TableAstVisitor>;
+	clang::ASTContext* astContext_;
+	RecordTable* table_;
+	std::vector<std::uint32_t>* outputIds_;
+	std::uint32_t parent_;
+};
+
+bool TableAstVisitor::TraverseCXXRecordDecl(clang::CXXRecordDecl* recDecl) {
+	clang::SourceManager& sourceManager = astContext_->getSourceManager();
+	bool isMainFile = sourceManager.getFileID(recDecl->getLocation()) ==
+	  sourceManager.getMainFileID();
+	std::uint32_t id = table_->add(parent_, recDecl->getName(), isMainFile);
+	std::uint32_t savedParent = parent_;
+	parent_ = id;
+	bool result = Base::TraverseCXXRecordDecl(recDecl);
+	parent_ = savedParent;
+	if (isMainFile) {outputIds_->push_back(id);}
+	return result;
+}
+
+class TableAstConsumer : public clang::ASTConsumer {
+public:
+	TableAstConsumer(RecordTable& table, std::vector<std::uint32_t>& outputIds)
+	  : table_(&table), outputIds_(&outputIds) {}
+	void HandleTranslationUnit(clang::ASTContext& astContext) final {
+		llvm::TimeTraceScope timeScope("HandleTranslationUnit");
+		TableAstVisitor astVisitor(astContext, *table_, *outputIds_);
+		astVisitor.TraverseDecl(astContext.getTranslationUnitDecl());
+	}
+private:
+	RecordTable* table_;
+	std::vector<std::uint32_t>* outputIds_;
+};
+
+class TableFrontendAction : public clang::ASTFrontendAction {
+public:
+	TableFrontendAction(RecordTable& table,
+	  std::vector<std::uint32_t>& outputIds) : table_(&table),
+	  outputIds_(&outputIds) {}
+	std::unique_ptr<clang::ASTConsumer> CreateASTConsumer(
+	  clang::CompilerInstance&, clang::StringRef) final {
+		return std::make_unique<TableAstConsumer>(*table_, *outputIds_);
+	}
+private:
+	RecordTable* table_;
+	std::vector<std::uint32_t>* outputIds_;
+};
+
+class TableFrontendActionFactory : public ct::FrontendActionFactory {
+public:
+	TableFrontendActionFactory(RecordTable& table,
+	  std::vector<std::uint32_t>& outputIds) : table_(&table),
+	  outputIds_(&outputIds) {}
+	std::unique_ptr<clang::FrontendAction> create() final {
+		return std::make_unique<TableFrontendAction>(*table_, *outputIds_);
+	}
+private:
+	RecordTable* table_;
+	std::vector<std::uint32_t>* outputIds_;
+};
+
 static llvm::cl::OptionCategory toolOptions("Tool Options");
+static llvm::cl::opt<bool> clTable("table",
+  llvm::cl::desc("Use a compact record table (for very many records)"),
+  llvm::cl::cat(toolOptions));
+static llvm::cl::opt<std::string> clDump("dump",
+  llvm::cl::desc("Write a binary dump of the record table to the specified "
+  "file (implies -table)"), llvm::cl::cat(toolOptions));
 
 int main(int argc, char** argv) {
+	cal::addTimeTraceOptions(toolOptions);
 	auto expectedOptionsParser = ct::CommonOptionsParser::create(argc,
 	  const_cast<const char**>(argv), toolOptions);
 	if (!expectedOptionsParser) {
@@ -71,10 +153,28 @@ int main(int argc, char** argv) {
 		return 1;
 	}
 	ct::CommonOptionsParser& optionsParser = *expectedOptionsParser;
+	cal::TimeTrace timeTrace(argv[0]);
 	ct::ClangTool tool(optionsParser.getCompilations(),
 	  optionsParser.getSourcePathList());
-	int status = tool.run(
-	  ct::newFrontendActionFactory<MyFrontendAction>().get());
+	int status;
+	if (clTable || !clDump.empty()) {
+		RecordTable table;
+		std::vector<std::uint32_t> outputIds;
+		TableFrontendActionFactory factory(table, outputIds);
+		cal::TracedToolAction tracedAction(&factory);
+		status = tool.run(&tracedAction);
+		llvm::TimeTraceScope timeScope("WriteOutput");
+		for (auto id : outputIds) {
+			table.writePath(llvm::outs(), id);
+			llvm::outs() << '\n';
+		}
+		if (!clDump.empty() && table.dump(clDump)) {status = 1;}
+	} else {
+		auto factory = ct::newFrontendActionFactory<MyFrontendAction>();
+		cal::TracedToolAction tracedAction(factory.get());
+		status = tool.run(&tracedAction);
+	}
+	if (timeTrace.finish()) {status = 1;}
 	if (status) {llvm::errs() << "error detected\n";}
 	return !status ? 0 : 1;
 }
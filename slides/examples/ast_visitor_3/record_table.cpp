@@ -0,0 +1,31 @@
+#include <array>
+#include <string_view>
+#include <llvm/ADT/SmallVector.h>
+#include "record_table.hpp"
+
+namespace {
+
+const cal::ColumnFileFormat tableFormat{std::string_view("RECTAB\0\0", 8), 2,
+  3, "a record table"};
+
+}
+
+std::uint32_t RecordTable::add(std::uint32_t parent, llvm::StringRef name,
+  bool isMainFile) {
+	return writer_.addRow(std::array<std::uint32_t, numColumns>{parent,
+	  writer_.getStringId(name), isMainFile ? 1U : 0U});
+}
+
+void RecordTable::writePath(llvm::raw_ostream& out, std::uint32_t id) const {
+	llvm::SmallVector<std::uint32_t, 16> path;
+	for (; id != noParent; id = getParent(id)) {path.push_back(id);}
+	for (auto i = path.rbegin(); i != path.rend(); ++i) {
+		llvm::StringRef name = getName(*i);
+		if (i != path.rbegin()) {out << " -> ";}
+		out << (name.size() ? name : "(anonymous)");
+	}
+}
+
+int RecordTable::dump(const std::string& pathName) const {
+	return writer_.write(pathName, tableFormat);
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <cal/column_file.hpp>
+#include <llvm/ADT/StringRef.h>
+#include <llvm/Support/raw_ostream.h>
+
+// A table of (class) records, where each record is identified by an
+// integer ID and stores only the ID of its enclosing record and the ID of
+// its name in a string dictionary (which holds each distinct name once).
+// The nesting path of a record is only materialized when it is written.
+//
+// The binary dump of the table is a column file (see cal/column_file.hpp)
+// with one row per record (indexed by record ID) and the columns: the
+// parent ID (noParent for a record with no enclosing record), the ID of
+// the name (with the empty name used for an anonymous record), and the
+// flags (bit 0 set for a record in a main file).
+class RecordTable {
+public:
+	static constexpr std::uint32_t noParent = ~std::uint32_t(0);
+	RecordTable() : writer_(numColumns) {}
+	// Add a record and return its ID.
+	std::uint32_t add(std::uint32_t parent, llvm::StringRef name,
+	  bool isMainFile);
+	std::size_t size() const {return writer_.size();}
+	std::uint32_t getParent(std::uint32_t id) const
+	  {return writer_.getInt(parentColumn, id);}
+	llvm::StringRef getName(std::uint32_t id) const
+	  {return writer_.getString(writer_.getInt(nameColumn, id));}
+	bool isMainFile(std::uint32_t id) const
+	  {return writer_.getInt(flagsColumn, id) & 1;}
+	// Write the nesting path of a record (e.g., "A -> B -> C").
+	void writePath(llvm::raw_ostream& out, std::uint32_t id) const;
+	// Write the binary dump of the table to a file.  Returns zero on
+	// success.
+	int dump(const std::string& pathName) const;
+private:
+	enum Column : std::size_t {
+		parentColumn, nameColumn, flagsColumn, numColumns
+	};
+	cal::ColumnFileWriter writer_;
+};
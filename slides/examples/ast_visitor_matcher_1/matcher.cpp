@@ -1,6 +1,7 @@
 #include <cassert>
 #include <format>
 #include <map>
+#include <cal/time_trace.hpp>
 #include <clang/AST/ASTContext.h>
 #include <clang/ASTMatchers/ASTMatchers.h>
 #include <clang/ASTMatchers/ASTMatchFinder.h>
@@ -63,6 +64,7 @@ void MyMatchCallback::onEndOfTranslationUnit() {
 }
 
 void MyMatchCallback::run(const cam::MatchFinder::MatchResult& result) {
+	llvm::TimeTraceScope timeScope("MatchCallback");
 	const clang::SourceManager& sourceManager = *result.SourceManager;
 	auto forStmt = result.Nodes.getNodeAs<clang::Stmt>("for");
 	auto funcDecl = result.Nodes.getNodeAs<clang::FunctionDecl>("func");
@@ -85,6 +87,7 @@ cam::StatementMatcher getMatcher() {
 
 struct MyAstConsumer : public clang::ASTConsumer {
 	void HandleTranslationUnit(clang::ASTContext& astContext) final {
+		llvm::TimeTraceScope timeScope("HandleTranslationUnit");
 		MyMatchCallback matchCallback;
 		cam::StatementMatcher matcher = getMatcher();
 		cam::MatchFinder matchFinder;
@@ -103,6 +106,7 @@ struct MyFrontendAction : public clang::ASTFrontendAction {
 };
 
 int main(int argc, const char **argv) {
+	cal::addTimeTraceOptions(optionCategory);
 	auto expectedParser = ct::CommonOptionsParser::create(argc, argv,
 	  optionCategory);
 	if (!expectedParser) {
@@ -110,10 +114,13 @@ int main(int argc, const char **argv) {
 		return 1;
 	}
 	ct::CommonOptionsParser& optionsParser = expectedParser.get();
+	cal::TimeTrace timeTrace(argv[0]);
 	ct::ClangTool tool(optionsParser.getCompilations(),
 	  optionsParser.getSourcePathList());
-	int status =
-	  tool.run(ct::newFrontendActionFactory<MyFrontendAction>().get());
+	auto factory = ct::newFrontendActionFactory<MyFrontendAction>();
+	cal::TracedToolAction tracedAction(factory.get());
+	int status = tool.run(&tracedAction);
+	if (timeTrace.finish()) {status = 1;}
 	if (status) {llvm::errs() << "error detected\n";}
 	return !status ? 0 : 1;
 }
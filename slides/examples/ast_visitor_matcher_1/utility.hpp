@@ -1,12 +1,13 @@
 #include <cassert>
+#include <cal/parent_map.hpp>
 #include <clang/AST/ASTContext.h>
 #include <clang/AST/RecursiveASTVisitor.h>
 #include <clang/AST/ParentMapContext.h>
 
 template<class NodeType>
-const NodeType* getParentOfStmt(clang::ASTContext& astContext,
+const NodeType* getParentOfStmt(cal::ParentMap& parentMap,
   const clang::Stmt* stmt) {
-	auto parents = astContext.getParents(*stmt);
+	auto parents = parentMap.getParents(*stmt);
 	const clang::Stmt* curStmt = nullptr;
 	const NodeType* parent = nullptr;
 	for (auto&& node : parents) {
@@ -18,13 +19,13 @@ const NodeType* getParentOfStmt(clang::ASTContext& astContext,
 	return parent;
 }
 
-inline unsigned getForDepth(clang::ASTContext& astContext,
+inline unsigned getForDepth(cal::ParentMap& parentMap,
   const clang::Stmt* forStmt) {
 	assert(llvm::isa<clang::ForStmt>(forStmt) ||
 	  llvm::isa<clang::CXXForRangeStmt>(forStmt));
 	unsigned count = 1;
 	const clang::Stmt* curStmt = forStmt;
-	while ((curStmt = getParentOfStmt<clang::Stmt>(astContext, curStmt))) {
+	while ((curStmt = getParentOfStmt<clang::Stmt>(parentMap, curStmt))) {
 		if (llvm::isa<clang::ForStmt>(curStmt) ||
 		  llvm::isa<clang::CXXForRangeStmt>(curStmt)) {++count;}
 	}
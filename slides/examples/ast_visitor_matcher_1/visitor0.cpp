@@ -1,5 +1,7 @@
 #include <format>
 #include <map>
+#include <cal/parent_map.hpp>
+#include <cal/time_trace.hpp>
 #include <clang/AST/ASTConsumer.h>
 #include <clang/AST/ParentMapContext.h>
 #include <clang/AST/RecursiveASTVisitor.h>
@@ -13,11 +15,11 @@
 
 namespace ct = clang::tooling;
 
-const clang::Stmt* getTopLevelStmt(clang::ASTContext& astContext,
+const clang::Stmt* getTopLevelStmt(cal::ParentMap& parentMap,
   const clang::Stmt* stmt) {
 	const clang::Stmt* curStmt = stmt;
 	for (;;) {
-		const clang::Stmt* nextStmt = getParentOfStmt<clang::Stmt>(astContext,
+		const clang::Stmt* nextStmt = getParentOfStmt<clang::Stmt>(parentMap,
 		  curStmt);
 		if (!nextStmt) {break;}
 		curStmt = nextStmt;
@@ -25,17 +27,17 @@ const clang::Stmt* getTopLevelStmt(clang::ASTContext& astContext,
 	return curStmt;
 }
 
-const clang::FunctionDecl* getContainingFuncDecl(clang::ASTContext& astContext,
+const clang::FunctionDecl* getContainingFuncDecl(cal::ParentMap& parentMap,
   const clang::Stmt* stmt) {
-	const clang::Stmt* topStmt = getTopLevelStmt(astContext, stmt);
-	return getParentOfStmt<clang::FunctionDecl>(astContext, topStmt);
+	const clang::Stmt* topStmt = getTopLevelStmt(parentMap, stmt);
+	return getParentOfStmt<clang::FunctionDecl>(parentMap, topStmt);
 }
 
 class MyAstVisitor : public clang::RecursiveASTVisitor<MyAstVisitor> {
 public:
 	using FuncTab = std::map<const clang::FunctionDecl*, unsigned>;
 	MyAstVisitor(clang::ASTContext& astContext, FuncTab& funcTab) :
-	  astContext_(&astContext), funcTab_(&funcTab) {}
+	  astContext_(&astContext), parentMap_(astContext), funcTab_(&funcTab) {}
 	bool VisitForStmt(clang::ForStmt* forStmt)
 	  {return handleForStatement(forStmt);}
 	bool VisitCXXForRangeStmt(clang::CXXForRangeStmt* forStmt)
@@ -43,14 +45,18 @@ public:
 	bool shouldVisitImplicitCode() const {return true;}
 private:
 	bool handleForStatement(clang::Stmt* forStmt) {
-		const clang::FunctionDecl* funcDecl =
-		  getContainingFuncDecl(*astContext_, forStmt);
-		assert(funcDecl);
 		const clang::SourceManager& sourceManager =
 		  astContext_->getSourceManager();
+		// A loop outside the main file cannot be in a function of interest,
+		// so it is skipped before the (costly) search of its ancestors.
+		if (!sourceManager.isInMainFile(sourceManager.getExpansionLoc(
+		  forStmt->getBeginLoc()))) {return true;}
+		const clang::FunctionDecl* funcDecl =
+		  getContainingFuncDecl(parentMap_, forStmt);
+		assert(funcDecl);
 		if (sourceManager.getFileID(funcDecl->getLocation()) !=
 		  sourceManager.getMainFileID()) {return true;}
-		unsigned forDepth = getForDepth(*astContext_, forStmt);
+		unsigned forDepth = getForDepth(parentMap_, forStmt);
 		auto funcTabIter = funcTab_->find(funcDecl);
 		if (funcTabIter == funcTab_->end()) {
 			funcTabIter = funcTab_->insert(std::make_pair(funcDecl,
@@ -60,12 +66,14 @@ private:
 		return true;
 	}
 	clang::ASTContext* astContext_;
+	cal::ParentMap parentMap_;
 	FuncTab* funcTab_;
 };
 
 class MyAstConsumer : public clang::ASTConsumer {
 public:
 	void HandleTranslationUnit(clang::ASTContext& astContext) final {
+		llvm::TimeTraceScope timeScope("HandleTranslationUnit");
 		MyAstVisitor visitor(astContext, funcTab_);
 		visitor.TraverseDecl(astContext.getTranslationUnitDecl());
 		for (auto [funcDecl, maxForDepth] : funcTab_) {
@@ -87,6 +95,8 @@ struct MyFrontendAction : public clang::ASTFrontendAction {
 static llvm::cl::OptionCategory toolOptions("Tool Options");
 
 int main(int argc, char** argv) {
+	cal::addTimeTraceOptions(toolOptions);
+	cal::addParentMapOptions(toolOptions);
 	auto expectedOptionsParser = ct::CommonOptionsParser::create(argc,
 	  const_cast<const char**>(argv), toolOptions);
 	if (!expectedOptionsParser) {
@@ -95,10 +105,14 @@ int main(int argc, char** argv) {
 		return 1;
 	}
 	ct::CommonOptionsParser& optionsParser = *expectedOptionsParser;
+	cal::TimeTrace timeTrace(argv[0]);
 	ct::ClangTool tool(optionsParser.getCompilations(),
 	  optionsParser.getSourcePathList());
-	int status = tool.run(
-	  ct::newFrontendActionFactory<MyFrontendAction>().get());
+	auto factory = ct::newFrontendActionFactory<MyFrontendAction>();
+	cal::TracedToolAction tracedAction(factory.get());
+	int status = tool.run(&tracedAction);
+	cal::printParentMapStats(llvm::errs());
+	if (timeTrace.finish()) {status = 1;}
 	if (status) {llvm::errs() << "error detected\n";}
 	return !status ? 0 : 1;
 }
@@ -1,6 +1,7 @@
 #include <format>
 #include <stack>
 #include <type_traits>
+#include <cal/time_trace.hpp>
 #include <clang/AST/ASTConsumer.h>
 #include <clang/AST/RecursiveASTVisitor.h>
 #include <clang/Frontend/CompilerInstance.h>
@@ -73,6 +74,7 @@ template<class NodeType> bool MyAstVisitor::handleFor(NodeType* forStmt) {
 
 struct MyAstConsumer : public clang::ASTConsumer {
 	void HandleTranslationUnit(clang::ASTContext& astContext) final {
+		llvm::TimeTraceScope timeScope("HandleTranslationUnit");
 		MyAstVisitor visitor(astContext);
 		visitor.TraverseDecl(astContext.getTranslationUnitDecl());
 	}
@@ -88,6 +90,7 @@ struct MyFrontendAction : public clang::ASTFrontendAction {
 };
 
 int main(int argc, char** argv) {
+	cal::addTimeTraceOptions(toolOptions);
 	auto expectedOptionsParser = ct::CommonOptionsParser::create(argc,
 	  const_cast<const char**>(argv), toolOptions);
 	if (!expectedOptionsParser) {
@@ -96,10 +99,13 @@ int main(int argc, char** argv) {
 		return 1;
 	}
 	ct::CommonOptionsParser& optionsParser = *expectedOptionsParser;
+	cal::TimeTrace timeTrace(argv[0]);
 	ct::ClangTool tool(optionsParser.getCompilations(),
 	  optionsParser.getSourcePathList());
-	int status = tool.run(
-	  ct::newFrontendActionFactory<MyFrontendAction>().get());
+	auto factory = ct::newFrontendActionFactory<MyFrontendAction>();
+	cal::TracedToolAction tracedAction(factory.get());
+	int status = tool.run(&tracedAction);
+	if (timeTrace.finish()) {status = 1;}
 	if (status) {llvm::errs() << "error detected\n";}
 	return !status ? 0 : 1;
 }
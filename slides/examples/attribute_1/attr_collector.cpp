@@ -0,0 +1,85 @@
+#include <cal/enum_names.hpp>
+#include <clang/AST/Decl.h>
+#include <clang/AST/Stmt.h>
+#include <clang/ASTMatchers/ASTMatchers.h>
+#include <clang/Basic/FileManager.h>
+#include <clang/Index/USRGeneration.h>
+#include <llvm/ADT/SmallString.h>
+#include <llvm/Support/TimeProfiler.h>
+#include "attr_collector.hpp"
+
+namespace cam = clang::ast_matchers;
+
+std::string_view attrSyntaxToString(clang::Attr::Syntax syntax) {
+	using Syntax = clang::Attr::Syntax;
+	// The other syntaxes are reported as unknown.
+	static constexpr auto lut = cal::makeEnumNames<Syntax>({
+		{Syntax::AS_GNU, "AS_GNU"},
+		{Syntax::AS_CXX11, "AS_CXX11"},
+		{Syntax::AS_Keyword, "AS_Keyword"},
+		{Syntax::AS_Pragma, "AS_Pragma"},
+	});
+	return lut(syntax);
+}
+
+static std::string getUsr(const clang::Decl* decl) {
+	llvm::SmallString<128> usr;
+	if (clang::index::generateUSRForDecl(decl, usr)) {return {};}
+	return std::string(usr);
+}
+
+// Get the pathname of the file containing a location, which is the same
+// for every TU that includes the file (however it is included), so that
+// the records for a header are deduplicated across TUs.
+static std::string getRealPathName(const clang::SourceManager& sourceManager,
+  clang::SourceLocation loc) {
+	if (const clang::FileEntry* fileEntry = sourceManager.getFileEntryForID(
+	  sourceManager.getFileID(loc))) {
+		llvm::StringRef realPathName = fileEntry->tryGetRealPathName();
+		if (!realPathName.empty()) {return std::string(realPathName);}
+	}
+	llvm::SmallString<256> pathName(sourceManager.getFilename(loc));
+	sourceManager.getFileManager().makeAbsolutePath(pathName);
+	return std::string(pathName);
+}
+
+void IndexMatchCallback::addRecord(const clang::SourceManager& sourceManager,
+  const clang::Attr* attr, const std::string& usr) {
+	if (attr->isImplicit() || attr->isInherited()) {return;}
+	clang::SourceLocation loc = sourceManager.getSpellingLoc(attr->getLoc());
+	if (loc.isInvalid()) {return;}
+	records_.push_back({
+		attr->getAttrName() ? attr->getNormalizedFullName() :
+		  std::string(attr->getSpelling()),
+		std::string(attrSyntaxToString(attr->getSyntax())),
+		usr,
+		getRealPathName(sourceManager, loc),
+		sourceManager.getSpellingLineNumber(loc),
+		sourceManager.getSpellingColumnNumber(loc)
+	});
+}
+
+void IndexMatchCallback::addMatchers(cam::MatchFinder& matchFinder) {
+	using namespace cam;
+	matchFinder.addMatcher(namedDecl(has(attr())).bind("d"), this);
+	matchFinder.addMatcher(attributedStmt(optionally(forFunction(
+	  functionDecl().bind("f")))).bind("s"), this);
+}
+
+void IndexMatchCallback::run(const cam::MatchFinder::MatchResult& result) {
+	llvm::TimeTraceScope timeScope("MatchCallback");
+	const clang::SourceManager& sourceManager = *result.SourceManager;
+	if (auto decl = result.Nodes.getNodeAs<clang::NamedDecl>("d")) {
+		std::string usr = getUsr(decl);
+		for (const clang::Attr* attr : decl->attrs()) {
+			addRecord(sourceManager, attr, usr);
+		}
+	} else if (auto stmt =
+	  result.Nodes.getNodeAs<clang::AttributedStmt>("s")) {
+		auto func = result.Nodes.getNodeAs<clang::FunctionDecl>("f");
+		std::string usr = func ? getUsr(func) : std::string();
+		for (const clang::Attr* attr : stmt->getAttrs()) {
+			addRecord(sourceManager, attr, usr);
+		}
+	}
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <clang/AST/Attr.h>
+#include <clang/ASTMatchers/ASTMatchFinder.h>
+#include <clang/Basic/SourceManager.h>
+#include "attr_index.hpp"
+
+// The code shared by the attribute tool and the attribute plugin.
+
+std::string_view attrSyntaxToString(clang::Attr::Syntax syntax);
+
+// Collects a record for each attribute that is spelled in the source code
+// (i.e., excluding implicit and inherited attributes), on either a
+// declaration or a statement.
+class IndexMatchCallback :
+  public clang::ast_matchers::MatchFinder::MatchCallback {
+public:
+	// Add the matchers for the attributes (with this as the callback).
+	void addMatchers(clang::ast_matchers::MatchFinder& matchFinder);
+	void run(const clang::ast_matchers::MatchFinder::MatchResult& result)
+	  override;
+	std::vector<AttrRecord>& getRecords() {return records_;}
+private:
+	void addRecord(const clang::SourceManager& sourceManager,
+	  const clang::Attr* attr, const std::string& usr);
+	std::vector<AttrRecord> records_;
+};
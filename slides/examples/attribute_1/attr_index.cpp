@@ -0,0 +1,43 @@
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include "attr_index.hpp"
+
+namespace {
+
+const cal::ColumnFileFormat indexFormat{std::string_view("ATTRIDX", 8), 2,
+  6, "an attribute index"};
+
+}
+
+int writeAttrIndex(const std::string& pathName,
+  std::vector<AttrRecord>& records) {
+	std::sort(records.begin(), records.end());
+	records.erase(std::unique(records.begin(), records.end()), records.end());
+	cal::ColumnFileWriter writer(indexFormat.numColumns);
+	writer.reserve(records.size());
+	for (const auto& record : records) {
+		writer.addRow(std::array<std::uint32_t, 6>{
+			writer.getStringId(record.kind),
+			writer.getStringId(record.syntax),
+			writer.getStringId(record.usr),
+			writer.getStringId(record.file),
+			record.line,
+			record.column
+		});
+	}
+	return writer.write(pathName, indexFormat);
+}
+
+std::unique_ptr<AttrIndex> AttrIndex::open(const std::string& pathName,
+  std::string& error) {
+	std::unique_ptr<cal::ColumnFile> file = cal::ColumnFile::open(pathName,
+	  indexFormat, error);
+	if (!file) {return nullptr;}
+	return std::unique_ptr<AttrIndex>(new AttrIndex(std::move(file)));
+}
+
+std::pair<std::size_t, std::size_t> AttrIndex::find(std::string_view kind)
+  const {
+	return file_->equalRange(0, kind);
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include <cal/column_file.hpp>
+
+// One use of an attribute.  For an attribute on a statement (e.g.,
+// [[likely]]), the declaration is the enclosing function.
+struct AttrRecord {
+	std::string kind;
+	std::string syntax;
+	std::string usr;
+	// The real path of the file (so that the records for a header from
+	// different TUs are deduplicated by writeAttrIndex).
+	std::string file;
+	unsigned line;
+	unsigned column;
+	auto asTuple() const
+	  {return std::tie(kind, file, line, column, usr, syntax);}
+	bool operator<(const AttrRecord& other) const
+	  {return asTuple() < other.asTuple();}
+	bool operator==(const AttrRecord& other) const
+	  {return asTuple() == other.asTuple();}
+};
+
+// The index file is a column file (see cal/column_file.hpp) with the
+// columns kind, syntax, USR, file, line, and column.  The records are
+// sorted by attribute kind (and then by location), so that all of the uses
+// of a given kind can be found by binary search on the kind column.
+
+// Sort and deduplicate the records and write them to an index file.
+// Returns zero on success.
+int writeAttrIndex(const std::string& pathName,
+  std::vector<AttrRecord>& records);
+
+// A read-only view of a memory-mapped index file.
+class AttrIndex {
+public:
+	// Returns null (and sets the error message) if the file cannot be
+	// read or is not a valid index.
+	static std::unique_ptr<AttrIndex> open(const std::string& pathName,
+	  std::string& error);
+	std::size_t size() const {return file_->size();}
+	std::string_view kind(std::size_t i) const
+	  {return file_->getString(0, i);}
+	std::string_view syntax(std::size_t i) const
+	  {return file_->getString(1, i);}
+	std::string_view usr(std::size_t i) const {return file_->getString(2, i);}
+	std::string_view file(std::size_t i) const
+	  {return file_->getString(3, i);}
+	unsigned line(std::size_t i) const {return file_->getInt(4, i);}
+	unsigned column(std::size_t i) const {return file_->getInt(5, i);}
+	// Get the half-open range of records with the specified kind.
+	std::pair<std::size_t, std::size_t> find(std::string_view kind) const;
+private:
+	explicit AttrIndex(std::unique_ptr<cal::ColumnFile> file) :
+	  file_(std::move(file)) {}
+	std::unique_ptr<cal::ColumnFile> file_;
+};
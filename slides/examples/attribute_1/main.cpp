@@ -1,17 +1,33 @@
+#include <algorithm>
 #include <format>
-#include <map>
+#include <iterator>
+#include <memory>
 #include <string>
 #include <string_view>
+#include <utility>
+#include <vector>
+#include <cal/parallel.hpp>
+#include <cal/time_trace.hpp>
 #include <clang/ASTMatchers/ASTMatchers.h>
 #include <clang/ASTMatchers/ASTMatchFinder.h>
 #include <clang/Frontend/FrontendActions.h>
 #include <clang/Tooling/CommonOptionsParser.h>
 #include <clang/Tooling/Tooling.h>
 #include <llvm/Support/CommandLine.h>
+#include "attr_collector.hpp"
 
 namespace ct = clang::tooling;
 namespace cam = clang::ast_matchers;
 
+static llvm::cl::OptionCategory optionCategory("Tool options");
+static llvm::cl::opt<std::string> clIndexFile("index",
+  llvm::cl::desc("Write an attribute index to the specified file (instead "
+  "of printing the attributes)"), llvm::cl::value_desc("file"),
+  llvm::cl::cat(optionCategory));
+static llvm::cl::opt<unsigned> clNumThreads("j",
+  llvm::cl::desc("Number of threads for indexing (0 means automatic)"),
+  llvm::cl::cat(optionCategory), llvm::cl::init(0));
+
 std::string locationToString(const clang::SourceManager& sourceManager,
   clang::SourceLocation sourceLoc) {
 	return std::format("{}:{}({})",
@@ -28,22 +44,12 @@ std::string declTypeToString(const clang::Decl* decl) {
 	else {return "other";}
 }
 
-std::string attrSyntaxToString(clang::Attr::Syntax syntax) {
-	const std::map<clang::Attr::Syntax, std::string> lut{
-		{clang::Attr::Syntax::AS_GNU, "AS_GNU"},
-		{clang::Attr::Syntax::AS_CXX11, "AS_CXX11"},
-		{clang::Attr::Syntax::AS_Keyword, "AS_Keyword"},
-		{clang::Attr::Syntax::AS_Pragma, "AS_Pragma"}
-	};
-	auto i = lut.find(syntax);
-	return (i != lut.end()) ? i->second : "unknown";
-}
-
 struct MyMatchCallback : public cam::MatchFinder::MatchCallback {
 	void run(const cam::MatchFinder::MatchResult& result) override;
 };
 
 void MyMatchCallback::run(const cam::MatchFinder::MatchResult& result) {
+	llvm::TimeTraceScope timeScope("MatchCallback");
 	const clang::SourceManager& sourceManager = *result.SourceManager;
 	auto decl = result.Nodes.getNodeAs<clang::NamedDecl>("d");
 	if (!decl) {return;}
@@ -60,8 +66,43 @@ void MyMatchCallback::run(const cam::MatchFinder::MatchResult& result) {
 	}
 }
 
+/****************************************************************************\
+Attribute Index
+\****************************************************************************/
+
+// The per-thread state of the indexing, with the records of the thread
+// appended to those of all of the threads at the end.
+class IndexAction : public cal::ParallelAction {
+public:
+	explicit IndexAction(std::vector<AttrRecord>& records) :
+	  records_(&records) {
+		matchCallback_.addMatchers(matchFinder_);
+		factory_ = ct::newFrontendActionFactory(&matchFinder_);
+	}
+	ct::ToolAction& getToolAction() override {return *factory_;}
+	void merge() override {
+		std::vector<AttrRecord>& localRecords = matchCallback_.getRecords();
+		records_->insert(records_->end(),
+		  std::make_move_iterator(localRecords.begin()),
+		  std::make_move_iterator(localRecords.end()));
+	}
+private:
+	std::vector<AttrRecord>* records_;
+	IndexMatchCallback matchCallback_;
+	cam::MatchFinder matchFinder_;
+	std::unique_ptr<ct::FrontendActionFactory> factory_;
+};
+
+int runIndex(const ct::CompilationDatabase& compilations,
+  const std::vector<std::string>& sources, unsigned numThreads,
+  std::vector<AttrRecord>& records) {
+	return cal::runParallel(compilations, sources, numThreads, [&]() {
+		return std::make_unique<IndexAction>(records);
+	});
+}
+
 int main(int argc, const char **argv) {
-	static llvm::cl::OptionCategory optionCategory("Tool options");
+	cal::addTimeTraceOptions(optionCategory);
 	auto expectedParser = ct::CommonOptionsParser::create(argc, argv,
 	  optionCategory);
 	if (!expectedParser) {
@@ -69,11 +110,29 @@ int main(int argc, const char **argv) {
 		return 1;
 	}
 	ct::CommonOptionsParser& optionsParser = expectedParser.get();
+	cal::TimeTrace timeTrace(argv[0]);
+	if (!clIndexFile.empty()) {
+		std::vector<AttrRecord> records;
+		int status = runIndex(optionsParser.getCompilations(),
+		  optionsParser.getSourcePathList(), clNumThreads, records);
+		{
+			llvm::TimeTraceScope timeScope("WriteIndex");
+			if (writeAttrIndex(clIndexFile, records)) {return 1;}
+		}
+		llvm::errs() << std::format("indexed {} attribute uses\n",
+		  records.size());
+		if (timeTrace.finish()) {status = 1;}
+		return !status ? 0 : 1;
+	}
 	ct::ClangTool tool(optionsParser.getCompilations(),
 	  optionsParser.getSourcePathList());
 	MyMatchCallback matchCallback;
 	cam::MatchFinder matchFinder;
 	matchFinder.addMatcher(cam::namedDecl(cam::has(cam::attr())).bind("d"),
 	  &matchCallback);
-	return !tool.run(ct::newFrontendActionFactory(&matchFinder).get()) ? 0 : 1;
+	auto factory = ct::newFrontendActionFactory(&matchFinder);
+	cal::TracedToolAction tracedAction(factory.get());
+	int status = tool.run(&tracedAction);
+	if (timeTrace.finish()) {status = 1;}
+	return !status ? 0 : 1;
 }
@@ -0,0 +1,89 @@
+#include <string>
+#include <vector>
+#include <cal/sidecar.hpp>
+#include <clang/AST/ASTConsumer.h>
+#include <clang/AST/ASTContext.h>
+#include <clang/Frontend/CompilerInstance.h>
+#include <clang/Frontend/FrontendPluginRegistry.h>
+#include <llvm/Support/JSON.h>
+#include <llvm/Support/raw_ostream.h>
+#include "attr_collector.hpp"
+
+// The attribute analysis as a Clang plugin, which runs after the main
+// action of a normal compilation (so the TU is only parsed once) and
+// writes a record for each attribute use (i.e., the same information as
+// in an attribute index) to a sidecar file.  For example:
+//   clang++ -fplugin=./attribute_plugin.so -c foo.cpp
+// writes foo.o.attributes.jsonl.  The uses of each attribute kind are
+// counted by merging the sidecar files with
+// "merge_sidecars -analysis attributes -count-by kind".  The plugin
+// arguments are:
+//   out-dir=DIR  write the sidecar file in DIR
+
+namespace cam = clang::ast_matchers;
+
+namespace {
+
+class AttrConsumer : public clang::ASTConsumer {
+public:
+	AttrConsumer(clang::CompilerInstance& compilerInstance,
+	  const std::string& outputDir) :
+	  compilerInstance_(&compilerInstance), outputDir_(outputDir) {}
+	void HandleTranslationUnit(clang::ASTContext& astContext) final {
+		// The results for a TU that failed to compile are of no use.
+		if (compilerInstance_->getDiagnostics().hasErrorOccurred()) {return;}
+		IndexMatchCallback matchCallback;
+		cam::MatchFinder matchFinder;
+		matchCallback.addMatchers(matchFinder);
+		matchFinder.matchAST(astContext);
+		std::string buffer;
+		llvm::raw_string_ostream out(buffer);
+		for (const auto& record : matchCallback.getRecords()) {
+			llvm::json::OStream json(out);
+			json.object([&]() {
+				json.attribute("kind", record.kind);
+				json.attribute("syntax", record.syntax);
+				json.attribute("usr", record.usr);
+				json.attribute("file", record.file);
+				json.attribute("line", record.line);
+				json.attribute("column", record.column);
+			});
+			out << '\n';
+		}
+		out.flush();
+		cal::writeSidecar(*compilerInstance_, cal::getSidecarPathName(
+		  *compilerInstance_, "attributes", outputDir_), buffer);
+	}
+private:
+	clang::CompilerInstance* compilerInstance_;
+	std::string outputDir_;
+};
+
+class AttrPluginAction : public clang::PluginASTAction {
+protected:
+	std::unique_ptr<clang::ASTConsumer> CreateASTConsumer(
+	  clang::CompilerInstance& compilerInstance, llvm::StringRef) final {
+		return std::make_unique<AttrConsumer>(compilerInstance, outputDir_);
+	}
+	bool ParseArgs(const clang::CompilerInstance& compilerInstance,
+	  const std::vector<std::string>& args) final {
+		clang::DiagnosticsEngine& diags = compilerInstance.getDiagnostics();
+		for (const auto& arg : args) {
+			if (!cal::getPluginArg(arg, "out-dir", outputDir_)) {
+				diags.Report(diags.getCustomDiagID(
+				  clang::DiagnosticsEngine::Error,
+				  "invalid argument '%0' for attributes plugin")) << arg;
+				return false;
+			}
+		}
+		return true;
+	}
+	ActionType getActionType() final {return AddAfterMainAction;}
+private:
+	std::string outputDir_;
+};
+
+}
+
+static clang::FrontendPluginRegistry::Add<AttrPluginAction>
+  registration("attributes", "Write the attribute uses to a sidecar file");
@@ -0,0 +1,48 @@
+#include <format>
+#include <map>
+#include <string>
+#include <string_view>
+#include <llvm/Support/CommandLine.h>
+#include <llvm/Support/raw_ostream.h>
+#include "attr_index.hpp"
+
+// Answer queries against an attribute index without invoking Clang.
+// With no attribute kinds specified, the kinds in the index are listed
+// (with their number of uses).
+
+static llvm::cl::OptionCategory optionCategory("Tool options");
+static llvm::cl::opt<std::string> clIndexFile(llvm::cl::Positional,
+  llvm::cl::desc("<index file>"), llvm::cl::Required,
+  llvm::cl::cat(optionCategory));
+static llvm::cl::list<std::string> clKinds(llvm::cl::Positional,
+  llvm::cl::desc("<attribute kind>..."), llvm::cl::cat(optionCategory));
+
+int main(int argc, const char **argv) {
+	llvm::cl::HideUnrelatedOptions(optionCategory);
+	llvm::cl::ParseCommandLineOptions(argc, argv);
+	std::string error;
+	std::unique_ptr<AttrIndex> index = AttrIndex::open(clIndexFile, error);
+	if (!index) {
+		llvm::errs() << error << '\n';
+		return 1;
+	}
+	llvm::raw_ostream& out = llvm::outs();
+	if (clKinds.empty()) {
+		// The records are sorted by kind, so this is one pass.
+		for (std::size_t i = 0; i < index->size();) {
+			auto [begin, end] = index->find(index->kind(i));
+			out << std::format("{} {}\n", index->kind(i), end - begin);
+			i = end;
+		}
+		return 0;
+	}
+	for (const auto& kind : clKinds) {
+		auto [begin, end] = index->find(kind);
+		for (std::size_t i = begin; i < end; ++i) {
+			out << std::format("{}:{}({}) {} {} {}\n", index->file(i),
+			  index->line(i), index->column(i), index->kind(i),
+			  index->syntax(i), index->usr(i));
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,38 @@
+#include <format>
+#include <cal/prefilter.hpp>
+#include "casts.hpp"
+
+namespace cam = clang::ast_matchers;
+
+std::string locationToString(const clang::SourceManager& sourceManager,
+  clang::SourceLocation sourceLoc) {
+	return std::format("{}:{}({})",
+	  std::string(sourceManager.getFilename(sourceLoc)),
+	  sourceManager.getSpellingLineNumber(sourceLoc),
+	  sourceManager.getSpellingColumnNumber(sourceLoc));
+}
+
+std::string_view getCastName(const clang::ExplicitCastExpr* castExpr) {
+	if (llvm::isa<clang::CStyleCastExpr>(castExpr)) {
+		return "C-style-cast";
+	} else if (llvm::isa<clang::CXXFunctionalCastExpr>(castExpr)) {
+		return "functional-cast";
+	} else if (llvm::isa<clang::BuiltinBitCastExpr>(castExpr)) {
+		return "bit-cast";
+	} else if (auto namedCastExpr =
+	  llvm::dyn_cast<clang::CXXNamedCastExpr>(castExpr)) {
+		return namedCastExpr->getCastName();
+	} else {return "unknown";}
+}
+
+// C-style and functional casts have no keyword, so only named casts can be
+// prefiltered.  Named casts spelled in system headers are excluded, since
+// their keywords need not appear in the files scanned by the prefilter.
+cam::StatementMatcher getCastMatcher(bool named) {
+	using namespace cam;
+	if (named) {
+		return cxxNamedCastExpr(unless(cal::isSpelledInSystemHeader()))
+		  .bind("c");
+	}
+	return explicitCastExpr().bind("c");
+}
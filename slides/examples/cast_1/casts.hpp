@@ -0,0 +1,21 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <clang/AST/ExprCXX.h>
+#include <clang/ASTMatchers/ASTMatchers.h>
+#include <clang/Basic/SourceManager.h>
+
+// The code shared by the cast tool and the cast plugin.
+
+std::string locationToString(const clang::SourceManager& sourceManager,
+  clang::SourceLocation sourceLoc);
+
+// Get the name of the kind of an explicit cast (e.g., static_cast or
+// C-style-cast).
+std::string_view getCastName(const clang::ExplicitCastExpr* castExpr);
+
+// Get the matcher for the casts of interest (bound to "c").  If named is
+// true, only the named casts (e.g., static_cast) that are not spelled in
+// system headers are matched.
+clang::ast_matchers::StatementMatcher getCastMatcher(bool named);
@@ -0,0 +1,12 @@
+// Each expansion of a macro that contains a cast is a separate cast, so
+// both the census and the census from the plugin count three static
+// casts from long to int here.
+#define NARROW(x) static_cast<int>(x)
+
+int narrow(long a, long b) {
+	return NARROW(a) + NARROW(b);
+}
+
+int narrow_again(long c) {
+	return NARROW(c);
+}
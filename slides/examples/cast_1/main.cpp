@@ -1,40 +1,55 @@
+#include <algorithm>
 #include <format>
+#include <map>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <vector>
+#include <cal/parallel.hpp>
+#include <cal/prefilter.hpp>
+#include <cal/time_trace.hpp>
 #include <clang/ASTMatchers/ASTMatchers.h>
 #include <clang/ASTMatchers/ASTMatchFinder.h>
 #include <clang/Frontend/FrontendActions.h>
 #include <clang/Tooling/CommonOptionsParser.h>
 #include <clang/Tooling/Tooling.h>
+#include <llvm/ADT/DenseMap.h>
 #include <llvm/Support/CommandLine.h>
+#include <llvm/Support/JSON.h>
+#include <llvm/Support/raw_ostream.h>
+#include "casts.hpp"
 
 namespace ct = clang::tooling;
 namespace cam = clang::ast_matchers;
 
-std::string locationToString(const clang::SourceManager& sourceManager,
-  clang::SourceLocation sourceLoc) {
-	return std::format("{}:{}({})",
-	  std::string(sourceManager.getFilename(sourceLoc)),
-	  sourceManager.getSpellingLineNumber(sourceLoc),
-	  sourceManager.getSpellingColumnNumber(sourceLoc));
-}
-
-std::string getCastName(const clang::ExplicitCastExpr* castExpr) {
-	if (llvm::isa<clang::CStyleCastExpr>(castExpr)) {
-		return "C-style-cast";
-	} else if (llvm::isa<clang::CXXFunctionalCastExpr>(castExpr)) {
-		return "functional-cast";
-	} else if (llvm::isa<clang::BuiltinBitCastExpr>(castExpr)) {
-		return "bit-cast";
-	} else if (auto namedCastExpr =
-	  llvm::dyn_cast<clang::CXXNamedCastExpr>(castExpr)) {
-		return namedCastExpr->getCastName();
-	} else {return "unknown";}
-}
+static llvm::cl::OptionCategory optionCategory("Tool options");
+static llvm::cl::opt<bool> clCensus("census",
+  llvm::cl::desc("Print aggregate counts per (cast, from type, to type)"),
+  llvm::cl::cat(optionCategory), llvm::cl::init(false));
+static llvm::cl::opt<std::string> clJsonFile("json",
+  llvm::cl::desc("Also write the census as JSON to the specified file"),
+  llvm::cl::value_desc("file"), llvm::cl::cat(optionCategory));
+static llvm::cl::opt<unsigned> clNumThreads("j",
+  llvm::cl::desc("Number of threads for the census (0 means automatic)"),
+  llvm::cl::cat(optionCategory), llvm::cl::init(0));
+static llvm::cl::opt<unsigned> clMaxExamples("examples",
+  llvm::cl::desc("Maximum number of example locations per census entry"),
+  llvm::cl::cat(optionCategory), llvm::cl::init(3));
+static llvm::cl::opt<bool> clNamed("named",
+  llvm::cl::desc("Only match named casts (e.g., static_cast) that are not "
+  "spelled in system headers"), llvm::cl::cat(optionCategory),
+  llvm::cl::init(false));
+static llvm::cl::opt<bool> clPrefilter("prefilter",
+  llvm::cl::desc("Skip translation units that cannot contain a named cast "
+  "(requires -named)"), llvm::cl::cat(optionCategory), llvm::cl::init(false));
 
 struct MyMatchCallback : public cam::MatchFinder::MatchCallback {
 	void run(const cam::MatchFinder::MatchResult& result) override;
 };
 
 void MyMatchCallback::run(const cam::MatchFinder::MatchResult& result) {
+	llvm::TimeTraceScope timeScope("MatchCallback");
 	const clang::SourceManager& sourceManager = *result.SourceManager;
 	const clang::ASTContext& astContext = *result.Context;
 	auto castExpr = result.Nodes.getNodeAs<clang::ExplicitCastExpr>("c");
@@ -51,9 +66,164 @@ void MyMatchCallback::run(const cam::MatchFinder::MatchResult& result) {
 	  );
 }
 
-static llvm::cl::OptionCategory optionCategory("Tool options");
+cam::StatementMatcher getMatcher() {return getCastMatcher(clNamed);}
+
+/****************************************************************************\
+Cast Census
+\****************************************************************************/
+
+// The census key is (cast name, from type, to type).
+using CastKey = std::tuple<std::string, std::string, std::string>;
+
+struct CastStats {
+	unsigned long count = 0;
+	std::vector<std::string> examples;
+};
+
+using CastCensus = std::map<CastKey, CastStats>;
+
+void mergeCensus(CastCensus& dst, CastCensus&& src) {
+	for (auto& [key, stats] : src) {
+		CastStats& dstStats = dst[key];
+		dstStats.count += stats.count;
+		for (auto& example : stats.examples) {
+			if (dstStats.examples.size() >= clMaxExamples) {break;}
+			dstStats.examples.push_back(std::move(example));
+		}
+	}
+}
+
+// Within a translation unit, each distinct canonical type is assigned a
+// small integer ID (keyed by the opaque pointer of the canonical type) and
+// its name is rendered only once.  The per-TU counts are keyed by type IDs
+// and only turned into strings when merged at the end of the TU.
+class CensusMatchCallback : public cam::MatchFinder::MatchCallback {
+public:
+	void run(const cam::MatchFinder::MatchResult& result) override;
+	void onStartOfTranslationUnit() override;
+	void onEndOfTranslationUnit() override;
+	CastCensus& getCensus() {return census_;}
+private:
+	using LocalKey = std::tuple<std::string_view, unsigned, unsigned>;
+	unsigned getTypeId(const clang::ASTContext& astContext,
+	  clang::QualType type);
+	llvm::DenseMap<void*, unsigned> typeIds_;
+	std::vector<std::string> typeNames_;
+	std::map<LocalKey, CastStats> localCensus_;
+	CastCensus census_;
+};
+
+unsigned CensusMatchCallback::getTypeId(const clang::ASTContext& astContext,
+  clang::QualType type) {
+	clang::QualType canonType = type.getCanonicalType();
+	auto [iter, inserted] = typeIds_.try_emplace(canonType.getAsOpaquePtr(),
+	  typeNames_.size());
+	if (inserted) {
+		clang::PrintingPolicy pp(astContext.getLangOpts());
+		pp.PrintCanonicalTypes = 1;
+		typeNames_.push_back(canonType.getAsString(pp));
+	}
+	return iter->second;
+}
+
+void CensusMatchCallback::onStartOfTranslationUnit() {
+	typeIds_.clear();
+	typeNames_.clear();
+	localCensus_.clear();
+}
+
+void CensusMatchCallback::run(const cam::MatchFinder::MatchResult& result) {
+	llvm::TimeTraceScope timeScope("MatchCallback");
+	const clang::ASTContext& astContext = *result.Context;
+	auto castExpr = result.Nodes.getNodeAs<clang::ExplicitCastExpr>("c");
+	unsigned fromId = getTypeId(astContext, castExpr->getSubExpr()->getType());
+	unsigned toId = getTypeId(astContext, castExpr->getType());
+	CastStats& stats = localCensus_[{getCastName(castExpr), fromId, toId}];
+	++stats.count;
+	if (stats.examples.size() < clMaxExamples) {
+		stats.examples.push_back(locationToString(*result.SourceManager,
+		  castExpr->getExprLoc()));
+	}
+}
+
+void CensusMatchCallback::onEndOfTranslationUnit() {
+	CastCensus tuCensus;
+	for (auto& [key, stats] : localCensus_) {
+		auto [castName, fromId, toId] = key;
+		tuCensus.emplace(CastKey{std::string(castName), typeNames_[fromId],
+		  typeNames_[toId]}, std::move(stats));
+	}
+	mergeCensus(census_, std::move(tuCensus));
+	localCensus_.clear();
+}
+
+// The per-thread state of the census, with the census of the thread merged
+// into that of all of the threads at the end.
+class CensusAction : public cal::ParallelAction {
+public:
+	explicit CensusAction(CastCensus& census) : census_(&census) {
+		matchFinder_.addMatcher(getMatcher(), &matchCallback_);
+		factory_ = ct::newFrontendActionFactory(&matchFinder_);
+	}
+	ct::ToolAction& getToolAction() override {return *factory_;}
+	void merge() override
+	  {mergeCensus(*census_, std::move(matchCallback_.getCensus()));}
+private:
+	CastCensus* census_;
+	CensusMatchCallback matchCallback_;
+	cam::MatchFinder matchFinder_;
+	std::unique_ptr<ct::FrontendActionFactory> factory_;
+};
+
+int runCensus(const ct::CompilationDatabase& compilations,
+  const std::vector<std::string>& sources, unsigned numThreads,
+  CastCensus& census) {
+	return cal::runParallel(compilations, sources, numThreads, [&]() {
+		return std::make_unique<CensusAction>(census);
+	});
+}
+
+void printCensus(llvm::raw_ostream& out, const CastCensus& census) {
+	std::vector<CastCensus::const_pointer> entries;
+	for (const auto& entry : census) {entries.push_back(&entry);}
+	std::stable_sort(entries.begin(), entries.end(), [](auto a, auto b) {
+		return a->second.count > b->second.count;
+	});
+	out << std::format("{:>8} {:<16} {} -> {}\n", "count", "cast",
+	  "from type", "to type");
+	for (auto entry : entries) {
+		const auto& [castName, fromType, toType] = entry->first;
+		out << std::format("{:>8} {:<16} {} -> {}\n", entry->second.count,
+		  castName, fromType, toType);
+		for (const auto& example : entry->second.examples) {
+			out << std::format("{:>8} {:<16} at {}\n", "", "", example);
+		}
+	}
+}
+
+void writeCensusJson(llvm::raw_ostream& out, const CastCensus& census) {
+	llvm::json::OStream json(out, 2);
+	json.array([&]() {
+		for (const auto& entry : census) {
+			json.object([&]() {
+				json.attribute("cast", std::get<0>(entry.first));
+				json.attribute("from", std::get<1>(entry.first));
+				json.attribute("to", std::get<2>(entry.first));
+				json.attribute("count",
+				  static_cast<int64_t>(entry.second.count));
+				json.attributeArray("examples", [&]() {
+					for (const auto& example : entry.second.examples) {
+						json.value(example);
+					}
+				});
+			});
+		}
+	});
+	out << '\n';
+}
 
 int main(int argc, const char **argv) {
+	cal::addTimeTraceOptions(optionCategory);
 	auto expectedParser = ct::CommonOptionsParser::create(argc, argv,
 	  optionCategory);
 	if (!expectedParser) {
@@ -61,11 +231,47 @@ int main(int argc, const char **argv) {
 		return 1;
 	}
 	ct::CommonOptionsParser& optionsParser = expectedParser.get();
-	ct::ClangTool tool(optionsParser.getCompilations(),
-	  optionsParser.getSourcePathList());
+	cal::TimeTrace timeTrace(argv[0]);
+	std::vector<std::string> sources = optionsParser.getSourcePathList();
+	if (clPrefilter) {
+		if (!clNamed) {
+			llvm::errs() << "-prefilter requires -named\n";
+			return 1;
+		}
+		// Every named cast keyword ends in _cast.
+		cal::TokenPrefilter prefilter({"_cast"});
+		sources = prefilter.filterSources(optionsParser.getCompilations(),
+		  sources);
+		prefilter.printSummary(llvm::errs());
+	}
+	if (clCensus) {
+		CastCensus census;
+		int status = runCensus(optionsParser.getCompilations(), sources,
+		  clNumThreads, census);
+		{
+			llvm::TimeTraceScope timeScope("WriteOutput");
+			printCensus(llvm::outs(), census);
+			if (!clJsonFile.empty()) {
+				std::error_code errCode;
+				llvm::raw_fd_ostream jsonOut(clJsonFile, errCode);
+				if (errCode) {
+					llvm::errs() << std::format("cannot open {} ({})\n",
+					  std::string(clJsonFile), errCode.message());
+					return 1;
+				}
+				writeCensusJson(jsonOut, census);
+			}
+		}
+		if (timeTrace.finish()) {status = 1;}
+		return !status ? 0 : 1;
+	}
+	ct::ClangTool tool(optionsParser.getCompilations(), sources);
 	MyMatchCallback matchCallback;
 	cam::MatchFinder matchFinder;
-	matchFinder.addMatcher(cam::explicitCastExpr().bind("c"),
-	  &matchCallback);
-	return !tool.run(ct::newFrontendActionFactory(&matchFinder).get()) ? 0 : 1;
+	matchFinder.addMatcher(getMatcher(), &matchCallback);
+	auto factory = ct::newFrontendActionFactory(&matchFinder);
+	cal::TracedToolAction tracedAction(factory.get());
+	int status = tool.run(&tracedAction);
+	if (timeTrace.finish()) {status = 1;}
+	return !status ? 0 : 1;
 }
@@ -0,0 +1,139 @@
+#include <format>
+#include <string>
+#include <vector>
+#include <cal/sidecar.hpp>
+#include <clang/AST/ASTConsumer.h>
+#include <clang/AST/ASTContext.h>
+#include <clang/ASTMatchers/ASTMatchFinder.h>
+#include <clang/Frontend/CompilerInstance.h>
+#include <clang/Frontend/FrontendPluginRegistry.h>
+#include <llvm/Support/JSON.h>
+#include <llvm/Support/raw_ostream.h>
+#include "casts.hpp"
+
+// The cast analysis as a Clang plugin, which runs after the main action
+// of a normal compilation (so the TU is only parsed once) and writes a
+// record for each explicit cast to a sidecar file.  For example:
+//   clang++ -fplugin=./cast_plugin.so -c foo.cpp
+// writes foo.o.casts.jsonl.  A census is obtained by merging the sidecar
+// files with "merge_sidecars -analysis casts -count-by cast,from,to".
+// Since identical records are merged, a cast in a header is only counted
+// once, regardless of how many TUs include the header.  The plugin
+// arguments are:
+//   named        only record named casts not spelled in system headers
+//   out-dir=DIR  write the sidecar file in DIR
+
+namespace cam = clang::ast_matchers;
+
+namespace {
+
+struct PluginOptions {
+	bool named = false;
+	std::string outputDir;
+};
+
+// Get the location of a cast for its sidecar record.  Since identical
+// records are merged, the location must distinguish the casts in the
+// source (but not the TUs that include a header).  So the expansion
+// location is used (which differs for each expansion of a macro that
+// contains a cast), with the file named by its real path, and the spelling
+// location is added for a cast in a macro (to distinguish the casts in one
+// expansion).
+std::string getRecordLocation(const clang::SourceManager& sourceManager,
+  clang::SourceLocation loc) {
+	auto fileLocToString = [&](clang::SourceLocation fileLoc) {
+		auto [fileId, offset] = sourceManager.getDecomposedLoc(fileLoc);
+		std::string fileName;
+		if (auto fileEntry = sourceManager.getFileEntryForID(fileId)) {
+			llvm::StringRef realPathName = fileEntry->tryGetRealPathName();
+			fileName = std::string(!realPathName.empty() ? realPathName :
+			  fileEntry->getName());
+		}
+		return std::format("{}:{}({})", fileName,
+		  sourceManager.getLineNumber(fileId, offset),
+		  sourceManager.getColumnNumber(fileId, offset));
+	};
+	clang::SourceLocation expansionLoc = sourceManager.getExpansionLoc(loc);
+	if (!loc.isMacroID()) {return fileLocToString(expansionLoc);}
+	return std::format("{} (spelled at {})", fileLocToString(expansionLoc),
+	  fileLocToString(sourceManager.getSpellingLoc(loc)));
+}
+
+class CastMatchCallback : public cam::MatchFinder::MatchCallback {
+public:
+	CastMatchCallback(llvm::raw_ostream& out) : out_(&out) {}
+	void run(const cam::MatchFinder::MatchResult& result) final {
+		const clang::ASTContext& astContext = *result.Context;
+		auto castExpr = result.Nodes.getNodeAs<clang::ExplicitCastExpr>("c");
+		clang::PrintingPolicy pp(astContext.getLangOpts());
+		pp.PrintCanonicalTypes = 1;
+		llvm::json::OStream json(*out_);
+		json.object([&]() {
+			json.attribute("cast", llvm::StringRef(getCastName(castExpr)));
+			json.attribute("from",
+			  castExpr->getSubExpr()->getType().getAsString(pp));
+			json.attribute("to", castExpr->getType().getAsString(pp));
+			json.attribute("location", getRecordLocation(
+			  *result.SourceManager, castExpr->getExprLoc()));
+		});
+		*out_ << '\n';
+	}
+private:
+	llvm::raw_ostream* out_;
+};
+
+class CastConsumer : public clang::ASTConsumer {
+public:
+	CastConsumer(clang::CompilerInstance& compilerInstance,
+	  const PluginOptions& options) :
+	  compilerInstance_(&compilerInstance), options_(options) {}
+	void HandleTranslationUnit(clang::ASTContext& astContext) final {
+		// The results for a TU that failed to compile are of no use.
+		if (compilerInstance_->getDiagnostics().hasErrorOccurred()) {return;}
+		std::string buffer;
+		llvm::raw_string_ostream out(buffer);
+		CastMatchCallback matchCallback(out);
+		cam::MatchFinder matchFinder;
+		matchFinder.addMatcher(getCastMatcher(options_.named),
+		  &matchCallback);
+		matchFinder.matchAST(astContext);
+		out.flush();
+		cal::writeSidecar(*compilerInstance_, cal::getSidecarPathName(
+		  *compilerInstance_, "casts", options_.outputDir), buffer);
+	}
+private:
+	clang::CompilerInstance* compilerInstance_;
+	PluginOptions options_;
+};
+
+class CastPluginAction : public clang::PluginASTAction {
+protected:
+	std::unique_ptr<clang::ASTConsumer> CreateASTConsumer(
+	  clang::CompilerInstance& compilerInstance, llvm::StringRef) final {
+		return std::make_unique<CastConsumer>(compilerInstance, options_);
+	}
+	bool ParseArgs(const clang::CompilerInstance& compilerInstance,
+	  const std::vector<std::string>& args) final {
+		clang::DiagnosticsEngine& diags = compilerInstance.getDiagnostics();
+		for (const auto& arg : args) {
+			if (arg == "named") {
+				options_.named = true;
+			} else if (!cal::getPluginArg(arg, "out-dir",
+			  options_.outputDir)) {
+				diags.Report(diags.getCustomDiagID(
+				  clang::DiagnosticsEngine::Error,
+				  "invalid argument '%0' for casts plugin")) << arg;
+				return false;
+			}
+		}
+		return true;
+	}
+	ActionType getActionType() final {return AddAfterMainAction;}
+private:
+	PluginOptions options_;
+};
+
+}
+
+static clang::FrontendPluginRegistry::Add<CastPluginAction>
+  registration("casts", "Write the explicit casts to a sidecar file");
@@ -1,6 +1,9 @@
 #include <format>
-#include <map>
 #include <string>
+#include <string_view>
+#include <cal/ast_cache.hpp>
+#include <cal/enum_names.hpp>
+#include <cal/time_trace.hpp>
 #include <clang/Analysis/CFG.h>
 #include <clang/AST/ASTContext.h>
 #include <clang/ASTMatchers/ASTMatchers.h>
@@ -18,14 +21,16 @@ namespace cam = clang::ast_matchers;
 static lc::OptionCategory toolCategory("Tool Options");
 static lc::opt<std::string> clFuncName("f", lc::cat(toolCategory));
 
-std::string toString(clang::CFGElement::Kind kind) {
-	const std::map<clang::CFGElement::Kind, std::string> lut{
-	  {clang::CFGElement::Kind::Statement, "statement"},
-	  {clang::CFGElement::Kind::Constructor, "constructor"},
-	  {clang::CFGElement::Kind::CXXRecordTypedCall, "recordTypedCall"},
-	};
-	auto i = lut.find(kind);
-	return std::format("{}", (i != lut.end() ? i->second : "unknown"));
+std::string_view toString(clang::CFGElement::Kind kind) {
+	using Kind = clang::CFGElement::Kind;
+	// Only the statement kinds are named.
+	static constexpr auto lut = cal::makeEnumNames<Kind>({
+	  {Kind::Statement, "statement"},
+	  {Kind::Constructor, "constructor"},
+	  {Kind::CXXRecordTypedCall, "recordTypedCall"},
+	});
+	static_assert(lut.covers(Kind::STMT_BEGIN, Kind::STMT_END));
+	return lut(kind);
 }
 
 void printBlock(llvm::raw_ostream& out, const clang::CFG& cfg,
@@ -68,6 +73,7 @@ cam::DeclarationMatcher getFuncMatcher(const std::string& name) {
 
 struct MyMatchCallback : public cam::MatchFinder::MatchCallback {
 	virtual void run(const cam::MatchFinder::MatchResult& result) final {
+		llvm::TimeTraceScope timeScope("MatchCallback");
 		if (const auto* funcDecl =
 		  result.Nodes.getNodeAs<clang::FunctionDecl>("func")) {
 			if (const clang::Stmt *funcBody = funcDecl->getBody())
@@ -77,6 +83,8 @@ struct MyMatchCallback : public cam::MatchFinder::MatchCallback {
 };
 
 int main(int argc, char** argv) {
+	cal::addTimeTraceOptions(toolCategory);
+	cal::addAstCacheOptions(toolCategory);
 	auto expectedOptionsParser = ct::CommonOptionsParser::create(argc,
 	  const_cast<const char**>(argv), toolCategory);
 	if (!expectedOptionsParser) {
@@ -84,13 +92,22 @@ int main(int argc, char** argv) {
 		return 1;
 	}
 	ct::CommonOptionsParser& optionsParser = *expectedOptionsParser;
+	cal::TimeTrace timeTrace(argv[0]);
 	ct::ClangTool tool(optionsParser.getCompilations(),
 	  optionsParser.getSourcePathList());
 	cam::DeclarationMatcher funcMatcher = getFuncMatcher(clFuncName);
 	MyMatchCallback matchCallback;
 	cam::MatchFinder finder;
 	finder.addMatcher(funcMatcher, &matchCallback);
-	int status = tool.run(ct::newFrontendActionFactory(&finder).get());
+	auto factory = ct::newFrontendActionFactory(&finder);
+	cal::AstCacheToolAction cacheAction([&]() {
+		return finder.newASTConsumer();
+	});
+	cal::TracedToolAction tracedAction(cal::isAstCacheEnabled() ?
+	  static_cast<ct::ToolAction*>(&cacheAction) : factory.get());
+	int status = tool.run(&tracedAction);
+	if (cal::isAstCacheEnabled()) {cacheAction.printStats(llvm::errs());}
+	if (timeTrace.finish()) {status = 1;}
 	if (status) {llvm::errs() << "error occurred\n";}
 	return !status ? 0 : 1;
 }
@@ -1,3 +1,5 @@
+#pragma once
+
 #include <string>
 #include <clang/Basic/SourceManager.h>
 #include <clang/Basic/SourceLocation.h>
@@ -1,5 +1,7 @@
 #include <format>
 #include <string>
+#include <cal/startup_profile.hpp>
+#include <cal/tool_options.hpp>
 #include <clang/Tooling/CommonOptionsParser.h>
 #include <clang/Tooling/Tooling.h>
 #include <llvm/Support/CommandLine.h>
@@ -28,14 +30,16 @@ llvm::cl::opt<std::string> opName(llvm::cl::Positional, llvm::cl::Required,
   llvm::cl::value_desc("op_name"), llvm::cl::cat(toolOptionCat));
 
 int main(int argc, const char **argv) {
-	llvm::Expected<clang::tooling::CommonOptionsParser> expectedOptionsParser(
-	  clang::tooling::CommonOptionsParser::create(argc, argv, toolOptionCat));
+	cal::markStartupMain();
+	cal::addStartupProfileOptions(toolOptionCat);
+	llvm::Expected<cal::ToolOptionsParser> expectedOptionsParser(
+	  cal::ToolOptionsParser::create(argc, argv, toolOptionCat));
 	if (!expectedOptionsParser) {
 		llvm::errs() << std::format("Unable to create option parser ({}).\n",
 		  llvm::toString(std::move(expectedOptionsParser.takeError())));
 		return 1;
 	}
-	clang::tooling::CommonOptionsParser& optionsParser = *expectedOptionsParser;
+	cal::ToolOptionsParser& optionsParser = *expectedOptionsParser;
 	llvm::outs()
 	  << std::format("verbose: {}\n", static_cast<bool>(verbose))
 	  << std::format("foobar: {}\n", static_cast<bool>(foobar))
@@ -49,5 +53,6 @@ int main(int argc, const char **argv) {
 	for (auto path : optionsParser.getSourcePathList()) {
 		llvm::outs() << std::format("    {}\n", path);
 	}
+	cal::printStartupProfile(llvm::errs());
 	return 0;
 }
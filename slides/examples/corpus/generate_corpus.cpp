@@ -0,0 +1,211 @@
+// Generate a synthetic C++ project (for measuring how the example tools
+// scale with the size of their input), along with a compilation database.
+//
+// The project consists of a common header and a number of translation
+// units.  Each translation unit defines a number of functions inside
+// nested namespaces, where each function has a body with nested blocks,
+// uses macros from the common header, instantiates templates from the
+// common header with several different types, and calls the previous
+// function (as well as a function, corpus_target, defined in the common
+// header).
+
+#include <filesystem>
+#include <format>
+#include <string>
+#include <system_error>
+#include <llvm/Support/CommandLine.h>
+#include <llvm/Support/JSON.h>
+#include <llvm/Support/raw_ostream.h>
+
+namespace fs = std::filesystem;
+namespace lc = llvm::cl;
+
+static lc::OptionCategory toolOptions("Tool Options");
+static lc::opt<std::string> clOutputDir("o", lc::cat(toolOptions),
+  lc::desc("Output directory"), lc::value_desc("directory"), lc::Required);
+static lc::opt<unsigned> clNumTus("n", lc::cat(toolOptions),
+  lc::desc("Number of translation units"), lc::init(10));
+static lc::opt<unsigned> clNumFuncs("m", lc::cat(toolOptions),
+  lc::desc("Number of functions per translation unit"), lc::init(10));
+static lc::opt<unsigned> clDepth("d", lc::cat(toolOptions),
+  lc::desc("Nesting depth (of namespaces, classes, and blocks)"),
+  lc::init(3));
+static lc::opt<unsigned> clFanOut("t", lc::cat(toolOptions),
+  lc::desc("Template fan-out (i.e., distinct instantiations per function)"),
+  lc::init(2));
+static lc::opt<unsigned> clMacroDensity("k", lc::cat(toolOptions),
+  lc::desc("Number of macro uses per function"), lc::init(2));
+static lc::opt<std::string> clCompiler("compiler", lc::cat(toolOptions),
+  lc::desc("Compiler in the compilation database"), lc::init("c++"));
+
+// The header shared by all of the translation units.
+static const char commonHeader[] = R"(#pragma once
+
+#define CORPUS_ADD(x, y) ((x) + (y))
+#define CORPUS_TWICE(x) CORPUS_ADD(x, x)
+#define CORPUS_CLAMP(x, lo, hi) ((x) < (lo) ? (lo) : (x) > (hi) ? (hi) : (x))
+
+template <int N>
+struct Tag {
+	int value = N;
+	operator int() const {return value;}
+};
+
+template <class T>
+struct Holder {
+	T value{};
+	T get() const {return value;}
+	void set(T x) {value = x;}
+};
+
+template <class T>
+T combine(T a, T b) {
+	Holder<T> holder;
+	holder.set(b);
+	return a ? a : holder.get();
+}
+
+inline int corpus_target(int x) {
+	return x + 1;
+}
+)";
+
+// Write a file, returning zero on success.
+int writeFile(const fs::path& path, const std::string& text) {
+	std::error_code errCode;
+	llvm::raw_fd_ostream out(path.string(), errCode);
+	if (errCode) {
+		llvm::errs() << std::format("cannot open {} ({})\n", path.string(),
+		  errCode.message());
+		return 1;
+	}
+	out << text;
+	out.close();
+	if (out.has_error()) {
+		llvm::errs() << std::format("cannot write {} ({})\n", path.string(),
+		  out.error().message());
+		out.clear_error();
+		return 1;
+	}
+	return 0;
+}
+
+// Get the name of the type used for the i-th template instantiation (which
+// is either a single-keyword builtin type or a template-id such as Tag<0>,
+// so that it can be used in a functional cast).
+std::string getTypeName(unsigned i) {
+	static constexpr const char* builtinTypes[] = {
+		"int", "long", "short", "unsigned", "char", "double",
+	};
+	constexpr unsigned numBuiltinTypes = std::size(builtinTypes);
+	return i < numBuiltinTypes ? builtinTypes[i] :
+	  std::format("Tag<{}>", i - numBuiltinTypes);
+}
+
+std::string generateFunction(unsigned tu, unsigned func) {
+	std::string s;
+	std::string indent(1, '\t');
+	s += std::format("int f_{}_{}(int x) {{\n", tu, func);
+	s += std::format("{}int result = corpus_target(x);\n", indent);
+	if (func > 0) {
+		s += std::format("{}result += f_{}_{}(x - 1);\n", indent, tu,
+		  func - 1);
+	}
+	for (unsigned i = 0; i < clMacroDensity; ++i) {
+		switch (i % 3) {
+		case 0:
+			s += std::format("{}result = CORPUS_ADD(result, {});\n", indent, i);
+			break;
+		case 1:
+			s += std::format("{}result = CORPUS_TWICE(result);\n", indent);
+			break;
+		case 2:
+			s += std::format("{}result = CORPUS_CLAMP(result, -{}, {});\n",
+			  indent, 1000 + i, 1000 + i);
+			break;
+		}
+	}
+	for (unsigned i = 0; i < clFanOut; ++i) {
+		std::string type = getTypeName(i);
+		s += std::format("{}result += static_cast<int>(combine<{}>({}(), "
+		  "{}()));\n", indent, type, type, type);
+	}
+	for (unsigned i = 0; i < clDepth; ++i) {
+		s += std::format("{}for (int i{} = 0; i{} < x; ++i{}) {{\n", indent,
+		  i, i, i);
+		indent += '\t';
+		s += std::format("{}if (result > {}) {{\n", indent, 100 * (i + 1));
+		indent += '\t';
+		s += std::format("{}result -= i{};\n", indent, i);
+	}
+	for (unsigned i = 0; i < clDepth; ++i) {
+		indent.pop_back();
+		s += std::format("{}}}\n", indent);
+		indent.pop_back();
+		s += std::format("{}}}\n", indent);
+	}
+	s += "\treturn result;\n}\n\n";
+	return s;
+}
+
+std::string generateTu(unsigned tu) {
+	std::string s = "#include \"common.hpp\"\n\n";
+	for (unsigned i = 0; i < clDepth; ++i) {
+		s += std::format("namespace n{} {{\n", i);
+	}
+	s += "\n";
+	// Nested classes.
+	for (unsigned i = 0; i < clDepth; ++i) {
+		s += std::format("struct C{}_{} {{\n\tint m{} = {};\n", tu, i, i, i);
+	}
+	for (unsigned i = 0; i < clDepth; ++i) {s += "};\n";}
+	s += "\n";
+	for (unsigned func = 0; func < clNumFuncs; ++func) {
+		s += generateFunction(tu, func);
+	}
+	for (unsigned i = clDepth; i > 0; --i) {
+		s += std::format("}} // namespace n{}\n", i - 1);
+	}
+	return s;
+}
+
+int main(int argc, char** argv) {
+	lc::HideUnrelatedOptions(toolOptions);
+	lc::ParseCommandLineOptions(argc, argv);
+	std::error_code errCode;
+	fs::path outputDir = fs::absolute(fs::path(std::string(clOutputDir)),
+	  errCode);
+	fs::path includeDir = outputDir / "include";
+	fs::path sourceDir = outputDir / "src";
+	if (errCode || (fs::create_directories(includeDir, errCode), errCode) ||
+	  (fs::create_directories(sourceDir, errCode), errCode)) {
+		llvm::errs() << std::format("cannot create {} ({})\n",
+		  outputDir.string(), errCode.message());
+		return 1;
+	}
+	if (writeFile(includeDir / "common.hpp", commonHeader)) {return 1;}
+	std::string database;
+	llvm::raw_string_ostream databaseOut(database);
+	llvm::json::OStream json(databaseOut, 2);
+	json.arrayBegin();
+	for (unsigned tu = 0; tu < clNumTus; ++tu) {
+		fs::path sourceFile = sourceDir / std::format("tu_{}.cpp", tu);
+		if (writeFile(sourceFile, generateTu(tu))) {return 1;}
+		json.object([&]() {
+			json.attribute("directory", outputDir.string());
+			json.attribute("file", sourceFile.string());
+			json.attributeArray("arguments", [&]() {
+				for (std::string arg : {std::string(clCompiler),
+				  std::string("-std=c++20"), "-I" + includeDir.string(),
+				  std::string("-c"), sourceFile.string()}) {
+					json.value(arg);
+				}
+			});
+		});
+	}
+	json.arrayEnd();
+	databaseOut << '\n';
+	databaseOut.flush();
+	if (writeFile(outputDir / "compile_commands.json", database)) {return 1;}
+	return 0;
+}
@@ -0,0 +1,14 @@
+#include <clang/Analysis/CFG.h>
+#include "complexity.hpp"
+
+int cyclomaticComplexity(const clang::FunctionDecl& funcDecl,
+  clang::ASTContext& astContext) {
+	const auto cfg = clang::CFG::buildCFG(&funcDecl, funcDecl.getBody(),
+	  &astContext, clang::CFG::BuildOptions());
+	if (!cfg) {return -1;}
+	const int numNodes = cfg->size() - 2;
+	int numEdges = 0;
+	for (const auto* block : *cfg) {numEdges += block->succ_size();}
+	numEdges -= 2; // adjust for entry and exit blocks
+	return numEdges - numNodes + (2 * 1); // E - V + 2 * P
+}
@@ -0,0 +1,9 @@
+#pragma once
+
+#include <clang/AST/ASTContext.h>
+#include <clang/AST/Decl.h>
+
+// Compute the cyclomatic complexity of a function (from its CFG).
+// Returns -1 if the CFG cannot be built.
+int cyclomaticComplexity(const clang::FunctionDecl& funcDecl,
+  clang::ASTContext& astContext);
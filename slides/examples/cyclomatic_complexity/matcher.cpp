@@ -1,5 +1,6 @@
 #include <format>
-#include <clang/Analysis/CFG.h>
+#include <cal/perf_counters.hpp>
+#include <cal/time_trace.hpp>
 #include <clang/AST/ASTContext.h>
 #include <clang/ASTMatchers/ASTMatchers.h>
 #include <clang/ASTMatchers/ASTMatchFinder.h>
@@ -7,6 +8,7 @@
 #include <clang/Tooling/Tooling.h>
 #include <llvm/Support/CommandLine.h>
 #include <llvm/Support/raw_ostream.h>
+#include "complexity.hpp"
 
 namespace ct = clang::tooling;
 namespace cam = clang::ast_matchers;
@@ -16,33 +18,34 @@ static llvm::cl::opt<unsigned int> thresholdOption("t",
   llvm::cl::init(0), llvm::cl::desc("Set complexity threshold."),
   llvm::cl::cat(toolCategory));
 
-int cyclomaticComplexity(const clang::FunctionDecl& funcDecl,
-  clang::ASTContext& astContext) {
-	const auto cfg = clang::CFG::buildCFG(&funcDecl, funcDecl.getBody(),
-	  &astContext, clang::CFG::BuildOptions());
-	if (!cfg) {return -1;}
-	const int numNodes = cfg->size() - 2;
-	int numEdges = 0;
-	for (const auto* block : *cfg) {numEdges += block->succ_size();}
-	numEdges -= 2;
-	return numEdges - numNodes + (2 * 1);
-}
-
 struct MyMatchCallback : public cam::MatchFinder::MatchCallback {
 	using MatchResult = cam::MatchFinder::MatchResult;
 	void run(const MatchResult& result) override {
+		llvm::TimeTraceScope timeScope("MatchCallback");
 		const auto* function =
 		  result.Nodes.getNodeAs<clang::FunctionDecl>("f");
 		std::string s = function->getQualifiedNameAsString();
 		int complexity = cyclomaticComplexity(*function,
 		  *result.Context);
 		if (complexity >= 0 && complexity >= thresholdOption) {
+			cal::PerfScope perfScope("output");
 			llvm::outs() << std::format("{} {}\n", s, complexity);
 		}
 	}
 };
 
+// Creates the consumers of the match finder, which are measured by the
+// performance counters (if enabled).
+struct MyConsumerFactory {
+	cam::MatchFinder* matchFinder;
+	std::unique_ptr<clang::ASTConsumer> newASTConsumer() {
+		return cal::makePerfConsumer(matchFinder->newASTConsumer(), "match");
+	}
+};
+
 int main(int argc, char** argv) {
+	cal::addTimeTraceOptions(toolCategory);
+	cal::addPerfCountersOptions(toolCategory);
 	auto expectedOptionsParser = ct::CommonOptionsParser::create(argc,
 	const_cast<const char**>(argv), toolCategory);
 	if (!expectedOptionsParser) {
@@ -50,6 +53,7 @@ int main(int argc, char** argv) {
 		return 1;
 	}
 	ct::CommonOptionsParser& optionsParser = *expectedOptionsParser;
+	cal::TimeTrace timeTrace(argv[0]);
 	auto matcher =
 	  cam::functionDecl(cam::isExpansionInMainFile()).bind("f");
 	MyMatchCallback matchCallback;
@@ -57,8 +61,12 @@ int main(int argc, char** argv) {
 	matchFinder.addMatcher(matcher, &matchCallback);
 	ct::ClangTool tool(optionsParser.getCompilations(),
 	  optionsParser.getSourcePathList());
-	auto status =
-	  tool.run(ct::newFrontendActionFactory(&matchFinder).get());
+	MyConsumerFactory consumerFactory{&matchFinder};
+	auto factory = ct::newFrontendActionFactory(&consumerFactory);
+	cal::TracedToolAction tracedAction(factory.get());
+	int status = tool.run(&tracedAction);
+	cal::printPerfCounters(llvm::errs());
+	if (timeTrace.finish()) {status = 1;}
     if (status) {llvm::errs() << "error detected\n";}
 	return !status ? 0 : 1;
 }
@@ -0,0 +1,125 @@
+#include <string>
+#include <vector>
+#include <cal/sidecar.hpp>
+#include <clang/AST/ASTConsumer.h>
+#include <clang/AST/ASTContext.h>
+#include <clang/AST/RecursiveASTVisitor.h>
+#include <clang/Frontend/CompilerInstance.h>
+#include <clang/Frontend/FrontendPluginRegistry.h>
+#include <llvm/Support/JSON.h>
+#include <llvm/Support/raw_ostream.h>
+#include "complexity.hpp"
+
+// The cyclomatic complexity analysis as a Clang plugin, which runs after
+// the main action of a normal compilation (so the TU is only parsed once)
+// and writes a record for each function defined in the main file to a
+// sidecar file.  For example:
+//   clang++ -fplugin=./cyclomatic_complexity_plugin.so
+//     -fplugin-arg-cyclomatic-complexity-threshold=5 -c foo.cpp
+// writes foo.o.cyclomatic_complexity.jsonl.  The plugin arguments are:
+//   threshold=N  only record functions with a complexity of at least N
+//   out-dir=DIR  write the sidecar file in DIR
+
+namespace {
+
+struct PluginOptions {
+	unsigned threshold = 0;
+	std::string outputDir;
+};
+
+class ComplexityVisitor :
+  public clang::RecursiveASTVisitor<ComplexityVisitor> {
+public:
+	ComplexityVisitor(clang::ASTContext& astContext,
+	  const PluginOptions& options, llvm::raw_ostream& out) :
+	  astContext_(&astContext), options_(&options), out_(&out) {}
+	bool VisitFunctionDecl(clang::FunctionDecl* funcDecl) {
+		const clang::SourceManager& sourceManager =
+		  astContext_->getSourceManager();
+		if (!funcDecl->doesThisDeclarationHaveABody() ||
+		  sourceManager.getFileID(funcDecl->getLocation()) !=
+		  sourceManager.getMainFileID()) {
+			return true;
+		}
+		int complexity = cyclomaticComplexity(*funcDecl, *astContext_);
+		if (complexity < 0 ||
+		  static_cast<unsigned>(complexity) < options_->threshold) {
+			return true;
+		}
+		clang::SourceLocation loc = sourceManager.getSpellingLoc(
+		  funcDecl->getLocation());
+		llvm::json::OStream json(*out_);
+		json.object([&]() {
+			json.attribute("function", funcDecl->getQualifiedNameAsString());
+			json.attribute("complexity", complexity);
+			json.attribute("file", sourceManager.getFilename(loc));
+			json.attribute("line", sourceManager.getSpellingLineNumber(loc));
+		});
+		*out_ << '\n';
+		return true;
+	}
+	bool shouldVisitTemplateInstantiations() const {return true;}
+private:
+	clang::ASTContext* astContext_;
+	const PluginOptions* options_;
+	llvm::raw_ostream* out_;
+};
+
+class ComplexityConsumer : public clang::ASTConsumer {
+public:
+	ComplexityConsumer(clang::CompilerInstance& compilerInstance,
+	  const PluginOptions& options) :
+	  compilerInstance_(&compilerInstance), options_(options) {}
+	void HandleTranslationUnit(clang::ASTContext& astContext) final {
+		// The results for a TU that failed to compile are of no use.
+		if (compilerInstance_->getDiagnostics().hasErrorOccurred()) {return;}
+		std::string buffer;
+		llvm::raw_string_ostream out(buffer);
+		ComplexityVisitor visitor(astContext, options_, out);
+		visitor.TraverseDecl(astContext.getTranslationUnitDecl());
+		out.flush();
+		cal::writeSidecar(*compilerInstance_, cal::getSidecarPathName(
+		  *compilerInstance_, "cyclomatic_complexity", options_.outputDir),
+		  buffer);
+	}
+private:
+	clang::CompilerInstance* compilerInstance_;
+	PluginOptions options_;
+};
+
+class ComplexityPluginAction : public clang::PluginASTAction {
+protected:
+	std::unique_ptr<clang::ASTConsumer> CreateASTConsumer(
+	  clang::CompilerInstance& compilerInstance, llvm::StringRef) final {
+		return std::make_unique<ComplexityConsumer>(compilerInstance,
+		  options_);
+	}
+	bool ParseArgs(const clang::CompilerInstance& compilerInstance,
+	  const std::vector<std::string>& args) final {
+		clang::DiagnosticsEngine& diags = compilerInstance.getDiagnostics();
+		for (const auto& arg : args) {
+			std::string value;
+			if (cal::getPluginArg(arg, "threshold", value) &&
+			  !llvm::StringRef(value).getAsInteger(10, options_.threshold)) {
+				continue;
+			}
+			if (!cal::getPluginArg(arg, "out-dir", options_.outputDir)) {
+				diags.Report(diags.getCustomDiagID(
+				  clang::DiagnosticsEngine::Error,
+				  "invalid argument '%0' for cyclomatic-complexity plugin"))
+				  << arg;
+				return false;
+			}
+		}
+		return true;
+	}
+	ActionType getActionType() final {return AddAfterMainAction;}
+private:
+	PluginOptions options_;
+};
+
+}
+
+static clang::FrontendPluginRegistry::Add<ComplexityPluginAction>
+  registration("cyclomatic-complexity",
+  "Write the cyclomatic complexity of each function to a sidecar file");
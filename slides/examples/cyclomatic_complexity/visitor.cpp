@@ -1,5 +1,6 @@
 #include <format>
-#include <clang/Analysis/CFG.h>
+#include <cal/perf_counters.hpp>
+#include <cal/time_trace.hpp>
 #include <clang/AST/ASTConsumer.h>
 #include <clang/AST/ASTContext.h>
 #include <clang/AST/RecursiveASTVisitor.h>
@@ -10,6 +11,7 @@
 #include <llvm/ADT/StringRef.h>
 #include <llvm/Support/CommandLine.h>
 #include <llvm/Support/raw_ostream.h>
+#include "complexity.hpp"
 
 namespace ct = clang::tooling;
 
@@ -18,18 +20,6 @@ static llvm::cl::opt<unsigned int> thresholdOption("t",
   llvm::cl::init(0), llvm::cl::desc("Set complexity threshold."),
   llvm::cl::cat(toolCategory));
 
-int cyclomaticComplexity(const clang::FunctionDecl& funcDecl,
-  clang::ASTContext& astContext) {
-	const auto cfg = clang::CFG::buildCFG(&funcDecl, funcDecl.getBody(),
-	  &astContext, clang::CFG::BuildOptions());
-	if (!cfg) {return -1;}
-	const int numNodes = cfg->size() - 2;
-	int numEdges = 0;
-	for (const auto* block : *cfg) {numEdges += block->succ_size();}
-	numEdges -= 2; // adjust for entry and exit blocks
-	return numEdges - numNodes + (2 * 1); // E - V + 2 * P
-}
-
 class MyAstVisitor : public clang::RecursiveASTVisitor<MyAstVisitor> {
 public:
 	MyAstVisitor(clang::ASTContext& astContext) : astContext_(&astContext) {}
@@ -41,6 +31,7 @@ public:
 			int complexity = cyclomaticComplexity(*funcDecl,
 			  *astContext_);
 			if (complexity >= 0 && complexity >= thresholdOption) {
+				cal::PerfScope perfScope("output");
 				llvm::outs() << std::format("{} {}\n", s, complexity);
 			}
 		}
@@ -53,6 +44,7 @@ private:
 
 struct MyAstConsumer : public clang::ASTConsumer {
 	void HandleTranslationUnit(clang::ASTContext& astContext) final {
+		llvm::TimeTraceScope timeScope("HandleTranslationUnit");
 		clang::TranslationUnitDecl* tuDecl =
 		  astContext.getTranslationUnitDecl();
 		MyAstVisitor astVisitor(astContext);
@@ -63,11 +55,14 @@ struct MyAstConsumer : public clang::ASTConsumer {
 struct MyFrontendAction : public clang::ASTFrontendAction {
 	std::unique_ptr<clang::ASTConsumer> CreateASTConsumer(
 	  clang::CompilerInstance& compilerInstance, llvm::StringRef) override {
-		return std::make_unique<MyAstConsumer>();
+		return cal::makePerfConsumer(std::make_unique<MyAstConsumer>(),
+		  "traverse");
 	}
 };
 
 int main(int argc, char** argv) {
+	cal::addTimeTraceOptions(toolCategory);
+	cal::addPerfCountersOptions(toolCategory);
 	auto expectedOptionsParser = ct::CommonOptionsParser::create(argc,
 	const_cast<const char**>(argv), toolCategory);
 	if (!expectedOptionsParser) {
@@ -75,10 +70,14 @@ int main(int argc, char** argv) {
 		return 1;
 	}
 	ct::CommonOptionsParser& optionsParser = *expectedOptionsParser;
+	cal::TimeTrace timeTrace(argv[0]);
 	ct::ClangTool tool(optionsParser.getCompilations(),
 	optionsParser.getSourcePathList());
-	auto status =
-	  tool.run(ct::newFrontendActionFactory<MyFrontendAction>().get());
+	auto factory = ct::newFrontendActionFactory<MyFrontendAction>();
+	cal::TracedToolAction tracedAction(factory.get());
+	int status = tool.run(&tracedAction);
+	cal::printPerfCounters(llvm::errs());
+	if (timeTrace.finish()) {status = 1;}
     if (status) {llvm::errs() << "error detected\n";}
 	return !status ? 0 : 1;
 }
@@ -1,6 +1,9 @@
 #include <format>
-#include <map>
 #include <string>
+#include <string_view>
+#include <cal/enum_names.hpp>
+#include <cal/modules.hpp>
+#include <cal/time_trace.hpp>
 #include <clang/Basic/Diagnostic.h>
 #include <clang/Basic/SourceLocation.h>
 #include <clang/Basic/SourceManager.h>
@@ -20,13 +23,14 @@ std::string locationToString(const clang::SourceManager& sourceManager,
 	  sourceManager.getSpellingColumnNumber(sourceLoc));
 }
 
-std::string levelToString(clang::DiagnosticsEngine::Level level) {
-	const std::map<clang::DiagnosticsEngine::Level, std::string> lut{
-	  {clang::DiagnosticsEngine::Level::Error, "error"},
-	  {clang::DiagnosticsEngine::Level::Fatal, "fatal error"},
-	};
-	auto i = lut.find(level);
-	return i != lut.end() ? i->second : "unknown";
+std::string_view levelToString(clang::DiagnosticsEngine::Level level) {
+	using Level = clang::DiagnosticsEngine::Level;
+	// Only errors are reported, so the other levels are unknown.
+	static constexpr auto lut = cal::makeEnumNames<Level>({
+	  {Level::Error, "error"},
+	  {Level::Fatal, "fatal error"},
+	});
+	return lut(level);
 }
 
 class MyDiagnosticConsumer : public clang::DiagnosticConsumer {
@@ -56,6 +60,8 @@ private:
 static llvm::cl::OptionCategory toolOptions("Tool Options");
 
 int main(int argc, char** argv) {
+	cal::addTimeTraceOptions(toolOptions);
+	cal::addModulesOptions(toolOptions);
 	auto expectedOptionsParser = ct::CommonOptionsParser::create(argc,
 	  const_cast<const char**>(argv), toolOptions);
 	if (!expectedOptionsParser) {
@@ -63,12 +69,20 @@ int main(int argc, char** argv) {
 		return 1;
 	}
 	ct::CommonOptionsParser& optionsParser = *expectedOptionsParser;
+	cal::TimeTrace timeTrace(argv[0]);
+	if (cal::prepareModules()) {return 1;}
 	ct::ClangTool tool(optionsParser.getCompilations(),
 	  optionsParser.getSourcePathList());
+	tool.appendArgumentsAdjuster(cal::getModulesArgumentsAdjuster());
 	MyDiagnosticConsumer diagnosticConsumer;
 	tool.setDiagnosticConsumer(&diagnosticConsumer);
-	int status = tool.run(
-	  ct::newFrontendActionFactory<clang::SyntaxOnlyAction>().get());
+	auto factory = ct::newFrontendActionFactory<clang::SyntaxOnlyAction>();
+	cal::ParseTimes parseTimes;
+	cal::TimedToolAction timedAction(factory.get(), parseTimes);
+	cal::TracedToolAction tracedAction(&timedAction);
+	int status = tool.run(&tracedAction);
+	if (parseTimes.finish(llvm::errs())) {status = 1;}
+	if (timeTrace.finish()) {status = 1;}
 	unsigned long errCount = diagnosticConsumer.getErrCount();
 	if (errCount) {
 		llvm::errs() << std::format("{} error(s) occurred\n", errCount);
@@ -1,5 +1,6 @@
 #include <format>
 #include <string>
+#include <cal/time_trace.hpp>
 #include <clang/Analysis/CFG.h>
 #include <clang/ASTMatchers/ASTMatchers.h>
 #include <clang/ASTMatchers/ASTMatchFinder.h>
@@ -23,6 +24,7 @@ cam::DeclarationMatcher getFuncMatcher(const std::string& namePattern)
 
 struct MyMatchCallback : public cam::MatchFinder::MatchCallback {
 	virtual void run(const cam::MatchFinder::MatchResult& result) final {
+		llvm::TimeTraceScope timeScope("MatchCallback");
 		if (const auto* funcDecl =
 		  result.Nodes.getNodeAs<clang::FunctionDecl>("func")) {
 			clang::ASTContext *astContext = result.Context;
@@ -43,6 +45,7 @@ struct MyMatchCallback : public cam::MatchFinder::MatchCallback {
 };
 
 int main(int argc, const char **argv) {
+	cal::addTimeTraceOptions(toolCategory);
 	llvm::Expected<ct::CommonOptionsParser> expOptionsParser =
 	ct::CommonOptionsParser::create(argc, argv, toolCategory);
 	if (!expOptionsParser) {
@@ -50,13 +53,17 @@ int main(int argc, const char **argv) {
 		return 1;
 	}
 	ct::CommonOptionsParser& optionsParser = *expOptionsParser;
+	cal::TimeTrace timeTrace(argv[0]);
 	ct::ClangTool tool(optionsParser.getCompilations(),
 	  optionsParser.getSourcePathList());
 	cam::DeclarationMatcher funcMatcher = getFuncMatcher(clFuncNamePattern);
 	MyMatchCallback matchCallback;
 	cam::MatchFinder finder;
 	finder.addMatcher(funcMatcher, &matchCallback);
-	int status = tool.run(ct::newFrontendActionFactory(&finder).get());
+	auto factory = ct::newFrontendActionFactory(&finder);
+	cal::TracedToolAction tracedAction(factory.get());
+	int status = tool.run(&tracedAction);
+	if (timeTrace.finish()) {status = 1;}
 	if (status) {llvm::errs() << "error occurred\n";}
 	return !status ? 0 : 1;
 }
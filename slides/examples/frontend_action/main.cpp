@@ -1,3 +1,7 @@
+#include <cal/lookup_cache.hpp>
+#include <cal/startup_profile.hpp>
+#include <cal/time_trace.hpp>
+#include <cal/tool_options.hpp>
 #include <clang/Frontend/FrontendAction.h>
 #include <clang/Frontend/FrontendActions.h>
 #include <clang/Tooling/CommonOptionsParser.h>
@@ -9,17 +13,30 @@ namespace ct = clang::tooling;
 static llvm::cl::OptionCategory toolOptions("Tool Options");
 
 int main(int argc, char** argv) {
-	auto expectedOptionsParser = ct::CommonOptionsParser::create(argc,
+	cal::markStartupMain();
+	cal::addTimeTraceOptions(toolOptions);
+	cal::addStartupProfileOptions(toolOptions);
+	cal::addLookupCacheOptions(toolOptions);
+	auto expectedOptionsParser = cal::ToolOptionsParser::create(argc,
 	  const_cast<const char**>(argv), toolOptions);
 	if (!expectedOptionsParser) {
 		llvm::errs() << llvm::toString(expectedOptionsParser.takeError());
 		return 1;
 	}
-	ct::CommonOptionsParser& optionsParser = *expectedOptionsParser;
+	cal::ToolOptionsParser& optionsParser = *expectedOptionsParser;
+	cal::TimeTrace timeTrace(argv[0]);
+	// The failed lookups in the header search (which are the same for each
+	// TU) can be answered from a cache.
+	auto fileSystem = cal::createLookupCacheFileSystem();
 	ct::ClangTool tool(optionsParser.getCompilations(),
-	  optionsParser.getSourcePathList());
-	int status = tool.run(
-	  ct::newFrontendActionFactory<clang::SyntaxOnlyAction>().get());
+	  optionsParser.getSourcePathList(),
+	  std::make_shared<clang::PCHContainerOperations>(), fileSystem);
+	auto factory = ct::newFrontendActionFactory<clang::SyntaxOnlyAction>();
+	cal::TracedToolAction tracedAction(factory.get());
+	int status = tool.run(&tracedAction);
+	cal::printStartupProfile(llvm::errs());
+	if (cal::finishLookupCache(*fileSystem, llvm::errs())) {status = 1;}
+	if (timeTrace.finish()) {status = 1;}
 	if (status) {llvm::errs() << "error detected\n";}
 	return !status ? 0 : 1;
 }
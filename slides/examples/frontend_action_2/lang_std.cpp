@@ -0,0 +1,45 @@
+#include <string>
+#include <string_view>
+#include <cal/enum_names.hpp>
+#include "lang_std.hpp"
+
+std::string langKindToNameString(clang::LangStandard::Kind kind) {
+	return clang::LangStandard::getLangStandardForKind(kind).getName();
+}
+
+std::string_view langKindToLangString(clang::LangStandard::Kind kind) {
+	clang::Language language =
+	  clang::LangStandard::getLangStandardForKind(kind).getLanguage();
+	// Only C and C++ are named.
+	static constexpr auto lut = cal::makeEnumNames<clang::Language>({
+		{clang::Language::CXX, "C++"},
+		{clang::Language::C, "C"},
+	});
+	static_assert(lut.covers(clang::Language::C, clang::Language::CXX));
+	return lut(language);
+}
+
+std::string langKindToStdString(clang::LangStandard::Kind kind) {
+	clang::LangStandard langStd =
+	  clang::LangStandard::getLangStandardForKind(kind);
+	clang::Language language = langStd.getLanguage();
+	if (language == clang::Language::CXX) {
+		if (langStd.isCPlusPlus() && !langStd.isCPlusPlus11())
+		  {return "C++98";}
+		else if (langStd.isCPlusPlus11() && !langStd.isCPlusPlus14())
+		  {return "C++11";}
+		else if (langStd.isCPlusPlus14() && !langStd.isCPlusPlus17())
+		  {return "C++14";}
+		else if (langStd.isCPlusPlus17() && !langStd.isCPlusPlus20())
+		  {return "C++17";}
+		else if (langStd.isCPlusPlus20()) {return "C++20-or-later";}
+		else {return "pre-C++98";}
+	} else if (language == clang::Language::C) {
+		if (langStd.isC99() && !langStd.isC11()) {return "C99";}
+		else if (langStd.isC11() && !langStd.isC17()) {return "C11";}
+		else if (langStd.isC17()) {return "C17-or-later";}
+		else {return "pre-C99";}
+	} else {
+		return "unknown";
+	}
+}
@@ -0,0 +1,17 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <clang/Basic/LangStandard.h>
+
+// The names used to report the language standard of a TU.
+
+// Get the name of the standard as used by -std (e.g., gnu++17).
+std::string langKindToNameString(clang::LangStandard::Kind kind);
+
+// Get the name of the language (i.e., C or C++), or "unknown" for any other
+// language.
+std::string_view langKindToLangString(clang::LangStandard::Kind kind);
+
+// Get the name of the version of the language (e.g., C++17).
+std::string langKindToStdString(clang::LangStandard::Kind kind);
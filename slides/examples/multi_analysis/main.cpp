@@ -0,0 +1,444 @@
+#include <algorithm>
+#include <chrono>
+#include <format>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cal/enum_names.hpp>
+#include <cal/time_trace.hpp>
+#include <clang/AST/ASTConsumer.h>
+#include <clang/AST/ASTContext.h>
+#include <clang/AST/Mangle.h>
+#include <clang/ASTMatchers/ASTMatchers.h>
+#include <clang/ASTMatchers/ASTMatchFinder.h>
+#include <clang/Frontend/CompilerInstance.h>
+#include <clang/Frontend/FrontendAction.h>
+#include <clang/Frontend/MultiplexConsumer.h>
+#include <clang/Tooling/CommonOptionsParser.h>
+#include <clang/Tooling/Tooling.h>
+#include <llvm/ADT/SmallString.h>
+#include <llvm/Support/CommandLine.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/JSON.h>
+#include <llvm/Support/Path.h>
+#include <llvm/Support/raw_ostream.h>
+#include "attr_collector.hpp"
+#include "casts.hpp"
+#include "complexity.hpp"
+#include "lang_std.hpp"
+
+// Run several of the example analyses (i.e., cyclomatic complexity, the
+// cast census, the attribute listing, the mangled-name inventory, and the
+// language-standard report) with a single parse of each TU.  The consumer
+// for each selected analysis is combined with the others in a
+// MultiplexConsumer, and the records for each analysis are written (as
+// JSON Lines) to a separate file.  The time spent in each analysis is
+// measured separately from the time spent parsing (i.e., building the
+// AST), so that the cost of each analysis in the combined run is known.
+
+namespace ct = clang::tooling;
+namespace cam = clang::ast_matchers;
+namespace lc = llvm::cl;
+
+enum class AnalysisId {
+	Cc,
+	Casts,
+	Attrs,
+	Mangle,
+	LangStd,
+};
+
+std::string_view analysisIdToName(AnalysisId id) {
+	static constexpr auto lut = cal::makeEnumNames<AnalysisId>({
+		{AnalysisId::Cc, "cc"},
+		{AnalysisId::Casts, "casts"},
+		{AnalysisId::Attrs, "attrs"},
+		{AnalysisId::Mangle, "mangle"},
+		{AnalysisId::LangStd, "langstd"},
+	}, "");
+	static_assert(lut.covers(AnalysisId::Cc, AnalysisId::LangStd));
+	return lut(id);
+}
+
+static lc::OptionCategory optionCategory("Tool options");
+static lc::list<AnalysisId> clAnalyses("analyses",
+  lc::desc("The analyses to run (by default, all of them)"),
+  lc::values(
+    clEnumValN(AnalysisId::Cc, "cc", "cyclomatic complexity"),
+    clEnumValN(AnalysisId::Casts, "casts", "explicit casts"),
+    clEnumValN(AnalysisId::Attrs, "attrs", "attribute uses"),
+    clEnumValN(AnalysisId::Mangle, "mangle", "mangled names"),
+    clEnumValN(AnalysisId::LangStd, "langstd", "language standard")
+  ),
+  lc::CommaSeparated, lc::cat(optionCategory));
+static lc::opt<std::string> clOutputDir("output-dir",
+  lc::desc("The directory for the output files (i.e., <analysis>.jsonl)"),
+  lc::value_desc("dir"), lc::init("."), lc::cat(optionCategory));
+
+/****************************************************************************\
+* Analyses
+\****************************************************************************/
+
+// One analysis, which is run on each TU and writes its records to its own
+// output file.
+class Analysis {
+public:
+	Analysis(AnalysisId id) : id_(id) {}
+	Analysis(const Analysis&) = delete;
+	Analysis& operator=(const Analysis&) = delete;
+	virtual ~Analysis() = default;
+	std::string_view getName() const {return analysisIdToName(id_);}
+	// Called when a TU is about to be parsed.
+	virtual void beginSourceFile(clang::CompilerInstance&, llvm::StringRef)
+	  {}
+	// Called with the AST of a TU.
+	virtual void analyze(clang::ASTContext& astContext) = 0;
+	int open(const std::string& dir);
+	int close();
+	std::chrono::nanoseconds elapsed{0};
+	std::size_t numRecords = 0;
+protected:
+	// Write one record (as a JSON object) to the output file.
+	template <class F> void writeRecord(F writeAttributes) {
+		llvm::json::OStream json(*out_);
+		json.object([&]() {writeAttributes(json);});
+		*out_ << '\n';
+		++numRecords;
+	}
+private:
+	AnalysisId id_;
+	std::string pathName_;
+	std::unique_ptr<llvm::raw_fd_ostream> out_;
+};
+
+int Analysis::open(const std::string& dir) {
+	llvm::SmallString<256> pathName(dir);
+	llvm::sys::path::append(pathName, std::format("{}.jsonl", getName()));
+	pathName_ = std::string(pathName);
+	std::error_code errCode;
+	out_ = std::make_unique<llvm::raw_fd_ostream>(pathName_, errCode);
+	if (errCode) {
+		llvm::errs() << std::format("cannot open {} ({})\n", pathName_,
+		  errCode.message());
+		return 1;
+	}
+	return 0;
+}
+
+int Analysis::close() {
+	out_->close();
+	if (out_->has_error()) {
+		llvm::errs() << std::format("cannot write {} ({})\n", pathName_,
+		  out_->error().message());
+		out_->clear_error();
+		return 1;
+	}
+	return 0;
+}
+
+// An analysis that uses its own MatchFinder (so that its matching time is
+// measured separately).
+class MatcherAnalysis : public Analysis,
+  public cam::MatchFinder::MatchCallback {
+public:
+	MatcherAnalysis(AnalysisId id) : Analysis(id) {}
+	void analyze(clang::ASTContext& astContext) override
+	  {matchFinder_.matchAST(astContext);}
+protected:
+	cam::MatchFinder matchFinder_;
+};
+
+class CcAnalysis : public MatcherAnalysis {
+public:
+	CcAnalysis() : MatcherAnalysis(AnalysisId::Cc) {
+		matchFinder_.addMatcher(cam::functionDecl(cam::isExpansionInMainFile(),
+		  cam::isDefinition()).bind("f"), this);
+	}
+	void run(const cam::MatchFinder::MatchResult& result) override {
+		const auto* funcDecl =
+		  result.Nodes.getNodeAs<clang::FunctionDecl>("f");
+		int complexity = cyclomaticComplexity(*funcDecl, *result.Context);
+		if (complexity < 0) {return;}
+		const clang::SourceManager& sourceManager = *result.SourceManager;
+		clang::SourceLocation loc = sourceManager.getSpellingLoc(
+		  funcDecl->getLocation());
+		writeRecord([&](llvm::json::OStream& json) {
+			json.attribute("function", funcDecl->getQualifiedNameAsString());
+			json.attribute("complexity", complexity);
+			json.attribute("file", sourceManager.getFilename(loc));
+			json.attribute("line", sourceManager.getSpellingLineNumber(loc));
+		});
+	}
+};
+
+class CastsAnalysis : public MatcherAnalysis {
+public:
+	CastsAnalysis() : MatcherAnalysis(AnalysisId::Casts) {
+		matchFinder_.addMatcher(getCastMatcher(false), this);
+	}
+	void run(const cam::MatchFinder::MatchResult& result) override {
+		auto castExpr =
+		  result.Nodes.getNodeAs<clang::ExplicitCastExpr>("c");
+		clang::PrintingPolicy pp(result.Context->getLangOpts());
+		pp.PrintCanonicalTypes = 1;
+		writeRecord([&](llvm::json::OStream& json) {
+			json.attribute("cast", llvm::StringRef(getCastName(castExpr)));
+			json.attribute("from",
+			  castExpr->getSubExpr()->getType().getAsString(pp));
+			json.attribute("to", castExpr->getType().getAsString(pp));
+			json.attribute("location", locationToString(
+			  *result.SourceManager, castExpr->getExprLoc()));
+		});
+	}
+};
+
+class AttrsAnalysis : public Analysis {
+public:
+	AttrsAnalysis() : Analysis(AnalysisId::Attrs) {
+		matchCallback_.addMatchers(matchFinder_);
+	}
+	void analyze(clang::ASTContext& astContext) override {
+		matchFinder_.matchAST(astContext);
+		std::vector<AttrRecord>& records = matchCallback_.getRecords();
+		for (const auto& record : records) {
+			writeRecord([&](llvm::json::OStream& json) {
+				json.attribute("kind", record.kind);
+				json.attribute("syntax", record.syntax);
+				json.attribute("usr", record.usr);
+				json.attribute("file", record.file);
+				json.attribute("line", record.line);
+				json.attribute("column", record.column);
+			});
+		}
+		records.clear();
+	}
+private:
+	IndexMatchCallback matchCallback_;
+	cam::MatchFinder matchFinder_;
+};
+
+// Unlike the mangle_1 tool, only the mangled names of the functions and
+// variables defined in the main file are listed.
+class MangleAnalysis : public MatcherAnalysis {
+public:
+	MangleAnalysis() : MatcherAnalysis(AnalysisId::Mangle) {
+		using namespace cam;
+		matchFinder_.addMatcher(functionDecl(isExpansionInMainFile(),
+		  isDefinition()).bind("d"), this);
+		matchFinder_.addMatcher(varDecl(isExpansionInMainFile(),
+		  isDefinition(), hasGlobalStorage()).bind("d"), this);
+	}
+	void analyze(clang::ASTContext& astContext) override {
+		mangleContext_.reset(astContext.createMangleContext());
+		MatcherAnalysis::analyze(astContext);
+		mangleContext_.reset();
+	}
+	void run(const cam::MatchFinder::MatchResult& result) override {
+		const auto* decl = result.Nodes.getNodeAs<clang::NamedDecl>("d");
+		if (decl->getDeclContext()->isDependentContext() ||
+		  !mangleContext_->shouldMangleDeclName(decl)) {
+			return;
+		}
+		clang::GlobalDecl globalDecl;
+		if (auto ctorDecl = llvm::dyn_cast<clang::CXXConstructorDecl>(decl)) {
+			globalDecl = clang::GlobalDecl(ctorDecl,
+			  clang::CXXCtorType::Ctor_Complete);
+		} else if (auto dtorDecl =
+		  llvm::dyn_cast<clang::CXXDestructorDecl>(decl)) {
+			globalDecl = clang::GlobalDecl(dtorDecl,
+			  clang::CXXDtorType::Dtor_Complete);
+		} else if (auto funcDecl = llvm::dyn_cast<clang::FunctionDecl>(decl)) {
+			if (funcDecl->isDependentContext()) {return;}
+			globalDecl = clang::GlobalDecl(funcDecl);
+		} else {
+			globalDecl = clang::GlobalDecl(llvm::cast<clang::VarDecl>(decl));
+		}
+		std::string mangledName;
+		llvm::raw_string_ostream mangledOut(mangledName);
+		mangleContext_->mangleName(globalDecl, mangledOut);
+		mangledOut.flush();
+		writeRecord([&](llvm::json::OStream& json) {
+			json.attribute("kind", llvm::isa<clang::FunctionDecl>(decl) ?
+			  "function" : "variable");
+			json.attribute("name", decl->getQualifiedNameAsString());
+			json.attribute("mangledName", mangledName);
+			json.attribute("location", locationToString(
+			  *result.SourceManager, decl->getLocation()));
+		});
+	}
+private:
+	std::unique_ptr<clang::MangleContext> mangleContext_;
+};
+
+// The language standard is known before the TU is parsed, so there is no
+// work to do with the AST.
+class LangStdAnalysis : public Analysis {
+public:
+	LangStdAnalysis() : Analysis(AnalysisId::LangStd) {}
+	void beginSourceFile(clang::CompilerInstance& compInstance,
+	  llvm::StringRef inFile) override {
+		clang::LangStandard::Kind kind = compInstance.getLangOpts().LangStd;
+		writeRecord([&](llvm::json::OStream& json) {
+			json.attribute("file", inFile);
+			json.attribute("language",
+			  llvm::StringRef(langKindToLangString(kind)));
+			json.attribute("standard", langKindToStdString(kind));
+			json.attribute("name", langKindToNameString(kind));
+		});
+	}
+	void analyze(clang::ASTContext&) override {}
+};
+
+std::unique_ptr<Analysis> makeAnalysis(AnalysisId id) {
+	switch (id) {
+	case AnalysisId::Cc:
+		return std::make_unique<CcAnalysis>();
+	case AnalysisId::Casts:
+		return std::make_unique<CastsAnalysis>();
+	case AnalysisId::Attrs:
+		return std::make_unique<AttrsAnalysis>();
+	case AnalysisId::Mangle:
+		return std::make_unique<MangleAnalysis>();
+	case AnalysisId::LangStd:
+	default:
+		return std::make_unique<LangStdAnalysis>();
+	}
+}
+
+/****************************************************************************\
+* Frontend Action
+\****************************************************************************/
+
+// The consumer for one analysis, which times the analysis.
+class AnalysisConsumer : public clang::ASTConsumer {
+public:
+	AnalysisConsumer(Analysis& analysis) : analysis_(&analysis) {}
+	void HandleTranslationUnit(clang::ASTContext& astContext) override {
+		llvm::TimeTraceScope timeScope("Analysis", analysis_->getName());
+		auto startTime = std::chrono::steady_clock::now();
+		analysis_->analyze(astContext);
+		analysis_->elapsed += std::chrono::steady_clock::now() - startTime;
+	}
+private:
+	Analysis* analysis_;
+};
+
+// The time spent in each TU (i.e., parsing and all of the analyses).
+static std::chrono::nanoseconds totalTime{0};
+
+class MultiAnalysisAction : public clang::ASTFrontendAction {
+public:
+	MultiAnalysisAction(const std::vector<std::unique_ptr<Analysis>>&
+	  analyses) : analyses_(&analyses) {}
+	bool BeginSourceFileAction(clang::CompilerInstance&) override {
+		startTime_ = std::chrono::steady_clock::now();
+		return true;
+	}
+	void EndSourceFileAction() override {
+		totalTime += std::chrono::steady_clock::now() - startTime_;
+	}
+	std::unique_ptr<clang::ASTConsumer> CreateASTConsumer(
+	  clang::CompilerInstance& compInstance, llvm::StringRef inFile)
+	  override {
+		std::vector<std::unique_ptr<clang::ASTConsumer>> consumers;
+		for (const auto& analysis : *analyses_) {
+			auto startTime = std::chrono::steady_clock::now();
+			analysis->beginSourceFile(compInstance, inFile);
+			analysis->elapsed += std::chrono::steady_clock::now() -
+			  startTime;
+			consumers.push_back(std::make_unique<AnalysisConsumer>(
+			  *analysis));
+		}
+		return std::make_unique<clang::MultiplexConsumer>(
+		  std::move(consumers));
+	}
+private:
+	const std::vector<std::unique_ptr<Analysis>>* analyses_;
+	std::chrono::steady_clock::time_point startTime_;
+};
+
+class MultiAnalysisActionFactory : public ct::FrontendActionFactory {
+public:
+	MultiAnalysisActionFactory(const std::vector<std::unique_ptr<Analysis>>&
+	  analyses) : analyses_(&analyses) {}
+	std::unique_ptr<clang::FrontendAction> create() override
+	  {return std::make_unique<MultiAnalysisAction>(*analyses_);}
+private:
+	const std::vector<std::unique_ptr<Analysis>>* analyses_;
+};
+
+/****************************************************************************\
+* Main
+\****************************************************************************/
+
+static double toSeconds(std::chrono::nanoseconds t) {
+	return std::chrono::duration<double>(t).count();
+}
+
+// Print the time attributed to parsing and to each analysis.
+static void printTimes(const std::vector<std::unique_ptr<Analysis>>&
+  analyses) {
+	std::chrono::nanoseconds analysisTime{0};
+	for (const auto& analysis : analyses) {analysisTime += analysis->elapsed;}
+	double total = toSeconds(totalTime);
+	auto printRow = [&](std::string_view name, std::chrono::nanoseconds t,
+	  std::string records) {
+		llvm::errs() << std::format("{:<10} {:>10.3f} {:>6.1f}% {:>8}\n",
+		  name, toSeconds(t), total > 0 ? 100 * toSeconds(t) / total : 0.0,
+		  records);
+	};
+	llvm::errs() << std::format("{:<10} {:>10} {:>7} {:>8}\n", "phase",
+	  "time (s)", "share", "records");
+	printRow("parse", totalTime - analysisTime, "");
+	for (const auto& analysis : analyses) {
+		printRow(analysis->getName(), analysis->elapsed,
+		  std::to_string(analysis->numRecords));
+	}
+	printRow("total", totalTime, "");
+}
+
+int main(int argc, const char** argv) {
+	cal::addTimeTraceOptions(optionCategory);
+	auto optParser = ct::CommonOptionsParser::create(argc, argv,
+	  optionCategory);
+	if (!optParser) {
+		llvm::errs() << llvm::toString(optParser.takeError());
+		return 1;
+	}
+	cal::TimeTrace timeTrace(argv[0]);
+
+	std::vector<AnalysisId> ids(clAnalyses.begin(), clAnalyses.end());
+	if (ids.empty()) {
+		ids = {AnalysisId::Cc, AnalysisId::Casts, AnalysisId::Attrs,
+		  AnalysisId::Mangle, AnalysisId::LangStd};
+	}
+	if (std::error_code errCode =
+	  llvm::sys::fs::create_directories(clOutputDir)) {
+		llvm::errs() << std::format("cannot create directory {} ({})\n",
+		  std::string(clOutputDir), errCode.message());
+		return 1;
+	}
+	std::vector<std::unique_ptr<Analysis>> analyses;
+	for (auto id : ids) {
+		// Ignore an analysis that is selected more than once.
+		if (std::find_if(analyses.begin(), analyses.end(), [&](auto& a) {
+		  return a->getName() == analysisIdToName(id);}) != analyses.end()) {
+			continue;
+		}
+		analyses.push_back(makeAnalysis(id));
+		if (analyses.back()->open(clOutputDir)) {return 1;}
+	}
+
+	ct::ClangTool tool(optParser->getCompilations(),
+	  optParser->getSourcePathList());
+	MultiAnalysisActionFactory factory(analyses);
+	cal::TracedToolAction tracedAction(&factory);
+	int status = tool.run(&tracedAction);
+	for (const auto& analysis : analyses) {
+		if (analysis->close()) {status = 1;}
+	}
+	printTimes(analyses);
+	if (timeTrace.finish()) {status = 1;}
+	return !status ? 0 : 1;
+}
@@ -0,0 +1,26 @@
+// A translation unit with many large std::tuple instantiations (for
+// measuring the cost of printing the template arguments).
+
+#include <tuple>
+
+template<int N> struct T {};
+
+#define E10(x) T<x##0>, T<x##1>, T<x##2>, T<x##3>, T<x##4>, \
+  T<x##5>, T<x##6>, T<x##7>, T<x##8>, T<x##9>
+#define E50(x) E10(x##0), E10(x##1), E10(x##2), E10(x##3), E10(x##4)
+
+#define VARS(n) \
+  std::tuple<E50(1)> a_##n; \
+  std::tuple<E50(2)> b_##n; \
+  std::tuple<E50(3), E50(4)> c_##n; \
+  std::tuple<E50(1), E50(2), E50(3)> d_##n;
+#define VARS10(n) VARS(n##0) VARS(n##1) VARS(n##2) VARS(n##3) VARS(n##4) \
+  VARS(n##5) VARS(n##6) VARS(n##7) VARS(n##8) VARS(n##9)
+
+VARS10(1)
+VARS10(2)
+VARS10(3)
+VARS10(4)
+VARS10(5)
+
+int main() {}
@@ -1,18 +1,33 @@
 #include <cassert>
+#include <chrono>
 #include <format>
 #include <string>
 #include <string_view>
 #include <vector>
+#include <cal/time_trace.hpp>
 #include <clang/ASTMatchers/ASTMatchers.h>
 #include <clang/ASTMatchers/ASTMatchFinder.h>
 #include <clang/Frontend/FrontendActions.h>
 #include <clang/Tooling/CommonOptionsParser.h>
 #include <clang/Tooling/Tooling.h>
+#include <llvm/ADT/DenseMap.h>
+#include <llvm/ADT/SmallString.h>
+#include <llvm/Support/Allocator.h>
 #include <llvm/Support/CommandLine.h>
+#include <llvm/Support/StringSaver.h>
+#include <llvm/Support/raw_ostream.h>
 
 namespace ct = clang::tooling;
 namespace cam = clang::ast_matchers;
 
+static llvm::cl::OptionCategory optionCategory("Tool options");
+static llvm::cl::opt<bool> clNaive("naive",
+  llvm::cl::desc("Print each type into a separate string (for comparison)"),
+  llvm::cl::cat(optionCategory), llvm::cl::init(false));
+static llvm::cl::opt<bool> clTime("time",
+  llvm::cl::desc("Report the time spent in the match callback"),
+  llvm::cl::cat(optionCategory), llvm::cl::init(false));
+
 std::vector<std::string> getPackTypeNames(const clang::TemplateArgument& arg,
   clang::PrintingPolicy pp) {
 	std::vector<std::string> names;
@@ -25,16 +40,106 @@ std::vector<std::string> getPackTypeNames(const clang::TemplateArgument& arg,
 	return names;
 }
 
-struct MyMatchCallback : public cam::MatchFinder::MatchCallback {
+// Prints template arguments, remembering the text of each canonical type
+// so that a type appearing in many tuples is only printed once.
+// The cache is keyed by the opaque pointer of the canonical type, which is
+// only meaningful within one ASTContext, so reset must be called at the
+// start of each translation unit.
+class TypeNamePrinter {
+public:
+	TypeNamePrinter() : saver_(allocator_) {}
+	void reset();
+	llvm::StringRef getName(const clang::TemplateArgument& arg,
+	  const clang::PrintingPolicy& pp);
+	unsigned long getNumHits() const {return numHits_;}
+	unsigned long getNumMisses() const {return numMisses_;}
+private:
+	llvm::BumpPtrAllocator allocator_;
+	llvm::StringSaver saver_;
+	llvm::DenseMap<void*, llvm::StringRef> cache_;
+	llvm::SmallString<256> buffer_;
+	unsigned long numHits_ = 0;
+	unsigned long numMisses_ = 0;
+};
+
+void TypeNamePrinter::reset() {
+	cache_.clear();
+	allocator_.Reset();
+}
+
+// The returned string is valid until the next call to reset (for types)
+// or to getName (for other kinds of template arguments).
+llvm::StringRef TypeNamePrinter::getName(const clang::TemplateArgument& arg,
+  const clang::PrintingPolicy& pp) {
+	buffer_.clear();
+	llvm::raw_svector_ostream outStream(buffer_);
+	if (arg.getKind() != clang::TemplateArgument::ArgKind::Type) {
+		arg.print(pp, outStream, false);
+		return buffer_.str();
+	}
+	clang::QualType type = arg.getAsType().getCanonicalType();
+	auto [iter, inserted] = cache_.try_emplace(type.getAsOpaquePtr());
+	if (inserted) {
+		type.print(outStream, pp);
+		iter->second = saver_.save(buffer_.str());
+		++numMisses_;
+	} else {
+		++numHits_;
+	}
+	return iter->second;
+}
+
+class MyMatchCallback : public cam::MatchFinder::MatchCallback {
+public:
 	void run(const cam::MatchFinder::MatchResult& result) override;
+	void onStartOfTranslationUnit() override {printer_.reset();}
+	const TypeNamePrinter& getPrinter() const {return printer_;}
+	std::chrono::nanoseconds getElapsedTime() const {return elapsed_;}
+private:
+	void runNaive(const cam::MatchFinder::MatchResult& result,
+	  const clang::ClassTemplateSpecializationDecl* tempDecl,
+	  const clang::VarDecl* varDecl, const clang::TemplateArgument& arg);
+	void runCached(const cam::MatchFinder::MatchResult& result,
+	  const clang::ClassTemplateSpecializationDecl* tempDecl,
+	  const clang::VarDecl* varDecl, const clang::TemplateArgument& arg);
+	TypeNamePrinter printer_;
+	std::chrono::nanoseconds elapsed_{0};
 };
 
+void MyMatchCallback::runNaive(const cam::MatchFinder::MatchResult& result,
+  const clang::ClassTemplateSpecializationDecl* tempDecl,
+  const clang::VarDecl* varDecl, const clang::TemplateArgument& arg) {
+	clang::PrintingPolicy pp(result.Context->getLangOpts());
+	std::vector<std::string> names = getPackTypeNames(arg, pp);
+	llvm::outs() << std::format(
+	  "variable {} of type {} with {} template arguments\n",
+	  std::string_view(varDecl->getName()),
+	  tempDecl->getQualifiedNameAsString(), arg.pack_size());
+	for (auto i : names) {llvm::outs() << std::format("    {}\n", i);}
+}
+
+void MyMatchCallback::runCached(const cam::MatchFinder::MatchResult& result,
+  const clang::ClassTemplateSpecializationDecl* tempDecl,
+  const clang::VarDecl* varDecl, const clang::TemplateArgument& arg) {
+	clang::PrintingPolicy pp(result.Context->getLangOpts());
+	llvm::raw_ostream& out = llvm::outs();
+	out << "variable " << varDecl->getName() << " of type ";
+	tempDecl->printQualifiedName(out);
+	out << " with " << arg.pack_size() << " template arguments\n";
+	for (auto packIter = arg.pack_begin(); packIter != arg.pack_end();
+	  ++packIter) {
+		out << "    " << printer_.getName(*packIter, pp) << '\n';
+	}
+}
+
 void MyMatchCallback::run(const cam::MatchFinder::MatchResult& result) {
-	const clang::SourceManager& sourceManager = *result.SourceManager;
+	llvm::TimeTraceScope timeScope("MatchCallback");
+	auto startTime = std::chrono::steady_clock::now();
 	auto tempDecl =
 	  result.Nodes.getNodeAs<clang::ClassTemplateSpecializationDecl>("c");
 	auto varDecl = result.Nodes.getNodeAs<clang::VarDecl>("v");
 	assert(tempDecl && varDecl);
+	assert(tempDecl->getQualifiedNameAsString() == "std::tuple");
 	const clang::TemplateArgumentList& args = tempDecl->getTemplateArgs();
 	if (args.size() != 1) {
 		llvm::errs() << "tuple does not have one template parameter\n";
@@ -45,14 +150,12 @@ void MyMatchCallback::run(const cam::MatchFinder::MatchResult& result) {
 		llvm::errs() << "tuple template parameter is not a pack\n";
 		return;
 	}
-	clang::PrintingPolicy pp(result.Context->getLangOpts());
-	std::vector<std::string> names = getPackTypeNames(arg, pp);
-	assert(tempDecl->getQualifiedNameAsString() == "std::tuple");
-	llvm::outs() << std::format(
-	  "variable {} of type {} with {} template arguments\n",
-	  std::string_view(varDecl->getName()),
-	  tempDecl->getQualifiedNameAsString(), arg.pack_size());
-	for (auto i : names) {llvm::outs() << std::format("    {}\n", i);}
+	if (clNaive) {
+		runNaive(result, tempDecl, varDecl, arg);
+	} else {
+		runCached(result, tempDecl, varDecl, arg);
+	}
+	elapsed_ += std::chrono::steady_clock::now() - startTime;
 }
 
 AST_MATCHER(clang::ClassTemplateSpecializationDecl, isPartialSpecialization)
@@ -68,9 +171,8 @@ cam::DeclarationMatcher getMatcher() {
 	  unless(isPartialSpecialization())).bind("c"))).bind("v");
 }
 
-static llvm::cl::OptionCategory optionCategory("Tool options");
-
 int main(int argc, const char **argv) {
+	cal::addTimeTraceOptions(optionCategory);
 	auto expectedParser = ct::CommonOptionsParser::create(argc, argv,
 	  optionCategory);
 	if (!expectedParser) {
@@ -78,11 +180,28 @@ int main(int argc, const char **argv) {
 		return 1;
 	}
 	ct::CommonOptionsParser& optionsParser = expectedParser.get();
+	cal::TimeTrace timeTrace(argv[0]);
 	ct::ClangTool tool(optionsParser.getCompilations(),
 	  optionsParser.getSourcePathList());
 	cam::DeclarationMatcher matcher = getMatcher();
 	MyMatchCallback matchCallback;
 	cam::MatchFinder matchFinder;
 	matchFinder.addMatcher(matcher, &matchCallback);
-	return !tool.run(ct::newFrontendActionFactory(&matchFinder).get()) ? 0 : 1;
+	auto factory = ct::newFrontendActionFactory(&matchFinder);
+	cal::TracedToolAction tracedAction(factory.get());
+	int status = tool.run(&tracedAction);
+	if (timeTrace.finish()) {status = 1;}
+	if (clTime) {
+		llvm::errs() << std::format(
+		  "match callback time: {:.3f} ms ({} printing)\n",
+		  std::chrono::duration<double, std::milli>(
+		  matchCallback.getElapsedTime()).count(),
+		  clNaive ? "naive" : "cached");
+		if (!clNaive) {
+			const TypeNamePrinter& printer = matchCallback.getPrinter();
+			llvm::errs() << std::format("type name cache: {} hits, {} "
+			  "misses\n", printer.getNumHits(), printer.getNumMisses());
+		}
+	}
+	return !status ? 0 : 1;
 }